@@ -30,7 +30,20 @@ data/sin1x.ps \
 data/dancingmen.ps \
 data/teamath.ps \
 data/bitfont.ps \
-data/class.ps
+data/class.ps \
+data/tokenbench.ps \
+data/loadbench.ps \
+data/opbench.ps \
+data/gcbench.ps \
+data/allocbench.ps \
+data/savebench.ps \
+data/dictbench.ps \
+data/namebench.ps \
+data/growbench.ps \
+data/pathbench.ps \
+data/gsavebench.ps \
+data/strokebench.ps \
+data/clipbench.ps
 
 psfilesdir = $(pkgdatadir)
 
@@ -65,5 +78,39 @@ data/sin1x.ps \
 data/dancingmen.ps \
 data/teamath.ps \
 data/bitfont.ps \
-data/class.ps
+data/class.ps \
+data/tokenbench.ps \
+data/loadbench.ps \
+data/opbench.ps \
+data/gcbench.ps \
+data/allocbench.ps \
+data/savebench.ps \
+data/dictbench.ps \
+data/namebench.ps \
+data/growbench.ps \
+data/pathbench.ps \
+data/gsavebench.ps \
+data/strokebench.ps \
+data/clipbench.ps
 
+
+# VM image of the interpreter state after init.ps and graphics.ps,
+# loaded with xpost --image=$(pkgdatadir)/xpost.img
+
+if XPOST_BUILD_IMAGE
+
+img_verbose = $(img_verbose_@AM_V@)
+img_verbose_ = $(img_verbose_@AM_DEFAULT_V@)
+img_verbose_0 = @echo "  IMG     " $@;
+
+data/xpost.img: src/bin/xpost$(EXEEXT) $(psfiles_DATA)
+	$(AM_V_at)$(MKDIR_P) data
+	$(AM_V_at)rm -f $@
+	$(img_verbose)XPOST_LOG_LEVEL=1 XPOST_DATA_DIR=$(abs_top_srcdir)/data $(top_builddir)/src/bin/xpost$(EXEEXT) -q -d null --save-image=$@ < /dev/null > /dev/null
+
+psimage_DATA = data/xpost.img
+psimagedir = $(pkgdatadir)
+
+XPOST_CLEANFILES += data/xpost.img
+
+endif
@@ -349,7 +349,8 @@ int main(int argc, const char *argv[])
                              ptr,
                              show_page,
                              output_msg,
-                             XPOST_IGNORE_SIZE, 0, 0)))
+                             XPOST_IGNORE_SIZE, 0, 0,
+                             0, 0)))
     {
         fprintf(stderr, "unable to create interpreter context");
         exit(0);
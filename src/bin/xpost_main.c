@@ -40,6 +40,17 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+
 #ifdef HAVE_SIGNAL_H
 # include <signal.h>
 #endif
@@ -138,6 +149,10 @@ _xpost_main_usage(const char *filename)
     printf("  -d, --device=[STRING]              device name\n");
     printf("  -Dname=token, --define name=token  add definition to userdict\n");
     printf("  -g, --geometry=WxH{+-}X{+-}Y       geometry specification\n");
+    printf("  -i, --image=[FILE]                 start from a VM image instead of init.ps\n");
+    printf("  -s, --save-image=[FILE]            save a VM image after init.ps and exit\n");
+    printf("  -b, --batch=[FILE]                 run the jobs listed in FILE, one \"input [output]\" per line\n");
+    printf("  -j, --jobs=[N]                     number of workers of the batch (default: one per processor)\n");
     printf("  -q, --quiet                        suppress interpreter messages (default)\n");
     printf("  -v, --verbose                      do not go quiet into that good night\n");
     printf("  -t, --trace                        add additional tracing messages, implies -v\n");
@@ -172,6 +187,145 @@ _xpost_atoi(char *str, int *v, char **endptr)
     return 1;
 }
 
+#define XPOST_MAIN_PATH_MAX 4096
+
+/* wall clock time in milliseconds */
+static double
+_xpost_main_time_get(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+#else
+    return time(NULL) * 1000.0;
+#endif
+}
+
+/*
+ * read the batch file: one job per line, the input file name followed
+ * by the output file name, if any, separated by blanks. Empty lines
+ * and lines starting with '#' are skipped.
+ */
+static Xpost_Batch_Job *
+_xpost_main_batch_read(const char *batch_file, int *count)
+{
+    char line[2 * XPOST_MAIN_PATH_MAX];
+    Xpost_Batch_Job *jobs = NULL;
+    FILE *f;
+    int n = 0;
+
+    f = fopen(batch_file, "r");
+    if (!f)
+    {
+        XPOST_LOG_ERR("can not open batch file %s", batch_file);
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        Xpost_Batch_Job *tmp;
+        char *input;
+        char *output;
+
+        input = strtok(line, " \t\r\n");
+        if (!input || (*input == '#'))
+            continue;
+        output = strtok(NULL, " \t\r\n");
+
+        tmp = realloc(jobs, (n + 1) * sizeof(Xpost_Batch_Job));
+        if (!tmp)
+        {
+            XPOST_LOG_ERR("can not allocate batch job");
+            break;
+        }
+        jobs = tmp;
+        memset(&jobs[n], 0, sizeof(Xpost_Batch_Job));
+        jobs[n].input_type = XPOST_INPUT_FILENAME;
+        jobs[n].inputptr = strdup(input);
+        jobs[n].output_type = output ? XPOST_OUTPUT_FILENAME : XPOST_OUTPUT_DEFAULT;
+        jobs[n].outputptr = output ? strdup(output) : NULL;
+        n++;
+    }
+    fclose(f);
+
+    *count = n;
+    return jobs;
+}
+
+/*
+ * run the jobs of the batch file and print the time of each job
+ * and the throughput of the batch.
+ */
+static int
+_xpost_main_batch(const char *batch_file,
+                  const char *device,
+                  Xpost_Output_Message output_msg,
+                  int have_geometry,
+                  int width,
+                  int height,
+                  int workers)
+{
+    Xpost_Batch_Job *jobs;
+    double total = 0.0;
+    double t0;
+    double t1;
+    int count = 0;
+    int failed = 0;
+    int ran;
+    int i;
+
+    jobs = _xpost_main_batch_read(batch_file, &count);
+    if (!jobs)
+    {
+        if (count == 0)
+            XPOST_LOG_ERR("no job in batch file %s", batch_file);
+        return 0;
+    }
+
+    if (workers <= 0)
+        workers = xpost_batch_workers_default();
+    if (workers > count)
+        workers = count;
+
+    t0 = _xpost_main_time_get();
+    ran = xpost_batch_run(device, output_msg,
+                          have_geometry ? XPOST_USE_SIZE : XPOST_IGNORE_SIZE,
+                          width, height,
+                          jobs, count, workers);
+    t1 = _xpost_main_time_get();
+
+    for (i = 0; i < count; i++)
+    {
+        if (jobs[i].worker < 0)
+        {
+            printf("%s: not run\n", (const char *)jobs[i].inputptr);
+            failed++;
+        }
+        else
+        {
+            printf("%s: %.1f ms (worker %d)%s\n",
+                   (const char *)jobs[i].inputptr, jobs[i].time, jobs[i].worker,
+                   jobs[i].status ? ", failed" : "");
+            if (jobs[i].status)
+                failed++;
+            total += jobs[i].time;
+        }
+        free((void *)jobs[i].inputptr);
+        free((void *)jobs[i].outputptr);
+    }
+    free(jobs);
+
+    if (t1 <= t0)
+        t1 = t0 + 1.0;
+    printf("%d jobs, %d workers: %.1f ms, %.2f jobs/s (%.1f ms per job)\n",
+           ran, workers, t1 - t0, ran * 1000.0 / (t1 - t0),
+           ran ? total / ran : 0.0);
+
+    return failed == 0;
+}
+
 static int
 _xpost_geometry_parse(const char *geometry, int *width, int *height, int *xoffset, int *xsign, int *yoffset, int *ysign)
 {
@@ -240,6 +394,10 @@ int main(int argc, char *argv[])
     const char *output_file = NULL;
     const char *device = NULL;
     const char *ps_file = NULL;
+    const char *image_file = NULL;
+    const char *save_image_file = NULL;
+    const char *batch_file = NULL;
+    const char *workers_str = NULL;
     const char *filename = argv[0];
     const char *define = NULL;
     char **defs = NULL;
@@ -355,6 +513,10 @@ int main(int argc, char *argv[])
             else XPOST_MAIN_IF_OPT("-o", "--output=", output_file)
             else XPOST_MAIN_IF_OPT("-d", "--device=", device)
             else XPOST_MAIN_IF_OPT("-g", "--geometry=", geometry)
+            else XPOST_MAIN_IF_OPT("-i", "--image=", image_file)
+            else XPOST_MAIN_IF_OPT("-s", "--save-image=", save_image_file)
+            else XPOST_MAIN_IF_OPT("-b", "--batch=", batch_file)
+            else XPOST_MAIN_IF_OPT("-j", "--jobs=", workers_str)
             else
             {
                 printf("unknown option\n");
@@ -417,18 +579,50 @@ int main(int argc, char *argv[])
         goto quit_xpost;
     }
 
+    xpost_image_file_set(image_file);
+
+    if (batch_file)
+    {
+        int workers = 0;
+        int done;
+
+        if (workers_str)
+        {
+            char *endptr;
+
+            if (!_xpost_atoi((char *)workers_str, &workers, &endptr) ||
+                (*endptr != '\0') || (workers <= 0))
+            {
+                XPOST_LOG_ERR("bad number of jobs");
+                goto quit_xpost;
+            }
+        }
+        done = _xpost_main_batch(batch_file, device, output_msg,
+                                 have_geometry, width, height, workers);
+        xpost_quit();
+        return done ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if (!(ctx = xpost_create(device,
                              XPOST_OUTPUT_FILENAME,
                              output_file,
                              XPOST_SHOWPAGE_DEFAULT,
                              output_msg,
                              have_geometry ? XPOST_USE_SIZE : XPOST_IGNORE_SIZE,
-                             width, height)))
+                             width, height,
+                             0, 0)))
     {
         XPOST_LOG_ERR("Failed to initialize.");
         goto quit_xpost;
     }
 
+    if (save_image_file)
+    {
+        int saved = xpost_image_save(ctx, save_image_file);
+        xpost_quit();
+        return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     XPOST_LOG_INFO("defs=%p", (void*)defs);
     if (defs){
         xpost_add_definitions(ctx, num_defs, defs);
@@ -238,7 +238,8 @@ int main(int argc, char *argv[])
                        &buffer,
                        XPOST_SHOWPAGE_RETURN,
                        output_msg,
-                       XPOST_USE_SIZE, width, height);
+                       XPOST_USE_SIZE, width, height,
+                       0, 0);
     if (!ctx)
     {
         fprintf(stderr, "Xpost failed to create interpreter context\n");
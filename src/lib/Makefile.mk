@@ -11,6 +11,8 @@ includesdir = $(pkgincludedir)-@VMAJ@
 
 src_lib_libxpost_la_SOURCES = \
 src/lib/xpost_array.c \
+src/lib/xpost_batch.c \
+src/lib/xpost_clip.c \
 src/lib/xpost_compat.c \
 src/lib/xpost_context.c \
 src/lib/xpost_dev_bgr.c \
@@ -24,6 +26,7 @@ src/lib/xpost_file.c \
 src/lib/xpost_font.c \
 src/lib/xpost_free.c \
 src/lib/xpost_garbage.c \
+src/lib/xpost_image.c \
 src/lib/xpost_interpreter.c \
 src/lib/xpost_log.c \
 src/lib/xpost_main.c \
@@ -31,16 +34,20 @@ src/lib/xpost_matrix.c \
 src/lib/xpost_memory.c \
 src/lib/xpost_name.c \
 src/lib/xpost_object.c \
+src/lib/xpost_path.c \
 src/lib/xpost_save.c \
 src/lib/xpost_stack.c \
 src/lib/xpost_string.c \
+src/lib/xpost_stroke.c \
 src/lib/xpost_op_array.c \
 src/lib/xpost_op_boolean.c \
+src/lib/xpost_op_clip.c \
 src/lib/xpost_op_context.c \
 src/lib/xpost_op_control.c \
 src/lib/xpost_op_dict.c \
 src/lib/xpost_op_file.c \
 src/lib/xpost_op_font.c \
+src/lib/xpost_op_gstate.c \
 src/lib/xpost_op_math.c \
 src/lib/xpost_op_matrix.c \
 src/lib/xpost_op_misc.c \
@@ -55,6 +62,7 @@ src/lib/xpost_op_type.c \
 src/lib/xpost_operator.c \
 src/lib/xpost_oplib.c \
 src/lib/xpost_array.h \
+src/lib/xpost_clip.h \
 src/lib/xpost_compat.h \
 src/lib/xpost_dev_bgr.h \
 src/lib/xpost_dev_generic.h \
@@ -67,20 +75,25 @@ src/lib/xpost_file.h \
 src/lib/xpost_font.h \
 src/lib/xpost_free.h \
 src/lib/xpost_garbage.h \
+src/lib/xpost_image.h \
 src/lib/xpost_log.h \
 src/lib/xpost_main.h \
 src/lib/xpost_matrix.h \
 src/lib/xpost_name.h \
+src/lib/xpost_path.h \
 src/lib/xpost_save.h \
 src/lib/xpost_stack.h \
 src/lib/xpost_string.h \
+src/lib/xpost_stroke.h \
 src/lib/xpost_op_array.h \
 src/lib/xpost_op_boolean.h \
+src/lib/xpost_op_clip.h \
 src/lib/xpost_op_context.h \
 src/lib/xpost_op_control.h \
 src/lib/xpost_op_dict.h \
 src/lib/xpost_op_file.h \
 src/lib/xpost_op_font.h \
+src/lib/xpost_op_gstate.h \
 src/lib/xpost_op_math.h \
 src/lib/xpost_op_matrix.h \
 src/lib/xpost_op_misc.h \
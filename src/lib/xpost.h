@@ -105,6 +105,22 @@ XPAPI int xpost_init(void);
  */
 XPAPI int xpost_quit(void);
 
+/**
+ * @brief Free the resources of the xpost library used by the calling
+ * thread.
+ *
+ * Contexts from separate xpost_create() calls share no state, so
+ * several threads may each create, run and destroy their own. An
+ * interpreter caches per thread the fonts it renders: a thread other
+ * than the one which called xpost_init() calls this function after it
+ * has destroyed its last context, to close them. The thread of
+ * xpost_init() has them closed by xpost_quit().
+ *
+ * @see xpost_init()
+ * @see xpost_destroy()
+ */
+XPAPI void xpost_thread_quit(void);
+
 /**
  * @brief Retrieve the version of the library.
  *
@@ -185,14 +201,19 @@ typedef enum {
  */
 typedef enum {
     XPOST_INPUT_STRING, /**< Treats inputptr as a char * to an
-                             zero-terminated ascii string, writes the
-                             whole string into a temporary file and
-                             falls through to the #XPOST_INPUT_FILEPTR
-                             case. */
+                             zero-terminated ascii string (or a
+                             buffer of the given size), wraps it
+                             without copying in a read-only memory
+                             file and schedules it to execute. The
+                             buffer must stay valid until the program
+                             has finished, including any
+                             #XPOST_INPUT_RESUME calls. */
     XPOST_INPUT_FILENAME, /**< Treats inputptr as a char * to a
                               zero-terminated OS path string, and
                               pushes the path string itself,
-                              scheduling a procedure to execute it. */
+                              scheduling a procedure to execute it.
+                              The file is mapped into memory when
+                              possible. */
     XPOST_INPUT_FILEPTR, /**< Treats inputptr as a FILE *, creates a
                                postscript file object and pushes it on
                                the execution stack (scheduling it to
@@ -233,10 +254,26 @@ typedef enum
  * @param set_size
  * @param width The height of the context page.
  * @param height The height of the context page.
+ * @param vm_size The initial size in bytes of each VM, or 0 for one page.
+ * @param vm_reserve The size in bytes of the address range reserved for
+ * each VM, or 0 for the default, 1GB on 64 bits systems and 64MB otherwise.
  *
  * This function creates a #Xpost_Context with the given
  * parameters. FIXME: give a more detailed explanation...
  *
+ * The global and local VM of the context grow geometrically from
+ * @p vm_size. Where the system allows it, they grow in place within
+ * an address range of @p vm_reserve bytes, which only takes address
+ * space until it is used, and they only move when the range is full.
+ * If @p vm_reserve is not larger than @p vm_size, no range is
+ * reserved.
+ *
+ * Each call makes a new interpreter instance, with its own memory, so
+ * several contexts may run on separate threads at the same time. A
+ * context must be used by one thread at a time, and the fonts it
+ * opens belong to that thread, so it is best kept on the thread which
+ * created it.
+ *
  * When not needed the context must be freed with xpost_destroy().
  *
  * @see xpost_destroy()
@@ -248,7 +285,51 @@ XPAPI Xpost_Context *xpost_create(const char *device,
                                   Xpost_Output_Message output_msg,
                                   Xpost_Set_Size set_size,
                                   int width,
-                                  int height);
+                                  int height,
+                                  unsigned int vm_size,
+                                  unsigned int vm_reserve);
+
+/**
+ * @brief Set the VM image used by xpost_create().
+ *
+ * @param filename The file name of the VM image, or @c NULL.
+ *
+ * This function makes the subsequent calls to xpost_create() load the
+ * VM image @p filename, written by xpost_image_save(), instead of
+ * interpreting init.ps, graphics.ps and the files they run. The image is mapped
+ * copy-on-write where possible, so that the processes which load the
+ * same image share its pages until they write them. If the image can
+ * not be used, because it is missing or was written by a different
+ * build, xpost_create() logs it and interprets init.ps as usual. The
+ * messages which init.ps prints while it loads, when not quiet, are
+ * not printed when the image is used.
+ *
+ * @p filename is not copied, it must stay valid until the last call to
+ * xpost_create(). Pass @c NULL to interpret init.ps again.
+ *
+ * @see xpost_image_save()
+ */
+XPAPI void xpost_image_file_set(const char *filename);
+
+/**
+ * @brief Save the VM of a context to a VM image.
+ *
+ * @param ctx The context, as returned by xpost_create().
+ * @param filename The file name of the VM image.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function loads the graphics files (graphics.ps and the files
+ * it runs) into @p ctx, then writes to @p filename the global and
+ * local VM of @p ctx, which must not have been run yet. The device
+ * itself is instantiated by each run. The device, output and
+ * showpage semantics given to xpost_create() are not part of the
+ * image, they are set again by each xpost_create() which loads it.
+ * The image is only valid for the build of the library which wrote
+ * it.
+ *
+ * @see xpost_image_file_set()
+ */
+XPAPI int xpost_image_save(Xpost_Context *ctx, const char *filename);
 
 /**
  * @brief Add extra definitions to userdict
@@ -272,6 +353,27 @@ XPAPI int xpost_add_definitions(Xpost_Context *ctx,
                                 int cnt,
                                 char *defs[]);
 
+/**
+ * @brief Replace the output of the given context.
+ *
+ * @param ctx The context to use.
+ * @param output_type The output type to use.
+ * @param outputptr The output, interpreted according to @p output_type.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function replaces the output given to xpost_create() for
+ * @p ctx by @p outputptr, interpreted as in xpost_create(). As the
+ * device is instantiated by each call to xpost_run(), the new output
+ * is used from the next run. It allows to reuse a context for several
+ * programs which each write their own output.
+ *
+ * @see xpost_create()
+ * @see xpost_run()
+ */
+XPAPI int xpost_output_set(Xpost_Context *ctx,
+                           Xpost_Output_Type output_type,
+                           const void *outputptr);
+
 /**
  * @brief Execute ps program.
  *
@@ -299,7 +401,8 @@ XPAPI int xpost_add_definitions(Xpost_Context *ctx,
  *
  * For a filename, push a proc to open and execute it.
  *
- * For a string, write to a temp file and fall-through to FILE * case.
+ * For a string, wrap the memory in a read-only file object, mark
+ * executable and push to exec stack. The memory is not copied.
  *
  * For a FILE *, mark executable and push to exec stack.
  *
@@ -328,13 +431,85 @@ XPAPI int xpost_run(Xpost_Context *ctx,
  * @param ctx The context to destroy.
  *
  * This function destroy the context @p ctx which has been created
- * with xpost_create(). No test is done on @p ctx, so it must be non
- * @c NULL.
+ * with xpost_create(), and frees the memory of its interpreter
+ * instance. No test is done on @p ctx, so it must be non @c NULL.
  *
  * @see xpost_create()
  */
 XPAPI void xpost_destroy(Xpost_Context *ctx);
 
+/**
+ * @typedef Xpost_Batch_Job
+ * @brief A job run by xpost_batch_run().
+ */
+typedef struct
+{
+    Xpost_Input_Type input_type; /**< The input type, as given to
+                                      xpost_run(). #XPOST_INPUT_RESUME
+                                      is not allowed. */
+    const void *inputptr; /**< The input, as given to xpost_run(). */
+    size_t size; /**< The size of the input, as given to xpost_run(). */
+    Xpost_Output_Type output_type; /**< The output type, as given to
+                                        xpost_output_set(). */
+    const void *outputptr; /**< The output, as given to
+                                xpost_output_set(). */
+    int status; /**< Set to the value returned by xpost_run(), or -1 if
+                     the job has not been run. */
+    int worker; /**< Set to the index of the worker which ran the job,
+                     or -1 if the job has not been run. */
+    double time; /**< Set to the time taken by the job, in milliseconds. */
+} Xpost_Batch_Job;
+
+/**
+ * @brief Return the default number of workers of xpost_batch_run().
+ *
+ * @return The number of processors, or 1 if it is unknown.
+ */
+XPAPI int xpost_batch_workers_default(void);
+
+/**
+ * @brief Run a batch of independent jobs on a pool of interpreters.
+ *
+ * @param device The device, as given to xpost_create().
+ * @param output_msg The messages, as given to xpost_create().
+ * @param set_size Whether to use @p width and @p height.
+ * @param width The width of the pages.
+ * @param height The height of the pages.
+ * @param jobs The array of jobs.
+ * @param count The number of elements in @p jobs.
+ * @param workers The number of workers, or 0 for
+ * xpost_batch_workers_default().
+ * @return The number of jobs which have been run.
+ *
+ * This function runs the @p count jobs of @p jobs on up to @p workers
+ * threads. Each worker creates one context with xpost_create(), with
+ * the #XPOST_SHOWPAGE_NOPAUSE semantics, then takes the next job,
+ * sets its output with xpost_output_set() and runs it with
+ * xpost_run(), until all the jobs are taken. The context stays warm
+ * between the jobs: xpost_run() restores its VM to the state it had
+ * before the job, so that only the first job of a worker pays for
+ * the initialization. If a VM image is set with
+ * xpost_image_file_set(), the workers start from it.
+ *
+ * The calling thread is one of the workers. The other workers call
+ * xpost_thread_quit() when they are done. Without thread support,
+ * all the jobs are run by the calling thread.
+ *
+ * The @c status, @c worker and @c time fields of each job are set.
+ * The jobs are taken in order, but may complete in any order.
+ *
+ * @see xpost_run()
+ * @see xpost_output_set()
+ */
+XPAPI int xpost_batch_run(const char *device,
+                          Xpost_Output_Message output_msg,
+                          Xpost_Set_Size set_size,
+                          int width,
+                          int height,
+                          Xpost_Batch_Job *jobs,
+                          int count,
+                          int workers);
+
 /**
  * @brief Set quality value for compression of JPEG files.
  *
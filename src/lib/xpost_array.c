@@ -149,7 +149,7 @@ Xpost_Object xpost_array_cons(Xpost_Context *ctx,
   Put object into array with given memory file.
   (Array must be valid for this memory file)
 
-  Copy if necessary for save/restore,
+  Save the element if necessary for save/restore,
    call memory_put.
 */
 int xpost_array_put_memory(Xpost_Memory_File *mem,
@@ -158,15 +158,15 @@ int xpost_array_put_memory(Xpost_Memory_File *mem,
                            Xpost_Object o)
 {
     int ret;
-    if (!xpost_save_ent_is_saved(mem, xpost_object_get_ent(a)))
-        if (!xpost_save_save_ent(mem, arraytype, a.comp_.sz, xpost_object_get_ent(a)))
-            return VMerror;
     if (i > a.comp_.sz)
     {
         XPOST_LOG_ERR("cannot put value in array (rangecheck) %u > [%u]", i, a.comp_.sz);
         /*breakhere((Xpost_Context *)mem);*/
         return rangecheck;
     }
+    if (!xpost_save_save_slots(mem, arraytype, a.comp_.sz, xpost_object_get_ent(a),
+                               (unsigned int)(a.comp_.off + i), 1))
+        return VMerror;
     ret = xpost_memory_put(mem, xpost_object_get_ent(a),
                            (unsigned int)(a.comp_.off + i),
                            (unsigned int)sizeof(Xpost_Object), &o);
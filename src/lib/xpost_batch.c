@@ -0,0 +1,348 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * Copyright (C) 2013-2016, Vincent Torri
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#ifdef TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# include <windows.h>
+# undef WIN32_LEAN_AND_MEAN
+#elif defined HAVE_PTHREAD_H
+# include <pthread.h>
+# include <unistd.h> /* sysconf */
+#endif
+
+#include "xpost.h"
+#include "xpost_log.h"
+
+/*============================================================================*
+ *                                  Local                                     *
+ *============================================================================*/
+
+#ifdef _WIN32
+# define XPOST_BATCH_THREADS
+typedef HANDLE Xpost_Batch_Thread;
+typedef CRITICAL_SECTION Xpost_Batch_Lock;
+# define XPOST_BATCH_LOCK_INIT(l) InitializeCriticalSection(l)
+# define XPOST_BATCH_LOCK_FREE(l) DeleteCriticalSection(l)
+# define XPOST_BATCH_LOCK(l) EnterCriticalSection(l)
+# define XPOST_BATCH_UNLOCK(l) LeaveCriticalSection(l)
+#elif defined HAVE_PTHREAD_H
+# define XPOST_BATCH_THREADS
+typedef pthread_t Xpost_Batch_Thread;
+typedef pthread_mutex_t Xpost_Batch_Lock;
+# define XPOST_BATCH_LOCK_INIT(l) pthread_mutex_init(l, NULL)
+# define XPOST_BATCH_LOCK_FREE(l) pthread_mutex_destroy(l)
+# define XPOST_BATCH_LOCK(l) pthread_mutex_lock(l)
+# define XPOST_BATCH_UNLOCK(l) pthread_mutex_unlock(l)
+#endif
+
+/* the state shared by the workers of one xpost_batch_run */
+typedef struct
+{
+    const char *device;
+    Xpost_Output_Message output_msg;
+    Xpost_Set_Size set_size;
+    int width;
+    int height;
+    Xpost_Batch_Job *jobs;
+    int count;
+    int next; /* index of the next job to take */
+#ifdef XPOST_BATCH_THREADS
+    Xpost_Batch_Lock lock;
+#endif
+} Xpost_Batch;
+
+typedef struct
+{
+    Xpost_Batch *batch;
+    int id;
+} Xpost_Batch_Worker;
+
+/* wall clock time in milliseconds */
+static double
+_xpost_batch_time_get(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1000.0 / (double)freq.QuadPart;
+#elif defined HAVE_GETTIMEOFDAY
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+#else
+    return time(NULL) * 1000.0;
+#endif
+}
+
+/* take the next job, or return NULL when there is none left */
+static Xpost_Batch_Job *
+_xpost_batch_job_take(Xpost_Batch *batch)
+{
+    Xpost_Batch_Job *job = NULL;
+
+#ifdef XPOST_BATCH_THREADS
+    XPOST_BATCH_LOCK(&batch->lock);
+#endif
+    if (batch->next < batch->count)
+        job = &batch->jobs[batch->next++];
+#ifdef XPOST_BATCH_THREADS
+    XPOST_BATCH_UNLOCK(&batch->lock);
+#endif
+
+    return job;
+}
+
+/*
+   the body of a worker: create one interpreter and run the jobs
+   on it until there is none left. xpost_run restores the VM to the
+   state it had before the job, so the next job starts from the
+   initialized interpreter without loading init.ps again.
+ */
+static void
+_xpost_batch_worker_run(Xpost_Batch_Worker *worker)
+{
+    Xpost_Batch *batch = worker->batch;
+    Xpost_Batch_Job *job;
+    Xpost_Context *ctx;
+    char batch_def[] = "BATCH";
+    char *defs[1];
+    double t0;
+
+    ctx = xpost_create(batch->device,
+                       XPOST_OUTPUT_DEFAULT, NULL,
+                       XPOST_SHOWPAGE_NOPAUSE,
+                       batch->output_msg,
+                       batch->set_size, batch->width, batch->height,
+                       0, 0);
+    if (!ctx)
+    {
+        XPOST_LOG_ERR("worker %d: failed to create the interpreter", worker->id);
+        return;
+    }
+    /* no executive after the job */
+    defs[0] = batch_def;
+    xpost_add_definitions(ctx, 1, defs);
+
+    while ((job = _xpost_batch_job_take(batch)))
+    {
+        if (job->input_type == XPOST_INPUT_RESUME)
+        {
+            XPOST_LOG_ERR("worker %d: can not resume a batch job", worker->id);
+            continue;
+        }
+
+        t0 = _xpost_batch_time_get();
+        xpost_output_set(ctx, job->output_type, job->outputptr);
+        job->status = xpost_run(ctx, job->input_type, job->inputptr, job->size);
+        job->time = _xpost_batch_time_get() - t0;
+        job->worker = worker->id;
+        XPOST_LOG_INFO("worker %d: job %d done in %g ms",
+                       worker->id, (int)(job - batch->jobs), job->time);
+    }
+    xpost_destroy(ctx);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+_xpost_batch_thread(LPVOID data)
+{
+    _xpost_batch_worker_run(data);
+    xpost_thread_quit();
+    return 0;
+}
+#elif defined HAVE_PTHREAD_H
+static void *
+_xpost_batch_thread(void *data)
+{
+    _xpost_batch_worker_run(data);
+    xpost_thread_quit();
+    return NULL;
+}
+#endif
+
+/*============================================================================*
+ *                                   API                                      *
+ *============================================================================*/
+
+XPAPI int
+xpost_batch_workers_default(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#elif defined HAVE_PTHREAD_H && defined _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n > 0) ? (int)n : 1;
+#else
+    return 1;
+#endif
+}
+
+XPAPI int
+xpost_batch_run(const char *device,
+                Xpost_Output_Message output_msg,
+                Xpost_Set_Size set_size,
+                int width,
+                int height,
+                Xpost_Batch_Job *jobs,
+                int count,
+                int workers)
+{
+    Xpost_Batch batch;
+    Xpost_Batch_Worker *pool;
+    int i;
+    int n;
+#ifdef XPOST_BATCH_THREADS
+    Xpost_Batch_Thread *threads;
+    int started;
+#endif
+
+    if (!jobs || (count <= 0))
+        return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        jobs[i].status = -1;
+        jobs[i].worker = -1;
+        jobs[i].time = 0.0;
+    }
+
+    if (workers <= 0)
+        workers = xpost_batch_workers_default();
+    if (workers > count)
+        workers = count;
+#ifndef XPOST_BATCH_THREADS
+    workers = 1;
+#endif
+
+    batch.device = device;
+    batch.output_msg = output_msg;
+    batch.set_size = set_size;
+    batch.width = width;
+    batch.height = height;
+    batch.jobs = jobs;
+    batch.count = count;
+    batch.next = 0;
+
+    pool = malloc(workers * sizeof(Xpost_Batch_Worker));
+    if (!pool)
+    {
+        XPOST_LOG_ERR("failed to allocate the workers");
+        return 0;
+    }
+    for (i = 0; i < workers; i++)
+    {
+        pool[i].batch = &batch;
+        pool[i].id = i;
+    }
+
+#ifdef XPOST_BATCH_THREADS
+    /* the calling thread is the first worker, the fonts it opens are
+       kept for the contexts it may have */
+    threads = malloc(workers * sizeof(Xpost_Batch_Thread));
+    if (!threads)
+    {
+        XPOST_LOG_ERR("failed to allocate the threads");
+        free(pool);
+        return 0;
+    }
+    XPOST_BATCH_LOCK_INIT(&batch.lock);
+
+    for (started = 1; started < workers; started++)
+    {
+# ifdef _WIN32
+        threads[started] = CreateThread(NULL, 0, _xpost_batch_thread,
+                                        &pool[started], 0, NULL);
+        if (!threads[started])
+            break;
+# else
+        if (pthread_create(&threads[started], NULL,
+                           _xpost_batch_thread, &pool[started]) != 0)
+            break;
+# endif
+    }
+    if (started < workers)
+        XPOST_LOG_WARN("only %d workers out of %d started", started, workers);
+
+    _xpost_batch_worker_run(&pool[0]);
+
+    for (i = 1; i < started; i++)
+    {
+# ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+# else
+        pthread_join(threads[i], NULL);
+# endif
+    }
+
+    XPOST_BATCH_LOCK_FREE(&batch.lock);
+    free(threads);
+#else
+    _xpost_batch_worker_run(&pool[0]);
+#endif
+
+    free(pool);
+
+    n = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (jobs[i].worker >= 0)
+            n++;
+    }
+
+    return n;
+}
@@ -0,0 +1,1011 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdlib.h>
+#else
+# ifdef HAVE_STDLIB_H
+#  include <stdlib.h>
+# endif
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "xpost.h"
+#include "xpost_log.h"
+#include "xpost_memory.h"  // regions live in mfile
+#include "xpost_object.h"  // regions are string objects
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_error.h"
+#include "xpost_path.h"
+
+#include "xpost_clip.h"
+
+/* the recursion limit of the flattening of a curve, which bounds
+   the number of its lines by 2^XPOST_CLIP_MAX_DEPTH */
+#define XPOST_CLIP_MAX_DEPTH 16
+
+/* the bound of the rounded coordinates, so that they fit an int */
+#define XPOST_CLIP_LIMIT 16777216.0
+
+/*
+   The header of a region. The bands follow it, each one as the ints
+   y0 and y1 of its rows, y1 excluded, and the number n of its spans,
+   followed by the ints x0 and x1 of the n spans, x1 excluded, by
+   increasing x. The bands are by increasing y, do not overlap, and
+   two consecutive bands have different spans or are not adjacent.
+ */
+typedef struct
+{
+    int nbands;
+    int x0, y0, x1, y1; /* the bounding box, x1 and y1 excluded */
+    unsigned int size;  /* the size of the bands in bytes */
+} _Header;
+
+/* the size of the bands of a rectangle */
+#define XPOST_CLIP_RECT_SIZE (5 * sizeof(int))
+
+/* a region loaded for a scan */
+typedef struct
+{
+    int clipped;      /* 0 for the unclipped region */
+    _Header h;
+    int *bands;       /* the bands, NULL for a rectangle */
+    int rect[2];      /* the span of the rows of a rectangle */
+    const int *band;  /* the band of the last row asked */
+    const int *end;
+} _Region;
+
+/* an edge of a path, between two rounded points */
+typedef struct
+{
+    real x;     /* x at the top point */
+    real y;     /* y of the top point */
+    real dxdy;  /* the slope */
+    int top;    /* the first row crossed */
+    int bottom; /* the last row crossed, excluded */
+    int dir;    /* 1 going down, -1 going up */
+} _Edge;
+
+/* the edges of a path, and the state of their construction */
+typedef struct
+{
+    _Edge *e;
+    int n;
+    int max;
+    real x, y;   /* the current point, rounded */
+    real sx, sy; /* the start of the subpath, rounded */
+    int open;    /* a subpath is started */
+} _Edges;
+
+/* a crossing of a row by an edge */
+typedef struct
+{
+    real x;
+    int dir;
+} _Cross;
+
+/* the function receiving the n spans of the row y */
+typedef int (*_Row_Func)(void *data, int y, const int *spans, int n);
+
+/* a growable array of ints */
+typedef struct
+{
+    int *v;
+    int n;
+    int max;
+} _Ints;
+
+static
+int _grow(_Ints *a, int n)
+{
+    if (a->n + n > a->max)
+    {
+        int *tmp;
+        int max;
+
+        max = a->max ? 2 * a->max : 64;
+        while (max < a->n + n)
+            max *= 2;
+        tmp = realloc(a->v, max * sizeof *tmp);
+        if (!tmp)
+            return VMerror;
+        a->v = tmp;
+        a->max = max;
+    }
+    return 0;
+}
+
+/* load a region, copying its bands unless it is a rectangle */
+static
+int _load(Xpost_Context *ctx, Xpost_Object region, _Region *r)
+{
+    Xpost_Memory_File *mem;
+    unsigned int adr, sz;
+
+    r->bands = NULL;
+    r->clipped = xpost_object_get_type(region) == stringtype;
+    if (!r->clipped)
+        return 0;
+
+    mem = xpost_context_select_memory(ctx, region);
+    if (!xpost_memory_table_get_addr(mem, xpost_object_get_ent(region), &adr) ||
+        !xpost_memory_table_get_size(mem, xpost_object_get_ent(region), &sz) ||
+        sz < sizeof r->h)
+    {
+        XPOST_LOG_ERR("cannot load clip region");
+        return VMerror;
+    }
+    memcpy(&r->h, mem->base + adr, sizeof r->h);
+    if (r->h.size > sz - sizeof r->h)
+        return VMerror;
+
+    if (r->h.nbands == 1 && r->h.size == XPOST_CLIP_RECT_SIZE)
+    {
+        r->rect[0] = r->h.x0;
+        r->rect[1] = r->h.x1;
+    }
+    else if (r->h.nbands)
+    {
+        r->bands = malloc(r->h.size);
+        if (!r->bands)
+            return VMerror;
+        memcpy(r->bands, mem->base + adr + sizeof r->h, r->h.size);
+    }
+    r->band = r->end = r->bands;
+    if (r->bands)
+        r->end += r->h.size / sizeof(int);
+    return 0;
+}
+
+/* the spans of the row y of a loaded region, for increasing y */
+static
+const int *_row(_Region *r, int y, int *n)
+{
+    *n = 0;
+    if (y < r->h.y0 || y >= r->h.y1)
+        return NULL;
+    if (!r->bands)
+    {
+        *n = 1;
+        return r->rect;
+    }
+    while (r->band < r->end && r->band[1] <= y)
+        r->band += 3 + 2 * r->band[2];
+    if (r->band == r->end || r->band[0] > y)
+        return NULL;
+    *n = r->band[2];
+    return r->band + 3;
+}
+
+/* round a coordinate to a whole pixel */
+static
+real _round(real v)
+{
+    v = (real)floor(v + 0.5);
+    if (v < -XPOST_CLIP_LIMIT)
+        return (real)-XPOST_CLIP_LIMIT;
+    if (v > XPOST_CLIP_LIMIT)
+        return (real)XPOST_CLIP_LIMIT;
+    return v;
+}
+
+/* append the edge between two rounded points, unless it is horizontal */
+static
+int _edge(_Edges *edges, real xa, real ya, real xb, real yb)
+{
+    _Edge *e;
+    int dir = 1;
+
+    if (ya == yb)
+        return 0;
+    if (ya > yb)
+    {
+        real t;
+
+        t = xa; xa = xb; xb = t;
+        t = ya; ya = yb; yb = t;
+        dir = -1;
+    }
+    if (edges->n == edges->max)
+    {
+        _Edge *tmp;
+        int max;
+
+        max = edges->max ? 2 * edges->max : 64;
+        tmp = realloc(edges->e, max * sizeof *tmp);
+        if (!tmp)
+            return VMerror;
+        edges->e = tmp;
+        edges->max = max;
+    }
+    e = edges->e + edges->n++;
+    e->x = xa;
+    e->y = ya;
+    e->dxdy = (xb - xa) / (yb - ya);
+    e->top = (int)ya;
+    e->bottom = (int)yb;
+    e->dir = dir;
+    return 0;
+}
+
+/* append the edge from the current point to the point x, y */
+static
+int _lineto(_Edges *edges, real x, real y)
+{
+    int ret;
+
+    x = _round(x);
+    y = _round(y);
+    ret = _edge(edges, edges->x, edges->y, x, y);
+    edges->x = x;
+    edges->y = y;
+    return ret;
+}
+
+/* close the current subpath */
+static
+int _close(_Edges *edges)
+{
+    int ret = 0;
+
+    if (edges->open)
+        ret = _edge(edges, edges->x, edges->y, edges->sx, edges->sy);
+    edges->open = 0;
+    return ret;
+}
+
+/* append the lines of a curve, flattened like flattenpath does */
+static
+int _curve(_Edges *edges,
+           real x0, real y0,
+           real x1, real y1,
+           real x2, real y2,
+           real x3, real y3,
+           real flat,
+           int depth)
+{
+    real x01, y01, x12, y12, x23, y23;
+    real x012, y012, x123, y123;
+    real x0123, y0123;
+    real dx, dy;
+    int ret;
+
+    x01 = (x0 + x1) / 2; y01 = (y0 + y1) / 2;
+    x12 = (x1 + x2) / 2; y12 = (y1 + y2) / 2;
+    x23 = (x2 + x3) / 2; y23 = (y2 + y3) / 2;
+    x012 = (x01 + x12) / 2; y012 = (y01 + y12) / 2;
+    x123 = (x12 + x23) / 2; y123 = (y12 + y23) / 2;
+    x0123 = (x012 + x123) / 2; y0123 = (y012 + y123) / 2;
+
+    dx = x0123 - (x0 + x3) / 2;
+    dy = y0123 - (y0 + y3) / 2;
+    if (depth == XPOST_CLIP_MAX_DEPTH || sqrt(dx * dx + dy * dy) < flat)
+        return _lineto(edges, x3, y3);
+
+    ret = _curve(edges, x0, y0, x01, y01, x012, y012, x0123, y0123,
+                 flat, depth + 1);
+    if (ret)
+        return ret;
+    return _curve(edges, x0123, y0123, x123, y123, x23, y23, x3, y3,
+                  flat, depth + 1);
+}
+
+/* collect the edges of a path, each subpath closed */
+static
+int _edges(Xpost_Context *ctx, Xpost_Object path, real flat, _Edges *edges)
+{
+    Xpost_Path_Verb verb;
+    float pts[6];
+    real x = 0, y = 0; /* the current point, not rounded */
+    unsigned int off, end;
+    int ret;
+
+    edges->e = NULL;
+    edges->n = edges->max = 0;
+    edges->open = 0;
+    end = xpost_path_length(ctx, path);
+    for (off = 0; off < end; )
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            return ret;
+        switch (verb)
+        {
+            case XPOST_PATH_MOVE:
+                ret = _close(edges);
+                edges->x = edges->sx = _round(pts[0]);
+                edges->y = edges->sy = _round(pts[1]);
+                edges->open = 1;
+                break;
+            case XPOST_PATH_LINE:
+                ret = _lineto(edges, pts[0], pts[1]);
+                break;
+            case XPOST_PATH_CURVE:
+                ret = _curve(edges, x, y, pts[0], pts[1], pts[2], pts[3],
+                             pts[4], pts[5], flat, 0);
+                break;
+            case XPOST_PATH_CLOSE:
+                ret = _close(edges);
+                edges->x = edges->sx;
+                edges->y = edges->sy;
+                edges->open = 1;
+                break;
+        }
+        if (ret)
+            return ret;
+        x = pts[2 * XPOST_PATH_POINTS(verb) - 2];
+        y = pts[2 * XPOST_PATH_POINTS(verb) - 1];
+    }
+    return _close(edges);
+}
+
+static
+int _edgecmp(const void *a, const void *b)
+{
+    return ((const _Edge *)a)->top - ((const _Edge *)b)->top;
+}
+
+static
+int _crosscmp(const void *a, const void *b)
+{
+    real xa = ((const _Cross *)a)->x;
+    real xb = ((const _Cross *)b)->x;
+
+    return (xa > xb) - (xa < xb);
+}
+
+/* intersect the n sorted spans a with the m sorted spans b into out */
+static
+int _intersect(const int *a, int n, const int *b, int m, _Ints *out)
+{
+    int i = 0, j = 0;
+    int ret;
+
+    out->n = 0;
+    ret = _grow(out, 2 * (n + m));
+    if (ret)
+        return ret;
+    while (i < n && j < m)
+    {
+        int x0, x1;
+
+        x0 = a[2 * i] > b[2 * j] ? a[2 * i] : b[2 * j];
+        x1 = a[2 * i + 1] < b[2 * j + 1] ? a[2 * i + 1] : b[2 * j + 1];
+        if (x0 < x1)
+        {
+            out->v[out->n++] = x0;
+            out->v[out->n++] = x1;
+        }
+        if (a[2 * i + 1] < b[2 * j + 1])
+            i++;
+        else
+            j++;
+    }
+    return 0;
+}
+
+/* scan convert the edges of a path within a region, passing the
+   spans of each row which has some to func */
+static
+int _scan(_Edges *edges,
+          Xpost_Clip_Rule rule,
+          _Region *clip,
+          _Row_Func func,
+          void *data)
+{
+    _Edge *e = edges->e;
+    int *active = NULL;
+    _Cross *cross = NULL;
+    _Ints spans = { NULL, 0, 0 };
+    _Ints out = { NULL, 0, 0 };
+    int nactive = 0;
+    int next = 0;
+    int ymin, ymax;
+    int y, i;
+    int ret = 0;
+
+    if (!edges->n || (clip->clipped && !clip->h.nbands))
+        return 0;
+
+    qsort(e, edges->n, sizeof *e, _edgecmp);
+    ymin = e[0].top;
+    ymax = e[0].bottom;
+    for (i = 1; i < edges->n; i++)
+        if (e[i].bottom > ymax)
+            ymax = e[i].bottom;
+    if (clip->clipped)
+    {
+        if (ymin < clip->h.y0)
+            ymin = clip->h.y0;
+        if (ymax > clip->h.y1)
+            ymax = clip->h.y1;
+    }
+
+    active = malloc(edges->n * sizeof *active);
+    cross = malloc(edges->n * sizeof *cross);
+    if (!active || !cross || (ret = _grow(&spans, edges->n + 2)))
+    {
+        ret = VMerror;
+        goto done;
+    }
+
+    for (y = ymin; y < ymax; y++)
+    {
+        const int *row;
+        int n, wind, inside;
+        real yc, xa = 0;
+
+        /* update the edges crossing the row */
+        while (next < edges->n && e[next].top <= y)
+        {
+            if (e[next].bottom > y)
+                active[nactive++] = next;
+            next++;
+        }
+        for (i = n = 0; i < nactive; i++)
+            if (e[active[i]].bottom > y)
+                active[n++] = active[i];
+        nactive = n;
+        if (!nactive)
+        {
+            if (next == edges->n)
+                break;
+            if (e[next].top > y + 1)
+                y = e[next].top - 1;
+            continue;
+        }
+
+        /* the crossings of the center of the row, by increasing x */
+        yc = (real)y + 0.5f;
+        for (i = 0; i < nactive; i++)
+        {
+            const _Edge *a = e + active[i];
+
+            cross[i].x = a->x + (yc - a->y) * a->dxdy;
+            cross[i].dir = a->dir;
+        }
+        if (nactive > 16)
+            qsort(cross, nactive, sizeof *cross, _crosscmp);
+        else
+        {
+            for (i = 1; i < nactive; i++)
+            {
+                _Cross c = cross[i];
+                int j;
+
+                for (j = i; j > 0 && cross[j - 1].x > c.x; j--)
+                    cross[j] = cross[j - 1];
+                cross[j] = c;
+            }
+        }
+
+        /* the spans inside the path, merging the ones which touch */
+        spans.n = 0;
+        wind = 0;
+        for (i = 0; i < nactive; i++)
+        {
+            inside = wind != 0;
+            if (rule == XPOST_CLIP_EVENODD)
+                wind ^= 1;
+            else
+                wind += cross[i].dir;
+            if (!inside && wind)
+                xa = cross[i].x;
+            else if (inside && !wind)
+            {
+                int x0 = (int)floor(xa);
+                int x1 = (int)floor(cross[i].x);
+
+                if (x0 >= x1)
+                    continue;
+                if (spans.n && x0 <= spans.v[spans.n - 1])
+                {
+                    if (x1 > spans.v[spans.n - 1])
+                        spans.v[spans.n - 1] = x1;
+                }
+                else
+                {
+                    spans.v[spans.n++] = x0;
+                    spans.v[spans.n++] = x1;
+                }
+            }
+        }
+        if (!spans.n)
+            continue;
+
+        if (!clip->clipped)
+            ret = func(data, y, spans.v, spans.n / 2);
+        else
+        {
+            row = _row(clip, y, &n);
+            if (!n)
+                continue;
+            ret = _intersect(spans.v, spans.n / 2, row, n, &out);
+            if (!ret && out.n)
+                ret = func(data, y, out.v, out.n / 2);
+        }
+        if (ret)
+            break;
+    }
+
+done:
+    free(active);
+    free(cross);
+    free(spans.v);
+    free(out.v);
+    return ret;
+}
+
+typedef struct
+{
+    Xpost_Clip_Span_Func func;
+    void *data;
+} _Spans;
+
+static
+int _spans(void *data, int y, const int *spans, int n)
+{
+    _Spans *s = data;
+    int i;
+    int ret;
+
+    for (i = 0; i < n; i++)
+    {
+        ret = s->func(s->data, y, spans[2 * i], spans[2 * i + 1]);
+        if (ret)
+            return ret;
+    }
+    return 0;
+}
+
+int xpost_clip_spans(Xpost_Context *ctx,
+                     Xpost_Object path,
+                     Xpost_Clip_Rule rule,
+                     real flat,
+                     Xpost_Object region,
+                     Xpost_Clip_Span_Func func,
+                     void *data)
+{
+    _Region r;
+    _Edges edges;
+    _Spans s;
+    int ret;
+
+    ret = _load(ctx, region, &r);
+    if (ret)
+        return ret;
+    ret = _edges(ctx, path, flat, &edges);
+    if (!ret)
+    {
+        s.func = func;
+        s.data = data;
+        ret = _scan(&edges, rule, &r, _spans, &s);
+    }
+    free(edges.e);
+    free(r.bands);
+    return ret;
+}
+
+/* the construction of the bands of a region */
+typedef struct
+{
+    _Header h;
+    _Ints bands;
+    int last; /* the index of the last band */
+} _Bands;
+
+/* append a row to the last band if it continues it, or to a new band */
+static
+int _band(void *data, int y, const int *spans, int n)
+{
+    _Bands *b = data;
+    int *last;
+    int ret;
+
+    last = b->bands.v + b->last;
+    if (b->h.nbands && last[1] == y && last[2] == n &&
+        !memcmp(last + 3, spans, 2 * n * sizeof *spans))
+    {
+        last[1] = y + 1;
+        b->h.y1 = y + 1;
+        return 0;
+    }
+
+    ret = _grow(&b->bands, 3 + 2 * n);
+    if (ret)
+        return ret;
+    b->last = b->bands.n;
+    last = b->bands.v + b->last;
+    last[0] = y;
+    last[1] = y + 1;
+    last[2] = n;
+    memcpy(last + 3, spans, 2 * n * sizeof *spans);
+    b->bands.n += 3 + 2 * n;
+
+    if (!b->h.nbands++)
+    {
+        b->h.y0 = y;
+        b->h.x0 = spans[0];
+        b->h.x1 = spans[2 * n - 1];
+    }
+    if (spans[0] < b->h.x0)
+        b->h.x0 = spans[0];
+    if (spans[2 * n - 1] > b->h.x1)
+        b->h.x1 = spans[2 * n - 1];
+    b->h.y1 = y + 1;
+    return 0;
+}
+
+int xpost_clip_intersect(Xpost_Context *ctx,
+                         Xpost_Object region,
+                         Xpost_Object path,
+                         Xpost_Clip_Rule rule,
+                         real flat,
+                         Xpost_Object *result)
+{
+    Xpost_Memory_File *mem;
+    unsigned int ent, adr;
+    _Region r;
+    _Edges edges;
+    _Bands b;
+    int ret;
+
+    ret = _load(ctx, region, &r);
+    if (ret)
+        return ret;
+    memset(&b, 0, sizeof b);
+    ret = _edges(ctx, path, flat, &edges);
+    if (!ret)
+        ret = _scan(&edges, rule, &r, _band, &b);
+    free(edges.e);
+    free(r.bands);
+    if (ret)
+        goto done;
+
+    b.h.size = b.bands.n * sizeof(int);
+    mem = (ctx->vmmode == GLOBAL) ? ctx->gl : ctx->lo;
+    if (!xpost_memory_table_alloc(mem, sizeof b.h + b.h.size, stringtype, &ent) ||
+        !xpost_memory_table_get_addr(mem, ent, &adr))
+    {
+        XPOST_LOG_ERR("cannot allocate clip region");
+        ret = VMerror;
+        goto done;
+    }
+    memcpy(mem->base + adr, &b.h, sizeof b.h);
+    if (b.h.size)
+        memcpy(mem->base + adr + sizeof b.h, b.bands.v, b.h.size);
+
+    /* literal, no access: the contents are not chars */
+    result->tag = stringtype | XPOST_OBJECT_TAG_DATA_FLAG_LIT;
+    if (ctx->vmmode == GLOBAL)
+        result->tag |= XPOST_OBJECT_TAG_DATA_FLAG_BANK;
+    result->comp_.sz = 0;
+    *result = xpost_object_set_ent(*result, ent);
+    result->comp_.off = 0;
+    xpost_stack_push(ctx->lo, ctx->hold, *result); /* in case of gc in caller */
+
+done:
+    free(b.bands.v);
+    return ret;
+}
+
+int xpost_clip_path(Xpost_Context *ctx,
+                    Xpost_Object region,
+                    Xpost_Object *path)
+{
+    _Region r;
+    const int *band;
+    int i;
+    int ret;
+
+    *path = null;
+    ret = _load(ctx, region, &r);
+    if (ret || !r.clipped)
+        return ret;
+
+    for (band = r.bands; r.h.nbands && !ret; )
+    {
+        const int *spans;
+        int y0, y1, n;
+
+        if (band)
+        {
+            y0 = band[0];
+            y1 = band[1];
+            n = band[2];
+            spans = band + 3;
+        }
+        else
+        {
+            y0 = r.h.y0;
+            y1 = r.h.y1;
+            n = 1;
+            spans = r.rect;
+        }
+        for (i = 0; i < n && !ret; i++)
+        {
+            float pts[2];
+
+            pts[0] = (float)spans[2 * i];
+            pts[1] = (float)y0;
+            ret = xpost_path_append(ctx, path, XPOST_PATH_MOVE, pts);
+            pts[0] = (float)spans[2 * i + 1];
+            if (!ret)
+                ret = xpost_path_append(ctx, path, XPOST_PATH_LINE, pts);
+            pts[1] = (float)y1;
+            if (!ret)
+                ret = xpost_path_append(ctx, path, XPOST_PATH_LINE, pts);
+            pts[0] = (float)spans[2 * i];
+            if (!ret)
+                ret = xpost_path_append(ctx, path, XPOST_PATH_LINE, pts);
+            if (!ret)
+                ret = xpost_path_append(ctx, path, XPOST_PATH_CLOSE, pts);
+        }
+        if (!band)
+            break;
+        band += 3 + 2 * n;
+        if (band == r.end)
+            break;
+    }
+
+    free(r.bands);
+    return ret;
+}
+
+int xpost_clip_contains(Xpost_Context *ctx,
+                        Xpost_Object region,
+                        Xpost_Object path,
+                        int *contains)
+{
+    _Region r;
+    Xpost_Path_Verb verb;
+    float pts[6];
+    unsigned int off, end;
+    int i;
+    int ret;
+
+    *contains = 1;
+    ret = _load(ctx, region, &r);
+    if (ret || !r.clipped)
+        return ret;
+
+    /* only a rectangle is tested, any other region is taken as
+       cutting the path */
+    *contains = 0;
+    if (r.bands || !r.h.nbands)
+    {
+        free(r.bands);
+        return 0;
+    }
+
+    end = xpost_path_length(ctx, path);
+    for (off = 0; off < end; )
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            return ret;
+        for (i = 0; i < XPOST_PATH_POINTS(verb); i++)
+        {
+            real x = _round(pts[2 * i]);
+            real y = _round(pts[2 * i + 1]);
+
+            if (x < r.h.x0 || x > r.h.x1 || y < r.h.y0 || y > r.h.y1)
+                return 0;
+        }
+    }
+    *contains = 1;
+    return 0;
+}
+
+/* the part of the segment a b in the rectangle x0 y0 x1 y1,
+   with the parametric clip of Liang and Barsky */
+static
+int _cliprect(const real *a, const real *b,
+              real x0, real y0, real x1, real y1,
+              real *p, real *q)
+{
+    real d[2];
+    real t0 = 0, t1 = 1;
+    real lo[2], hi[2];
+    int i;
+
+    d[0] = b[0] - a[0];
+    d[1] = b[1] - a[1];
+    lo[0] = x0; lo[1] = y0;
+    hi[0] = x1; hi[1] = y1;
+    for (i = 0; i < 2; i++)
+    {
+        if (d[i] == 0)
+        {
+            if (a[i] < lo[i] || a[i] > hi[i])
+                return 0;
+            continue;
+        }
+        else
+        {
+            real ta = (lo[i] - a[i]) / d[i];
+            real tb = (hi[i] - a[i]) / d[i];
+
+            if (ta > tb)
+            {
+                real t = ta;
+
+                ta = tb;
+                tb = t;
+            }
+            if (ta > t0)
+                t0 = ta;
+            if (tb < t1)
+                t1 = tb;
+            if (t0 > t1)
+                return 0;
+        }
+    }
+
+    /* the points of a segment which is not cut are kept as they are */
+    p[0] = t0 > 0 ? a[0] + t0 * d[0] : a[0];
+    p[1] = t0 > 0 ? a[1] + t0 * d[1] : a[1];
+    q[0] = t1 < 1 ? a[0] + t1 * d[0] : b[0];
+    q[1] = t1 < 1 ? a[1] + t1 * d[1] : b[1];
+    return 1;
+}
+
+/* the state of the clip of lines */
+typedef struct
+{
+    Xpost_Context *ctx;
+    _Region *r;
+    Xpost_Object *out;
+    float last[2]; /* the end of the last piece */
+    int any;       /* a piece was appended */
+} _Lines;
+
+/* append the parts of the segment a b inside the region */
+static
+int _clipline(_Lines *l, const real *a, const real *b)
+{
+    const _Region *r = l->r;
+    const int *band;
+    real ylo, yhi;
+    int ret;
+
+    ylo = a[1] < b[1] ? a[1] : b[1];
+    yhi = a[1] < b[1] ? b[1] : a[1];
+    if (yhi < r->h.y0 || ylo > r->h.y1)
+        return 0;
+
+    for (band = r->bands; ; )
+    {
+        const int *spans;
+        int y0, y1, n, i;
+
+        if (band)
+        {
+            y0 = band[0];
+            y1 = band[1];
+            n = band[2];
+            spans = band + 3;
+        }
+        else
+        {
+            y0 = r->h.y0;
+            y1 = r->h.y1;
+            n = 1;
+            spans = r->rect;
+        }
+        if (y0 > yhi)
+            break;
+        for (i = 0; y1 >= ylo && i < n; i++)
+        {
+            real p[2], q[2];
+            float pts[2];
+
+            if (!_cliprect(a, b, (real)spans[2 * i], (real)y0,
+                           (real)spans[2 * i + 1], (real)y1, p, q))
+                continue;
+            pts[0] = (float)p[0];
+            pts[1] = (float)p[1];
+            if (!l->any || pts[0] != l->last[0] || pts[1] != l->last[1])
+            {
+                ret = xpost_path_append(l->ctx, l->out, XPOST_PATH_MOVE, pts);
+                if (ret)
+                    return ret;
+            }
+            pts[0] = l->last[0] = (float)q[0];
+            pts[1] = l->last[1] = (float)q[1];
+            ret = xpost_path_append(l->ctx, l->out, XPOST_PATH_LINE, pts);
+            if (ret)
+                return ret;
+            l->any = 1;
+        }
+        if (!band)
+            break;
+        band += 3 + 2 * n;
+        if (band == r->end)
+            break;
+    }
+    return 0;
+}
+
+int xpost_clip_lines(Xpost_Context *ctx,
+                     Xpost_Object path,
+                     Xpost_Object region,
+                     Xpost_Object *result)
+{
+    _Region r;
+    _Lines l;
+    Xpost_Path_Verb verb;
+    float pts[6];
+    real a[2] = { 0, 0 }, b[2];
+    unsigned int off, end;
+    int ret;
+
+    if (xpost_object_get_type(region) != stringtype)
+    {
+        *result = path;
+        return 0;
+    }
+    *result = null;
+    ret = _load(ctx, region, &r);
+    if (ret || !r.h.nbands)
+        return ret;
+
+    l.ctx = ctx;
+    l.r = &r;
+    l.out = result;
+    l.any = 0;
+    end = xpost_path_length(ctx, path);
+    for (off = 0; off < end; )
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            break;
+        b[0] = pts[2 * XPOST_PATH_POINTS(verb) - 2];
+        b[1] = pts[2 * XPOST_PATH_POINTS(verb) - 1];
+        if (verb != XPOST_PATH_MOVE)
+        {
+            ret = _clipline(&l, a, b);
+            if (ret)
+                break;
+        }
+        a[0] = b[0];
+        a[1] = b[1];
+    }
+
+    free(r.bands);
+    return ret;
+}
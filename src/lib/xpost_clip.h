@@ -0,0 +1,177 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XPOST_CLIP_H
+#define XPOST_CLIP_H
+
+/**
+ * @file xpost_clip.h
+ * @brief clip region functions
+ *
+ * A clip region is a set of device pixels, held like a path (see
+ * xpost_path.h) in an opaque string object: its allocation holds a
+ * header with the bounding box of the region, followed by bands of
+ * consecutive rows which have the same spans of pixels. The null
+ * object is the unclipped region, the empty region has no band, and
+ * a region is never changed once made, so it can be referenced from
+ * several places, like the saved graphics states, without copy.
+ *
+ * A path is scan converted at the centers of the rows: its points
+ * are rounded to whole pixels, and the row y holds the pixels from
+ * floor(xa) to floor(xb), excluded, for each interval [xa, xb] of
+ * the line y + 0.5 inside the path, with the nonzero or the even-odd
+ * rule. Each subpath is implicitly closed and a curve is flattened.
+ *
+ * A region made of a single rectangle, like the page or the clip of
+ * rectclip, is the common case: it is used as a scissor, clamping
+ * the spans to its bounding box, without going through the bands.
+ *
+ * @{
+ */
+
+/**
+ * @typedef Xpost_Clip_Rule
+ * @brief the rule which tells the inside of a path.
+ */
+typedef enum
+{
+    XPOST_CLIP_NONZERO,
+    XPOST_CLIP_EVENODD
+} Xpost_Clip_Rule;
+
+/**
+ * @typedef Xpost_Clip_Span_Func
+ * @brief the function receiving the spans of a fill.
+ *
+ * It is called with the pixels from @p x0 to @p x1, excluded, of
+ * the row @p y, and returns 0 or a postscript error code.
+ */
+typedef int (*Xpost_Clip_Span_Func)(void *data, int y, int x0, int x1);
+
+/**
+ * @brief Scan convert a path within a clip region.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The path, or null.
+ * @param[in] rule The rule of the inside of the path.
+ * @param[in] flat The flatness of the curves, in device space.
+ * @param[in] region The clip region, or null.
+ * @param[in] func The function called for each span.
+ * @param[in] data The data passed to @p func.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * The spans are given row by row, by increasing y then x.
+ */
+int xpost_clip_spans(Xpost_Context *ctx,
+                     Xpost_Object path,
+                     Xpost_Clip_Rule rule,
+                     real flat,
+                     Xpost_Object region,
+                     Xpost_Clip_Span_Func func,
+                     void *data);
+
+/**
+ * @brief Intersect a clip region with the inside of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] region The clip region, or null.
+ * @param[in] path The path, or null.
+ * @param[in] rule The rule of the inside of the path.
+ * @param[in] flat The flatness of the curves, in device space.
+ * @param[out] result The new clip region.
+ * @return 0 on success, a postscript error code otherwise.
+ */
+int xpost_clip_intersect(Xpost_Context *ctx,
+                         Xpost_Object region,
+                         Xpost_Object path,
+                         Xpost_Clip_Rule rule,
+                         real flat,
+                         Xpost_Object *result);
+
+/**
+ * @brief Return the path of the outline of a clip region.
+ *
+ * @param[in] ctx The context.
+ * @param[in] region The clip region, or null.
+ * @param[out] path The path, null for the empty or unclipped region.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * The path is a closed rectangle for each span of each band, all
+ * turning the same way, whose inside is the region with either rule.
+ */
+int xpost_clip_path(Xpost_Context *ctx,
+                    Xpost_Object region,
+                    Xpost_Object *path);
+
+/**
+ * @brief Tell whether a clip region contains the inside of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] region The clip region, or null.
+ * @param[in] path The path, or null.
+ * @param[out] contains 1 if the region contains the path, 0 otherwise.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * The unclipped region contains any path, and a rectangle the paths
+ * whose rounded points are in it. Any other region is taken as not
+ * containing the path, so that their intersection is not assumed to
+ * be the inside of the path.
+ */
+int xpost_clip_contains(Xpost_Context *ctx,
+                        Xpost_Object region,
+                        Xpost_Object path,
+                        int *contains);
+
+/**
+ * @brief Clip the segments of a path to a clip region.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The flattened path, or null.
+ * @param[in] region The clip region, or null.
+ * @param[out] result The path of the visible parts of the segments.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * This is the clip of the lines of a hairline stroke, which has no
+ * inside: the segments of @p path, including the closing segments
+ * of its closed subpaths, are cut by the rectangles of the region,
+ * and the parts inside are given as open subpaths of lines. The
+ * points are not rounded. With the unclipped region, @p result is
+ * @p path itself.
+ */
+int xpost_clip_lines(Xpost_Context *ctx,
+                     Xpost_Object path,
+                     Xpost_Object region,
+                     Xpost_Object *result);
+
+/**
+ * @}
+ */
+
+#endif
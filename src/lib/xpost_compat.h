@@ -72,6 +72,16 @@
 
 #endif /* _MSC_VER */
 
+/**
+ * @brief storage class of the variables which each thread has its own
+ * copy of.
+ */
+#ifdef _MSC_VER
+# define XPOST_THREAD_LOCAL __declspec(thread)
+#else
+# define XPOST_THREAD_LOCAL __thread
+#endif
+
 #ifdef _WIN32
 # ifndef WIN32_LEAN_AND_MEAN
 #  define WIN32_LEAN_AND_MEAN
@@ -100,6 +100,89 @@ int xpost_context_append_ctxlist(Xpost_Memory_File *mem,
     return 0;
 }
 
+static
+Xpost_Context_Load_Cache_Entry *_load_cache_slot(Xpost_Context *ctx,
+                                                 Xpost_Object name)
+{
+    return &ctx->load_cache.entry[name.mark_.padw & (XPOST_CONTEXT_LOAD_CACHE_SIZE - 1)];
+}
+
+/* same name index in the same (global or local) name table */
+static
+int _load_cache_is_name(const Xpost_Context_Load_Cache_Entry *e,
+                        Xpost_Object name)
+{
+    return e->name.mark_.padw == name.mark_.padw &&
+        (e->name.mark_.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK) ==
+        (name.mark_.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK);
+}
+
+int xpost_context_load_cache_get(Xpost_Context *ctx,
+                                 Xpost_Object name,
+                                 Xpost_Object *value)
+{
+    Xpost_Context_Load_Cache_Entry *e = _load_cache_slot(ctx, name);
+
+    ++ctx->load_cache.lookups;
+    if (e->version != ctx->load_cache.version || !_load_cache_is_name(e, name))
+        return 0;
+    ++ctx->load_cache.hits;
+    ctx->load_cache.saved += e->depth;
+    *value = e->value;
+    return 1;
+}
+
+void xpost_context_load_cache_put(Xpost_Context *ctx,
+                                  Xpost_Object name,
+                                  Xpost_Object value,
+                                  unsigned int depth)
+{
+    Xpost_Context_Load_Cache_Entry *e = _load_cache_slot(ctx, name);
+
+    e->name = name;
+    e->value = value;
+    e->version = ctx->load_cache.version;
+    e->depth = depth;
+}
+
+void xpost_context_load_cache_flush(Xpost_Context *ctx)
+{
+    /* entries of older versions are stale. on wrap-around, clear them all */
+    if (++ctx->load_cache.version == 0)
+    {
+        memset(ctx->load_cache.entry, 0, sizeof ctx->load_cache.entry);
+        ctx->load_cache.version = 1;
+    }
+}
+
+void xpost_context_load_cache_invalidate(Xpost_Memory_File *mem,
+                                         Xpost_Object key)
+{
+    unsigned int *ctxlist;
+    int i;
+
+    if (!mem->interpreter_cid_get_context ||
+        mem->table.nextent <= XPOST_MEMORY_TABLE_SPECIAL_CONTEXT_LIST)
+        return;
+    ctxlist = (void *)(mem->base + mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_CONTEXT_LIST].adr);
+    for (i = 0; i < MAXCONTEXT; i++)
+    {
+        Xpost_Context *ctx;
+
+        if (ctxlist[i] == 0)
+            continue;
+        ctx = mem->interpreter_cid_get_context(ctxlist[i]);
+        if (xpost_object_get_type(key) == nametype)
+        {
+            Xpost_Context_Load_Cache_Entry *e = _load_cache_slot(ctx, key);
+
+            if (_load_cache_is_name(e, key))
+                e->version = 0;
+        }
+        else
+            xpost_context_load_cache_flush(ctx);
+    }
+}
 
 /* build a stack, return address */
 static
@@ -158,6 +241,10 @@ int initglobal(Xpost_Context *ctx,
         xpost_memory_file_exit(ctx->gl);
         return 0;
     }
+    /* a global collection marks all the local vms too, but global
+       vm has no restore to drop its garbage, so collect it sooner */
+    ctx->gl->threshold = XPOST_GARBAGE_COLLECTION_GLOBAL_THRESHOLD;
+    ctx->gl->vmthreshold = XPOST_GARBAGE_COLLECTION_GLOBAL_THRESHOLD;
     xpost_memory_register_garbage_collect_function(ctx->gl, garbage_collect_function);
     ret = xpost_save_init(ctx->gl);
     if (!ret)
@@ -291,6 +378,8 @@ int xpost_context_init(Xpost_Context *ctx,
     if (!ret)
         return 0;
     ctx->state = C_IDLE;
+    memset(&ctx->load_cache, 0, sizeof ctx->load_cache);
+    ctx->load_cache.version = 1;
 
     ret = initlocal(ctx, xpost_interpreter_cid_get_context, 
             xpost_interpreter_get_initializing, xpost_interpreter_set_initializing, 
@@ -385,6 +474,7 @@ unsigned int xpost_context_fork1(Xpost_Context *ctx,
             xpost_interpreter_get_initializing, xpost_interpreter_set_initializing, 
             xpost_interpreter_alloc_global_memory, garbage_collect_function);
     newctx->vmmode = LOCAL;
+    xpost_context_load_cache_flush(newctx);
     return newcid;
 }
 
@@ -419,6 +509,7 @@ unsigned int xpost_context_fork2(Xpost_Context *ctx,
     xpost_context_append_ctxlist(newctx->gl, newcid);
     xpost_stack_push(newctx->lo, newctx->ds,
             xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0)); // systemdict
+    xpost_context_load_cache_flush(newctx);
     return newcid;
 }
 
@@ -459,6 +550,7 @@ unsigned int xpost_context_fork3(Xpost_Context *ctx,
 
     xpost_stack_push(newctx->lo, newctx->ds,
             xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0)); // systemdict
+    xpost_context_load_cache_flush(newctx);
     printf("fork cid %u, ctx->id %u\n", newcid, newctx->id);
     return newcid;
 }
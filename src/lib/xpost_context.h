@@ -53,6 +53,22 @@ enum { LOCAL, GLOBAL };
  */
 enum { C_FREE, C_IDLE, C_RUN, C_WAIT, C_IOBLOCK, C_ZOMB };
 
+/**
+ * @brief number of slots of the name lookup cache, a power of 2
+ */
+#define XPOST_CONTEXT_LOAD_CACHE_SIZE 1024
+
+/**
+ * @brief a slot of the name lookup cache of a context
+ */
+typedef struct
+{
+    Xpost_Object name;
+    Xpost_Object value;
+    unsigned int version; /**< valid if equal to the version of the cache */
+    unsigned int depth; /**< number of dicts searched to find the name */
+} Xpost_Context_Load_Cache_Entry;
+
 /** @struct Xpost_Context
  * @brief The context structure for a thread of execution of ps code
  */
@@ -72,10 +88,79 @@ struct _Xpost_Context {
         int itransform;
         int rotate;
         int concatmatrix;
+        int currentpoint;
+        int moveto;
+        int rmoveto_cont;
+        int lineto;
+        int rlineto_cont;
+        int curveto;
+        int rcurveto_cont;
+        int arc_start;
+        int pathforall_cont;
+        int devpathforall_cont;
     } opcode_shortcuts;  /**< opcodes for internal use, to avoid lookups */
 
+    struct
+    {
+        Xpost_Object dollarerror;
+        Xpost_Object errordict;
+        Xpost_Object graphicsdict;
+        Xpost_Object currgstate;
+        Xpost_Object currpath;
+        Xpost_Object currmatrix;
+        Xpost_Object flat;
+        Xpost_Object gstackarray;
+        Xpost_Object gptr;
+        Xpost_Object clipregion;
+        Xpost_Object clipoutline;
+        Xpost_Object colorspace;
+        Xpost_Object colorcomp1;
+        Xpost_Object colorcomp2;
+        Xpost_Object colorcomp3;
+        Xpost_Object colorcomp4;
+        Xpost_Object transfer;
+        Xpost_Object linewidth;
+        Xpost_Object linecap;
+        Xpost_Object linejoin;
+        Xpost_Object miterlimit;
+        Xpost_Object dasharray;
+        Xpost_Object dashoffset;
+        Xpost_Object currfont;
+        Xpost_Object device;
+        Xpost_Object Private;
+        Xpost_Object width;
+        Xpost_Object height;
+        Xpost_Object dotcopydict;
+        Xpost_Object nativecolorspace;
+        Xpost_Object DeviceGray;
+        Xpost_Object DeviceRGB;
+        Xpost_Object roll;
+        Xpost_Object DrawLine;
+        Xpost_Object exec;
+        Xpost_Object repeat;
+        Xpost_Object cvx;
+        Xpost_Object Rbracket;
+        Xpost_Object Raster;
+    } name_shortcuts;  /**< names for internal use, to avoid lookups */
+
+    /*@dependent@*/
+    struct _Xpost_Operator_Dispatch *dispatch; /**< native operator table of the interpreter */
+    /*@dependent@*/
+    struct _Xpost_Interpreter *itp; /**< interpreter instance owning this context */
+    int tracing; /**< output trace log, see traceon */
+
     Xpost_Object currentobject;  /**< currently-executing object, for error() */
 
+    struct
+    {
+        unsigned int version; /**< bumped when the dict stack changes */
+        unsigned long lookups; /**< names looked up */
+        unsigned long hits; /**< names found in the cache */
+        unsigned long probes; /**< dicts searched for the misses */
+        unsigned long saved; /**< dicts the hits would have searched */
+        Xpost_Context_Load_Cache_Entry entry[XPOST_CONTEXT_LOAD_CACHE_SIZE];
+    } load_cache;  /**< dict stack lookups of names, see xpost_op_any_load() */
+
     /*@dependent@*/
     Xpost_Memory_File *gl; /**< global VM */
     /*@dependent@*/
@@ -133,6 +218,38 @@ Xpost_Memory_File *xpost_context_select_memory(Xpost_Context *ctx, Xpost_Object
  */
 void xpost_context_dump(Xpost_Context *ctx);
 
+/**
+ * @brief find name in the name lookup cache
+ *
+ * returns 1 and the value the dict stack gives name if it is cached,
+ * 0 otherwise.
+ */
+int xpost_context_load_cache_get(Xpost_Context *ctx,
+                                 Xpost_Object name,
+                                 Xpost_Object *value);
+
+/**
+ * @brief record the value of name found in the depth-th dict of the dict stack
+ */
+void xpost_context_load_cache_put(Xpost_Context *ctx,
+                                  Xpost_Object name,
+                                  Xpost_Object value,
+                                  unsigned int depth);
+
+/**
+ * @brief empty the name lookup cache, when the dict stack changes
+ */
+void xpost_context_load_cache_flush(Xpost_Context *ctx);
+
+/**
+ * @brief drop key from the name lookup caches of the contexts using mem
+ *
+ * called when key is defined or undefined in a dict of mem.
+ * a key other than a name empties the caches.
+ */
+void xpost_context_load_cache_invalidate(Xpost_Memory_File *mem,
+                                         Xpost_Object key);
+
 /**
  * @brief install a function to be called by eval()
  */
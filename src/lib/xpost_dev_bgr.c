@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <stdlib.h> /* abs */
 //#include <stdio.h>
+#include <stddef.h> /* offsetof */
 #include <string.h>
 
 #include "xpost.h"
@@ -51,6 +52,7 @@
 
 #include "xpost_operator.h" /* create operators */
 #include "xpost_op_dict.h" /* call load operator for convenience */
+#include "xpost_dev_generic.h" /* native drawing routines */
 #include "xpost_dev_bgr.h" /* check prototypes */
 
 #define FAST_C_BUFFER
@@ -78,15 +80,6 @@ typedef struct
 } PrivateData;
 
 
-static Xpost_Object namePrivate;
-static Xpost_Object namewidth;
-static Xpost_Object nameheight;
-static Xpost_Object namedotcopydict;
-static Xpost_Object namenativecolorspace;
-static Xpost_Object nameDeviceRGB;
-
-
-static unsigned int _create_cont_opcode;
 
 /* create an instance of the device
    using the class .copydict procedure */
@@ -99,8 +92,8 @@ int _create(Xpost_Context *ctx,
     xpost_stack_push(ctx->lo, ctx->os, width);
     xpost_stack_push(ctx->lo, ctx->os, height);
     xpost_stack_push(ctx->lo, ctx->os, classdic);
-    xpost_dict_put(ctx, classdic, namewidth, width);
-    xpost_dict_put(ctx, classdic, nameheight, height);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.width, width);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.height, height);
 
     //printf("create\n");
     //fflush(0);
@@ -108,11 +101,11 @@ int _create(Xpost_Context *ctx,
        //call base-class's Create procedure (to initialize ImgData array)
        then call _create_cont, by continuation. */
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_operator_cons_opcode(_create_cont_opcode)))
+                          xpost_operator_cons(ctx, "bgrCreateCont", NULL, 0, 0)))
         return execstackoverflow;
 
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -139,7 +132,7 @@ int _create_cont(Xpost_Context *ctx,
         XPOST_LOG_ERR("cannot allocat private data structure");
         return unregistered;
     }
-    xpost_dict_put(ctx, devdic, namePrivate, privatestr);
+    xpost_dict_put(ctx, devdic, ctx->name_shortcuts.Private, privatestr);
 
     private.width = width;
     private.height = height;
@@ -193,6 +186,30 @@ int _create_cont(Xpost_Context *ctx,
     }
 #endif
 
+#ifdef FAST_C_BUFFER
+    {
+        Xpost_Device_Raster raster;
+        int ret;
+
+        /* publish the buffer to the native drawing operators */
+        raster.data = (unsigned char *)private.buf->data;
+        raster.width = width;
+        raster.height = height;
+        raster.bpp = sizeof(Xpost_Bgr_Pixel);
+        raster.stride = width * raster.bpp;
+        raster.red = offsetof(Xpost_Bgr_Pixel, red);
+        raster.green = offsetof(Xpost_Bgr_Pixel, green);
+        raster.blue = offsetof(Xpost_Bgr_Pixel, blue);
+        raster.alpha = -1;
+        ret = xpost_device_raster_set(ctx, devdic, &raster);
+        if (ret)
+        {
+            free(private.buf);
+            return ret;
+        }
+    }
+#endif
+
     /* save private data struct in string */
     xpost_memory_put(xpost_context_select_memory(ctx, privatestr),
                      xpost_object_get_ent(privatestr), 0,
@@ -236,7 +253,7 @@ int _putpix(Xpost_Context *ctx,
         y = xpost_int_cons(y.real_.val);
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -276,7 +293,7 @@ int _flush(Xpost_Context *ctx,
     PrivateData private;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -301,7 +318,7 @@ int _emit(Xpost_Context *ctx,
 #endif
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -392,9 +409,6 @@ int newbgrdevice(Xpost_Context *ctx,
     return 0;
 }
 
-static
-unsigned int _loadbgrdevicecont_opcode;
-
 /* Specializes or sub-classes the PPMIMAGE device class.
    load PPMIMAGE
    load and call ps procedure .copydict which leaves copy on stack
@@ -411,10 +425,10 @@ int loadbgrdevice(Xpost_Context *ctx)
         return ret;
     classdic = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_operator_cons_opcode(_loadbgrdevicecont_opcode)))
+                          xpost_operator_cons(ctx, "loadbgrdevicecont", NULL, 0, 0)))
         return execstackoverflow;
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -432,10 +446,9 @@ int loadbgrdevicecont(Xpost_Context *ctx,
     Xpost_Object op;
     int ret;
 
-    ret = xpost_dict_put(ctx, classdic, namenativecolorspace, nameDeviceRGB);
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.nativecolorspace, ctx->name_shortcuts.DeviceRGB);
 
     op = xpost_operator_cons(ctx, "bgrCreateCont", (Xpost_Op_Func)_create_cont, 1, 3, integertype, integertype, dicttype);
-    _create_cont_opcode = op.mark_.padw;
     op = xpost_operator_cons(ctx, "bgrCreate", (Xpost_Op_Func)_create, 1, 3, integertype, integertype, dicttype);
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "Create"), op);
     if (ret)
@@ -449,6 +462,10 @@ int loadbgrdevicecont(Xpost_Context *ctx,
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "PutPix"), op);
     if (ret)
         return ret;
+
+    ret = xpost_device_raster_ops_install(ctx, classdic, "bgr");
+    if (ret)
+        return ret;
 #endif
 
     op = xpost_operator_cons(ctx, "bgrEmit", (Xpost_Op_Func)_emit, 0, 1, dicttype);
@@ -487,17 +504,17 @@ int xpost_oper_init_bgr_device_ops(Xpost_Context *ctx,
     Xpost_Object n,op;
 
     /* factor-out name lookups from the operators (optimization) */
-    if (xpost_object_get_type((namePrivate = xpost_name_cons(ctx, "Private"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Private = xpost_name_cons(ctx, "Private"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namewidth = xpost_name_cons(ctx, "width"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.width = xpost_name_cons(ctx, "width"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameheight = xpost_name_cons(ctx, "height"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.height = xpost_name_cons(ctx, "height"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namedotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.dotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namenativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.nativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
         return VMerror;
 
     xpost_memory_table_get_addr(ctx->gl,
@@ -506,7 +523,6 @@ int xpost_oper_init_bgr_device_ops(Xpost_Context *ctx,
     optab = (Xpost_Operator *)(ctx->gl->base + optadr);
     op = xpost_operator_cons(ctx, "loadbgrdevice", (Xpost_Op_Func)loadbgrdevice, 1, 0); INSTALL;
     op = xpost_operator_cons(ctx, "loadbgrdevicecont", (Xpost_Op_Func)loadbgrdevicecont, 1, 1, dicttype);
-    _loadbgrdevicecont_opcode = op.mark_.padw;
 
     return 0;
 }
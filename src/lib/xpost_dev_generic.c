@@ -61,9 +61,11 @@ void *alloca (size_t);
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h> /* abs */
+#include <stdio.h> /* snprintf */
 #include <string.h>
 
 #include "xpost.h"
+#include "xpost_compat.h" /* XPOST_THREAD_LOCAL */
 #include "xpost_log.h"
 #include "xpost_memory.h" /* access memory */
 #include "xpost_object.h" /* work with objects */
@@ -84,19 +86,10 @@ struct point
     real x, y;
 };
 
-/* FIXME: re-entrancy */
-static Xpost_Context *localctx;
-
-static Xpost_Object namewidth;
-static Xpost_Object namenativecolorspace;
-static Xpost_Object nameDeviceGray;
-static Xpost_Object nameDeviceRGB;
-static Xpost_Object nameroll;
-static Xpost_Object nameDrawLine;
-static Xpost_Object nameexec;
-static Xpost_Object namerepeat;
-static Xpost_Object namecvx;
-static Xpost_Object nameRbracket;
+/* context of the qsort in _yxsort, for the comparison function.
+   each thread sorts with its own. */
+static XPOST_THREAD_LOCAL
+Xpost_Context *localctx;
 
 char *xpost_device_get_filename(Xpost_Context *ctx, Xpost_Object devdic)
 {
@@ -334,50 +327,32 @@ int _cyxcomp (const void *left, const void *right)
     }
 }
 
+/* intersect the edges of poly with the scanlines through the pixel centers
+   and sort the intersections by y, then x.
+   the points are returned in a malloc'ed array which the caller must free. */
 static
-int _fillpoly(Xpost_Context *ctx,
+int _scanpoly(Xpost_Context *ctx,
               Xpost_Object poly,
-              Xpost_Object devdic)
+              struct point **scan,
+              int *count)
 {
-    Xpost_Object colorspace;
-    int ncomp;
-    Xpost_Object comp1, comp2, comp3;
-    int numlines;
-    /* Xpost_Object x1, y1, x2, y2; */
-    Xpost_Object drawline;
     struct point *points, *intersections;
-    int i, j;
+    int i, j, n;
     real yscan;
     real minx = (real)0x7ffffff;
     real miny = minx;
     real maxx = -minx;
     real maxy = maxx;
-    //int width;
 
-    //printf("_fillpoly\n");
-
-    //width = xpost_dict_get(ctx, devdic, namewidth).int_.val;
-    colorspace = xpost_dict_get(ctx, devdic, namenativecolorspace);
-    if (xpost_dict_compare_objects(ctx, colorspace, nameDeviceGray) == 0)
-    {
-        ncomp = 1;
-        comp1 = xpost_stack_pop(ctx->lo, ctx->os);
-    }
-    else if (xpost_dict_compare_objects(ctx, colorspace, nameDeviceRGB) == 0)
-    {
-        ncomp = 3;
-        comp3 = xpost_stack_pop(ctx->lo, ctx->os);
-        comp2 = xpost_stack_pop(ctx->lo, ctx->os);
-        comp1 = xpost_stack_pop(ctx->lo, ctx->os);
-    }
-    else
-    {
-        XPOST_LOG_ERR("unimplemented device color space");
-        return unregistered;
-    }
+    *scan = NULL;
+    *count = 0;
+    if (poly.comp_.sz < 2)
+        return 0;
 
     /* extract polygon vertices from ps array */
-    points = alloca(poly.comp_.sz * sizeof *points);
+    points = malloc(poly.comp_.sz * sizeof *points);
+    if (!points)
+        return VMerror;
     for (i = 0; i < poly.comp_.sz; i++)
     {
         Xpost_Object pair, x, y;
@@ -396,7 +371,8 @@ int _fillpoly(Xpost_Context *ctx,
         points[i].y = (real)floor(y.real_.val + 0.5);
     }
 
-    /* find bounding box */
+    /* find bounding box, and the number of scanlines crossed by the edges */
+    n = 0;
     for (i = 0; i < poly.comp_.sz; i++)
     {
         if (points[i].x < minx)
@@ -407,16 +383,28 @@ int _fillpoly(Xpost_Context *ctx,
             miny = points[i].y;
         if (points[i].y > maxy)
             maxy = points[i].y;
+        if (i > 0)
+            n += (int)fabs(points[i].y - points[i-1].y) + 1;
     }
 
-    intersections = alloca((int)(maxy - miny) * 2 * 2 * sizeof *intersections);
+    intersections = malloc((n + 1) * sizeof *intersections);
+    if (!intersections)
+    {
+        free(points);
+        return VMerror;
+    }
 
-    /* intersect polygon edges with scanlines */
+    /* intersect polygon edges with scanlines.
+       vertices lie on integer coordinates, so scanlines outside
+       the vertical extent of an edge cannot intersect it. */
     for (i = 0, j = 0; i < poly.comp_.sz - 1; i++)
     {
         real rx, ry;
+        real ylo, yhi;
 
-        for (yscan = (real)(miny + 0.5); yscan < maxy; yscan += 1.0)
+        ylo = points[i].y < points[i+1].y ? points[i].y : points[i+1].y;
+        yhi = points[i].y < points[i+1].y ? points[i+1].y : points[i].y;
+        for (yscan = (real)(ylo + 0.5); yscan < yhi; yscan += 1.0)
         {
             if (_intersect(points[i].x, points[i].y,
                            points[i+1].x, points[i+1].y,
@@ -430,11 +418,59 @@ int _fillpoly(Xpost_Context *ctx,
             }
         }
     }
-    numlines = j / 2;
+    free(points);
 
     /* sort intersection points */
     qsort(intersections, j, sizeof *intersections, _cyxcomp);
 
+    *scan = intersections;
+    *count = j;
+    return 0;
+}
+
+static
+int _fillpoly(Xpost_Context *ctx,
+              Xpost_Object poly,
+              Xpost_Object devdic)
+{
+    Xpost_Object colorspace;
+    int ncomp;
+    Xpost_Object comp1, comp2, comp3;
+    int numlines;
+    /* Xpost_Object x1, y1, x2, y2; */
+    Xpost_Object drawline;
+    struct point *intersections;
+    int i, j;
+    int ret;
+    //int width;
+
+    //printf("_fillpoly\n");
+
+    //width = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.width).int_.val;
+    colorspace = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.nativecolorspace);
+    if (xpost_dict_compare_objects(ctx, colorspace, ctx->name_shortcuts.DeviceGray) == 0)
+    {
+        ncomp = 1;
+        comp1 = xpost_stack_pop(ctx->lo, ctx->os);
+    }
+    else if (xpost_dict_compare_objects(ctx, colorspace, ctx->name_shortcuts.DeviceRGB) == 0)
+    {
+        ncomp = 3;
+        comp3 = xpost_stack_pop(ctx->lo, ctx->os);
+        comp2 = xpost_stack_pop(ctx->lo, ctx->os);
+        comp1 = xpost_stack_pop(ctx->lo, ctx->os);
+    }
+    else
+    {
+        XPOST_LOG_ERR("unimplemented device color space");
+        return unregistered;
+    }
+
+    ret = _scanpoly(ctx, poly, &intersections, &j);
+    if (ret)
+        return ret;
+    numlines = j / 2;
+
     /* arrange ((x1,y1),(x2,y2)) pairs */
     for (i = 0; i < numlines * 2; i += 2)
     {
@@ -443,6 +479,7 @@ int _fillpoly(Xpost_Context *ctx,
         xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons((integer)floor(intersections[i+1].x)));
         xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons((integer)floor(intersections[i+1].y)));
     }
+    free(intersections);
 
     /*call the device's DrawLine generically with continuations.
       each call to DrawLine looks like this
@@ -492,7 +529,7 @@ int _fillpoly(Xpost_Context *ctx,
             xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(3)); /* color components to move */
             break;
     }
-    xpost_stack_push(ctx->lo, ctx->os, xpost_object_cvx( nameroll));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_object_cvx( ctx->name_shortcuts.roll));
 
       /*at this point (in constructing the (color-space-generic) loop-body) we have the desired stack picture:
 
@@ -505,12 +542,12 @@ int _fillpoly(Xpost_Context *ctx,
        */
 
     xpost_stack_push(ctx->lo, ctx->os, devdic);
-    drawline = xpost_dict_get(ctx, devdic, nameDrawLine);
+    drawline = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.DrawLine);
     xpost_stack_push(ctx->lo, ctx->os, drawline);
 
     /*if drawline is a procedure, we also need to call exec */
     if (xpost_object_get_type(drawline) == arraytype)
-        xpost_stack_push(ctx->lo, ctx->os, nameexec);
+        xpost_stack_push(ctx->lo, ctx->os, ctx->name_shortcuts.exec);
 
     /*--the rest of the code here calls-back to postscript (by "continuation")
         by pushing executable names on the execution-stack, and then returns.
@@ -544,9 +581,9 @@ int _fillpoly(Xpost_Context *ctx,
       So the sequence in C is:
      */
 
-    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( namerepeat));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( namecvx));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( nameRbracket));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( ctx->name_shortcuts.repeat));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( ctx->name_shortcuts.cvx));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx( ctx->name_shortcuts.Rbracket));
 
     /*performance could be increased by factoring-out calls to xpost_name_cons()  ... DONE!
       or using opcode shortcuts for Rbracket & cvx (or just the arrtomark() function) and repeat.
@@ -554,6 +591,429 @@ int _fillpoly(Xpost_Context *ctx,
     return 0;
 }
 
+int xpost_device_raster_set(Xpost_Context *ctx, Xpost_Object devdic,
+                            const Xpost_Device_Raster *raster)
+{
+    Xpost_Object rasterstr;
+
+    rasterstr = xpost_string_cons(ctx, sizeof(*raster), (const char *)raster);
+    if (xpost_object_get_type(rasterstr) == invalidtype)
+        return VMerror;
+    return xpost_dict_put(ctx, devdic, ctx->name_shortcuts.Raster, rasterstr);
+}
+
+int xpost_device_raster_get(Xpost_Context *ctx, Xpost_Object devdic,
+                            Xpost_Device_Raster *raster)
+{
+    Xpost_Object rasterstr;
+
+    rasterstr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Raster);
+    if (xpost_object_get_type(rasterstr) != stringtype ||
+        rasterstr.comp_.sz != sizeof(*raster))
+        return 0;
+    xpost_memory_get(xpost_context_select_memory(ctx, rasterstr),
+                     xpost_object_get_ent(rasterstr), 0,
+                     sizeof(*raster), raster);
+    return 1;
+}
+
+/* fold a color component the way the devices' PutPix does */
+static
+unsigned char _colorbyte(Xpost_Object comp)
+{
+    if (xpost_object_get_type(comp) == realtype)
+        return (integer)(comp.real_.val * 255.0);
+    return comp.int_.val * 255;
+}
+
+void xpost_device_raster_set_color(Xpost_Device_Raster *raster,
+                                   Xpost_Object red,
+                                   Xpost_Object green,
+                                   Xpost_Object blue)
+{
+    raster->pixel[raster->red] = _colorbyte(red);
+    raster->pixel[raster->green] = _colorbyte(green);
+    raster->pixel[raster->blue] = _colorbyte(blue);
+    if (raster->alpha >= 0)
+        raster->pixel[raster->alpha] = 255;
+}
+
+/* compare reals with the tolerance of the PostScript relational operators,
+   see xpost_dict_compare_objects */
+static
+int _pscmp(real a, real b)
+{
+    if (fabs(a - b) < 0.0001)
+        return 0;
+    return a - b > 0 ? 1 : -1;
+}
+
+/* fill pixels x1..x2 (inclusive, already clipped) of row y */
+static
+void _fillspan(const Xpost_Device_Raster *raster,
+               int y, int x1, int x2)
+{
+    unsigned char *row;
+    size_t len, done, chunk;
+    int i;
+
+    row = raster->data + (size_t)y * raster->stride + (size_t)x1 * raster->bpp;
+    len = (size_t)(x2 - x1 + 1) * raster->bpp;
+
+    for (i = 1; i < raster->bpp; i++)
+        if (raster->pixel[i] != raster->pixel[0])
+            break;
+    if (i == raster->bpp)
+    {
+        memset(row, raster->pixel[0], len);
+        return;
+    }
+
+    /* double the filled part of the span with each copy */
+    memcpy(row, raster->pixel, raster->bpp);
+    for (done = raster->bpp; done < len; done += chunk)
+    {
+        chunk = done < len - done ? done : len - done;
+        memcpy(row + done, row, chunk);
+    }
+}
+
+/* clip the run of pixel coordinates lo..hi (PutPix truncates toward zero)
+   to 0..limit-1. returns 0 if nothing is left. */
+static
+int _cliprun(real lo, real hi, int limit, int *ilo, int *ihi)
+{
+    if (hi <= -1 || lo >= limit || lo > hi)
+        return 0;
+    *ilo = lo <= 0 ? 0 : (int)lo;
+    *ihi = hi >= limit ? limit - 1 : (int)hi;
+    return 1;
+}
+
+void xpost_device_raster_fill_rect(const Xpost_Device_Raster *raster,
+                                   real x, real y, real width, real height)
+{
+    int x1, y1, x2, y2;
+    int i;
+    size_t len;
+
+    if (_pscmp(width, 0) < 0)
+    {
+        width = -width;
+        x -= width;
+    }
+    if (_pscmp(height, 0) < 0)
+    {
+        height = -height;
+        y -= height;
+    }
+
+    /* the PostScript procedure visits x, x+1, ... up to x+width */
+    if (!_cliprun(x, x + (real)floor(width), raster->width, &x1, &x2) ||
+        !_cliprun(y, y + (real)floor(height), raster->height, &y1, &y2))
+        return;
+
+    _fillspan(raster, y1, x1, x2);
+    len = (size_t)(x2 - x1 + 1) * raster->bpp;
+    for (i = y1 + 1; i <= y2; i++)
+        memcpy(raster->data + (size_t)i * raster->stride + (size_t)x1 * raster->bpp,
+               raster->data + (size_t)y1 * raster->stride + (size_t)x1 * raster->bpp,
+               len);
+}
+
+/* the .intersect procedure of ppmimage.ps, used by DrawLine
+   to clip lines against the edges of the image.
+   it repeats the arithmetic of the procedure step for step, so the same
+   pixels are drawn as by the PostScript implementation. */
+static
+int _clipedge(real ax, real ay,  real bx, real by,
+              real cx, real cy,  real dx, real dy,
+              real *rx, real *ry)
+{
+    real distAB;
+    real theCos;
+    real theSin;
+    real newX;
+    real ABpos;
+
+    /* reject degenerate line */
+    if ((!_pscmp(ax, bx) && !_pscmp(ay, by)) ||
+        (!_pscmp(cx, dx) && !_pscmp(cy, dy)))
+        return 0;
+
+    /* reject coinciding endpoints */
+    if ((!_pscmp(ax, cx) && !_pscmp(ay, cy)) ||
+        (!_pscmp(bx, cx) && !_pscmp(by, cy)) ||
+        (!_pscmp(ax, dx) && !_pscmp(ay, dy)) ||
+        (!_pscmp(bx, dx) && !_pscmp(by, dy)))
+        return 0;
+
+    /* translate by -ax, -ay */
+    bx -= ax;  by -= ay;
+    cx -= ax;  cy -= ay;
+    dx -= ax;  dy -= ay;
+
+    distAB = (real)sqrt(bx * bx + by * by);
+
+    /* rotate AB to x-axis */
+    theCos = bx / distAB;
+    theSin = by / distAB;
+    newX = cx * theCos + cy * theSin;
+    cy = cy * theCos - cx * theSin;
+    cx = newX;
+    newX = dx * theCos + dy * theSin;
+    dy = dy * theCos - dx * theSin;
+    dx = newX;
+
+    /* no intersection */
+    if ((_pscmp(cy, 0) < 0 && _pscmp(dy, 0) < 0) ||
+        (_pscmp(cy, 0) >= 0 && _pscmp(dy, 0) >= 0))
+        return 0;
+
+    ABpos = dx + (cx - dx) * dy / (dy - cy);
+    if (_pscmp(ABpos, 0) < 0 || _pscmp(ABpos, distAB) > 0)
+        return 0;
+
+    *rx = ax + ABpos * theCos;
+    *ry = ay + ABpos * theSin;
+    return 1;
+}
+
+void xpost_device_raster_draw_line(const Xpost_Device_Raster *raster,
+                                   real x1, real y1, real x2, real y2)
+{
+    real w = (real)raster->width;
+    real h = (real)raster->height;
+    real xx, yy;
+    real deltax, deltay;
+    real s1, s2;
+    real err;
+    real i;
+    int interchange;
+
+    if (_pscmp(x1, 0) < 0) _clipedge(x1, y1, x2, y2, 0, 0, 0, h, &x1, &y1);
+    if (_pscmp(x2, 0) < 0) _clipedge(x1, y1, x2, y2, 0, 0, 0, h, &x2, &y2);
+    if (_pscmp(y1, 0) < 0) _clipedge(x1, y1, x2, y2, 0, 0, w, 0, &x1, &y1);
+    if (_pscmp(y2, 0) < 0) _clipedge(x1, y1, x2, y2, 0, 0, w, 0, &x2, &y2);
+    if (_pscmp(x1, w) >= 0) _clipedge(x1, y1, x2, y2, w, 0, w, h, &x1, &y1);
+    if (_pscmp(x2, w) >= 0) _clipedge(x1, y1, x2, y2, w, 0, w, h, &x2, &y2);
+    if (_pscmp(y1, h) >= 0) _clipedge(x1, y1, x2, y2, 0, h, w, h, &x1, &y1);
+    if (_pscmp(y2, h) >= 0) _clipedge(x1, y1, x2, y2, 0, h, w, h, &x2, &y2);
+
+    deltax = x2 - x1;
+    s1 = (real)_pscmp(deltax, 0);
+    deltax = (real)fabs(deltax);
+    deltay = y2 - y1;
+    s2 = (real)_pscmp(deltay, 0);
+    deltay = (real)fabs(deltay);
+
+    /* horizontal run: pixels x1, x1+s1, ... for floor(deltax) steps */
+    if (deltay == 0)
+    {
+        int row, lo, hi;
+        real last;
+
+        if (deltax < 1 || y1 <= -1 || y1 >= h)
+            return;
+        row = (int)y1;
+        last = x1 + s1 * (real)(floor(deltax) - 1);
+        if (s1 > 0 ? _cliprun(x1, last, raster->width, &lo, &hi)
+                   : _cliprun(last, x1, raster->width, &lo, &hi))
+            _fillspan(raster, row, lo, hi);
+        return;
+    }
+
+    interchange = _pscmp(deltay, deltax) > 0;
+    if (interchange)
+    {
+        real tmp = deltax;
+        deltax = deltay;
+        deltay = tmp;
+    }
+
+    xx = x1;
+    yy = y1;
+    err = 2 * deltay - deltax;
+    for (i = 1; i <= deltax; i += 1)
+    {
+        if (xx > -1 && xx < w && yy > -1 && yy < h)
+            memcpy(raster->data + (size_t)(int)yy * raster->stride + (size_t)(int)xx * raster->bpp,
+                   raster->pixel, raster->bpp);
+        while (_pscmp(err, 0) >= 0)
+        {
+            if (interchange)
+                xx += s1;
+            else
+                yy += s2;
+            err -= 2 * deltax;
+        }
+        if (interchange)
+            yy += s2;
+        else
+            xx += s1;
+        err += 2 * deltay;
+    }
+}
+
+int xpost_device_raster_fill_poly(Xpost_Context *ctx,
+                                  const Xpost_Device_Raster *raster,
+                                  Xpost_Object poly)
+{
+    struct point *intersections;
+    int i, count;
+    int ret;
+
+    ret = _scanpoly(ctx, poly, &intersections, &count);
+    if (ret)
+        return ret;
+
+    /* each pair of intersections is a span, drawn like .fillpoly
+       does with the device's DrawLine */
+    for (i = 0; i + 1 < count; i += 2)
+    {
+        xpost_device_raster_draw_line(raster,
+                                      (real)floor(intersections[i].x),
+                                      (real)floor(intersections[i].y),
+                                      (real)floor(intersections[i+1].x),
+                                      (real)floor(intersections[i+1].y));
+    }
+    free(intersections);
+
+    return 0;
+}
+
+void xpost_device_raster_draw_mask(const Xpost_Device_Raster *raster,
+                                   const unsigned char *mask,
+                                   int rows, int width, int pitch, int depth,
+                                   int x, int y)
+{
+    int i, j;
+    int jlo, jhi;
+    unsigned char *row;
+
+    /* clip the mask to the raster */
+    jlo = x < 0 ? -x : 0;
+    jhi = x + width > raster->width ? raster->width - x : width;
+    i = y < 0 ? -y : 0;
+    if (y + rows > raster->height)
+        rows = raster->height - y;
+    mask += (size_t)i * pitch;
+
+    for ( ; i < rows; i++, mask += pitch)
+    {
+        row = raster->data + (size_t)(y + i) * raster->stride;
+        for (j = jlo; j < jhi; j++)
+        {
+            if (depth == 1 ? (mask[j / 8] >> (7 - (j % 8))) & 1 : mask[j])
+                memcpy(row + (size_t)(x + j) * raster->bpp,
+                       raster->pixel, raster->bpp);
+        }
+    }
+}
+
+static
+int _rasterfillrect(Xpost_Context *ctx,
+                    Xpost_Object red,
+                    Xpost_Object green,
+                    Xpost_Object blue,
+                    Xpost_Object x,
+                    Xpost_Object y,
+                    Xpost_Object width,
+                    Xpost_Object height,
+                    Xpost_Object devdic)
+{
+    Xpost_Device_Raster raster;
+
+    if (!xpost_device_raster_get(ctx, devdic, &raster))
+        return undefined;
+    xpost_device_raster_set_color(&raster, red, green, blue);
+    xpost_device_raster_fill_rect(&raster,
+                                  x.real_.val, y.real_.val,
+                                  width.real_.val, height.real_.val);
+
+    return 0;
+}
+
+static
+int _rasterdrawline(Xpost_Context *ctx,
+                    Xpost_Object red,
+                    Xpost_Object green,
+                    Xpost_Object blue,
+                    Xpost_Object x1,
+                    Xpost_Object y1,
+                    Xpost_Object x2,
+                    Xpost_Object y2,
+                    Xpost_Object devdic)
+{
+    Xpost_Device_Raster raster;
+
+    if (!xpost_device_raster_get(ctx, devdic, &raster))
+        return undefined;
+    xpost_device_raster_set_color(&raster, red, green, blue);
+    xpost_device_raster_draw_line(&raster,
+                                  x1.real_.val, y1.real_.val,
+                                  x2.real_.val, y2.real_.val);
+
+    return 0;
+}
+
+static
+int _rasterfillpoly(Xpost_Context *ctx,
+                    Xpost_Object red,
+                    Xpost_Object green,
+                    Xpost_Object blue,
+                    Xpost_Object poly,
+                    Xpost_Object devdic)
+{
+    Xpost_Device_Raster raster;
+
+    if (!xpost_device_raster_get(ctx, devdic, &raster))
+        return undefined;
+    xpost_device_raster_set_color(&raster, red, green, blue);
+
+    return xpost_device_raster_fill_poly(ctx, &raster, poly);
+}
+
+int xpost_device_raster_ops_install(Xpost_Context *ctx,
+                                    Xpost_Object classdic,
+                                    const char *prefix)
+{
+    Xpost_Object op;
+    char opname[64];
+    int ret;
+
+    snprintf(opname, sizeof opname, "%sDrawLine", prefix);
+    op = xpost_operator_cons(ctx, opname, (Xpost_Op_Func)_rasterdrawline, 0, 8,
+                             floattype, floattype, floattype, /* r g b color values */
+                             floattype, floattype, /* x1 y1 */
+                             floattype, floattype, /* x2 y2 */
+                             dicttype); /* devdic */
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.DrawLine, op);
+    if (ret)
+        return ret;
+
+    snprintf(opname, sizeof opname, "%sFillRect", prefix);
+    op = xpost_operator_cons(ctx, opname, (Xpost_Op_Func)_rasterfillrect, 0, 8,
+                             floattype, floattype, floattype, /* r g b color values */
+                             floattype, floattype, /* x y coords */
+                             floattype, floattype, /* width height */
+                             dicttype); /* devdic */
+    ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "FillRect"), op);
+    if (ret)
+        return ret;
+
+    snprintf(opname, sizeof opname, "%sFillPoly", prefix);
+    op = xpost_operator_cons(ctx, opname, (Xpost_Op_Func)_rasterfillpoly, 0, 5,
+                             floattype, floattype, floattype, /* r g b color values */
+                             arraytype, /* polygon */
+                             dicttype); /* devdic */
+    ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "FillPoly"), op);
+    if (ret)
+        return ret;
+
+    return 0;
+}
+
 int xpost_oper_init_generic_device_ops(Xpost_Context *ctx,
                                        Xpost_Object sd)
 {
@@ -568,25 +1028,27 @@ int xpost_oper_init_generic_device_ops(Xpost_Context *ctx,
 
     op = xpost_operator_cons(ctx, ".yxsort", (Xpost_Op_Func)_yxsort, 0, 1, arraytype); INSTALL;
     op = xpost_operator_cons(ctx, ".fillpoly", (Xpost_Op_Func)_fillpoly, 0, 2, arraytype, dicttype); INSTALL;
-    if (xpost_object_get_type((namewidth = xpost_name_cons(ctx, "width"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.width = xpost_name_cons(ctx, "width"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.nativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namenativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DeviceGray = xpost_name_cons(ctx, "DeviceGray"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDeviceGray = xpost_name_cons(ctx, "DeviceGray"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.roll = xpost_name_cons(ctx, "roll"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameroll = xpost_name_cons(ctx, "roll"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DrawLine = xpost_name_cons(ctx, "DrawLine"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDrawLine = xpost_name_cons(ctx, "DrawLine"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.exec = xpost_name_cons(ctx, "exec"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameexec = xpost_name_cons(ctx, "exec"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.repeat = xpost_name_cons(ctx, "repeat"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namerepeat = xpost_name_cons(ctx, "repeat"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.cvx = xpost_name_cons(ctx, "cvx"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namecvx = xpost_name_cons(ctx, "cvx"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Rbracket = xpost_name_cons(ctx, "]"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameRbracket = xpost_name_cons(ctx, "]"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Raster = xpost_name_cons(ctx, "Raster"))) == invalidtype)
         return VMerror;
 
     return 0;
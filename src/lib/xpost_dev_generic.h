@@ -58,6 +58,106 @@ char *xpost_device_get_filename(Xpost_Context *ctx, Xpost_Object devdic);
  */
 int xpost_device_set_filename(Xpost_Context *ctx, Xpost_Object devdic, char *filename);
 
+/**
+ * @brief a device's pixel buffer, for the native drawing routines
+ *
+ * Devices which keep their image in a C buffer describe it with
+ * this struct and publish it in the device dictionary with
+ * xpost_device_raster_set(), so the FillRect, DrawLine and FillPoly
+ * operators and the text renderer can write spans directly into
+ * the pixel data.
+ * pixel holds the bytes of the current color in the device's
+ * pixel format, see xpost_device_raster_set_color().
+ */
+typedef struct
+{
+    unsigned char *data; /**< first byte of the top row */
+    int width;
+    int height;
+    int stride; /**< bytes per row */
+    int bpp; /**< bytes per pixel, at most 4 */
+    int red, green, blue; /**< byte offsets of the components in a pixel */
+    int alpha; /**< byte offset of the alpha component, or -1 */
+    unsigned char pixel[4];
+} Xpost_Device_Raster;
+
+/**
+ * @brief define the raster description of a device instance
+ *
+ * stores a copy of @p raster in the /Raster entry of @p devdic.
+ * returns a postscript error code from xpost_error.h, 0 == noerror
+ */
+int xpost_device_raster_set(Xpost_Context *ctx, Xpost_Object devdic,
+                            const Xpost_Device_Raster *raster);
+
+/**
+ * @brief retrieve the raster description of a device instance
+ *
+ * returns 1 if @p devdic describes its pixel buffer, 0 if it is
+ * a PostScript-level device which must be drawn with PutPix.
+ */
+int xpost_device_raster_get(Xpost_Context *ctx, Xpost_Object devdic,
+                            Xpost_Device_Raster *raster);
+
+/**
+ * @brief set the drawing color of raster from 0..1 color components
+ *
+ * the components are folded to bytes the way PutPix does.
+ */
+void xpost_device_raster_set_color(Xpost_Device_Raster *raster,
+                                   Xpost_Object red,
+                                   Xpost_Object green,
+                                   Xpost_Object blue);
+
+/**
+ * @brief fill the rectangle x..x+width, y..y+height (edges inclusive)
+ *
+ * negative width or height extend the rectangle to the left or up.
+ */
+void xpost_device_raster_fill_rect(const Xpost_Device_Raster *raster,
+                                   real x, real y, real width, real height);
+
+/**
+ * @brief draw a Bresenham line from x1,y1 towards x2,y2
+ *
+ * the last point is not drawn, matching the PostScript DrawLine
+ * procedure in ppmimage.ps.
+ */
+void xpost_device_raster_draw_line(const Xpost_Device_Raster *raster,
+                                   real x1, real y1, real x2, real y2);
+
+/**
+ * @brief scanline fill of polygon, an array of [x y] pairs
+ *
+ * produces the same spans as the .fillpoly operator.
+ * returns a postscript error code from xpost_error.h, 0 == noerror
+ */
+int xpost_device_raster_fill_poly(Xpost_Context *ctx,
+                                  const Xpost_Device_Raster *raster,
+                                  Xpost_Object poly);
+
+/**
+ * @brief set the pixels of raster where the coverage mask is non-zero
+ *
+ * the top-left pixel of the mask is drawn at x,y.
+ * depth is the number of bits per mask pixel, 1 or 8.
+ */
+void xpost_device_raster_draw_mask(const Xpost_Device_Raster *raster,
+                                   const unsigned char *mask,
+                                   int rows, int width, int pitch, int depth,
+                                   int x, int y);
+
+/**
+ * @brief install native DrawLine, FillRect and FillPoly in a device class
+ *
+ * for devices which describe their buffer with xpost_device_raster_set().
+ * the operators are named after @p prefix, eg. pngFillRect.
+ * returns a postscript error code from xpost_error.h, 0 == noerror
+ */
+int xpost_device_raster_ops_install(Xpost_Context *ctx,
+                                    Xpost_Object classdic,
+                                    const char *prefix);
+
 /**
  * @brief install operator .yxsort to improve performance of 'fill'
  *
@@ -37,6 +37,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h> /* offsetof */
 #include <string.h>
 #include <jpeglib.h>
 #include <setjmp.h>
@@ -55,7 +56,7 @@
 
 #include "xpost_operator.h" /* create operators */
 #include "xpost_op_dict.h" /* call load operator for convenience */
-#include "xpost_dev_generic.h" /* get filename */
+#include "xpost_dev_generic.h" /* get filename, native drawing routines */
 #include "xpost_dev_jpeg.h" /* check prototypes */
 
 typedef struct _JPEG_error_mgr *emptr;
@@ -87,15 +88,6 @@ typedef struct
     Xpost_Jpeg_Buffer *buf;
 } PrivateData;
 
-static Xpost_Object namePrivate;
-static Xpost_Object namewidth;
-static Xpost_Object nameheight;
-static Xpost_Object namedotcopydict;
-static Xpost_Object namenativecolorspace;
-static Xpost_Object nameDeviceRGB;
-
-
-static unsigned int _create_cont_opcode;
 
 static void
 _JPEGFatalErrorHandler(j_common_ptr cinfo)
@@ -133,16 +125,16 @@ int _create(Xpost_Context *ctx,
     xpost_stack_push(ctx->lo, ctx->os, width);
     xpost_stack_push(ctx->lo, ctx->os, height);
     xpost_stack_push(ctx->lo, ctx->os, classdic);
-    xpost_dict_put(ctx, classdic, namewidth, width);
-    xpost_dict_put(ctx, classdic, nameheight, height);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.width, width);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.height, height);
 
     /* call device class's ps-level .copydict procedure,
        //call base-class's Create procedure (to initialize ImgData array)
        then call _create_cont, by continuation. */
-    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_create_cont_opcode)))
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "jpegCreateCont", NULL, 0, 0)))
         return execstackoverflow;
 
-    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_dict_get(ctx, classdic, namedotcopydict)))
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -157,6 +149,7 @@ int _create_cont(Xpost_Context *ctx,
                  Xpost_Object devdic)
 {
     PrivateData private;
+    Xpost_Device_Raster raster;
     Xpost_Object privatestr;
     char *filename;
     integer width = w.int_.val;
@@ -170,7 +163,7 @@ int _create_cont(Xpost_Context *ctx,
         XPOST_LOG_ERR("cannot allocat private data structure");
         return unregistered;
     }
-    xpost_dict_put(ctx, devdic, namePrivate, privatestr);
+    xpost_dict_put(ctx, devdic, ctx->name_shortcuts.Private, privatestr);
 
     private.width = width;
     private.height = height;
@@ -205,6 +198,22 @@ int _create_cont(Xpost_Context *ctx,
         goto close_file;
     }
 
+    /* publish the buffer to the native drawing operators */
+    raster.data = (unsigned char *)private.buf->data;
+    raster.width = width;
+    raster.height = height;
+    raster.bpp = sizeof(Xpost_Jpeg_Pixel);
+    raster.stride = width * raster.bpp;
+    raster.red = offsetof(Xpost_Jpeg_Pixel, red);
+    raster.green = offsetof(Xpost_Jpeg_Pixel, green);
+    raster.blue = offsetof(Xpost_Jpeg_Pixel, blue);
+    raster.alpha = -1;
+    if (xpost_device_raster_set(ctx, devdic, &raster))
+    {
+        free(private.buf);
+        goto close_file;
+    }
+
     /* save private data struct in string */
     xpost_memory_put(xpost_context_select_memory(ctx, privatestr),
                      xpost_object_get_ent(privatestr), 0,
@@ -251,7 +260,7 @@ int _putpix(Xpost_Context *ctx,
         y = xpost_int_cons(y.real_.val);
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -296,7 +305,7 @@ int _emit(Xpost_Context *ctx,
     int quality;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -378,7 +387,7 @@ int _destroy(Xpost_Context *ctx,
     PrivateData private;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -414,9 +423,6 @@ int newjpegdevice(Xpost_Context *ctx,
     return 0;
 }
 
-static
-unsigned int _loadjpegdevicecont_opcode;
-
 /* Specializes or sub-classes the PPMIMAGE device class.
    load PPMIMAGE
    load and call ps procedure .copydict which leaves copy on stack
@@ -432,9 +438,9 @@ int loadjpegdevice(Xpost_Context *ctx)
     if (ret)
         return ret;
     classdic = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_loadjpegdevicecont_opcode)))
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "loadjpegdevicecont", NULL, 0, 0)))
         return execstackoverflow;
-    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_dict_get(ctx, classdic, namedotcopydict)))
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -452,10 +458,9 @@ int loadjpegdevicecont(Xpost_Context *ctx,
     Xpost_Object op;
     int ret;
 
-    ret = xpost_dict_put(ctx, classdic, namenativecolorspace, nameDeviceRGB);
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.nativecolorspace, ctx->name_shortcuts.DeviceRGB);
 
     op = xpost_operator_cons(ctx, "jpegCreateCont", (Xpost_Op_Func)_create_cont, 1, 3, integertype, integertype, dicttype);
-    _create_cont_opcode = op.mark_.padw;
     op = xpost_operator_cons(ctx, "jpegCreate", (Xpost_Op_Func)_create, 1, 3, integertype, integertype, dicttype);
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "Create"), op);
     if (ret)
@@ -469,6 +474,10 @@ int loadjpegdevicecont(Xpost_Context *ctx,
     if (ret)
         return ret;
 
+    ret = xpost_device_raster_ops_install(ctx, classdic, "jpeg");
+    if (ret)
+        return ret;
+
     op = xpost_operator_cons(ctx, "jpegEmit", (Xpost_Op_Func)_emit, 0, 1, dicttype);
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "Emit"), op);
     if (ret)
@@ -505,17 +514,17 @@ int xpost_oper_init_jpeg_device_ops(Xpost_Context *ctx,
     Xpost_Object n,op;
 
     /* factor-out name lookups from the operators (optimization) */
-    if (xpost_object_get_type((namePrivate = xpost_name_cons(ctx, "Private"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Private = xpost_name_cons(ctx, "Private"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namewidth = xpost_name_cons(ctx, "width"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.width = xpost_name_cons(ctx, "width"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameheight = xpost_name_cons(ctx, "height"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.height = xpost_name_cons(ctx, "height"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namedotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.dotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namenativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.nativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
         return VMerror;
 
     xpost_memory_table_get_addr(ctx->gl,
@@ -524,7 +533,6 @@ int xpost_oper_init_jpeg_device_ops(Xpost_Context *ctx,
     optab = (Xpost_Operator *)(ctx->gl->base + optadr);
     op = xpost_operator_cons(ctx, "loadjpegdevice", (Xpost_Op_Func)loadjpegdevice, 1, 0); INSTALL;
     op = xpost_operator_cons(ctx, "loadjpegdevicecont", (Xpost_Op_Func)loadjpegdevicecont, 1, 1, dicttype);
-    _loadjpegdevicecont_opcode = op.mark_.padw;
 
     return 0;
 }
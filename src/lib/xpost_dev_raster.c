@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <stdlib.h> /* abs */
 #include <stdio.h>  /* FIXME: remove once printf() is removed */
+#include <stddef.h> /* offsetof */
 #include <string.h>
 
 #include "xpost.h"
@@ -51,6 +52,7 @@
 
 #include "xpost_operator.h" /* create operators */
 #include "xpost_op_dict.h" /* call load operator for convenience */
+#include "xpost_dev_generic.h" /* native drawing routines */
 #include "xpost_dev_raster.h" /* check prototypes */
 
 enum Xpost_PixelFormat { RGB, ARGB, BGR, BGRA };
@@ -96,15 +98,6 @@ typedef struct
 } PrivateData;
 
 
-static Xpost_Object namePrivate;
-static Xpost_Object namewidth;
-static Xpost_Object nameheight;
-static Xpost_Object namedotcopydict;
-static Xpost_Object namenativecolorspace;
-static Xpost_Object nameDeviceRGB;
-
-
-static unsigned int _create_cont_opcode;
 
 /* create an instance of the device
    using the class .copydict procedure */
@@ -117,8 +110,8 @@ int _create(Xpost_Context *ctx,
     xpost_stack_push(ctx->lo, ctx->os, width);
     xpost_stack_push(ctx->lo, ctx->os, height);
     xpost_stack_push(ctx->lo, ctx->os, classdic);
-    xpost_dict_put(ctx, classdic, namewidth, width);
-    xpost_dict_put(ctx, classdic, nameheight, height);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.width, width);
+    xpost_dict_put(ctx, classdic, ctx->name_shortcuts.height, height);
 
     //printf("create\n");
     //fflush(0);
@@ -126,11 +119,11 @@ int _create(Xpost_Context *ctx,
        //call base-class's Create procedure (to initialize ImgData array)
        then call _create_cont, by continuation. */
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_operator_cons_opcode(_create_cont_opcode)))
+                          xpost_operator_cons(ctx, "rasterCreateCont", NULL, 0, 0)))
         return execstackoverflow;
 
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -184,7 +177,7 @@ int _create_cont(Xpost_Context *ctx,
         XPOST_LOG_ERR("cannot allocat private data structure");
         return unregistered;
     }
-    xpost_dict_put(ctx, devdic, namePrivate, privatestr);
+    xpost_dict_put(ctx, devdic, ctx->name_shortcuts.Private, privatestr);
 
     private.width = width;
     private.height = height;
@@ -269,6 +262,54 @@ int _create_cont(Xpost_Context *ctx,
     }
 #endif
 
+#ifdef FAST_C_BUFFER
+    {
+        Xpost_Device_Raster raster;
+        int ret;
+
+        /* publish the buffer to the native drawing operators */
+        switch(private.pixelformat)
+        {
+            case BGRA:
+                raster.bpp = sizeof(Xpost_Raster_BGRA_Pixel);
+                raster.red = offsetof(Xpost_Raster_BGRA_Pixel, red);
+                raster.green = offsetof(Xpost_Raster_BGRA_Pixel, green);
+                raster.blue = offsetof(Xpost_Raster_BGRA_Pixel, blue);
+                raster.alpha = offsetof(Xpost_Raster_BGRA_Pixel, alpha);
+                break;
+            case BGR:
+                raster.bpp = sizeof(Xpost_Raster_BGR_Pixel);
+                raster.red = offsetof(Xpost_Raster_BGR_Pixel, red);
+                raster.green = offsetof(Xpost_Raster_BGR_Pixel, green);
+                raster.blue = offsetof(Xpost_Raster_BGR_Pixel, blue);
+                raster.alpha = -1;
+                break;
+            case ARGB:
+                raster.bpp = sizeof(Xpost_Raster_ARGB_Pixel);
+                raster.red = offsetof(Xpost_Raster_ARGB_Pixel, red);
+                raster.green = offsetof(Xpost_Raster_ARGB_Pixel, green);
+                raster.blue = offsetof(Xpost_Raster_ARGB_Pixel, blue);
+                raster.alpha = offsetof(Xpost_Raster_ARGB_Pixel, alpha);
+                break;
+            case RGB:
+            default:
+                raster.bpp = sizeof(Xpost_Raster_RGB_Pixel);
+                raster.red = offsetof(Xpost_Raster_RGB_Pixel, red);
+                raster.green = offsetof(Xpost_Raster_RGB_Pixel, green);
+                raster.blue = offsetof(Xpost_Raster_RGB_Pixel, blue);
+                raster.alpha = -1;
+                break;
+        }
+        raster.data = (unsigned char *)private.buf->data;
+        raster.width = width;
+        raster.height = height;
+        raster.stride = private.buf->width * raster.bpp;
+        ret = xpost_device_raster_set(ctx, devdic, &raster);
+        if (ret)
+            return ret;
+    }
+#endif
+
     /* save private data struct in string */
     xpost_memory_put(xpost_context_select_memory(ctx, privatestr),
                      xpost_object_get_ent(privatestr), 0,
@@ -312,7 +353,7 @@ int _putpix(Xpost_Context *ctx,
         y = xpost_int_cons((integer)y.real_.val);
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -320,9 +361,9 @@ int _putpix(Xpost_Context *ctx,
                      sizeof(private), &private);
 
     /* check bounds */
-    if (x.int_.val < 0 || x.int_.val >= xpost_dict_get(ctx, devdic, namewidth).int_.val)
+    if (x.int_.val < 0 || x.int_.val >= xpost_dict_get(ctx, devdic, ctx->name_shortcuts.width).int_.val)
         return 0;
-    if (y.int_.val < 0 || y.int_.val >= xpost_dict_get(ctx, devdic, nameheight).int_.val)
+    if (y.int_.val < 0 || y.int_.val >= xpost_dict_get(ctx, devdic, ctx->name_shortcuts.height).int_.val)
         return 0;
 
     switch(private.pixelformat)
@@ -389,7 +430,7 @@ int _flush(Xpost_Context *ctx,
     PrivateData private;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -414,7 +455,7 @@ int _emit(Xpost_Context *ctx,
 #endif
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -540,9 +581,6 @@ int newrasterdevice(Xpost_Context *ctx,
     return 0;
 }
 
-static
-unsigned int _loadrasterdevicecont_opcode;
-
 /* Specializes or sub-classes the PPMIMAGE device class.
    load PPMIMAGE
    load and call ps procedure .copydict which leaves copy on stack
@@ -559,10 +597,10 @@ int loadrasterdevice (Xpost_Context *ctx)
         return ret;
     classdic = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_operator_cons_opcode(_loadrasterdevicecont_opcode)))
+                          xpost_operator_cons(ctx, "loadrasterdevicecont", NULL, 0, 0)))
         return execstackoverflow;
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -580,10 +618,9 @@ int loadrasterdevicecont(Xpost_Context *ctx,
     Xpost_Object op;
     int ret;
 
-    ret = xpost_dict_put(ctx, classdic, namenativecolorspace, nameDeviceRGB);
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.nativecolorspace, ctx->name_shortcuts.DeviceRGB);
 
     op = xpost_operator_cons(ctx, "rasterCreateCont", (Xpost_Op_Func)_create_cont, 1, 3, integertype, integertype, dicttype);
-    _create_cont_opcode = op.mark_.padw;
     op = xpost_operator_cons(ctx, "rasterCreate", (Xpost_Op_Func)_create, 1, 3, integertype, integertype, dicttype);
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "Create"), op);
     if (ret)
@@ -597,6 +634,10 @@ int loadrasterdevicecont(Xpost_Context *ctx,
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "PutPix"), op);
     if (ret)
         return ret;
+
+    ret = xpost_device_raster_ops_install(ctx, classdic, "raster");
+    if (ret)
+        return ret;
 #endif
 
     op = xpost_operator_cons(ctx, "rasterEmit", (Xpost_Op_Func)_emit, 0, 1, dicttype);
@@ -635,17 +676,17 @@ int xpost_oper_init_raster_device_ops (Xpost_Context *ctx,
     Xpost_Object n,op;
 
     /* factor-out name lookups from the operators (optimization) */
-    if (xpost_object_get_type((namePrivate = xpost_name_cons(ctx, "Private"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Private = xpost_name_cons(ctx, "Private"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namewidth = xpost_name_cons(ctx, "width"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.width = xpost_name_cons(ctx, "width"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameheight = xpost_name_cons(ctx, "height"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.height = xpost_name_cons(ctx, "height"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namedotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.dotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namenativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.nativecolorspace = xpost_name_cons(ctx, "nativecolorspace"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameDeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.DeviceRGB = xpost_name_cons(ctx, "DeviceRGB"))) == invalidtype)
         return VMerror;
 
     xpost_memory_table_get_addr(ctx->gl,
@@ -654,7 +695,6 @@ int xpost_oper_init_raster_device_ops (Xpost_Context *ctx,
     optab = (Xpost_Operator *)(ctx->gl->base + optadr);
     op = xpost_operator_cons(ctx, "loadrasterdevice", (Xpost_Op_Func)loadrasterdevice, 1, 0); INSTALL;
     op = xpost_operator_cons(ctx, "loadrasterdevicecont", (Xpost_Op_Func)loadrasterdevicecont, 1, 1, dicttype);
-    _loadrasterdevicecont_opcode = op.mark_.padw;
 
     return 0;
 }
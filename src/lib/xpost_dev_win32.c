@@ -109,14 +109,6 @@ typedef struct
     } backend;
 } Render_Data;
 
-static unsigned int _event_handler_opcode;
-static unsigned int _create_cont_opcode;
-
-static Xpost_Object namePrivate;
-static Xpost_Object namewidth;
-static Xpost_Object nameheight;
-static Xpost_Object namedotcopydict;
-
 static void
 _xpost_dev_gl_win32_viewport_set(int width, int height)
 {
@@ -140,7 +132,7 @@ int _event_handler(Xpost_Context *ctx,
     MSG msg;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -184,19 +176,19 @@ int _create(Xpost_Context *ctx,
     xpost_stack_push(ctx->lo, ctx->os, width);
     xpost_stack_push(ctx->lo, ctx->os, height);
     xpost_stack_push(ctx->lo, ctx->os, classdic);
-    ret = xpost_dict_put(ctx, classdic, namewidth, width);
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.width, width);
     if (ret)
         return ret;
-    ret = xpost_dict_put(ctx, classdic, nameheight, height);
+    ret = xpost_dict_put(ctx, classdic, ctx->name_shortcuts.height, height);
     if (ret)
         return ret;
 
      /* call device class's ps-level .copydict procedure,
         then call _create_cont, by continuation. */
-    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_create_cont_opcode)))
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "win32CreateCont", NULL, 0, 0)))
         return execstackoverflow;
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -228,7 +220,7 @@ int _create_cont(Xpost_Context *ctx,
         XPOST_LOG_ERR("cannot allocate private data structure");
         return unregistered;
     }
-    ret = xpost_dict_put(ctx, devdic, namePrivate, privatestr);
+    ret = xpost_dict_put(ctx, devdic, ctx->name_shortcuts.Private, privatestr);
     if (ret)
         return ret;
 
@@ -443,7 +435,7 @@ int _create_cont(Xpost_Context *ctx,
     }
 
     xpost_context_install_event_handler(ctx,
-                                        xpost_operator_cons_opcode(_event_handler_opcode),
+                                        xpost_operator_cons(ctx, "win32EventHandler", NULL, 0, 0),
                                         devdic);
 
     /* save private data struct in string */
@@ -500,7 +492,7 @@ int _putpix(Xpost_Context *ctx,
         y = xpost_int_cons((integer)y.real_.val);
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -557,7 +549,7 @@ int _getpix(Xpost_Context *ctx,
     Render_Data *rd;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -636,7 +628,7 @@ int _drawline(Xpost_Context *ctx,
         y2 = xpost_int_cons((integer)y2.real_.val);
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -831,7 +823,7 @@ int _fillrect(Xpost_Context *ctx,
     if (y.int_.val < 0) y.int_.val = 0;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -897,7 +889,7 @@ int _flush(Xpost_Context *ctx,
     Render_Data *rd;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -942,7 +934,7 @@ int _destroy(Xpost_Context *ctx,
     Render_Data *rd;
 
     /* load private data struct from string */
-    privatestr = xpost_dict_get(ctx, devdic, namePrivate);
+    privatestr = xpost_dict_get(ctx, devdic, ctx->name_shortcuts.Private);
     if (xpost_object_get_type(privatestr) == invalidtype)
         return undefined;
     xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
@@ -1013,9 +1005,6 @@ int newwin32device(Xpost_Context *ctx,
     return 0;
 }
 
-static
-unsigned int _loadwin32devicecont_opcode;
-
 /* Specializes or sub-classes the PPMIMAGE device class.
    load PPMIMAGE
    load and call ps procedure .copydict which leaves copy on stack
@@ -1033,10 +1022,10 @@ int loadwin32device(Xpost_Context *ctx)
         return ret;
     classdic = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_operator_cons_opcode(_loadwin32devicecont_opcode)))
+                          xpost_operator_cons(ctx, "loadwin32devicecont", NULL, 0, 0)))
         return execstackoverflow;
     if (!xpost_stack_push(ctx->lo, ctx->es,
-                          xpost_dict_get(ctx, classdic, namedotcopydict)))
+                          xpost_dict_get(ctx, classdic, ctx->name_shortcuts.dotcopydict)))
         return execstackoverflow;
 
     return 0;
@@ -1059,7 +1048,6 @@ int loadwin32devicecont(Xpost_Context *ctx,
         return ret;
 
     op = xpost_operator_cons(ctx, "win32CreateCont", (Xpost_Op_Func)_create_cont, 1, 3, integertype, integertype, dicttype);
-    _create_cont_opcode = op.mark_.padw;
     op = xpost_operator_cons(ctx, "win32Create", (Xpost_Op_Func)_create, 1, 3, integertype, integertype, dicttype);
     ret = xpost_dict_put(ctx, classdic, xpost_name_cons(ctx, "Create"), op);
     if (ret)
@@ -1125,7 +1113,6 @@ int loadwin32devicecont(Xpost_Context *ctx,
         return ret;
 
     op = xpost_operator_cons(ctx, "win32EventHandler", (Xpost_Op_Func)_event_handler, 0, 1, dicttype);
-    _event_handler_opcode = op.mark_.padw;
 
     return 0;
 }
@@ -1142,13 +1129,13 @@ int xpost_oper_init_win32_device_ops(Xpost_Context *ctx,
     Xpost_Operator *optab;
     Xpost_Object n,op;
 
-    if (xpost_object_get_type((namePrivate = xpost_name_cons(ctx, "Private"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.Private = xpost_name_cons(ctx, "Private"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namewidth = xpost_name_cons(ctx, "width"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.width = xpost_name_cons(ctx, "width"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameheight = xpost_name_cons(ctx, "height"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.height = xpost_name_cons(ctx, "height"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namedotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.dotcopydict = xpost_name_cons(ctx, ".copydict"))) == invalidtype)
         return VMerror;
 
     xpost_memory_table_get_addr(ctx->gl,
@@ -1157,7 +1144,6 @@ int xpost_oper_init_win32_device_ops(Xpost_Context *ctx,
     optab = (Xpost_Operator *)(ctx->gl->base + optadr);
     op = xpost_operator_cons(ctx, "loadwin32device", (Xpost_Op_Func)loadwin32device, 1, 0); INSTALL;
     op = xpost_operator_cons(ctx, "loadwin32devicecont", (Xpost_Op_Func)loadwin32devicecont, 1, 1, dicttype);
-    _loadwin32devicecont_opcode = op.mark_.padw;
 
     return 0;
 }
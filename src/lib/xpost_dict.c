@@ -212,18 +212,42 @@ cont:
     }
 }
 
-/* more like scrambled eggs */
+/* the finalizer of MurmurHash3: each bit of h changes
+   about half of the bits of the result */
+static
+unsigned int _xpost_dict_hash_mix(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+/* hash a cleaned key (see clean_key()).
+   keys which compare equal hash equal: the flags are ignored,
+   except BANK. */
 static
 unsigned int hash(Xpost_Object k)
 {
     unsigned int h;
-    h = ( (xpost_object_get_type(k)
-            | (k.comp_.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK))
-            << 1) /* ignore flags (except BANK!) */
-        + (k.comp_.sz << 3)
-        + (xpost_object_get_ent(k) << 7)
-        + (k.comp_.off << 5);
-    /* h = xpost_object_get_type(k); /\* test collisions. *\/ */
+
+    h = (xpost_object_get_type(k)
+         | (k.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK)) * 0x9e3779b9U;
+    switch (xpost_object_get_type(k))
+    {
+        case stringtype: /*@fallthrough@*/
+        case arraytype: /*@fallthrough@*/
+        case dicttype:
+            h = _xpost_dict_hash_mix(h ^ xpost_object_get_ent(k))
+                ^ (k.comp_.sz | ((unsigned int)k.comp_.off << 16));
+            break;
+        default: /* names, numbers and the other simple objects */
+            h ^= (unsigned int)k.mark_.padw;
+            break;
+    }
+    h = _xpost_dict_hash_mix(h);
 #ifdef DEBUGDIC
     printf("\nhash(");
     xpost_object_dump(k);
@@ -232,6 +256,26 @@ unsigned int hash(Xpost_Object k)
     return h;
 }
 
+/* the number of records of the table of a dict of size sz:
+   a power of two, so the lookup masks the hash, at most 7/8
+   full when the dict is full. the size of a dict is already
+   a quarter larger than requested, see xpost_dict_cons_memory() */
+unsigned int xpost_dict_table_size(unsigned int sz)
+{
+    unsigned int n;
+
+    n = sz + (sz + 6) / 7;
+    if (n < 8)
+        return 8;
+    n--;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+    return n + 1;
+}
+
 /*
    Allocate a dictionary in the specified memory file.
 
@@ -257,6 +301,7 @@ Xpost_Object xpost_dict_cons_memory (Xpost_Memory_File *mem,
 
     if (sz < 8) sz = 8;
     sz = (unsigned int)ceil((double)sz * 1.25);
+    if (sz > XPOST_DICT_MAX_SIZE) sz = XPOST_DICT_MAX_SIZE;
 
     assert(mem->base);
     d.tag = dicttype | (XPOST_OBJECT_TAG_ACCESS_UNLIMITED << XPOST_OBJECT_TAG_DATA_FLAG_ACCESS_OFFSET);
@@ -340,9 +385,30 @@ unsigned int xpost_dict_max_length_memory (Xpost_Memory_File *mem,
     return dp->sz;
 }
 
+/*
+   save the record r of dict d, before changing it.
+   return the record, which moves if the memory file grows,
+   or NULL on error. */
+static
+dicrec *_xpost_dict_save_rec(Xpost_Memory_File *mem,
+                             Xpost_Object d,
+                             dicrec *r)
+{
+    unsigned int ad;
+    unsigned int i;
+
+    xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad);
+    i = (unsigned int)(r - (dicrec *)(mem->base + ad + sizeof(dichead)));
+    if (!xpost_save_save_slots(mem, dicttype, 0, xpost_object_get_ent(d), i, 1))
+        return NULL;
+    xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad);
+    return (dicrec *)(mem->base + ad + sizeof(dichead)) + i;
+}
+
 /*
    grow a dictionary to a larger size.
 
+   save the dictionary if necessary for save/restore,
    allocate a new dictionary,
    copy over all non-null key/value pairs,
    swap adrs in the two table slots. */
@@ -361,6 +427,9 @@ int dicgrow(Xpost_Context *ctx,
 
     xpost_stack_push(ctx->lo, ctx->hold, d);
     mem = xpost_context_select_memory(ctx, d);
+    if (!xpost_save_ent_is_saved(mem, xpost_object_get_ent(d)))
+        if (!xpost_save_save_ent(mem, dicttype, 0, xpost_object_get_ent(d)))
+            return 0;
 #ifdef DEBUGDIC
     printf("DI growing dict\n");
     xpost_dict_dump_memory (mem, d);
@@ -407,6 +476,11 @@ int dicgrow(Xpost_Context *ctx,
                tab->tab[dent].sz = tab->tab[nent].sz;
                                    tab->tab[nent].sz = hold;
 
+        /* exchange used sizes, which the chunks of a save follow */
+        hold = tab->tab[dent].used;
+               tab->tab[dent].used = tab->tab[nent].used;
+                                     tab->tab[nent].used = hold;
+
 #if 0
         if (xpost_free_memory_ent(mem, nent) < 0)
         {
@@ -451,23 +525,6 @@ void xpost_dict_dump_memory (Xpost_Memory_File *mem,
     }
 }
 
-/* construct an extendedtype object
-   from a double value */
-/*n.b. Caller Must set EXTENDEDINT or EXTENDEDREAL flag */
-/*     in order to xpost_dict_convert_extended_to_number() later. */
-static
-Xpost_Object consextended (double d)
-{
-    Xpost_Ieee_Double_As_Int r;
-    Xpost_Object o;
-
-    r.number = d;
-    o.extended_.tag = extendedtype;
-    o.extended_.sign_exp = (r.bits >> 52) & 0x7FF;
-    o.extended_.fraction = (r.bits >> 20) & 0xFFFFFFFF;
-    return o;
-}
-
 /* adapter:
    double <- extendedtype object */
 double xpost_dict_convert_extended_to_double (Xpost_Object e)
@@ -501,30 +558,43 @@ Xpost_Object xpost_dict_convert_extended_to_number (Xpost_Object e)
     return o;
 }
 
-/* make key the proper type for hashing */
+/* make key the proper type for hashing.
+
+   a string is the name with its bytes. a lookup which does not
+   intern the key only finds the name if it exists already: no
+   dict can have the key otherwise, so it yields null, which finds
+   the first null record as a missing key does. nothing is allocated.
+
+   a real with an integer value is that integer, the same key
+   as the integer. */
 static
 Xpost_Object clean_key (Xpost_Context *ctx,
-                        Xpost_Object k)
+                        Xpost_Object k,
+                        int intern)
 {
     switch(xpost_object_get_type(k))
     {
         default: break;
         case stringtype:
-        {
-            char *s = alloca(k.comp_.sz+1);
-            memcpy(s, xpost_string_get_pointer(ctx, k), k.comp_.sz);
-            s[k.comp_.sz] = '\0';
-            k = xpost_name_cons(ctx, s);
-            break;
-        }
-        case integertype:
-            k = consextended(k.int_.val);
-            k.tag |= XPOST_OBJECT_TAG_DATA_EXTENDED_INT;
+            if (intern)
+                k = xpost_name_cons_bytes(ctx, xpost_string_get_pointer(ctx, k), k.comp_.sz);
+            else
+            {
+                k = xpost_name_find(ctx, xpost_string_get_pointer(ctx, k), k.comp_.sz);
+                if (xpost_object_get_type(k) == invalidtype)
+                    k = null;
+            }
             break;
         case realtype:
-            k = consextended(k.real_.val);
-            k.tag |= XPOST_OBJECT_TAG_DATA_EXTENDED_REAL;
+        {
+            /* the range of integer, exactly representable in a double */
+            double lim = (double)((dword)1 << (8 * sizeof(integer) - 1));
+            double v = k.real_.val;
+
+            if (v >= -lim && v < lim && v == floor(v))
+                k = xpost_int_cons((integer)v);
             break;
+        }
     }
     return k;
 }
@@ -536,9 +606,20 @@ Xpost_Object clean_key (Xpost_Context *ctx,
             && xpost_dict_compare_objects(ctx, tp[i].key, k) == 0)) \
         return tp + i
 
+/* the same for a name key: names are equal if they have the same
+   index in the same name table, skip the generic comparison */
+#define RETURN_TAB_I_IF_EQ_NAME_K_OR_NULL    \
+    if ((hashval == tp[i].hash \
+         && xpost_object_get_type(tp[i].key) == nametype \
+         && tp[i].key.mark_.padw == k.mark_.padw \
+         && (tp[i].key.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK) \
+             == (k.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK)) \
+        || xpost_object_get_type(tp[i].key) == nulltype) \
+        return tp + i
+
 static dicrec invalidrec[] = {{ 0, {0}, {0}}};
 
-/* perform a hash-assisted lookup.
+/* perform a hash-assisted lookup of a cleaned key, see clean_key().
    returns a pointer to the desired pair (if found)), or a null-pair. */
 /*@dependent@*/ /*@null@*/
 static
@@ -550,12 +631,11 @@ dicrec *diclookup(Xpost_Context *ctx,
     unsigned int ad;
     dichead *dp;
     dicrec *tp;
-    unsigned int sz;
+    unsigned int mask;
     unsigned int hashval;
-    unsigned int h;
     unsigned int i;
+    unsigned int n;
 
-    k = clean_key(ctx, k);
     if (xpost_object_get_type(k) == invalidtype)
         return invalidrec;
 
@@ -563,28 +643,32 @@ dicrec *diclookup(Xpost_Context *ctx,
         return invalidrec;
     dp = (void *)(mem->base + ad);
     tp = (void *)(mem->base + ad + sizeof(dichead));
-    sz = (dp->sz + 1);
+    mask = DICTABN(dp->sz) - 1;
 
     hashval = hash(k);
-    h = hashval % sz;
-    i = h;
+    i = hashval & mask;
 #ifdef DEBUGDIC
     printf("diclookup(");
     xpost_object_dump(k);
     printf(");");
-    printf("%%%u=%u",sz, h);
+    printf("&%u=%u", mask, i);
 #endif
 
-    RETURN_TAB_I_IF_EQ_K_OR_NULL;
-    for (++i; i < sz; i++)
+    if (xpost_object_get_type(k) == nametype)
     {
-        RETURN_TAB_I_IF_EQ_K_OR_NULL;
+        for (n = 0; n <= mask; n++, i = (i + 1) & mask)
+        {
+            RETURN_TAB_I_IF_EQ_NAME_K_OR_NULL;
+        }
     }
-    for (i = 0; i < h; i++)
+    else
     {
-        RETURN_TAB_I_IF_EQ_K_OR_NULL;
+        for (n = 0; n <= mask; n++, i = (i + 1) & mask)
+        {
+            RETURN_TAB_I_IF_EQ_K_OR_NULL;
+        }
     }
-    return NULL; /* i == h : dict is overfull: no null entry */
+    return NULL; /* dict is overfull: no null entry */
 }
 
 /* see if lookup returns a non-null pair. */
@@ -595,7 +679,7 @@ int xpost_dict_known_key(Xpost_Context *ctx,
 {
     dicrec *r;
 
-    r = diclookup(ctx, mem, d, k);
+    r = diclookup(ctx, mem, d, clean_key(ctx, k, 0));
     if (r == NULL) return 0;
     if (r == invalidrec) return 0;
     return xpost_object_get_type(r->key) != nulltype;
@@ -615,7 +699,7 @@ Xpost_Object xpost_dict_get_memory (Xpost_Context *ctx,
 {
     dicrec *r;
 
-    r = diclookup(ctx, mem, d, k);
+    r = diclookup(ctx, mem, d, clean_key(ctx, k, 0));
     if (r == invalidrec){
         XPOST_LOG_ERR("warning: invalid key\n");
         return invalid;
@@ -649,8 +733,8 @@ Xpost_Object xpost_dict_get(Xpost_Context *ctx,
    Put key+value in dict with specified memory file.
    (dict must be valid for this memory file)
 
-   save data if not save at this level,
    lookup the key,
+   save the record if not saved at this level,
    if key is null, check if the dict is full,
        increase nused,
        set key,
@@ -663,6 +747,7 @@ int xpost_dict_put_memory(Xpost_Context *ctx,
 {
     dicrec *r;
     dichead *dp;
+    Xpost_Object ck;
     unsigned int ad;
     int ret;
 
@@ -670,11 +755,10 @@ int xpost_dict_put_memory(Xpost_Context *ctx,
         if (!xpost_object_is_writeable(ctx, d))
             return invalidaccess;
 
-    if (!xpost_save_ent_is_saved(mem, xpost_object_get_ent(d)))
-        if (!xpost_save_save_ent(mem, dicttype, 0, xpost_object_get_ent(d)))
-            return VMerror;
+    ck = clean_key(ctx, k, 1);
+    xpost_context_load_cache_invalidate(mem, ck);
 
-    r = diclookup(ctx, mem, d, k);
+    r = diclookup(ctx, mem, d, ck);
 
     if (r == invalidrec){
         XPOST_LOG_ERR("warning: invalid key\n");
@@ -687,11 +771,15 @@ int xpost_dict_put_memory(Xpost_Context *ctx,
         if (!ret)
             return VMerror;
 
-        r = diclookup(ctx, mem, d, k);
+        r = diclookup(ctx, mem, d, ck);
         if (r == NULL)
             return VMerror;
     }
-    else if (xpost_object_get_type(r->key) == invalidtype)
+    r = _xpost_dict_save_rec(mem, d, r);
+    if (r == NULL)
+        return VMerror;
+
+    if (xpost_object_get_type(r->key) == invalidtype)
     {
         XPOST_LOG_ERR("warning: invalidtype key in dict\n");
         r->key = null;
@@ -705,8 +793,11 @@ int xpost_dict_put_memory(Xpost_Context *ctx,
             if (!ret)
                 return VMerror;
 
-            r = diclookup(ctx, mem, d, k);
+            r = diclookup(ctx, mem, d, ck);
 
+            if (r == NULL)
+                return VMerror;
+            r = _xpost_dict_save_rec(mem, d, r);
             if (r == NULL)
                 return VMerror;
         }
@@ -714,10 +805,8 @@ int xpost_dict_put_memory(Xpost_Context *ctx,
         xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad);
         dp = (void *)(mem->base + ad);
         ++ dp->nused;
-        r->key = clean_key(ctx, k);
-        r->hash = hash(r->key);
-        if (xpost_object_get_type(r->key) == invalidtype)
-            return VMerror;
+        r->key = ck;
+        r->hash = hash(ck);
     }
     else if (xpost_object_get_type(r->value) == magictype)
     {
@@ -764,7 +853,11 @@ int xpost_dict_put(Xpost_Context *ctx,
     return xpost_dict_put_memory(ctx, xpost_context_select_memory(ctx, d), d, k, v);
 }
 
-/* undefine key from dict */
+/* undefine key from dict.
+
+   the records after the key which hash to a slot before it
+   would be lost by the probes which stop at the null left by the
+   key: shift each of them back into the hole. */
 int xpost_dict_undef_memory(Xpost_Context *ctx,
         Xpost_Memory_File *mem,
         Xpost_Object d,
@@ -774,90 +867,45 @@ int xpost_dict_undef_memory(Xpost_Context *ctx,
     unsigned int ad;
     dichead *dp;
     dicrec *tp;
-    unsigned int sz;
-    unsigned int hashval;
-    unsigned int h;
+    unsigned int mask;
+    unsigned int home;
     unsigned int i;
-    unsigned int last = 0;
-    int lastisset = 0;
-    int found = 0;
+    unsigned int j;
 
     if (!xpost_save_ent_is_saved(mem, xpost_object_get_ent(d)))
         if (!xpost_save_save_ent(mem, dicttype, 0, xpost_object_get_ent(d)))
             return VMerror;
 
-    xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad);
-    dp = (void *)(mem->base + ad);
-    tp = (void *)(mem->base + ad + sizeof(dichead));
-
-    k = clean_key(ctx, k);
-    if (xpost_object_get_type(k) == invalidtype)
-        return VMerror;
-
+    k = clean_key(ctx, k, 0);
     e = diclookup(ctx, mem, d, k); /*find slot for key */
-    if (e == NULL || e == invalidrec || xpost_dict_compare_objects(ctx,e->key,null) == 0)
+    if (e == NULL || e == invalidrec || xpost_object_get_type(e->key) == nulltype)
     {
         return undefined;
     }
 
-    /*find last chained key and value with same hash */
-    /*FIXME: need to repeat this process with this 'last chained key with same hash'
-      until the key we're clearing is the actual last key in the chain, recursively. */
-    sz = DICTABN(dp->sz);
-    hashval = hash(k);
-    h = hashval % sz;
-
-    for (i = h; i < sz; i++)
-    {
-        if (h == hash(tp[i].key) % sz)
-        {
-            last = i;
-            lastisset = 1;
-        }
-        else if (xpost_dict_compare_objects(ctx, tp[i].key, null) == 0)
-        {
-            if (lastisset)
-            {
-                found = 1;
-                break;
-            }
-        }
-    }
+    xpost_context_load_cache_invalidate(mem, k);
 
-    if (!found)
-    {
-        for (i = 0; i < h; i++)
-        {
-            if (h == hash(tp[i].key) % sz)
-            {
-                last = i;
-                lastisset = 1;
-            }
-            else if (xpost_dict_compare_objects(ctx, tp[i].key, null) == 0)
-            {
-                if (lastisset)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-        }
-    }
+    xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad);
+    dp = (void *)(mem->base + ad);
+    tp = (void *)(mem->base + ad + sizeof(dichead));
+    mask = DICTABN(dp->sz) - 1;
 
-    if (found) /* f found: move last key and value to slot */
+    i = (unsigned int)(e - tp);
+    for (j = (i + 1) & mask;
+         xpost_object_get_type(tp[j].key) != nulltype;
+         j = (j + 1) & mask)
     {
-        e->key = tp[last].key;
-        e->value = tp[last].value;
-        tp[last].key = null;
-        tp[last].hash = hash(tp[last].key);
-        tp[last].value = null;
-    }
-    else /* ot found: write null over key and value */
-    {
-        e->key = null;
-        tp[last].hash = hash(tp[last].key);
-        e->value = null;
+        /* the record j stays if it hashes between the hole and j */
+        home = tp[j].hash & mask;
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        tp[i] = tp[j];
+        i = j;
     }
+    tp[i].key = null;
+    tp[i].hash = hash(null);
+    tp[i].value = null;
+    --dp->nused;
 
     return 0;
 }
@@ -871,6 +919,43 @@ void xpost_dict_undef(Xpost_Context *ctx,
 }
 
 
+int xpost_dict_stats(Xpost_Context *ctx,
+        Xpost_Object d,
+        unsigned int *slots,
+        unsigned int *probes,
+        unsigned int *maxprobe)
+{
+    Xpost_Memory_File *mem;
+    unsigned int ad;
+    dichead *dp;
+    dicrec *tp;
+    unsigned int mask;
+    unsigned int i;
+    unsigned int n;
+
+    mem = xpost_context_select_memory(ctx, d);
+    if (!xpost_memory_table_get_addr(mem, xpost_object_get_ent(d), &ad))
+        return 0;
+    dp = (void *)(mem->base + ad);
+    tp = (void *)(mem->base + ad + sizeof(dichead));
+    mask = DICTABN(dp->sz) - 1;
+
+    *slots = mask + 1;
+    *probes = 0;
+    *maxprobe = 0;
+    for (i = 0; i <= mask; i++)
+    {
+        if (xpost_object_get_type(tp[i].key) == nulltype)
+            continue;
+        /* distance from the hashed slot, around the end of the table */
+        n = ((i - tp[i].hash) & mask) + 1;
+        *probes += n;
+        if (n > *maxprobe)
+            *maxprobe = n;
+    }
+    return 1;
+}
+
 #ifdef TESTMODULE_DI
 #include <stdio.h>
 
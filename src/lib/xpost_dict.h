@@ -44,11 +44,12 @@
  *   off, offset into allocation
 
  * The entity data is a header structure
- * followed by header->sz+1 key/value pairs of objects in a linear array.
+ * followed by DICTABN(header->sz) key/value pairs of objects in a linear array.
  * Null keys denote empty slots in the hash table.
 
- * Dicts are implicitly 1 entry larger than declared
- * in order to simplify searching (terminate on null)
+ * The table is a power of two larger than declared,
+ * so a lookup masks the hash and probes linearly
+ * until the key or a null.
  */
 
 /** @typedef typedef struct {} dichead
@@ -74,16 +75,26 @@ typedef struct Xpost_Magic_Pair
     int (*put)(Xpost_Context *ctx, Xpost_Object dict, Xpost_Object key, Xpost_Object val);
 } Xpost_Magic_Pair;
 
+/**
+ * @brief the largest size of a dict, whose table offsets fit in a word
+ */
+#define XPOST_DICT_MAX_SIZE 57344
+
 /**
  * @brief yields the number of real entries in the table for a dict of size n
  */
-#define DICTABN(n) ((n)+1)
+#define DICTABN(n) xpost_dict_table_size(n)
 
 /**
  * @brief yields the size in bytes of the table for a dict of size n
  */
 #define DICTABSZ(n) (DICTABN(n) * sizeof(dicrec))
 
+/**
+ * @brief the number of records of the table of a dict of size sz
+ */
+unsigned int xpost_dict_table_size(unsigned int sz);
+
 /**
  * @brief yield the access field from the dichead in vm
  */
@@ -180,4 +191,14 @@ int xpost_dict_undef_memory(Xpost_Context *ctx, Xpost_Memory_File *mem, Xpost_Ob
 */
 void xpost_dict_undef(Xpost_Context *ctx, Xpost_Object d, Xpost_Object k);
 
+/**
+ * @brief yield the records of the table of dict d, the sum of the
+ * probes which find its keys and the longest of them.
+ *
+ * A key in its hashed record takes 1 probe. The load factor is the
+ * length of the dict over slots, the mean probe length probes over
+ * the length.
+ */
+int xpost_dict_stats(Xpost_Context *ctx, Xpost_Object d, unsigned int *slots, unsigned int *probes, unsigned int *maxprobe);
+
 #endif
@@ -64,12 +64,27 @@ void *alloca (size_t);
 
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h> /* SIZE_MAX */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#ifdef HAVE_UNISTD_H
+# include <unistd.h> /* read lseek */
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h> /* mmap munmap */
+#endif
+
+#ifdef _WIN32
+# include <io.h>
+# define read(f, p, s) _read(f, p, s)
+# define lseek(f, p, fl) _lseek(f, p, fl)
+#endif
+
 #include "xpost.h"
 #include "xpost_log.h"
 #include "xpost_compat.h"
@@ -231,6 +246,25 @@ disk_seek(Xpost_File *file, long offset)
     return fseek(df->file, offset, SEEK_SET);
 }
 
+static long
+disk_bytesavailable(Xpost_File *file)
+{
+    Xpost_DiskFile *df = (Xpost_DiskFile*) file;
+    struct stat sb;
+
+    if (!df->file)
+        return -1;
+    if (fstat(fileno(df->file), &sb) != 0)
+    {
+        XPOST_LOG_ERR("fstat did not return 0");
+        return -1;
+    }
+    if (sb.st_size > LONG_MAX)
+        return -1;
+
+    return (long)sb.st_size - ftell(df->file);
+}
+
 struct Xpost_File_Methods disk_methods =
 {
     disk_readch,
@@ -240,7 +274,8 @@ struct Xpost_File_Methods disk_methods =
     disk_purge,
     disk_unreadch,
     disk_tell,
-    disk_seek
+    disk_seek,
+    disk_bytesavailable
 };
 
 static Xpost_File *
@@ -258,6 +293,204 @@ xpost_diskfile_open(const FILE *fp)
 }
 
 
+/*
+   BufferedFile: a read-only disk file which pulls a whole block
+   with one read() and then serves readch/unreadch out of memory.
+   The last byte of the previous block is carried over to buffer[0]
+   on every refill so a single unreadch is always possible.
+   The readiness check (select) is only done when the block is
+   exhausted, not on every byte.
+ */
+static int
+buffered_fill(Xpost_BufferedFile *bf)
+{
+    size_t keep = 0;
+    ssize_t n;
+
+#ifdef HAVE_SYS_SELECT_H
+    {
+        fd_set reads, writes, excepts;
+        int ret;
+        struct timeval tv_timeout;
+        FD_ZERO(&reads);
+        FD_ZERO(&writes);
+        FD_ZERO(&excepts);
+        FD_SET(bf->fd, &reads);
+        tv_timeout.tv_sec = 0;
+        tv_timeout.tv_usec = 0;
+
+        ret = select(bf->fd + 1, &reads, &writes, &excepts, &tv_timeout);
+
+        if (ret <= 0 || !FD_ISSET(bf->fd, &reads))
+        {
+            /* block not available, caller may retry */
+            errno=EINTR;
+            return EOF;
+        }
+    }
+#endif
+
+    if (bf->read_limit)
+    {
+        bf->buffer[0] = bf->buffer[bf->read_limit - 1];
+        keep = 1;
+    }
+    n = read(bf->fd, bf->buffer + keep, XPOST_FILE_BUFFER_SIZE - keep);
+    if (n <= 0)
+        return EOF;
+
+    bf->offset += (long)(bf->read_limit - keep);
+    bf->read_next = keep;
+    bf->read_limit = keep + n;
+    return 0;
+}
+
+static int
+buffered_readch(Xpost_File *file)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+
+    if (bf->read_next == bf->read_limit)
+    {
+        if (!bf->file)
+            return EOF;
+        if (buffered_fill(bf) == EOF)
+            return EOF;
+    }
+
+    return bf->buffer[ bf->read_next++ ];
+}
+
+static int
+buffered_writech(Xpost_File *file, int c)
+{
+    (void)file;
+    (void)c;
+    return EOF;
+}
+
+static int
+buffered_close(Xpost_File *file)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+    FILE *fp = bf->file;
+    int ret;
+
+    bf->read_next = bf->read_limit = 0;
+    if (fp == stdin) /* do NOT close standard files */
+        return 0;
+    ret = fclose(fp);
+    bf->file = NULL;
+
+    return ret;
+}
+
+static int
+buffered_flush(Xpost_File *file)
+{
+    (void)file;
+    return 0;
+}
+
+static void
+buffered_purge(Xpost_File *file)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+
+    bf->read_next = bf->read_limit;
+}
+
+static int
+buffered_unreadch(Xpost_File *file, int c)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+
+    if (bf->read_next == 0)
+        return EOF;
+
+    bf->buffer[ --bf->read_next ] = c;
+    return c;
+}
+
+static long
+buffered_tell(Xpost_File *file)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+
+    return bf->offset + (long)bf->read_next;
+}
+
+static int
+buffered_seek(Xpost_File *file, long offset)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+
+    if (offset >= bf->offset && offset <= bf->offset + (long)bf->read_limit)
+    { /* still inside the current block */
+        bf->read_next = offset - bf->offset;
+        return 0;
+    }
+
+    if (lseek(bf->fd, offset, SEEK_SET) == -1)
+        return EOF;
+    bf->offset = offset;
+    bf->read_next = bf->read_limit = 0;
+    return 0;
+}
+
+static long
+buffered_bytesavailable(Xpost_File *file)
+{
+    Xpost_BufferedFile *bf = (Xpost_BufferedFile*) file;
+    struct stat sb;
+
+    if (!bf->file)
+        return -1;
+    if (fstat(bf->fd, &sb) != 0)
+    {
+        XPOST_LOG_ERR("fstat did not return 0");
+        return -1;
+    }
+    if (!S_ISREG(sb.st_mode)) /* pipe or terminal: only what is buffered */
+        return (long)(bf->read_limit - bf->read_next);
+    if (sb.st_size > LONG_MAX)
+        return -1;
+
+    return (long)sb.st_size - buffered_tell(file);
+}
+
+struct Xpost_File_Methods buffered_methods =
+{
+    buffered_readch,
+    buffered_writech,
+    buffered_close,
+    buffered_flush,
+    buffered_purge,
+    buffered_unreadch,
+    buffered_tell,
+    buffered_seek,
+    buffered_bytesavailable
+};
+
+static Xpost_File *
+xpost_bufferedfile_open(const FILE *fp)
+{
+    Xpost_BufferedFile *bf = malloc(sizeof *bf);
+
+    if (!bf)
+        return NULL;
+
+    bf->methods.methods = &buffered_methods;
+    bf->file = (FILE*)fp;
+    bf->fd = fileno(bf->file);
+    bf->offset = 0;
+    bf->read_next = 0;
+    bf->read_limit = 0;
+
+    return &bf->methods;
+}
+
+
 static int
 memory_readch(Xpost_File *f)
 {
@@ -300,6 +533,10 @@ memory_close(Xpost_File *f)
 
     if (mf->is_malloc)
         free(mf->contents);
+#ifdef HAVE_MMAP
+    else if (mf->is_mmap && mf->contents)
+        munmap(mf->contents, mf->read_limit);
+#endif
 
     mf->contents = NULL;
     mf->read_next =
@@ -338,7 +575,10 @@ memory_unreadch(Xpost_File *f, int c)
     if (mf->read_next <= 0)
         return EOF;
 
-    mf->contents[ --mf->read_next ] = c;
+    /* the contents may be a read-only mapping or a caller's buffer,
+       so only step back over the byte that was read. */
+    (void)c;
+    --mf->read_next;
     return 0;
 }
 
@@ -362,6 +602,17 @@ memory_seek(Xpost_File *f, long pos)
     return 0;
 }
 
+static long
+memory_bytesavailable(Xpost_File *f)
+{
+    Xpost_MemoryFile *mf = (Xpost_MemoryFile *)f;
+
+    if (!mf->is_read)
+        return -1;
+
+    return (long)(mf->read_limit - mf->read_next);
+}
+
 struct Xpost_File_Methods memory_methods =
 {
     memory_readch,
@@ -371,7 +622,8 @@ struct Xpost_File_Methods memory_methods =
     memory_purge,
     memory_unreadch,
     memory_tell,
-    memory_seek
+    memory_seek,
+    memory_bytesavailable
 };
 
 static Xpost_File *
@@ -385,6 +637,7 @@ xpost_memoryfile_open_read(unsigned char *ptr, size_t limit)
         mf->contents = ptr;
         mf->is_read = 1;
         mf->is_malloc = 0;
+        mf->is_mmap = 0;
         mf->read_next = 0;
         mf->read_limit = limit;
     }
@@ -403,6 +656,7 @@ xpost_memoryfile_open_write(void)
 	mf->contents = NULL;
 	mf->is_read = 0;
 	mf->is_malloc = 1;
+	mf->is_mmap = 0;
 	mf->write_next = 0;
 	mf->write_capacity = 0;
     }
@@ -410,6 +664,43 @@ xpost_memoryfile_open_write(void)
     return &mf->methods;
 }
 
+#ifdef HAVE_MMAP
+/* map a regular disk file read-only into memory.
+   the mapping outlives the descriptor, which the caller closes
+   once the file is installed. */
+static Xpost_File *
+xpost_mappedfile_open(FILE *fp)
+{
+    Xpost_MemoryFile *mf;
+    struct stat sb;
+    void *ptr;
+
+    if (fstat(fileno(fp), &sb) != 0)
+        return NULL;
+    if (!S_ISREG(sb.st_mode) || sb.st_size <= 0 ||
+        (unsigned long long)sb.st_size > SIZE_MAX)
+        return NULL;
+
+    ptr = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE,
+               fileno(fp), 0);
+    if (ptr == MAP_FAILED)
+        return NULL;
+#ifdef MADV_SEQUENTIAL
+    (void)madvise(ptr, (size_t)sb.st_size, MADV_SEQUENTIAL);
+#endif
+
+    mf = (Xpost_MemoryFile *)xpost_memoryfile_open_read(ptr, (size_t)sb.st_size);
+    if (!mf)
+    {
+        munmap(ptr, (size_t)sb.st_size);
+        return NULL;
+    }
+    mf->is_mmap = 1;
+
+    return &mf->methods;
+}
+#endif
+
 /* filetype objects use a slightly different interpretation
    of the access field.
    It uses two flags rather than a 2-bit number.
@@ -458,6 +749,81 @@ Xpost_Object xpost_file_cons(Xpost_Memory_File *mem,
     return f;
 }
 
+/* construct a read-only filetype object
+   over an open FILE* which is read in blocks
+   rather than byte by byte. */
+Xpost_Object xpost_file_cons_buffered(Xpost_Memory_File *mem,
+                                      const FILE *fp)
+{
+    Xpost_Object f;
+    unsigned int ent;
+    int ret;
+    Xpost_File *bf;
+
+    f.tag = filetype;
+    bf = xpost_bufferedfile_open(fp);
+    if (!bf)
+    {
+        XPOST_LOG_ERR("cannot allocate buffered file");
+        return invalid;
+    }
+    if (!xpost_memory_table_alloc(mem, sizeof bf, filetype, &ent))
+    {
+        XPOST_LOG_ERR("cannot allocate file record");
+        free(bf);
+        return invalid;
+    }
+    f.mark_.padw = ent;
+    ret = xpost_memory_put(mem, f.mark_.padw, 0, sizeof bf, &bf);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot save file pointer in VM");
+        free(bf);
+        return invalid;
+    }
+    return f;
+}
+
+/* construct a read-only filetype object
+   over the whole contents of an open FILE*,
+   mapped into memory if the platform and the file allow it,
+   otherwise block-buffered. */
+Xpost_Object xpost_file_cons_mapped(Xpost_Memory_File *mem,
+                                    const FILE *fp)
+{
+    Xpost_Object f;
+    unsigned int ent;
+    int ret;
+    Xpost_File *mf = NULL;
+
+#ifdef HAVE_MMAP
+    mf = xpost_mappedfile_open((FILE *)fp);
+#endif
+    if (!mf)
+        return xpost_file_cons_buffered(mem, fp);
+
+    f.tag = filetype;
+    if (!xpost_memory_table_alloc(mem, sizeof mf, filetype, &ent))
+    {
+        XPOST_LOG_ERR("cannot allocate file record");
+        goto unmap;
+    }
+    f.mark_.padw = ent;
+    ret = xpost_memory_put(mem, f.mark_.padw, 0, sizeof mf, &mf);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot save file pointer in VM");
+        goto unmap;
+    }
+    fclose((FILE *)fp);
+    return f;
+
+unmap:
+    xpost_file_close(mf);
+    free(mf);
+    return invalid;
+}
+
 Xpost_Object xpost_file_cons_readbuffer(Xpost_Memory_File *mem,
 					unsigned char *ptr,
 					size_t limit)
@@ -720,7 +1086,15 @@ int xpost_file_open(Xpost_Memory_File *mem,
                     break;
             }
         }
-        f = xpost_file_cons(mem, fp);
+        if (strcmp(mode, "r") == 0)
+            f = xpost_file_cons_mapped(mem, fp);
+        else
+            f = xpost_file_cons(mem, fp);
+        if (xpost_object_get_type(f) == invalidtype)
+        {
+            fclose(fp);
+            return VMerror;
+        }
         if (strcmp(mode, "r") == 0)
         {
             f.tag &= ~XPOST_OBJECT_TAG_DATA_FLAG_ACCESS_MASK;
@@ -770,6 +1144,58 @@ Xpost_File *xpost_file_get_file_pointer(Xpost_Memory_File *mem,
     return fp;
 }
 
+/* yield the MemoryFile if the file is readable from memory,
+   so a scanner can consume it directly. */
+Xpost_MemoryFile *xpost_file_get_read_buffer(Xpost_File *f)
+{
+    Xpost_MemoryFile *mf;
+
+    if (!f || f->methods != &memory_methods)
+        return NULL;
+    mf = (Xpost_MemoryFile *)f;
+    if (!mf->is_read || !mf->contents)
+        return NULL;
+    return mf;
+}
+
+/* expose the unread bytes the file holds in memory,
+   so a scanner can consume them in bulk. */
+int xpost_file_peek(Xpost_File *f,
+                    const unsigned char **ptr,
+                    size_t *len,
+                    int *final)
+{
+    if (f->methods == &memory_methods)
+    {
+        Xpost_MemoryFile *mf = (Xpost_MemoryFile *)f;
+        if (!mf->is_read || !mf->contents)
+            return 0;
+        *ptr = mf->contents + mf->read_next;
+        *len = mf->read_limit - mf->read_next;
+        *final = 1;
+        return 1;
+    }
+    if (f->methods == &buffered_methods)
+    {
+        Xpost_BufferedFile *bf = (Xpost_BufferedFile *)f;
+        if (!bf->file)
+            return 0;
+        *ptr = bf->buffer + bf->read_next;
+        *len = bf->read_limit - bf->read_next;
+        *final = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void xpost_file_skip(Xpost_File *f, size_t n)
+{
+    if (f->methods == &memory_methods)
+        ((Xpost_MemoryFile *)f)->read_next += n;
+    else if (f->methods == &buffered_methods)
+        ((Xpost_BufferedFile *)f)->read_next += n;
+}
+
 /* make sure the FILE* is not null */
 int xpost_file_get_status(Xpost_Memory_File *mem,
                           Xpost_Object f)
@@ -777,34 +1203,23 @@ int xpost_file_get_status(Xpost_Memory_File *mem,
     return xpost_file_get_file_pointer(mem, f) != NULL;
 }
 
-//FIXME assumes DiskFile subtype
-/* call fstat. */
+/* ask the file how many bytes remain. */
 int xpost_file_get_bytes_available(Xpost_Memory_File *mem,
                                    Xpost_Object f,
                                    int *retval)
 {
-    int ret;
-    FILE *fp;
-    struct stat sb;
-    long sz, pos;
+    Xpost_File *fp;
+    long avail;
 
-    fp = ((Xpost_DiskFile*)xpost_file_get_file_pointer(mem, f))->file;
+    fp = xpost_file_get_file_pointer(mem, f);
     if (!fp) return ioerror;
-    ret = fstat(fileno(fp), &sb);
-    if (ret != 0)
-    {
-        XPOST_LOG_ERR("fstat did not return 0");
+    avail = xpost_file_bytesavailable(fp);
+    if (avail < 0)
         return ioerror;
-    }
-    if (sb.st_size > LONG_MAX)
-        return rangecheck;
-    sz = (long)sb.st_size;
-
-    pos = ftell(fp);
-    if ((sz - pos) > INT_MAX)
+    if (avail > INT_MAX)
         return rangecheck;
 
-    *retval = (int)(sz - pos);
+    *retval = (int)avail;
 
     return 0;
 }
@@ -71,6 +71,7 @@ typedef struct Xpost_File_Methods
     int (*unreadch)(Xpost_File*, int);
     long (*tell)(Xpost_File*);
     int (*seek)(Xpost_File*, long);
+    long (*bytesavailable)(Xpost_File*);
 } Xpost_File_Methods;
 
 struct Xpost_File
@@ -84,12 +85,32 @@ typedef struct Xpost_DiskFile
     FILE *file;
 } Xpost_DiskFile;
 
+/*
+   size of the read-ahead block of a BufferedFile.
+   The scanner consumes a read-only file one byte at a time,
+   so a BufferedFile fills this block with a single read()
+   and serves readch and unreadch out of memory.
+   */
+#define XPOST_FILE_BUFFER_SIZE 65536
+
+typedef struct Xpost_BufferedFile
+{
+    Xpost_File methods;
+    FILE *file;
+    int fd;
+    long offset; /* file position of buffer[0] */
+    size_t read_next;
+    size_t read_limit;
+    unsigned char buffer[XPOST_FILE_BUFFER_SIZE];
+} Xpost_BufferedFile;
+
 typedef struct Xpost_MemoryFile
 {
     Xpost_File methods;
     unsigned char *contents;
     int is_malloc;
     int is_read;
+    int is_mmap; /* contents is a read-only mapping of a disk file */
     size_t read_next;
     size_t read_limit;
     size_t write_next;
@@ -152,14 +173,40 @@ int xpost_file_seek(Xpost_File *f, long offset)
     return f->methods->seek(f, offset);
 }
 
+static inline
+long xpost_file_bytesavailable(Xpost_File *f)
+{
+    return f->methods->bytesavailable(f);
+}
+
 
 /**
  * @brief Construct a file object given a FILE*.
  */
 Xpost_Object xpost_file_cons(Xpost_Memory_File *mem, /*@NULL@*/ const FILE *fp);
 
+/**
+ * @brief Construct a block-buffered, read-only file object given a FILE*.
+ *
+ * On failure, the invalid object is returned and @p fp is left open.
+ */
+Xpost_Object xpost_file_cons_buffered(Xpost_Memory_File *mem, const FILE *fp);
+
+/**
+ * @brief Construct a read-only file object given a FILE*,
+ * mapping the whole file into memory when possible and
+ * falling back to a block-buffered file otherwise.
+ *
+ * A mapped @p fp is closed once the object is made. On failure, the
+ * invalid object is returned and @p fp is left open.
+ */
+Xpost_Object xpost_file_cons_mapped(Xpost_Memory_File *mem, const FILE *fp);
+
 /**
  * @brief Construct a file object wrapping a pointer and size.
+ *
+ * The memory is not copied and must stay valid as long as
+ * the file object is readable.
  */
 Xpost_Object xpost_file_cons_readbuffer(Xpost_Memory_File *mem, unsigned char *str, size_t limit);
 
@@ -178,6 +225,26 @@ int xpost_file_open(Xpost_Memory_File *mem, char *fn, char *mode, Xpost_Object *
  */
 Xpost_File *xpost_file_get_file_pointer(Xpost_Memory_File *mem, Xpost_Object f);
 
+/**
+ * @brief Return the file as a readable Xpost_MemoryFile, or NULL
+ * if its contents are not held in memory.
+ */
+Xpost_MemoryFile *xpost_file_get_read_buffer(Xpost_File *f);
+
+/**
+ * @brief Expose the unread bytes the file already holds in memory.
+ *
+ * On success, @p ptr and @p len describe the bytes which the next
+ * reads would return and @p final is set if they run to the end of
+ * the file. Returns 0 if the file keeps no such buffer.
+ */
+int xpost_file_peek(Xpost_File *f, const unsigned char **ptr, size_t *len, int *final);
+
+/**
+ * @brief Consume @p n bytes previously exposed by xpost_file_peek().
+ */
+void xpost_file_skip(Xpost_File *f, size_t n);
+
 /**
  * @brief Get the status of the file object.
  */
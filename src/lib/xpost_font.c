@@ -34,6 +34,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h> /* memcpy strcmp */
 
 #ifdef HAVE_FONTCONFIG
 # include <fontconfig/fontconfig.h>
@@ -45,6 +46,7 @@
 #endif
 
 #include "xpost.h"
+#include "xpost_compat.h" /* XPOST_THREAD_LOCAL */
 #include "xpost_log.h"
 #include "xpost_object.h"
 #include "xpost_font.h"
@@ -54,7 +56,189 @@ static FcConfig *_xpost_font_fc_config = NULL;
 #endif
 
 #ifdef HAVE_FREETYPE
-static FT_Library _xpost_font_ft_library = NULL;
+/*
+ * A FreeType library and its faces must not be used by several
+ * threads at once, so each thread opens its own library, and has its
+ * own caches of faces and glyphs.
+ */
+static XPOST_THREAD_LOCAL FT_Library _xpost_font_ft_library = NULL;
+
+/* bytes of rendered glyphs kept by xpost_font_face_glyph_cache_get() */
+# ifndef XPOST_FONT_GLYPH_CACHE_SIZE
+#  define XPOST_FONT_GLYPH_CACHE_SIZE (1024 * 1024)
+# endif
+
+/* must be a power of 2 */
+# define XPOST_FONT_GLYPH_CACHE_BUCKETS 512
+
+/* size and transformation last set on a face, kept in face->generic */
+typedef struct
+{
+    FT_F26Dot6 size;
+    FT_Matrix matrix;
+} Xpost_Font_Face_State;
+
+typedef struct _Xpost_Font_Glyph Xpost_Font_Glyph;
+
+struct _Xpost_Font_Glyph
+{
+    Xpost_Font_Glyph *next; /* hash chain */
+    Xpost_Font_Glyph *lru_prev;
+    Xpost_Font_Glyph *lru_next;
+    size_t size; /* bytes accounted to the cache */
+
+    FT_Face face;
+    Xpost_Font_Face_State state;
+    unsigned int glyph_index;
+
+    int rows;
+    int width;
+    int pitch;
+    char pixel_mode;
+    int left;
+    int top;
+    long advance_x;
+    long advance_y;
+    unsigned char buffer[1];
+};
+
+/* must be a power of 2 */
+# define XPOST_FONT_FACE_CACHE_BUCKETS 64
+
+/* faces opened by xpost_font_face_new_from_name(), by requested name */
+typedef struct _Xpost_Font_Face_Entry Xpost_Font_Face_Entry;
+
+struct _Xpost_Font_Face_Entry
+{
+    Xpost_Font_Face_Entry *next;
+    FT_Face face;
+    char name[1];
+};
+
+static XPOST_THREAD_LOCAL Xpost_Font_Face_Entry *_xpost_font_face_buckets[XPOST_FONT_FACE_CACHE_BUCKETS];
+static XPOST_THREAD_LOCAL unsigned long _xpost_font_face_cache_hits = 0;
+static XPOST_THREAD_LOCAL unsigned long _xpost_font_face_cache_misses = 0;
+
+static XPOST_THREAD_LOCAL Xpost_Font_Glyph *_xpost_font_glyph_buckets[XPOST_FONT_GLYPH_CACHE_BUCKETS];
+static XPOST_THREAD_LOCAL Xpost_Font_Glyph *_xpost_font_glyph_lru_first = NULL; /* most recently used */
+static XPOST_THREAD_LOCAL Xpost_Font_Glyph *_xpost_font_glyph_lru_last = NULL;
+static XPOST_THREAD_LOCAL size_t _xpost_font_glyph_cache_size = 0;
+
+static unsigned int
+_xpost_font_glyph_hash(FT_Face face, const Xpost_Font_Face_State *state, unsigned int glyph_index)
+{
+    unsigned long h;
+
+    h = (unsigned long)(size_t)face >> 4;
+    h = h * 31 + (unsigned long)state->size;
+    h = h * 31 + (unsigned long)state->matrix.xx;
+    h = h * 31 + (unsigned long)state->matrix.xy;
+    h = h * 31 + (unsigned long)state->matrix.yx;
+    h = h * 31 + (unsigned long)state->matrix.yy;
+    h = h * 31 + glyph_index;
+    h ^= h >> 16;
+
+    return (unsigned int)h & (XPOST_FONT_GLYPH_CACHE_BUCKETS - 1);
+}
+
+static void
+_xpost_font_glyph_lru_unlink(Xpost_Font_Glyph *glyph)
+{
+    if (glyph->lru_prev)
+        glyph->lru_prev->lru_next = glyph->lru_next;
+    else
+        _xpost_font_glyph_lru_first = glyph->lru_next;
+    if (glyph->lru_next)
+        glyph->lru_next->lru_prev = glyph->lru_prev;
+    else
+        _xpost_font_glyph_lru_last = glyph->lru_prev;
+}
+
+static void
+_xpost_font_glyph_lru_push(Xpost_Font_Glyph *glyph)
+{
+    glyph->lru_prev = NULL;
+    glyph->lru_next = _xpost_font_glyph_lru_first;
+    if (_xpost_font_glyph_lru_first)
+        _xpost_font_glyph_lru_first->lru_prev = glyph;
+    else
+        _xpost_font_glyph_lru_last = glyph;
+    _xpost_font_glyph_lru_first = glyph;
+}
+
+static void
+_xpost_font_glyph_remove(Xpost_Font_Glyph *glyph)
+{
+    Xpost_Font_Glyph **link;
+
+    link = &_xpost_font_glyph_buckets[_xpost_font_glyph_hash(glyph->face, &glyph->state, glyph->glyph_index)];
+    while (*link != glyph)
+        link = &(*link)->next;
+    *link = glyph->next;
+
+    _xpost_font_glyph_lru_unlink(glyph);
+    _xpost_font_glyph_cache_size -= glyph->size;
+    free(glyph);
+}
+
+/* drop the cached glyphs of face, or all of them if face is NULL */
+static void
+_xpost_font_glyph_cache_flush(FT_Face face)
+{
+    Xpost_Font_Glyph *glyph;
+    Xpost_Font_Glyph *prev;
+
+    for (glyph = _xpost_font_glyph_lru_last; glyph; glyph = prev)
+    {
+        prev = glyph->lru_prev;
+        if (!face || glyph->face == face)
+            _xpost_font_glyph_remove(glyph);
+    }
+}
+
+static unsigned int
+_xpost_font_face_hash(const char *name)
+{
+    unsigned int h = 5381;
+
+    while (*name)
+        h = h * 33 + (unsigned char)*name++;
+
+    return h & (XPOST_FONT_FACE_CACHE_BUCKETS - 1);
+}
+
+/* called by FT_Done_Face() */
+static void
+_xpost_font_face_state_free(void *object)
+{
+    FT_Face face = object;
+
+    _xpost_font_glyph_cache_flush(face);
+    free(face->generic.data);
+    face->generic.data = NULL;
+}
+
+static Xpost_Font_Face_State *
+_xpost_font_face_state_get(FT_Face face)
+{
+    Xpost_Font_Face_State *state;
+
+    if (face->generic.data)
+        return face->generic.data;
+
+    state = malloc(sizeof(Xpost_Font_Face_State));
+    if (!state)
+        return NULL;
+    state->size = 0;
+    state->matrix.xx = 0x10000L;
+    state->matrix.xy = 0;
+    state->matrix.yx = 0;
+    state->matrix.yy = 0x10000L;
+    face->generic.data = state;
+    face->generic.finalizer = _xpost_font_face_state_free;
+
+    return state;
+}
 #endif
 
 int
@@ -98,8 +282,36 @@ xpost_font_quit(void)
     FcFini();
 #endif
 
+    xpost_font_thread_quit();
+}
+
+void
+xpost_font_thread_quit(void)
+{
 #ifdef HAVE_FREETYPE
+    int i;
+
+    if (!_xpost_font_ft_library)
+        return;
+
+    XPOST_LOG_INFO("font face cache: %lu hits, %lu misses",
+                   _xpost_font_face_cache_hits, _xpost_font_face_cache_misses);
+
+    /* the face finalizers flush the glyphs of the faces still open */
     FT_Done_FreeType(_xpost_font_ft_library);
+    _xpost_font_ft_library = NULL;
+    _xpost_font_glyph_cache_flush(NULL);
+
+    for (i = 0; i < XPOST_FONT_FACE_CACHE_BUCKETS; i++)
+    {
+        while (_xpost_font_face_buckets[i])
+        {
+            Xpost_Font_Face_Entry *entry = _xpost_font_face_buckets[i];
+
+            _xpost_font_face_buckets[i] = entry->next;
+            free(entry);
+        }
+    }
 #endif
 }
 
@@ -167,11 +379,34 @@ void *
 xpost_font_face_new_from_name(const char *name)
 {
 #ifdef HAVE_FREETYPE
+    Xpost_Font_Face_Entry *entry;
     FT_Face face;
     FT_Error err;
     char *filename;
+    unsigned int h;
     int idx;
 
+    h = _xpost_font_face_hash(name);
+    for (entry = _xpost_font_face_buckets[h]; entry; entry = entry->next)
+    {
+        if (strcmp(entry->name, name) == 0)
+        {
+            _xpost_font_face_cache_hits++;
+            return entry->face;
+        }
+    }
+    _xpost_font_face_cache_misses++;
+
+    /* the threads other than the one of xpost_init() open their
+       library with their first face */
+    if (!_xpost_font_ft_library &&
+        FT_Init_FreeType(&_xpost_font_ft_library))
+    {
+        XPOST_LOG_ERR("cannot initialize FreeType");
+        _xpost_font_ft_library = NULL;
+        return NULL;
+    }
+
     filename = _xpost_font_face_filename_and_index_get(name, &idx);
     if (!filename)
         return NULL;
@@ -192,6 +427,15 @@ xpost_font_face_new_from_name(const char *name)
 
     free(filename);
 
+    entry = malloc(sizeof(Xpost_Font_Face_Entry) + strlen(name));
+    if (entry)
+    {
+        strcpy(entry->name, name);
+        entry->face = face;
+        entry->next = _xpost_font_face_buckets[h];
+        _xpost_font_face_buckets[h] = entry;
+    }
+
     return face;
 #else
     (void)name;
@@ -204,19 +448,58 @@ void
 xpost_font_face_free(void *face)
 {
 #ifdef HAVE_FREETYPE
+    Xpost_Font_Face_Entry **link;
+    int i;
+
     if (!face)
         return;
 
+    for (i = 0; i < XPOST_FONT_FACE_CACHE_BUCKETS; i++)
+    {
+        for (link = &_xpost_font_face_buckets[i]; *link; link = &(*link)->next)
+        {
+            if ((*link)->face == face)
+            {
+                Xpost_Font_Face_Entry *entry = *link;
+
+                *link = entry->next;
+                free(entry);
+                break;
+            }
+        }
+    }
+
     FT_Done_Face(face);
 #else
     (void)face;
 #endif
 }
 
+void
+xpost_font_face_cache_stats_get(unsigned long *hits, unsigned long *misses)
+{
+#ifdef HAVE_FREETYPE
+    *hits = _xpost_font_face_cache_hits;
+    *misses = _xpost_font_face_cache_misses;
+#else
+    *hits = 0;
+    *misses = 0;
+#endif
+}
+
 void
 xpost_font_face_scale(void *face, real scale)
 {
 #ifdef HAVE_FREETYPE
+    Xpost_Font_Face_State *state;
+
+    state = _xpost_font_face_state_get((FT_Face)face);
+    if (state)
+    {
+        if (state->size == (FT_F26Dot6)(scale * 64))
+            return;
+        state->size = (FT_F26Dot6)(scale * 64);
+    }
     FT_Set_Char_Size((FT_Face)face, 0, (FT_F26Dot6)(scale * 64), 96, 96);
 #else
     (void)face;
@@ -228,6 +511,7 @@ void
 xpost_font_face_transform(void *face, float *mat)
 {
 #ifdef HAVE_FREETYPE
+    Xpost_Font_Face_State *state;
     FT_Matrix matrix;
     //FT_Vector pen;
     matrix.xx = (FT_Fixed)(mat[0] * 0x10000L);
@@ -236,6 +520,14 @@ xpost_font_face_transform(void *face, float *mat)
     matrix.yy = (FT_Fixed)(mat[3] * 0x10000L);
     //pen.x = (FT_F26Dot6)(mat[4] * 64.0);
     //pen.y = (FT_F26Dot6)(mat[5] * 64.0);
+    state = _xpost_font_face_state_get((FT_Face)face);
+    if (state)
+    {
+        if (state->matrix.xx == matrix.xx && state->matrix.xy == matrix.xy &&
+            state->matrix.yx == matrix.yx && state->matrix.yy == matrix.yy)
+            return;
+        state->matrix = matrix;
+    }
     FT_Set_Transform((FT_Face)face, &matrix, 0);
 #else
     (void)face;
@@ -319,6 +611,105 @@ xpost_font_face_glyph_buffer_get(void *face, unsigned char **buffer, int *rows,
 #endif
 }
 
+int
+xpost_font_face_glyph_cache_get(void *face, unsigned int glyph_index, const unsigned char **buffer, int *rows, int *width, int *pitch, char *pixel_mode, int *left, int *top, long *advance_x, long *advance_y)
+{
+#ifdef HAVE_FREETYPE
+    Xpost_Font_Face_State *state;
+    Xpost_Font_Glyph *glyph;
+    FT_Bitmap *bitmap;
+    unsigned int h;
+    size_t bytes;
+
+    state = _xpost_font_face_state_get((FT_Face)face);
+    if (!state)
+        return 0;
+
+    h = _xpost_font_glyph_hash(face, state, glyph_index);
+    for (glyph = _xpost_font_glyph_buckets[h]; glyph; glyph = glyph->next)
+    {
+        if (glyph->face == face &&
+            glyph->glyph_index == glyph_index &&
+            glyph->state.size == state->size &&
+            glyph->state.matrix.xx == state->matrix.xx &&
+            glyph->state.matrix.xy == state->matrix.xy &&
+            glyph->state.matrix.yx == state->matrix.yx &&
+            glyph->state.matrix.yy == state->matrix.yy)
+            break;
+    }
+
+    if (glyph)
+    {
+        _xpost_font_glyph_lru_unlink(glyph);
+        _xpost_font_glyph_lru_push(glyph);
+    }
+    else
+    {
+        if (!xpost_font_face_glyph_render(face, glyph_index))
+            return 0;
+
+        bitmap = &((FT_Face)face)->glyph->bitmap;
+        bytes = (size_t)bitmap->rows * abs(bitmap->pitch);
+        glyph = malloc(sizeof(Xpost_Font_Glyph) + bytes);
+        if (!glyph)
+        {
+            XPOST_LOG_ERR("cannot allocate glyph cache entry");
+            return 0;
+        }
+        glyph->size = sizeof(Xpost_Font_Glyph) + bytes;
+        glyph->face = face;
+        glyph->state = *state;
+        glyph->glyph_index = glyph_index;
+        glyph->rows = bitmap->rows;
+        glyph->width = bitmap->width;
+        glyph->pitch = bitmap->pitch;
+        glyph->pixel_mode = bitmap->pixel_mode;
+        glyph->left = ((FT_Face)face)->glyph->bitmap_left;
+        glyph->top = ((FT_Face)face)->glyph->bitmap_top;
+        glyph->advance_x = ((FT_Face)face)->glyph->advance.x;
+        glyph->advance_y = ((FT_Face)face)->glyph->advance.y;
+        if (bytes)
+            memcpy(glyph->buffer, bitmap->buffer, bytes);
+
+        glyph->next = _xpost_font_glyph_buckets[h];
+        _xpost_font_glyph_buckets[h] = glyph;
+        _xpost_font_glyph_lru_push(glyph);
+        _xpost_font_glyph_cache_size += glyph->size;
+
+        /* evict the least recently used glyphs, but never the new one */
+        while (_xpost_font_glyph_cache_size > XPOST_FONT_GLYPH_CACHE_SIZE &&
+               _xpost_font_glyph_lru_last != glyph)
+            _xpost_font_glyph_remove(_xpost_font_glyph_lru_last);
+    }
+
+    *buffer = glyph->buffer;
+    *rows = glyph->rows;
+    *width = glyph->width;
+    *pitch = glyph->pitch;
+    *pixel_mode = glyph->pixel_mode;
+    *left = glyph->left;
+    *top = glyph->top;
+    *advance_x = glyph->advance_x;
+    *advance_y = glyph->advance_y;
+
+    return 1;
+#else
+    (void)face;
+    (void)glyph_index;
+    (void)buffer;
+    (void)rows;
+    (void)width;
+    (void)pitch;
+    (void)pixel_mode;
+    (void)left;
+    (void)top;
+    (void)advance_x;
+    (void)advance_y;
+
+    return 0;
+#endif
+}
+
 int
 xpost_font_face_kerning_has(void *face)
 {
@@ -86,6 +86,17 @@ int xpost_font_init(void);
  */
 void xpost_font_quit(void);
 
+/**
+ * @brief Shut down the font module for the calling thread.
+ *
+ * This function closes the faces opened by the calling thread and
+ * frees its caches. It is called by xpost_font_quit() and
+ * xpost_thread_quit().
+ *
+ * @see xpost_font_quit()
+ */
+void xpost_font_thread_quit(void);
+
 /**
  * @brief Return the font face from the given font name.
  *
@@ -93,18 +104,35 @@ void xpost_font_quit(void);
  * @return The font face.
  *
  * This function returns the font face of the font named @p name. On
- * error, it returs @c NULL.
+ * error, it returs @c NULL. Faces are cached by name, so all the
+ * calls with the same @p name from one thread share one face, which
+ * stays open until xpost_font_thread_quit() or xpost_font_face_free().
  *
  * @see xpost_font_face_free()
+ * @see xpost_font_face_cache_stats_get()
  */
 void *xpost_font_face_new_from_name(const char *name);
 
+/**
+ * @brief Retrieve the statistics of the font face cache.
+ *
+ * @param[out] hits The number of faces found in the cache.
+ * @param[out] misses The number of faces opened.
+ *
+ * This function stores in @p hits and @p misses the number of calls
+ * to xpost_font_face_new_from_name() which returned a cached face
+ * and which had to look up and open the font file. Each thread has
+ * its own cache, so these are the calls of the calling thread.
+ */
+void xpost_font_face_cache_stats_get(unsigned long *hits, unsigned long *misses);
+
 /**
  * @brief Free the given font.
  *
  * @param[in,out] face The font face.
  *
- * This function frees the memory stored by @p face.
+ * This function frees the memory stored by @p face and removes it
+ * from the face cache.
  *
  * @see xpost_font_face_new_from_name()
  */
@@ -116,7 +144,7 @@ void xpost_font_face_free(void *face);
  * @param[in] scale The scale factor in point.
  *
  * This function scales the font @p face to size @p scale in point
- * unit.
+ * unit. Nothing is done if @p face already has this size.
  */
 void xpost_font_face_scale(void *face, real scale);
 
@@ -164,6 +192,36 @@ int xpost_font_face_glyph_render(void *face, unsigned int glyph_index);
 
 void xpost_font_face_glyph_buffer_get(void *face, unsigned char **buffer, int *rows, int *width, int *pitch, char *pixel_mode, int *left, int *top, long *advance_x, long *advance_y);
 
+/**
+ * @brief Retrieve the rendered bitmap of the given glyph from the
+ * glyph cache.
+ *
+ * @param[in] face The font face.
+ * @param[in] glyph_index The glyph index.
+ * @param[out] buffer The coverage bitmap.
+ * @param[out] rows The number of rows of the bitmap.
+ * @param[out] width The number of pixels per row.
+ * @param[out] pitch The number of bytes per row.
+ * @param[out] pixel_mode The #Xpost_Font_Pixel_Mode of the bitmap.
+ * @param[out] left The horizontal offset of the bitmap from the pen.
+ * @param[out] top The vertical offset of the top row from the pen.
+ * @param[out] advance_x The horizontal advance in 26.6 units.
+ * @param[out] advance_y The vertical advance in 26.6 units.
+ * @return 1 on success, 0 otherwise.
+ *
+ * This function looks up the glyph @p glyph_index of font @p face
+ * at the size and transformation last set with
+ * xpost_font_face_scale() and xpost_font_face_transform(). On a
+ * miss, the glyph is rendered with xpost_font_face_glyph_render()
+ * and a copy of the bitmap is kept. The least recently used glyphs
+ * are evicted once the cache holds more than
+ * XPOST_FONT_GLYPH_CACHE_SIZE bytes. @p buffer remains valid until
+ * the next call. It returns 1 on success, 0 otherwise.
+ *
+ * @see xpost_font_face_glyph_render()
+ */
+int xpost_font_face_glyph_cache_get(void *face, unsigned int glyph_index, const unsigned char **buffer, int *rows, int *width, int *pitch, char *pixel_mode, int *left, int *top, long *advance_x, long *advance_y);
+
 /**
  * @brief Check if the given font has kerning feature.
  *
@@ -43,21 +43,51 @@
 #include "xpost_object.h" /* Xpost_Object */
 #include "xpost_free.h"
 
+/* size of the allocation of ent 0, which holds the list heads */
+#define XPOST_FREE_HEAD_SIZE 1024
+
+/* the class of a free allocation of sz bytes:
+   all the allocations of a class are at least its lower bound */
+static
+unsigned int _xpost_free_class(unsigned int sz)
+{
+    unsigned int c;
+
+    if (sz < XPOST_FREE_SMALL_CLASSES * XPOST_FREE_GRANULE)
+        return sz / XPOST_FREE_GRANULE;
+
+    c = XPOST_FREE_SMALL_CLASSES;
+    sz /= XPOST_FREE_SMALL_CLASSES * XPOST_FREE_GRANULE;
+    while ((sz >>= 1) && (c < XPOST_FREE_CLASSES - 1))
+        c++;
+    return c;
+}
+
+/* the smallest size of the allocations of class c */
+static
+unsigned int _xpost_free_class_size(unsigned int c)
+{
+    if (c < XPOST_FREE_SMALL_CLASSES)
+        return c * XPOST_FREE_GRANULE;
+    return (XPOST_FREE_SMALL_CLASSES * XPOST_FREE_GRANULE)
+        << (c - XPOST_FREE_SMALL_CLASSES);
+}
+
 /*
    initialize the free-list in the memory file.
-   free list head is in slot zero
+   free list heads are in slot zero
    sz is 0 so gc will ignore it */
 int xpost_free_init(Xpost_Memory_File *mem)
 {
     unsigned int ent;
-    unsigned int val = 0;
     int ret;
 
-    /* allocate the free list head: 4 bytes in ent 0
-       allocate additional 1k "scratch" space to protect
+    /* allocate the free list heads: 4 bytes per class in ent 0
+       allocate additional "scratch" space up to 1k to protect
        interpreter data from NULL writes
      */
-    ret = xpost_memory_table_alloc(mem, 1024, 0, &ent);
+    assert(XPOST_FREE_CLASSES * sizeof(unsigned int) <= XPOST_FREE_HEAD_SIZE);
+    ret = xpost_memory_table_alloc(mem, XPOST_FREE_HEAD_SIZE, 0, &ent);
     if (!ret)
     {
         return 0;
@@ -67,7 +97,7 @@ int xpost_free_init(Xpost_Memory_File *mem)
     assert (ent == XPOST_MEMORY_TABLE_SPECIAL_FREE);
 
     /* set to zero (== NULL == link-back-to-head) */
-    ret = xpost_memory_put(mem, ent, 0, sizeof(unsigned int), &val);
+    ret = xpost_free_clear(mem);
     if (!ret)
     {
         XPOST_LOG_ERR("xpost_free_init cannot access list head");
@@ -84,6 +114,7 @@ int xpost_free_init(Xpost_Memory_File *mem)
     (void) xpost_memory_register_free_list_alloc_function(mem, xpost_free_alloc);
     mem->period = XPOST_GARBAGE_COLLECTION_PERIOD;
     mem->threshold = XPOST_GARBAGE_COLLECTION_THRESHOLD;
+    mem->vmthreshold = XPOST_GARBAGE_COLLECTION_THRESHOLD;
 
     return 1;
 }
@@ -97,6 +128,7 @@ int xpost_free_memory_ent(Xpost_Memory_File *mem,
     unsigned int z; /* free list pointer */
     unsigned int a; /* adr associated with ent */
     unsigned int sz; /* sz associated with adr */
+    unsigned int c; /* class of sz */
     int ret;
     /* return; */
 
@@ -111,7 +143,9 @@ int xpost_free_memory_ent(Xpost_Memory_File *mem,
     tab = &mem->table;
     a = tab->tab[rent].adr;
     sz = tab->tab[rent].sz;
-    if (sz == 0) return 0; /* do not add zero-size allocations to list */
+    /* do not add zero-size allocations to list,
+       nor those which can not hold the link */
+    if (sz < sizeof(unsigned int)) return 0;
 
     if (tab->tab[rent].tag == filetype)
     {
@@ -153,10 +187,13 @@ int xpost_free_memory_ent(Xpost_Memory_File *mem,
         return -1;
     }
     /* printf("freeing %d bytes\n", xpost_memory_table_get_size(mem, ent)); */
+    c = _xpost_free_class(sz);
+    z += c * sizeof(unsigned int);
 
     //while current node < size of ent being added
         //load next ent in list
-    while (1)
+    /* a small class is not sorted, the ent goes first */
+    while (c >= XPOST_FREE_SMALL_CLASSES)
     {
         unsigned int t;
         unsigned int ta;
@@ -197,40 +234,67 @@ int xpost_free_memory_ent(Xpost_Memory_File *mem,
     return sz;
 }
 
+/* empty the free list: set all the heads to zero */
+int xpost_free_clear(Xpost_Memory_File *mem)
+{
+    unsigned int z;
+    int ret;
+
+    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &z);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("unable to load free list head");
+        return 0;
+    }
+    memset(mem->base + z, 0, XPOST_FREE_CLASSES * sizeof(unsigned int));
+
+    return 1;
+}
+
 /* print a dump of the free list */
 void xpost_free_dump(Xpost_Memory_File *mem)
 {
+    unsigned int c;
     unsigned int e;
     unsigned int z;
+    unsigned int head;
     int ret;
 
-    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &z);
+    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &head);
     if (!ret)
     {
         return;
     }
 
     printf("freelist: ");
-    memcpy(&e, mem->base + z, sizeof(unsigned int));
-    while (e)
+    for (c = 0; c < XPOST_FREE_CLASSES; c++)
     {
-        unsigned int sz;
-        ret = xpost_memory_table_get_size(mem, e, &sz);
-        if (!ret)
+        memcpy(&e, mem->base + head + c * sizeof(unsigned int), sizeof(unsigned int));
+        if (e)
+            printf("[%u] ", _xpost_free_class_size(c));
+        while (e)
         {
-            return;
-        }
-        printf("%u(%u) ", e, sz);
-        ret = xpost_memory_table_get_addr(mem, e, &z);
-        if (!ret)
-        {
-            return;
+            unsigned int sz;
+            ret = xpost_memory_table_get_size(mem, e, &sz);
+            if (!ret)
+            {
+                return;
+            }
+            printf("%u(%u) ", e, sz);
+            ret = xpost_memory_table_get_addr(mem, e, &z);
+            if (!ret)
+            {
+                return;
+            }
+            memcpy(&e, mem->base + z, sizeof(unsigned int));
         }
-        memcpy(&e, mem->base + z, sizeof(unsigned int));
     }
 }
 
 /* scan the free list for a suitably-sized bit of memory,
+   starting with the smallest class which may hold sz bytes.
+   a small class is taken from its head, a large class is
+   scanned for its first (smallest) ent which holds sz bytes.
 
    if the allocator falls back to fresh memory XPOST_GARBAGE_COLLECTION_PERIOD times,
         it triggers a collection.
@@ -241,6 +305,8 @@ int xpost_free_alloc(Xpost_Memory_File *mem,
                      unsigned int tag,
                      unsigned int *entity)
 {
+    unsigned int head;
+    unsigned int c;                     /* class */
     unsigned int z;
     unsigned int e;                     /* working pointer */
     //static int period = XPOST_GARBAGE_COLLECTION_PERIOD;
@@ -253,7 +319,7 @@ int xpost_free_alloc(Xpost_Memory_File *mem,
         //(void)period;
         if ((mem->threshold -= sz) <= 0)
         {
-            mem->threshold = XPOST_GARBAGE_COLLECTION_THRESHOLD;
+            mem->threshold = mem->vmthreshold;
             return 2;
         }
 #else
@@ -268,71 +334,91 @@ int xpost_free_alloc(Xpost_Memory_File *mem,
 #endif
     }
 
-    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &z); /* free pointer */
+    if (sz == 0) /* zero-size allocations are never on the list */
+        return 0;
+
+    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &head); /* free pointer */
     if (!ret)
     {
         XPOST_LOG_ERR("unable to load free list head");
         return 0;
     }
 
-    memcpy(&e, mem->base+z, sizeof(unsigned int)); /* e = *z */
-    while (e) /* e is not zero */
+    /* all the ents of a small class from this one hold sz bytes */
+    if (sz < XPOST_FREE_SMALL_CLASSES * XPOST_FREE_GRANULE)
+        c = (sz + XPOST_FREE_GRANULE - 1) / XPOST_FREE_GRANULE;
+    else
+        c = _xpost_free_class(sz);
+
+    for ( ; c < XPOST_FREE_CLASSES; c++)
     {
-        unsigned int tsz;
-        if (e > XPOST_OBJECT_COMP_MAX_ENT)
+        /* if all the ents of this class are too big */
+        if (_xpost_free_class_size(c) * XPOST_FREE_ACCEPT_DENOM > sz * XPOST_FREE_ACCEPT_OVERSIZE)
         {
-            unsigned int zero = 0;
-            XPOST_LOG_ERR("ent number %u exceeds object storage max %u",
-                    e, XPOST_OBJECT_COMP_MAX_ENT);
-            /* bad element found: discard free list */
-            xpost_memory_put(mem, 0, 0, sizeof zero, &zero);
-            return 2; /* request collection to fill the list */
-        }
-        ret = xpost_memory_table_get_size(mem, e, &tsz);
-        if (!ret)
-        {
-            XPOST_LOG_ERR("cannot retrieve size of ent %u", e);
-            return 0;
+            break;
         }
 
-        /* if this ent is sufficient to hold sz,
-           but does not waste more than sz bytes, use it */
-        if (tsz >= sz)
+        z = head + c * sizeof(unsigned int);
+        memcpy(&e, mem->base + z, sizeof(unsigned int)); /* e = *z */
+        while (e) /* e is not zero */
         {
-            Xpost_Memory_Table *tab = &mem->table;
-            unsigned int ent;
-            unsigned int ad;
-
-            /* if this ent is too big */
-            if (tsz * XPOST_FREE_ACCEPT_DENOM > sz * XPOST_FREE_ACCEPT_OVERSIZE)
+            unsigned int tsz;
+            if (e > XPOST_OBJECT_COMP_MAX_ENT)
             {
-                return 0; /* early exit to _new allocator since free list is sorted */
+                XPOST_LOG_ERR("ent number %u exceeds object storage max %u",
+                        e, XPOST_OBJECT_COMP_MAX_ENT);
+                /* bad element found: discard free list */
+                (void) xpost_free_clear(mem);
+                return 2; /* request collection to fill the list */
             }
-
-            ret = xpost_memory_table_get_addr(mem, e, &ad);
+            ret = xpost_memory_table_get_size(mem, e, &tsz);
             if (!ret)
             {
-                XPOST_LOG_ERR("cannot retrieve address of ent %u", e);
+                XPOST_LOG_ERR("cannot retrieve size of ent %u", e);
                 return 0;
             }
-            memcpy(mem->base + z, mem->base + ad, sizeof(unsigned int));
-            ent = e;
-            if (ent >= mem->table.nextent)
+
+            /* if this ent is sufficient to hold sz,
+               but does not waste more than sz bytes, use it */
+            if (tsz >= sz)
+            {
+                Xpost_Memory_Table *tab = &mem->table;
+                unsigned int ent;
+                unsigned int ad;
+
+                /* if this ent is too big */
+                if (tsz * XPOST_FREE_ACCEPT_DENOM > sz * XPOST_FREE_ACCEPT_OVERSIZE)
+                {
+                    return 0; /* early exit to _new allocator since the next ones are bigger */
+                }
+
+                ret = xpost_memory_table_get_addr(mem, e, &ad);
+                if (!ret)
+                {
+                    XPOST_LOG_ERR("cannot retrieve address of ent %u", e);
+                    return 0;
+                }
+                memcpy(mem->base + z, mem->base + ad, sizeof(unsigned int));
+                ent = e;
+                if (ent >= mem->table.nextent)
+                {
+                    XPOST_LOG_ERR("cannot find table for ent %u", e);
+                    return 0;
+                }
+                tab->tab[ent].tag = tag;
+                tab->tab[ent].used = sz;
+                tab->tab[ent].save = 0;
+                *entity = e;
+                return 1; /* found, return SUCCESS */
+            }
+            ret = xpost_memory_table_get_addr(mem, e, &z);
+            if (!ret)
             {
-                XPOST_LOG_ERR("cannot find table for ent %u", e);
+                XPOST_LOG_ERR("cannot retrieve address for ent %u", e);
                 return 0;
             }
-            tab->tab[ent].tag = tag;
-            *entity = e;
-            return 1; /* found, return SUCCESS */
-        }
-        ret = xpost_memory_table_get_addr(mem, e, &z);
-        if (!ret)
-        {
-            XPOST_LOG_ERR("cannot retrieve address for ent %u", e);
-            return 0;
+            memcpy(&e, mem->base + z, sizeof(unsigned int));
         }
-        memcpy(&e, mem->base + z, sizeof(unsigned int));
     }
     /* finished scanning free list */
 
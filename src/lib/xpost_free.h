@@ -45,16 +45,23 @@
  *  will first call xpost_free_alloc before falling back to increasing the size
  *  of the memory space.
 
- *  The free list is a chain of unused ents and their associated memory.
- *  The free list head is ent 0, which points (via the address field in
- *  the memory table entry for ent 0) to a 32bit int which is either 0
- *  (ie. a "NULL" "pointer", also a link back to the head (!)) or the ent
- *  number of the next free allocation. Any subsequent ents in the chain
- *  will have the next ent or 0 in the first 4 bytes of the allocation.
+ *  The free list is a set of chains of unused ents and their associated
+ *  memory, one per size class. The heads of the chains are in the
+ *  allocation of ent 0: XPOST_FREE_CLASSES 32bit ints, each of which is
+ *  either 0 (ie. a "NULL" "pointer", also a link back to the head (!))
+ *  or the ent number of the first free allocation of its class. Any
+ *  subsequent ents in a chain will have the next ent or 0 in the first
+ *  4 bytes of the allocation. The heads are in VM, so they stay valid
+ *  when the memory file grows, and are saved in VM images.
  *
- *  (All allocations are padded to at least an even word and zero-sized
- *  allocations are ignored, so any ent that can be put on the free list
- *  is guaranteed to have at least these 4 bytes allocated to it.)
+ *  The small classes hold allocations of the same size, rounded down
+ *  to XPOST_FREE_GRANULE bytes, so allocating one is taking the head
+ *  of a chain. The large classes hold allocations from a power of 2 to
+ *  the next, and their chains are sorted by size to allocate the best
+ *  fit.
+ *
+ *  (Allocations smaller than these 4 bytes and zero-sized allocations
+ *  are not put on the free list.)
  */
 
 /**
@@ -75,7 +82,8 @@
 typedef enum
 {
     XPOST_GARBAGE_COLLECTION_PERIOD = 20000,  /**< number of times to grow before collecting */
-    XPOST_GARBAGE_COLLECTION_THRESHOLD = 1000000000  /**< number of bytes to allocate before collecting */
+    XPOST_GARBAGE_COLLECTION_THRESHOLD = 1000000000,  /**< number of bytes to allocate before collecting */
+    XPOST_GARBAGE_COLLECTION_GLOBAL_THRESHOLD = 4000000  /**< number of bytes to allocate in global vm before collecting */
 } Xpost_Garbage_Params;
 
 #define XPOST_USE_THRESHOLD
@@ -86,11 +94,38 @@ typedef enum
 #define XPOST_FREE_ACCEPT_OVERSIZE 3
 #define XPOST_FREE_ACCEPT_DENOM 2
 
+/**
+ * Size step of the small classes of the free list
+ */
+#define XPOST_FREE_GRANULE 8
+
+/**
+ * Number of small classes, for the allocations smaller than
+ * XPOST_FREE_SMALL_CLASSES * XPOST_FREE_GRANULE bytes
+ */
+#define XPOST_FREE_SMALL_CLASSES 64
+
+/**
+ * Number of large classes, one per power of 2 above the small ones,
+ * the last one holds all the larger allocations
+ */
+#define XPOST_FREE_LARGE_CLASSES 23
+
+/**
+ * Number of chains of the free list
+ */
+#define XPOST_FREE_CLASSES (XPOST_FREE_SMALL_CLASSES + XPOST_FREE_LARGE_CLASSES)
+
 /**
  * @brief  initialize the FREE special entity which points
  *         to the head of the free list
  */
-int xpost_free_init(Xpost_Memory_File *mem);
+XPCHECKAPI int xpost_free_init(Xpost_Memory_File *mem);
+
+/**
+ * @brief  empty the free list, without freeing its allocations
+ */
+int xpost_free_clear(Xpost_Memory_File *mem);
 
 /**
  * @brief  print a dump of the free list
@@ -108,8 +143,8 @@ int xpost_free_alloc(Xpost_Memory_File *mem,
 /**
  * @brief  explicitly add ent to free list
  */
-int xpost_free_memory_ent(Xpost_Memory_File *mem,
-                          unsigned int ent);
+XPCHECKAPI int xpost_free_memory_ent(Xpost_Memory_File *mem,
+                                     unsigned int ent);
 
 /**
  * @brief reallocate data, preserving original contents
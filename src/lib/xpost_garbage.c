@@ -64,346 +64,381 @@
 #endif
 
 
-/* iterate through all tables,
-    clear the MARK in the mark. */
-static
-void _xpost_garbage_unmark(Xpost_Memory_File *mem)
+/*
+   the mark phase does not recurse: marking a composite object sets
+   its bit in the mark bitmap of its memory file and pushes it on the
+   grey list, and its contents are marked when it is popped. so the
+   depth of a structure is only limited by the size of the grey list,
+   which is on the heap.
+ */
+
+/* number of objects scanned ahead of the one being marked, whose
+   table entry and mark bit are prefetched */
+#define XPOST_GARBAGE_PREFETCH_DISTANCE 8
+
+/* initial number of objects in the grey list */
+#define XPOST_GARBAGE_GREY_SIZE 1024
+
+#ifdef __GNUC__
+# define XPOST_GARBAGE_PREFETCH(p) __builtin_prefetch(p)
+#else
+# define XPOST_GARBAGE_PREFETCH(p)
+#endif
+
+/* a composite object marked, but whose contents are not yet */
+typedef struct
 {
-    unsigned int i;
+    Xpost_Memory_File *mem;
+    unsigned int adr; /* address of the objects or dict records */
+    unsigned int n; /* number of objects or dict records */
+    Xpost_Object_Type type; /* arraytype or dicttype */
+} Xpost_Garbage_Grey;
 
-    if (!mem) return;
+typedef struct
+{
+    Xpost_Context *ctx; /* selects the memory file of objects */
+    int markall; /* follow references across memory files */
+    Xpost_Garbage_Grey *grey;
+    unsigned int ngrey;
+    unsigned int maxgrey;
+} Xpost_Garbage_Marker;
 
-    for (i = mem->start; i < mem->table.nextent; i++)
+static
+int _xpost_garbage_marker_init(Xpost_Garbage_Marker *m,
+                               Xpost_Context *ctx,
+                               int markall)
+{
+    m->ctx = ctx;
+    m->markall = markall;
+    m->ngrey = 0;
+    m->maxgrey = XPOST_GARBAGE_GREY_SIZE;
+    m->grey = malloc(m->maxgrey * sizeof(*m->grey));
+    if (!m->grey)
     {
-        mem->table.tab[i].mark &= ~XPOST_MEMORY_TABLE_MARK_DATA_MARK_MASK;
+        XPOST_LOG_ERR("cannot allocate grey list");
+        return 0;
     }
+    return 1;
 }
 
-/* set the MARK in the mark in the tab[ent] */
 static
-int _xpost_garbage_mark_ent(Xpost_Memory_File *mem,
-                            unsigned int ent)
+void _xpost_garbage_marker_exit(Xpost_Garbage_Marker *m)
+{
+    free(m->grey);
+    m->grey = NULL;
+}
+
+/* resize the mark bitmap to the table and clear all the marks */
+static
+int _xpost_garbage_unmark(Xpost_Memory_File *mem)
 {
+    unsigned int sz;
+
     if (!mem) return 0;
 
-    if (ent < mem->start)
+    sz = (mem->table.nextent + 7) / 8;
+    if (sz > mem->markbits_size)
     {
-        XPOST_LOG_ERR("attempt to mark ent %u < mem->start", ent);
-        return 1;
-    }
+        unsigned char *tmp;
 
-    if (ent >= mem->table.nextent)
-    {
-        XPOST_LOG_ERR("cannot find ent %u", ent);
-        return 0;
+        tmp = realloc(mem->markbits, sz);
+        if (!tmp)
+        {
+            XPOST_LOG_ERR("cannot allocate mark bitmap for %u ents",
+                          mem->table.nextent);
+            return 0;
+        }
+        mem->markbits = tmp;
+        mem->markbits_size = sz;
     }
-    mem->table.tab[ent].mark |= XPOST_MEMORY_TABLE_MARK_DATA_MARK_MASK;
+    memset(mem->markbits, 0, mem->markbits_size);
     return 1;
 }
 
 /* is it marked? */
-static
+static inline
 int _xpost_garbage_ent_is_marked(Xpost_Memory_File *mem,
-                                 unsigned int ent,
-                                 int *retval)
+                                 unsigned int ent)
 {
-    if (!mem) return 0;
+    return (mem->markbits[ent >> 3] >> (ent & 7)) & 1;
+}
+
+/* set the mark of ent.
+   return 1 if it was not marked yet, 0 if it was, -1 on error */
+static inline
+int _xpost_garbage_mark_ent(Xpost_Memory_File *mem,
+                            unsigned int ent)
+{
+    unsigned char bit = (unsigned char)(1 << (ent & 7));
 
     if (ent >= mem->table.nextent)
     {
-        XPOST_LOG_ERR("cannot find table for ent %u", ent);
-        return 0;
+        XPOST_LOG_ERR("cannot find ent %u", ent);
+        return -1;
     }
-    *retval = (mem->table.tab[ent].mark & XPOST_MEMORY_TABLE_MARK_DATA_MARK_MASK)
-        >> XPOST_MEMORY_TABLE_MARK_DATA_MARK_OFFSET;
-
+    if (mem->markbits[ent >> 3] & bit)
+        return 0;
+    mem->markbits[ent >> 3] |= bit;
     return 1;
 }
 
-/* recursively mark an object */
-static
-int _xpost_garbage_mark_object(Xpost_Context *ctx, Xpost_Memory_File *mem, Xpost_Object o, int markall);
-
-/* recursively mark a dictionary */
+/* push the contents of a marked object on the grey list */
 static
-int _xpost_garbage_mark_dict(Xpost_Context *ctx,
+int _xpost_garbage_grey_push(Xpost_Garbage_Marker *m,
                              Xpost_Memory_File *mem,
                              unsigned int adr,
-                             int markall)
+                             unsigned int n,
+                             Xpost_Object_Type type)
 {
-    if (!mem) return 0;
+    Xpost_Garbage_Grey *g;
 
+    if (m->ngrey == m->maxgrey)
     {
-        dichead *dp = (void *)(mem->base + adr);
-        dicrec *tp = (void *)(mem->base + adr + sizeof(dichead));
-        int j;
-#ifdef DEBUG_GC
-        Xpost_Object_Type type;
-        printf("markdict: nused=%d\n", dp->nused);
-#endif
+        Xpost_Garbage_Grey *tmp;
 
-        for (j = 0; j < DICTABN(dp->sz); j++)
+        tmp = realloc(m->grey, 2 * m->maxgrey * sizeof(*m->grey));
+        if (!tmp)
         {
-            if (xpost_object_get_type(tp[j].key) != nulltype){
-                if (!_xpost_garbage_mark_object(ctx,
-                            xpost_context_select_memory(ctx,tp[j].key), tp[j].key, markall))
-                    return 0;
-#ifdef DEBUG_GC
-            switch(type = xpost_object_get_type(tp[j].key)){
-            default: {
-                    printf("%s", xpost_object_type_names[type]);
-                }
-                break;
-            case nametype: {
-                unsigned int address;
-                Xpost_Object str;
-
-                xpost_memory_table_get_addr( xpost_context_select_memory(ctx,tp[j].key),
-                    XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &address);
-
-                str = xpost_stack_bottomup_fetch(
-                    xpost_context_select_memory(ctx,tp[j].key),
-                    address, tp[j].key.mark_.padw);
-                printf("%*s", str.comp_.sz, xpost_string_get_pointer(ctx,str));
-
-                }
-                break;
-            }
-            printf(":");
-            printf("%s\n", xpost_object_type_names[xpost_object_get_type(tp[j].value)]);
-#endif
-                if (!_xpost_garbage_mark_object(ctx,
-                            xpost_context_select_memory(ctx,tp[j].value), tp[j].value, markall))
-                    return 0;
-            }
+            XPOST_LOG_ERR("cannot grow grey list to %u objects",
+                          2 * m->maxgrey);
+            return 0;
         }
+        m->grey = tmp;
+        m->maxgrey *= 2;
     }
-
+    g = &m->grey[m->ngrey++];
+    g->mem = mem;
+    g->adr = adr;
+    g->n = n;
+    g->type = type;
     return 1;
 }
 
-/* recursively mark all elements of array */
+/* push the contents of the marked array or dict allocation ent */
 static
-int _xpost_garbage_mark_array(Xpost_Context *ctx,
-                              Xpost_Memory_File *mem,
-                              unsigned int adr,
-                              unsigned int sz,
-                              int markall)
+int _xpost_garbage_grey_push_ent(Xpost_Garbage_Marker *m,
+                                 Xpost_Memory_File *mem,
+                                 unsigned int ent,
+                                 Xpost_Object_Type type)
 {
-    if (!mem) return 0;
+    unsigned int adr = mem->table.tab[ent].adr;
 
-#ifdef DEBUG_GC
-    printf("markarray: sz=%u\n", sz);
-#endif
+    if (type == dicttype)
+        return _xpost_garbage_grey_push(m, mem, adr + sizeof(dichead),
+                DICTABN(((dichead *)(mem->base + adr))->sz), dicttype);
+    return _xpost_garbage_grey_push(m, mem, adr,
+            mem->table.tab[ent].used / sizeof(Xpost_Object), arraytype);
+}
 
-    {
-        Xpost_Object *op = (void *)(mem->base + adr);
-        unsigned int j;
+/* the type of o if it is composite, 0 otherwise.
+   the functions of xpost_object.c are not used here,
+   they are not inlined and this is the innermost loop. */
+static inline
+Xpost_Object_Type _xpost_garbage_composite_type(Xpost_Object o)
+{
+    Xpost_Object_Type type = o.tag & XPOST_OBJECT_TAG_DATA_TYPE_MASK;
 
-        for (j = 0; j < sz; j++)
-        {
-#ifdef DEBUG_GC
-            printf("%u:%s\n", j, xpost_object_type_names[xpost_object_get_type(op[j])]);
-#endif
-            if (!_xpost_garbage_mark_object(ctx,
-                                            xpost_context_select_memory(ctx,op[j]),
-                                            op[j], markall))
-                return 0;
-        }
-    }
+    return (type == arraytype || type == dicttype || type == stringtype) ?
+        type : 0;
+}
 
-    return 1;
+/* the ent of a composite object, as xpost_object_get_ent() */
+static inline
+unsigned int _xpost_garbage_object_ent(Xpost_Object o)
+{
+    return (unsigned int)o.comp_.ent +
+        ((o.comp_.tag >> XPOST_OBJECT_TAG_DATA_EXTRA_BITS)
+         << (8 * sizeof(word)));
 }
 
-/* traverse the contents of composite objects
-   if markall is true, this is a collection of global vm,
-   so we must mark objects and recurse
-   even if it means switching memory files
- */
+/* the memory file holding the allocation of o,
+   or NULL if the collection does not follow it from mem */
+static inline
+Xpost_Memory_File *_xpost_garbage_object_memory(Xpost_Garbage_Marker *m,
+                                                Xpost_Memory_File *mem,
+                                                Xpost_Object o)
+{
+    Xpost_Memory_File *objmem;
+
+    objmem = (o.tag & XPOST_OBJECT_TAG_DATA_FLAG_BANK) ? m->ctx->gl : m->ctx->lo;
+    if (objmem != mem && !m->markall)
+        return NULL;
+    return objmem;
+}
+
+/* mark a composite object and push it on the grey list
+   if it has contents to mark.
+   mem is the memory file holding the reference to o:
+   if markall is false, objects of other memory files are not marked */
 static
-int _xpost_garbage_mark_object(Xpost_Context *ctx,
-                               Xpost_Memory_File *mem,
-                               Xpost_Object o,
-                               int markall)
+int _xpost_garbage_shade(Xpost_Garbage_Marker *m,
+                         Xpost_Memory_File *mem,
+                         Xpost_Object o)
 {
-    unsigned int ad;
-    int ret;
-    unsigned int tag;
-    unsigned int ent;
     Xpost_Object_Type type;
     Xpost_Memory_File *objmem;
+    unsigned int ent;
+    int ret;
 
-    if (!mem) return 0;
+    type = _xpost_garbage_composite_type(o);
+    if (!type)
+        return 1;
 
-    if (!xpost_object_is_composite(o))
+    objmem = _xpost_garbage_object_memory(m, mem, o);
+    if (!objmem)
         return 1;
 
-    ent = xpost_object_get_ent(o);
-    type = xpost_object_get_type(o);
+    ent = _xpost_garbage_object_ent(o);
+    if (ent == 0 && type != dicttype)
+        return 1; /* empty array or string */
+    if (ent < objmem->start)
+    {
+        XPOST_LOG_ERR("attempt to mark %s object %d",
+                      xpost_object_type_names[type], ent);
+        return 0;
+    }
+
+    ret = _xpost_garbage_mark_ent(objmem, ent);
+    if (ret < 0)
+    {
+        XPOST_LOG_ERR("cannot mark %s %d", xpost_object_type_names[type], ent);
+        return 0;
+    }
+    if (!ret || type == stringtype)
+        return 1;
 
 #ifdef DEBUG_GC
-            printf("markobject: ent %d, addr %u, %s (size %d)\n",
-                   ent,
-                   xpost_context_select_memory(ctx,o)==mem?
-                       (ent >= mem->table.nextent?
-                        (unsigned)-1: mem->table.tab[ent].adr) : 0,
-                   xpost_object_type_names[type],
-                   o.comp_.sz);
+    printf("markobject: ent %d, %s (size %d)\n",
+           ent, xpost_object_type_names[type], o.comp_.sz);
 #endif
 
-    switch(type)
+    /* an array may be referred to by subarrays, so all the
+       allocation is marked, not only the elements of o */
+    return _xpost_garbage_grey_push_ent(m, objmem, ent, type);
+}
+
+/* fetch the table entry and the mark of o into the cache,
+   ahead of its marking */
+static inline
+void _xpost_garbage_prefetch(Xpost_Garbage_Marker *m,
+                             Xpost_Memory_File *mem,
+                             Xpost_Object o)
+{
+    Xpost_Memory_File *objmem;
+    unsigned int ent;
+
+    if (!_xpost_garbage_composite_type(o))
+        return;
+    objmem = _xpost_garbage_object_memory(m, mem, o);
+    if (!objmem)
+        return;
+    ent = _xpost_garbage_object_ent(o);
+    if (ent < objmem->table.nextent)
     {
-        default: break;
+        XPOST_GARBAGE_PREFETCH(&objmem->markbits[ent >> 3]);
+        XPOST_GARBAGE_PREFETCH(&objmem->table.tab[ent]);
+    }
+}
 
-        case arraytype:
-            if (ent == 0)
-            {
-                return 1;
-            }
+/* mark the keys and values of the n dictionary records at adr */
+static
+int _xpost_garbage_scan_dict(Xpost_Garbage_Marker *m,
+                             Xpost_Memory_File *mem,
+                             unsigned int adr,
+                             unsigned int n)
+{
+    dicrec *tp = (void *)(mem->base + adr);
+    unsigned int j;
 
-            objmem = xpost_context_select_memory(ctx, o);
-            if (objmem != mem) {
-                if (!markall)
-                    break;
-            }
-            if (ent < objmem->start)
-            {
-                XPOST_LOG_ERR("attempt to mark %s object %d",
-                        xpost_object_type_names[type],
-                        ent);
-                return 0;
-            }
-            if (!objmem) return 0;
-            if (!_xpost_garbage_ent_is_marked(objmem, ent, &ret))
-                return 0;
-            if (!ret) {
-                ret = _xpost_garbage_mark_ent(objmem, ent);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot mark array %d", ent);
-                    return 0;
-                }
-                ret = xpost_memory_table_get_addr(objmem, ent, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for array ent %u", ent);
-                    return 0;
-                }
-                ret = xpost_memory_table_get_tag(objmem, ent, &tag);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve tag for array ent %u", ent);
-                    return 0;
-                }
-                if (o.comp_.sz != objmem->table.tab[ent].used/sizeof(Xpost_Object))
-                {
-                    XPOST_LOG_INFO("o.comp_.sz %u != tab[ent].used/obj %u",
-                            o.comp_.sz, objmem->table.tab[ent].used/sizeof(Xpost_Object));
-                }
-                if (!_xpost_garbage_mark_array(ctx, objmem, ad,
-                            //mem->table.tab[ent].used/sizeof(Xpost_Object)
-                            o.comp_.sz
-                            , markall))
-                    return 0;
-            }
-            break;
+#ifdef DEBUG_GC
+    printf("markdict: n=%u\n", n);
+#endif
 
-        case dicttype:
-            objmem = xpost_context_select_memory(ctx, o);
-            if (objmem != mem)
-            {
-                if (!markall)
-                    break;
-            }
-            if (ent < objmem->start)
-            {
-                XPOST_LOG_ERR("attempt to mark %s object %d",
-                        xpost_object_type_names[type],
-                        ent);
+    for (j = 0; j < n; j++)
+    {
+        if (j + XPOST_GARBAGE_PREFETCH_DISTANCE < n)
+            _xpost_garbage_prefetch(m, mem,
+                                    tp[j + XPOST_GARBAGE_PREFETCH_DISTANCE].value);
+        if ((tp[j].key.tag & XPOST_OBJECT_TAG_DATA_TYPE_MASK) != nulltype)
+        {
+            if (!_xpost_garbage_shade(m, mem, tp[j].key))
                 return 0;
-            }
-            if (!_xpost_garbage_ent_is_marked(objmem, ent, &ret))
+            if (!_xpost_garbage_shade(m, mem, tp[j].value))
                 return 0;
-            if (!ret)
-            {
-                ret = _xpost_garbage_mark_ent(objmem, ent);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot mark dict");
-                    return 0;
-                }
-                ret = xpost_memory_table_get_addr(objmem, ent, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for dict ent %u", ent);
-                    return 0;
-                }
-                if (!_xpost_garbage_mark_dict(ctx, objmem, ad, markall))
-                    return 0;
-            }
-            break;
+        }
+    }
 
-        case stringtype:
-            if (ent == 0)
-            {
-                return 1;
-            }
+    return 1;
+}
 
-            objmem = xpost_context_select_memory(ctx, o);
-            if (objmem != mem)
-            {
-                if (!markall)
-                    break;
-            }
+/* mark the n objects of the array at adr */
+static
+int _xpost_garbage_scan_array(Xpost_Garbage_Marker *m,
+                              Xpost_Memory_File *mem,
+                              unsigned int adr,
+                              unsigned int n)
+{
+    Xpost_Object *op = (void *)(mem->base + adr);
+    unsigned int j;
 
-            if (ent < objmem->start)
-            {
-                XPOST_LOG_ERR("attempt to mark %s object %d",
-                        xpost_object_type_names[type],
-                        ent);
-                return 0;
-            }
-            ret = _xpost_garbage_mark_ent(objmem, ent);
-            if (!ret)
-            {
-                XPOST_LOG_ERR("cannot mark string");
-                return 0;
-            }
-            break;
+#ifdef DEBUG_GC
+    printf("markarray: sz=%u\n", n);
+#endif
 
-        case filetype:
-            objmem = xpost_context_select_memory(ctx, o);
-            if (ent < objmem->start)
-            {
-                XPOST_LOG_ERR("attempt to mark %s object %d",
-                        xpost_object_type_names[type],
-                        ent);
+    for (j = 0; j < n; j++)
+    {
+        if (j + XPOST_GARBAGE_PREFETCH_DISTANCE < n)
+            _xpost_garbage_prefetch(m, mem,
+                                    op[j + XPOST_GARBAGE_PREFETCH_DISTANCE]);
+        if (!_xpost_garbage_shade(m, mem, op[j]))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* mark the contents of the objects of the grey list until it is empty */
+static
+int _xpost_garbage_drain(Xpost_Garbage_Marker *m)
+{
+    Xpost_Garbage_Grey g;
+
+    while (m->ngrey)
+    {
+        /* copied, the list may be reallocated by the scan */
+        g = m->grey[--m->ngrey];
+        if (g.type == dicttype)
+        {
+            if (!_xpost_garbage_scan_dict(m, g.mem, g.adr, g.n))
                 return 0;
-            }
-            if (objmem == ctx->gl)
-            {
-                printf("file found in global vm\n");
-            } else {
-                ret = _xpost_garbage_mark_ent(objmem, o.mark_.padw);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot mark file");
-                    return 0;
-                }
-            }
-            break;
+        }
+        else
+        {
+            if (!_xpost_garbage_scan_array(m, g.mem, g.adr, g.n))
+                return 0;
+        }
     }
 
     return 1;
 }
 
+/* mark an object and all the objects reachable from it */
+static
+int _xpost_garbage_mark_object(Xpost_Garbage_Marker *m,
+                               Xpost_Memory_File *mem,
+                               Xpost_Object o)
+{
+    if (!_xpost_garbage_shade(m, mem, o))
+        return 0;
+    return _xpost_garbage_drain(m);
+}
+
 
 /* mark all names in stack except 0::BOGUSNAME */
 static
-int _xpost_garbage_mark_names(Xpost_Context *ctx,
+int _xpost_garbage_mark_names(Xpost_Garbage_Marker *m,
                               Xpost_Memory_File *mem,
-                              unsigned int stackadr,
-                              int markall)
+                              unsigned int stackadr)
 {
     int start = 1;
     if (!mem) return 0;
@@ -419,7 +454,7 @@ int _xpost_garbage_mark_names(Xpost_Context *ctx,
 next:
         for (i = start; i < s->top; i++)
         {
-            if (!_xpost_garbage_mark_object(ctx, mem, s->data[i], markall))
+            if (!_xpost_garbage_shade(m, mem, s->data[i]))
                 return 0;
         }
         if (i == XPOST_STACK_SEGMENT_SIZE) /* ie. s->top == XPOST_STACK_SEGMENT_SIZE */
@@ -432,16 +467,15 @@ next:
         }
     }
 
-    return 1;
+    return _xpost_garbage_drain(m);
 }
 
 
 /* mark all allocations referred to by objects in stack */
 static
-int _xpost_garbage_mark_stack(Xpost_Context *ctx,
+int _xpost_garbage_mark_stack(Xpost_Garbage_Marker *m,
                               Xpost_Memory_File *mem,
-                              unsigned int stackadr,
-                              int markall)
+                              unsigned int stackadr)
 {
     if (!mem) return 0;
 
@@ -456,11 +490,8 @@ int _xpost_garbage_mark_stack(Xpost_Context *ctx,
 next:
         for (i = 0; i < s->top; i++)
         {
-            Xpost_Memory_File *objmem;
-            objmem = xpost_context_select_memory(ctx, s->data[i]);
-            if (objmem == mem || markall)
-                if (!_xpost_garbage_mark_object(ctx, objmem, s->data[i], markall))
-                    return 0;
+            if (!_xpost_garbage_shade(m, mem, s->data[i]))
+                return 0;
         }
         if (i == XPOST_STACK_SEGMENT_SIZE) /* ie. s->top == XPOST_STACK_SEGMENT_SIZE */
         {
@@ -471,12 +502,74 @@ next:
         }
     }
 
+    return _xpost_garbage_drain(m);
+}
+
+/* mark an ent of a saverec, and push its contents on the grey list */
+static
+int _xpost_garbage_mark_save_ent(Xpost_Garbage_Marker *m,
+                                 Xpost_Memory_File *mem,
+                                 unsigned int ent,
+                                 Xpost_Object_Type type)
+{
+    int ret;
+
+    if (ent < mem->start)
+    {
+        XPOST_LOG_ERR("attempt to mark ent %u < mem->start", ent);
+        return 1;
+    }
+    ret = _xpost_garbage_mark_ent(mem, ent);
+    if (ret < 0)
+    {
+        XPOST_LOG_ERR("cannot mark %s", xpost_object_type_names[type]);
+        return 0;
+    }
+    if (!ret)
+        return 1;
+    if (type == dicttype || type == arraytype)
+        return _xpost_garbage_grey_push_ent(m, mem, ent, type);
+    return 1;
+}
+
+/* mark the chunk directory of a saverec, and the copies of the
+   chunks, whose slots are objects or dict records */
+static
+int _xpost_garbage_mark_save_chunks(Xpost_Garbage_Marker *m,
+                                    Xpost_Memory_File *mem,
+                                    Xpost_Object rec,
+                                    Xpost_Object_Type type)
+{
+    unsigned int n;
+    unsigned int i;
+
+    if (_xpost_garbage_mark_ent(mem, xpost_save_rec_get_cpy(rec)) < 0)
+        return 0;
+    n = xpost_save_rec_get_chunk_count(mem, rec);
+    for (i = 0; i < n; i++)
+    {
+        unsigned int ent = xpost_save_rec_get_chunk(mem, rec, i);
+        int ret;
+
+        if (!ent)
+            continue;
+        ret = _xpost_garbage_mark_ent(mem, ent);
+        if (ret < 0)
+            return 0;
+        if (!ret)
+            continue;
+        if (!_xpost_garbage_grey_push(m, mem, mem->table.tab[ent].adr,
+                mem->table.tab[ent].used /
+                (type == dicttype ? sizeof(dicrec) : sizeof(Xpost_Object)),
+                type))
+            return 0;
+    }
     return 1;
 }
 
 /* mark all allocations referred to by objects in save object's stack of saverec_'s */
 static
-int _xpost_garbage_mark_save_stack(Xpost_Context *ctx,
+int _xpost_garbage_mark_save_stack(Xpost_Garbage_Marker *m,
                                    Xpost_Memory_File *mem,
                                    unsigned int stackadr)
 {
@@ -485,9 +578,6 @@ int _xpost_garbage_mark_save_stack(Xpost_Context *ctx,
     {
         Xpost_Stack *s = (Xpost_Stack *)(mem->base + stackadr);
         unsigned int i;
-        unsigned int ad;
-        int ret;
-        (void)ctx;
 
 #ifdef DEBUG_GC
         printf("marking saverec stack of size %u\n", xpost_stack_count(mem, stackadr));
@@ -496,63 +586,21 @@ int _xpost_garbage_mark_save_stack(Xpost_Context *ctx,
 next:
         for (i = 0; i < s->top; i++)
         {
-            /* _xpost_garbage_mark_object(ctx, mem, s->data[i]); */
-            /* _xpost_garbage_mark_save_stack(ctx, mem, s->data[i].save_.stk); */
-            ret = _xpost_garbage_mark_ent(mem, s->data[i].saverec_.src);
-            if (!ret)
-            {
-                XPOST_LOG_ERR("cannot mark array");
-                return 0;
-            }
-            ret = _xpost_garbage_mark_ent(mem, s->data[i].saverec_.cpy);
-            if (!ret)
-            {
-                XPOST_LOG_ERR("cannot mark array");
+            Xpost_Object_Type type = xpost_object_get_type(s->data[i]);
+
+            if (!_xpost_garbage_mark_save_ent(m, mem,
+                        xpost_save_rec_get_src(s->data[i]), type))
                 return 0;
-            }
-            if (s->data[i].saverec_.tag == dicttype)
-            {
-                ret = xpost_memory_table_get_addr(mem, s->data[i].saverec_.src, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for ent %u",
-                                  s->data[i].saverec_.src);
-                    return 0;
-                }
-                if (!_xpost_garbage_mark_dict(ctx, mem, ad, 0))
-                    return 0;
-                ret = xpost_memory_table_get_addr(mem, s->data[i].saverec_.cpy, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for ent %u",
-                                  s->data[i].saverec_.cpy);
-                    return 0;
-                }
-                if (!_xpost_garbage_mark_dict(ctx, mem, ad, 0))
-                    return 0;
-            }
-            if (s->data[i].saverec_.tag == arraytype)
+            if (xpost_save_rec_get_chunk_count(mem, s->data[i]))
             {
-                unsigned int sz = s->data[i].saverec_.pad;
-                ret = xpost_memory_table_get_addr(mem, s->data[i].saverec_.src, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for array ent %u",
-                                  s->data[i].saverec_.src);
-                    return 0;
-                }
-                if (!_xpost_garbage_mark_array(ctx, mem, ad, sz, 0))
-                    return 0;
-                ret = xpost_memory_table_get_addr(mem, s->data[i].saverec_.cpy, &ad);
-                if (!ret)
-                {
-                    XPOST_LOG_ERR("cannot retrieve address for array ent %u",
-                                  s->data[i].saverec_.cpy);
-                    return 0;
-                }
-                if (!_xpost_garbage_mark_array(ctx, mem, ad, sz, 0))
+                if (!_xpost_garbage_mark_save_chunks(m, mem, s->data[i], type))
                     return 0;
             }
+            else if (!_xpost_garbage_mark_save_ent(m, mem,
+                        xpost_save_rec_get_cpy(s->data[i]), type))
+                return 0;
+            if (!_xpost_garbage_drain(m))
+                return 0;
         }
         if (i == XPOST_STACK_SEGMENT_SIZE) /* ie. s->top == XPOST_STACK_SEGMENT_SIZE */
         {
@@ -566,7 +614,7 @@ next:
 
 /* mark all allocations referred to by objects in save stack */
 static
-int _xpost_garbage_mark_save(Xpost_Context *ctx,
+int _xpost_garbage_mark_save(Xpost_Garbage_Marker *m,
                              Xpost_Memory_File *mem,
                              unsigned int stackadr)
 {
@@ -583,8 +631,7 @@ int _xpost_garbage_mark_save(Xpost_Context *ctx,
     next:
         for (i = 0; i < s->top; i++)
         {
-            /* _xpost_garbage_mark_object(ctx, mem, s->data[i]); */
-            if (!_xpost_garbage_mark_save_stack(ctx, mem, s->data[i].save_.stk))
+            if (!_xpost_garbage_mark_save_stack(m, mem, s->data[i].save_.stk))
                 return 0;
         }
         if (i == XPOST_STACK_SEGMENT_SIZE) /* ie. s->top == XPOST_STACK_SEGMENT_SIZE */
@@ -605,29 +652,24 @@ int _xpost_garbage_mark_save(Xpost_Context *ctx,
 static
 unsigned int _xpost_garbage_sweep(Xpost_Memory_File *mem)
 {
-    unsigned int zero = 0;
-    unsigned int z;
     unsigned int i;
     unsigned int sz = 0;
     int ret;
 
-    ret = xpost_memory_table_get_addr(mem, XPOST_MEMORY_TABLE_SPECIAL_FREE, &z); /* address of the free list head */
+    ret = xpost_free_clear(mem); /* discard list */
     if (!ret)
     {
         XPOST_LOG_ERR("cannot load free list head");
         return 0;
     }
 
-    memcpy(mem->base+z, &zero, sizeof(unsigned int)); /* discard list */
-    /* *(unsigned int *)(mem->base+z) = 0; */
-
 #ifdef DEBUG_GC
     printf("freeing ");
 #endif
     /* scan table */
     for (i = mem->start; i < mem->table.nextent; i++)
     {
-        if (((mem->table.tab[i].mark & XPOST_MEMORY_TABLE_MARK_DATA_MARK_MASK) == 0) &&
+        if (!_xpost_garbage_ent_is_marked(mem, i) &&
             (mem->table.tab[i].sz != 0))
         {
 #ifdef DEBUG_GC
@@ -651,11 +693,120 @@ unsigned int _xpost_garbage_sweep(Xpost_Memory_File *mem)
     return sz;
 }
 
+/* mark all allocations reachable from a local memory file:
+   its save stack, its names and the stacks of the contexts using it.
+   if markall is true, follow the references to global vm too. */
+static
+int _xpost_garbage_mark_local(Xpost_Garbage_Marker *m,
+                              Xpost_Memory_File *mem)
+{
+    Xpost_Context *ctx;
+    unsigned int i;
+    unsigned int *cid;
+    unsigned int ad;
+    int ret;
+
+    ret = xpost_memory_table_get_addr(mem,
+                                      XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK, &ad);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot load save stack for local memory");
+        return 0;
+    }
+    if (!_xpost_garbage_mark_save(m, mem, ad))
+        return 0;
+    ret = xpost_memory_table_get_addr(mem,
+                                      XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &ad);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot load name stack for local memory");
+        return 0;
+    }
+#ifdef DEBUG_GC
+    printf("marking name stack\n");
+#endif
+    if (!_xpost_garbage_mark_names(m, mem, ad))
+        return 0;
+
+    ret = xpost_memory_table_get_addr(mem,
+                                      XPOST_MEMORY_TABLE_SPECIAL_CONTEXT_LIST, &ad);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot load context list");
+        return 0;
+    }
+    cid = (void *)(mem->base + ad);
+    for (i = 0; i < MAXCONTEXT && cid[i]; i++)
+    {
+        ctx = mem->interpreter_cid_get_context(cid[i]);
+        m->ctx = ctx;
+
+#ifdef DEBUG_GC
+        printf("marking os\n");
+#endif
+        if (!_xpost_garbage_mark_stack(m, mem, ctx->os))
+            return 0;
+
+#ifdef DEBUG_GC
+        printf("marking ds\n");
+#endif
+        if (!_xpost_garbage_mark_stack(m, mem, ctx->ds))
+            return 0;
+
+#ifdef DEBUG_GC
+        printf("marking es\n");
+#endif
+        if (!_xpost_garbage_mark_stack(m, mem, ctx->es))
+            return 0;
+
+#ifdef DEBUG_GC
+        printf("marking hold\n");
+#endif
+        if (!_xpost_garbage_mark_stack(m, mem, ctx->hold))
+            return 0;
+#ifdef DEBUG_GC
+        printf("marking window device\n");
+#endif
+        if (!_xpost_garbage_mark_object(m, mem, ctx->window_device))
+            return 0;
+#if 0
+#ifdef DEBUG_GC
+        printf("marking event handler\n");
+#endif
+        if (!_xpost_garbage_mark_object(m, mem, ctx->event_handler))
+            return 0;
+#endif
+    }
+
+    return 1;
+}
+
+/* is the local memory of the i-th context of cid already the one
+   of a previous context? contexts may share their local memory. */
+static
+int _xpost_garbage_local_is_shared(Xpost_Memory_File *mem,
+                                   unsigned int *cid,
+                                   unsigned int i)
+{
+    Xpost_Memory_File *lo = mem->interpreter_cid_get_context(cid[i])->lo;
+    unsigned int j;
+
+    for (j = 0; j < i; j++)
+    {
+        if (mem->interpreter_cid_get_context(cid[j])->lo == lo)
+            return 1;
+    }
+
+    return 0;
+}
+
 /*
    determine GLOBAL/LOCAL
    clear all marks,
    mark all root stacks,
    sweep.
+   a global collection marks from the local memories of all the
+   contexts sharing the global memory, and sweeps them too.
    return reclaimed size or -1 if error occured.
  */
 int xpost_garbage_collect(Xpost_Memory_File *mem, int dosweep, int markall)
@@ -663,6 +814,7 @@ int xpost_garbage_collect(Xpost_Memory_File *mem, int dosweep, int markall)
     unsigned int i;
     unsigned int *cid;
     Xpost_Context *ctx = NULL;
+    Xpost_Garbage_Marker m;
     int isglobal;
     unsigned int sz = 0;
     unsigned int ad;
@@ -704,109 +856,67 @@ int xpost_garbage_collect(Xpost_Memory_File *mem, int dosweep, int markall)
     printf("using cid=%d\n", ctx->id);
 #endif
 
+    if (!_xpost_garbage_marker_init(&m, ctx, isglobal || markall))
+        return -1;
+
     if (isglobal)
     {
-        dosweep = 0;
-        return 0; /* do not perform global collections at this time */
-
-        _xpost_garbage_unmark(mem);
+        if (!_xpost_garbage_unmark(mem))
+            goto error;
 
         ret = xpost_memory_table_get_addr(mem,
                                           XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK, &ad);
         if (!ret)
         {
             XPOST_LOG_ERR("cannot load save stack for global memory");
-            return -1;
+            goto error;
         }
-        if (!_xpost_garbage_mark_save(ctx, mem, ad))
-            return -1;
+        if (!_xpost_garbage_mark_save(&m, mem, ad))
+            goto error;
         ret = xpost_memory_table_get_addr(mem,
                                           XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &ad);
         if (!ret)
         {
             XPOST_LOG_ERR("cannot load name stack for global memory");
-            return -1;
+            goto error;
         }
-        if (!_xpost_garbage_mark_names(ctx, mem, ad, markall))
-            return -1;
+        if (!_xpost_garbage_mark_names(&m, mem, ad))
+            goto error;
 
+        /* the roots of global vm are in the local vms: mark each
+           of them completely, following the references to global vm */
+        ret = xpost_memory_table_get_addr(mem,
+                                          XPOST_MEMORY_TABLE_SPECIAL_CONTEXT_LIST, &ad);
+        if (!ret)
+        {
+            XPOST_LOG_ERR("cannot load context list");
+            goto error;
+        }
+        cid = (void *)(mem->base + ad);
         for (i = 0; i < MAXCONTEXT && cid[i]; i++)
         {
+            if (_xpost_garbage_local_is_shared(mem, cid, i))
+                continue;
             ctx = mem->interpreter_cid_get_context(cid[i]);
-            xpost_garbage_collect(ctx->lo, 0, markall);
+            m.ctx = ctx;
+            if (!_xpost_garbage_unmark(ctx->lo))
+                goto error;
+            if (!_xpost_garbage_mark_local(&m, ctx->lo))
+                goto error;
         }
-
     }
     else /* local */
     {
         //printf("collect!\n");
-        _xpost_garbage_unmark(mem);
-        if (markall)
-            _xpost_garbage_unmark(ctx->gl);
-
-        ret = xpost_memory_table_get_addr(mem,
-                                          XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK, &ad);
-        if (!ret)
-        {
-            XPOST_LOG_ERR("cannot load save stack for local memory");
-            return -1;
-        }
-        if (!_xpost_garbage_mark_save(ctx, mem, ad))
-            return -1;
-        ret = xpost_memory_table_get_addr(mem,
-                                          XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &ad);
-        if (!ret)
-        {
-            XPOST_LOG_ERR("cannot load name stack for local memory");
-            return -1;
-        }
-#ifdef DEBUG_GC
-        printf("marking name stack\n");
-#endif
-        if (!_xpost_garbage_mark_names(ctx, mem, ad, markall))
-            return -1;
+        if (!_xpost_garbage_unmark(mem))
+            goto error;
+        if (markall && !_xpost_garbage_unmark(ctx->gl))
+            goto error;
 
-        for (i = 0; i < MAXCONTEXT && cid[i]; i++)
-        {
-            ctx = mem->interpreter_cid_get_context(cid[i]);
-
-#ifdef DEBUG_GC
-            printf("marking os\n");
-#endif
-            if (!_xpost_garbage_mark_stack(ctx, mem, ctx->os, markall))
-                return -1;
-
-#ifdef DEBUG_GC
-            printf("marking ds\n");
-#endif
-            if (!_xpost_garbage_mark_stack(ctx, mem, ctx->ds, markall))
-                return -1;
-
-#ifdef DEBUG_GC
-            printf("marking es\n");
-#endif
-            if (!_xpost_garbage_mark_stack(ctx, mem, ctx->es, markall))
-                return -1;
-
-#ifdef DEBUG_GC
-            printf("marking hold\n");
-#endif
-            if (!_xpost_garbage_mark_stack(ctx, mem, ctx->hold, markall))
-                return -1;
-#ifdef DEBUG_GC
-            printf("marking window device\n");
-#endif
-            if (!_xpost_garbage_mark_object(ctx, mem, ctx->window_device, markall))
-                return -1;
-#if 0
-#ifdef DEBUG_GC
-            printf("marking event handler\n");
-#endif
-            if (!_xpost_garbage_mark_object(ctx, mem, ctx->event_handler, markall))
-                return -1;
-#endif
-        }
+        if (!_xpost_garbage_mark_local(&m, mem))
+            goto error;
     }
+    _xpost_garbage_marker_exit(&m);
 
     if (dosweep) {
 #ifdef DEBUG_GC
@@ -817,8 +927,10 @@ int xpost_garbage_collect(Xpost_Memory_File *mem, int dosweep, int markall)
         {
             for (i = 0; i < MAXCONTEXT && cid[i]; i++)
             {
+                if (_xpost_garbage_local_is_shared(mem, cid, i))
+                    continue;
 #ifdef DEBUG_GC
-                printf("sweep context(%d)->gl\n", cid[i]);
+                printf("sweep context(%d)->lo\n", cid[i]);
 #endif
                 ctx = mem->interpreter_cid_get_context(cid[i]);
                 sz += _xpost_garbage_sweep(ctx->lo);
@@ -826,8 +938,13 @@ int xpost_garbage_collect(Xpost_Memory_File *mem, int dosweep, int markall)
         }
     }
 
-    printf("collect recovered %u bytes\n", sz);
+    XPOST_LOG_INFO("%s collect recovered %u bytes",
+                   isglobal ? "global" : "local", sz);
     return sz;
+
+error:
+    _xpost_garbage_marker_exit(&m);
+    return -1;
 }
 
 #if 0
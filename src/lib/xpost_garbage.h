@@ -48,8 +48,12 @@
  * For a local vm, dosweep should be 1 and markall should be 0.
  * For a global vm, dosweep should be 1 and markall should be 1.
  *
- * For a global vm, collect() calls itself recursively upon each
- * associated local vm, with dosweep = 0, markall = 1.
+ * For a global vm, the local vms of all the contexts sharing it
+ * are marked and swept too.
+ *
+ * The marks are kept in a bitmap of each memory file, and the mark
+ * phase uses a work list instead of recursion, so deeply nested
+ * structures do not overflow the C stack.
  *
  * returns size collected or -1 if error occured.
  */
@@ -0,0 +1,325 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h> /* fopen fwrite remove */
+#include <stdlib.h> /* malloc free */
+#include <string.h> /* memcmp memcpy memset strerror */
+
+#include <sys/stat.h> /* open */
+#include <fcntl.h> /* open */
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h> /* read lseek close */
+#endif
+
+#ifdef _WIN32
+# include <io.h>
+# define read(f, p, s) _read(f, p, s)
+# define lseek(f, p, fl) _lseek(f, p, fl)
+# define close(f) _close(f)
+#endif
+
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
+#include "xpost.h"
+#include "xpost_log.h"
+#include "xpost_memory.h"  /* the image holds memory files and tables */
+#include "xpost_object.h"
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_interpreter.h"  /* the interpreter holds the signature */
+#include "xpost_operator.h"  /* relink */
+
+#include "xpost_image.h"
+
+/*
+   The image starts with a header, padded to XPOST_IMAGE_ALIGN,
+   followed by the data of the global and local memory files,
+   each padded to XPOST_IMAGE_ALIGN so that it can be mapped,
+   followed by the entries of their memory tables.
+ */
+
+/* a memory file in the image */
+typedef struct
+{
+    unsigned int offset; /* position of the data */
+    unsigned int used;
+    unsigned int size; /* used, rounded up to XPOST_IMAGE_ALIGN */
+    unsigned int taboffset; /* position of the table entries */
+    unsigned int nextent;
+    unsigned int start;
+    int period;
+    int threshold;
+} Xpost_Image_Memory;
+
+typedef struct
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int objsize; /* sizeof(Xpost_Object) */
+    unsigned int entsize; /* size of a memory table entry */
+    unsigned int sig[XPOST_IMAGE_SIGNATURE_SIZE];
+    unsigned int os;
+    unsigned int es;
+    unsigned int ds;
+    unsigned int hold;
+    Xpost_Image_Memory mem[2]; /* global, local */
+} Xpost_Image_Header;
+
+static const char _xpost_image_magic[8] = "XPOSTVM";
+
+static const char *_xpost_image_file = NULL;
+
+XPAPI void
+xpost_image_file_set(const char *filename)
+{
+    _xpost_image_file = filename;
+}
+
+const char *
+xpost_image_file_get(void)
+{
+    return _xpost_image_file;
+}
+
+void
+xpost_image_signature_get(Xpost_Context *ctx,
+                          unsigned int sig[XPOST_IMAGE_SIGNATURE_SIZE])
+{
+    sig[0] = ctx->gl->used;
+    sig[1] = ctx->gl->table.nextent;
+    sig[2] = ctx->lo->used;
+    sig[3] = ctx->lo->table.nextent;
+}
+
+static unsigned int
+_xpost_image_align(unsigned int sz)
+{
+    return (sz + XPOST_IMAGE_ALIGN - 1) / XPOST_IMAGE_ALIGN * XPOST_IMAGE_ALIGN;
+}
+
+/* write n bytes from p, then zeros up to sz bytes */
+static int
+_xpost_image_write(FILE *f, const void *p, size_t n, size_t sz)
+{
+    if (n && fwrite(p, 1, n, f) != n)
+        return 0;
+    for ( ; n < sz; n++)
+    {
+        if (putc(0, f) == EOF)
+            return 0;
+    }
+    return 1;
+}
+
+/* write the memory files of ctx to filename */
+XPAPI int
+xpost_image_save(Xpost_Context *ctx, const char *filename)
+{
+    Xpost_Image_Header h;
+    Xpost_Memory_File *mem[2];
+    unsigned int offset;
+    FILE *f;
+    int ok;
+    int i;
+
+    if (xpost_stack_count(ctx->lo, ctx->os) ||
+        xpost_stack_count(ctx->lo, ctx->es))
+    {
+        XPOST_LOG_ERR("VM image must be saved before the context runs");
+        return 0;
+    }
+
+    /* the device is created by each run, the procedures are not */
+    xpost_interpreter_load_graphics_files(ctx);
+    if (xpost_stack_count(ctx->lo, ctx->os) ||
+        xpost_stack_count(ctx->lo, ctx->es))
+    {
+        XPOST_LOG_ERR("loading the graphics files for the VM image failed");
+        return 0;
+    }
+
+    mem[0] = ctx->gl;
+    mem[1] = ctx->lo;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, _xpost_image_magic, sizeof h.magic);
+    h.version = XPOST_IMAGE_VERSION;
+    h.objsize = sizeof(Xpost_Object);
+    h.entsize = sizeof(*ctx->gl->table.tab);
+    memcpy(h.sig, ctx->itp->initsig, sizeof h.sig);
+    h.os = ctx->os;
+    h.es = ctx->es;
+    h.ds = ctx->ds;
+    h.hold = ctx->hold;
+    offset = XPOST_IMAGE_ALIGN;
+    for (i = 0; i < 2; i++)
+    {
+        h.mem[i].offset = offset;
+        h.mem[i].used = mem[i]->used;
+        h.mem[i].size = _xpost_image_align(mem[i]->used);
+        offset += h.mem[i].size;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        h.mem[i].taboffset = offset;
+        h.mem[i].nextent = mem[i]->table.nextent;
+        h.mem[i].start = mem[i]->start;
+        h.mem[i].period = mem[i]->period;
+        h.mem[i].threshold = mem[i]->threshold;
+        offset += h.mem[i].nextent * h.entsize;
+    }
+
+    f = fopen(filename, "wb");
+    if (!f)
+    {
+        XPOST_LOG_ERR("can not create VM image %s (error: %s)",
+                      filename, strerror(errno));
+        return 0;
+    }
+    ok = _xpost_image_write(f, &h, sizeof h, XPOST_IMAGE_ALIGN);
+    for (i = 0; i < 2; i++)
+        ok = ok && _xpost_image_write(f, mem[i]->base,
+                                      h.mem[i].used, h.mem[i].size);
+    for (i = 0; i < 2; i++)
+        ok = ok && _xpost_image_write(f, mem[i]->table.tab,
+                                      h.mem[i].nextent * h.entsize,
+                                      h.mem[i].nextent * h.entsize);
+    if (fclose(f) != 0)
+        ok = 0;
+    if (!ok)
+    {
+        XPOST_LOG_ERR("can not write VM image %s", filename);
+        remove(filename);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* replace the memory files of ctx with the ones in filename */
+int
+xpost_image_load(Xpost_Context *ctx,
+                 const char *filename,
+                 const unsigned int sig[XPOST_IMAGE_SIGNATURE_SIZE])
+{
+    Xpost_Image_Header h;
+    Xpost_Memory_File *mem[2];
+    void *tab[2] = { NULL, NULL };
+    unsigned int tabmax[2];
+    unsigned int sz;
+    int fd;
+    int i;
+
+    fd = open(filename, O_RDONLY | O_BINARY);
+    if (fd == -1)
+    {
+        XPOST_LOG_ERR("can not open VM image %s (error: %s)",
+                      filename, strerror(errno));
+        return 0;
+    }
+
+    if ((read(fd, &h, sizeof h) != (int)sizeof h) ||
+        (memcmp(h.magic, _xpost_image_magic, sizeof h.magic) != 0) ||
+        (h.version != XPOST_IMAGE_VERSION) ||
+        (h.objsize != sizeof(Xpost_Object)) ||
+        (h.entsize != sizeof(*ctx->gl->table.tab)))
+    {
+        XPOST_LOG_ERR("%s is not a VM image of this version", filename);
+        close(fd);
+        return 0;
+    }
+
+    if ((memcmp(h.sig, sig, sizeof h.sig) != 0) ||
+        (h.os != ctx->os) || (h.es != ctx->es) ||
+        (h.ds != ctx->ds) || (h.hold != ctx->hold))
+    {
+        XPOST_LOG_ERR("VM image %s was written by a different build", filename);
+        close(fd);
+        return 0;
+    }
+
+    mem[0] = ctx->gl;
+    mem[1] = ctx->lo;
+
+    /* read the tables first, so that ctx is untouched if it fails */
+    for (i = 0; i < 2; i++)
+    {
+        sz = h.mem[i].nextent * h.entsize;
+        for (tabmax[i] = mem[i]->table.max; tabmax[i] <= h.mem[i].nextent; )
+            tabmax[i] *= 2;
+        tab[i] = malloc(tabmax[i] * h.entsize);
+        if (!tab[i] ||
+            (lseek(fd, (long)h.mem[i].taboffset, SEEK_SET) == -1) ||
+            (read(fd, tab[i], sz) != (int)sz))
+        {
+            XPOST_LOG_ERR("can not read VM image %s", filename);
+            free(tab[0]);
+            free(tab[1]);
+            close(fd);
+            return 0;
+        }
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (!xpost_memory_file_load(mem[i], fd,
+                                    h.mem[i].offset,
+                                    h.mem[i].used,
+                                    h.mem[i].size))
+        {
+            XPOST_LOG_ERR("can not load VM image %s", filename);
+            for ( ; i < 2; i++)
+                free(tab[i]);
+            close(fd);
+            return -1;
+        }
+        free(mem[i]->table.tab);
+        mem[i]->table.tab = tab[i];
+        mem[i]->table.max = tabmax[i];
+        mem[i]->table.nextent = h.mem[i].nextent;
+        mem[i]->start = h.mem[i].start;
+        mem[i]->period = h.mem[i].period;
+        mem[i]->threshold = h.mem[i].threshold;
+    }
+    close(fd);
+
+    xpost_operator_relink(ctx);
+    xpost_context_load_cache_flush(ctx);
+
+    return 1;
+}
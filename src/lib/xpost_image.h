@@ -0,0 +1,116 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XPOST_IMAGE_H
+#define XPOST_IMAGE_H
+
+/**
+ * @file xpost_image.h
+ * @brief VM images.
+ *
+ * A VM image holds the global and local memory files of a context,
+ * along with their memory tables, as xpost_create() leaves them after
+ * running init.ps. All references in VM are addresses relative to the
+ * base of a memory file or entity numbers, so the image can be mapped
+ * in place of the memory files of a new context instead of
+ * interpreting init.ps again.
+ *
+ * The state which lives outside VM (the operator functions, the
+ * dispatch table, the names cached by the operator modules) is still
+ * built by the C initialization, which allocates the operators and
+ * their names in VM. An image is only loaded if the C initialization
+ * left the memory files with the same sizes as in the process which
+ * wrote it.
+ */
+
+/**
+ * @def XPOST_IMAGE_VERSION
+ * @brief Version of the VM image format.
+ */
+#define XPOST_IMAGE_VERSION 6
+
+/**
+ * @def XPOST_IMAGE_ALIGN
+ * @brief Alignment of the memory files in a VM image.
+ *
+ * The memory files must start at multiples of the page size to be
+ * mapped, this is a multiple of all the usual ones.
+ */
+#define XPOST_IMAGE_ALIGN 65536
+
+/**
+ * @def XPOST_IMAGE_SIGNATURE_SIZE
+ * @brief Number of values of the signature of the C initialization.
+ */
+#define XPOST_IMAGE_SIGNATURE_SIZE 4
+
+/**
+ * @brief Retrieve the signature of the C initialization.
+ *
+ * @param[in] ctx The context.
+ * @param[out] sig The signature.
+ *
+ * This function stores in @p sig the used sizes and the numbers of
+ * entities of the global and local memory files of @p ctx. It is
+ * called by xpost_create() right after the C initialization, before
+ * anything else is allocated.
+ */
+void xpost_image_signature_get(Xpost_Context *ctx,
+                               unsigned int sig[XPOST_IMAGE_SIGNATURE_SIZE]);
+
+/**
+ * @brief Return the VM image set with xpost_image_file_set().
+ *
+ * @return The file name of the VM image, or @c NULL.
+ */
+const char *xpost_image_file_get(void);
+
+/**
+ * @brief Load a VM image into the given context.
+ *
+ * @param[in,out] ctx The context.
+ * @param[in] filename The file name of the VM image.
+ * @param[in] sig The signature of the C initialization of @p ctx.
+ * @return 1 if the image is loaded, 0 if it can not be used, -1 on error.
+ *
+ * This function replaces the memory files of @p ctx with the ones
+ * stored in @p filename, which are mapped copy-on-write where
+ * possible. It returns 0 and leaves @p ctx untouched if the file can
+ * not be read, is not a VM image, or was written by a process whose
+ * C initialization does not match @p sig. It returns -1 if the memory
+ * files could not be replaced, @p ctx is then unusable.
+ *
+ * @see xpost_image_save()
+ */
+int xpost_image_load(Xpost_Context *ctx,
+                     const char *filename,
+                     const unsigned int sig[XPOST_IMAGE_SIGNATURE_SIZE]);
+
+#endif
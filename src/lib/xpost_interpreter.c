@@ -60,41 +60,34 @@
 #include "xpost_garbage.h"  /*  test gc, install collect() in context's memory files */
 #include "xpost_operator.h"  /* eval functions call operators */
 #include "xpost_oplib.h"
+#include "xpost_image.h"  /* load the state left by init.ps */
 
-static
-Xpost_Object namedollarerror; /* cached result of xpost_name_cons(ctx, "$error")
-                                 to reduce time in error handler */
-static Xpost_Object nameerrordict;
-
-int _xpost_interpreter_is_tracing = 0;             /* output trace log */
-Xpost_Interpreter *itpdata;  /* the global interpreter instance, containing all contexts and memory files */
-static int _initializing = 1;  /* garbage collect does not run while _initializing is true.
-                                  a getter function is exported in the memory file struct
-                                  for the gc to access this global without #include'ing interpreter.h
-                                  which would create a circular dependency. */
+/* the interpreter instance used by the calling thread,
+   containing all contexts and memory files.
+   each thread may run its own instances, so this is set by the
+   public entry points from the context they are given. */
+static XPOST_THREAD_LOCAL
+Xpost_Interpreter *itpdata;
 
 int eval(Xpost_Context *ctx);
 int mainloop(Xpost_Context *ctx);
 void init(void);
 void xit(void);
 
-/*
-   global shortcut for a single-threaded interpreter
-FIXME: "static context pointer". s.b. changed to a returned
-   value from xpost_create()
-   value now returned. this variable should be removed */
-Xpost_Context *xpost_ctx;
-
-/* getter function for _initializing, for export */
+/* getter function for initializing, for export.
+   garbage collect does not run while initializing is true.
+   the getter is exported in the memory file struct
+   for the gc to access the flag without #include'ing interpreter.h
+   which would create a circular dependency. */
 int xpost_interpreter_get_initializing(void)
 {
-    return _initializing;
+    return itpdata->initializing;
 }
 
-/* setter function for _initializing, for consistency */
+/* setter function for initializing, for consistency */
 void xpost_interpreter_set_initializing(int i)
 {
-    _initializing = i;
+    itpdata->initializing = i;
 }
 
 /*  allocate a global memory file
@@ -107,6 +100,8 @@ static Xpost_Memory_File *xpost_interpreter_alloc_global_memory(void)
     {
         if (itpdata->gtab[i].base == NULL)
         {
+            itpdata->gtab[i].max = itpdata->vm_size;
+            itpdata->gtab[i].reserve = itpdata->vm_reserve;
             return &itpdata->gtab[i];
         }
     }
@@ -123,6 +118,8 @@ static Xpost_Memory_File *xpost_interpreter_alloc_local_memory(void)
     {
         if (itpdata->ltab[i].base == NULL)
         {
+            itpdata->ltab[i].max = itpdata->vm_size;
+            itpdata->ltab[i].reserve = itpdata->vm_reserve;
             return &itpdata->ltab[i];
         }
     }
@@ -131,10 +128,6 @@ static Xpost_Memory_File *xpost_interpreter_alloc_local_memory(void)
 }
 
 
-/* cursor to next cid number to try to allocate */
-static
-unsigned int nextid = 0;
-
 /* allocate a context-id and associated context struct
    returns cid;
    a context in state zero is considered available for allocation,
@@ -142,17 +135,17 @@ unsigned int nextid = 0;
  */
 static int xpost_interpreter_cid_init(unsigned int *cid)
 {
-    unsigned int startid = nextid;
+    unsigned int startid = itpdata->nextid;
     /*printf("cid_init\n"); */
-    while ( xpost_interpreter_cid_get_context(++nextid)->state != 0 )
+    while ( xpost_interpreter_cid_get_context(++itpdata->nextid)->state != 0 )
     {
-        if (nextid == startid + MAXCONTEXT)
+        if (itpdata->nextid == startid + MAXCONTEXT)
         {
             XPOST_LOG_ERR("ctab full. cannot create new process");
             return 0;
         }
     }
-    *cid = nextid;
+    *cid = itpdata->nextid;
     return 1;
 }
 
@@ -207,9 +200,9 @@ int _xpost_interpreter_extra_context_init(Xpost_Context *ctx, const char *device
         return 0;
     if (xpost_object_get_type(xpost_name_cons(ctx, "setmiterlimit")) == invalidtype)
         return 0;
-    if (xpost_object_get_type((namedollarerror = xpost_name_cons(ctx, "$error"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.dollarerror = xpost_name_cons(ctx, "$error"))) == invalidtype)
         return 0;
-    if (xpost_object_get_type((nameerrordict = xpost_name_cons(ctx, "errordict"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.errordict = xpost_name_cons(ctx, "errordict"))) == invalidtype)
         return 0;
 
     xpost_oplib_init_ops(ctx); /* populate the optab (and systemdict) with operators */
@@ -226,6 +219,7 @@ int _xpost_interpreter_extra_context_init(Xpost_Context *ctx, const char *device
         if (ret)
             return 0;
         xpost_stack_push(ctx->lo, ctx->ds, gd);
+        xpost_context_load_cache_flush(ctx);
     }
 
     ctx->vmmode = LOCAL;
@@ -250,6 +244,7 @@ int _xpost_interpreter_extra_context_init(Xpost_Context *ctx, const char *device
         if (ret)
             return 0;
         xpost_stack_push(ctx->lo, ctx->ds, ud);
+        xpost_context_load_cache_flush(ctx);
     }
 
     ctx->device_str = device;
@@ -265,6 +260,10 @@ int xpost_interpreter_init(Xpost_Interpreter *itpptr, const char *device)
 {
     int ret;
 
+    itpdata = itpptr;
+    itpptr->initializing = 1;
+    itpptr->nextid = 0;
+    itpptr->ctab[0].itp = itpptr;
     ret = xpost_context_init(&itpptr->ctab[0],
                              xpost_interpreter_cid_init,
                              xpost_interpreter_cid_get_context,
@@ -288,10 +287,20 @@ int xpost_interpreter_init(Xpost_Interpreter *itpptr, const char *device)
     return 1;
 }
 
-/* destroy context in ctab[0] */
+/* destroy the memory files of all the contexts
+   and the operator table they share */
 void xpost_interpreter_exit(Xpost_Interpreter *itpptr)
 {
-    xpost_context_exit(&itpptr->ctab[0]);
+    int i;
+
+    xpost_operator_exit_optab(&itpptr->ctab[0]);
+    for (i = 0; i < MAXMFILE; i++)
+    {
+        if (itpptr->gtab[i].base)
+            xpost_memory_file_exit(&itpptr->gtab[i]);
+        if (itpptr->ltab[i].base)
+            xpost_memory_file_exit(&itpptr->ltab[i]);
+    }
 }
 
 
@@ -336,7 +345,7 @@ static
 int evalload(Xpost_Context *ctx)
 {
     int ret;
-    if (_xpost_interpreter_is_tracing)
+    if (ctx->tracing)
     {
         Xpost_Object s = xpost_name_get_string(ctx, xpost_stack_topdown_fetch(ctx->lo, ctx->es, 0));
         XPOST_LOG_DUMP("evalload <name \"%*s\">", s.comp_.sz, xpost_string_get_pointer(ctx, s));
@@ -371,7 +380,7 @@ int evaloperator(Xpost_Context *ctx)
     if (xpost_object_get_type(op) == invalidtype)
         return stackunderflow;
 
-    if (_xpost_interpreter_is_tracing)
+    if (ctx->tracing)
         xpost_operator_dump(ctx, op.mark_.padw);
     ret = xpost_operator_exec(ctx, op.mark_.padw);
     if (ret)
@@ -379,6 +388,87 @@ int evaloperator(Xpost_Context *ctx)
     return 0;
 }
 
+/* run a compiled procedure, as left read-only by bind.
+   Instead of pushing the tail of the body back on the exec stack for
+   each element, the tail stays on top of the exec stack and is
+   shortened in place. Operators are called directly and literals
+   pushed from this loop, which returns to eval() for names and other
+   executable objects, when an operator has touched the exec stack,
+   and on errors. The exec stack is then just as evalarray would have
+   left it, so exit, stop, execstack and _onerror behave the same.
+ */
+static
+int evalproc(Xpost_Context *ctx,
+             Xpost_Object a)
+{
+    Xpost_Stack *s;
+    Xpost_Object b;
+    unsigned int seg = 0; /* exec stack segment holding the tail, if any */
+    unsigned int top = 0;
+    int last;
+    int ret;
+
+    while (a.comp_.sz > 0)
+    {
+        b = xpost_array_get(ctx, a, 0);
+        last = a.comp_.sz == 1;
+        if (last)
+        {
+            if (seg)
+                xpost_stack_discard(ctx->lo, ctx->es, 1);
+        }
+        else
+        {
+            a = xpost_object_get_interval(a, 1, a.comp_.sz - 1);
+            if (seg)
+                ((Xpost_Stack *)(ctx->lo->base + seg))->data[top - 1] = a;
+            else
+            {
+                if (!xpost_stack_push(ctx->lo, ctx->es, a))
+                    return execstackoverflow;
+                seg = ((Xpost_Stack *)(ctx->lo->base + ctx->es))->prevseg;
+                top = xpost_stack_top_segment(ctx->lo, ctx->es)->top;
+                if (top == 0) /* the push linked a new segment */
+                    seg = 0;
+            }
+        }
+
+        ctx->currentobject = b;
+        if (xpost_object_get_type(b) == arraytype || !xpost_object_is_exe(b))
+        {
+            if (!xpost_stack_push(ctx->lo, ctx->os, b))
+                return stackoverflow;
+        }
+        else if (xpost_object_get_type(b) == operatortype)
+        {
+            ret = xpost_operator_exec(ctx, b.mark_.padw);
+            if (ret)
+                return ret;
+        }
+        else
+        {
+            if (!xpost_stack_push(ctx->lo, ctx->es, b))
+                return execstackoverflow;
+            return 0;
+        }
+
+        if (last || !seg || ctx->quit)
+            return 0;
+        ret = idleproc(ctx);
+        if (ret)
+            return ret;
+
+        /* go on only if the tail is still on top of the exec stack */
+        s = (Xpost_Stack *)(ctx->lo->base + ctx->es);
+        if (s->prevseg != seg)
+            return 0;
+        s = (Xpost_Stack *)(ctx->lo->base + seg);
+        if (s->top != top || memcmp(&s->data[top - 1], &a, sizeof a) != 0)
+            return 0;
+    }
+    return 0;
+}
+
 /* extract head (&tail) of array */
 static
 int evalarray(Xpost_Context *ctx)
@@ -389,6 +479,10 @@ int evalarray(Xpost_Context *ctx)
     if (xpost_object_get_type(a) == invalidtype)
         return stackunderflow;
 
+    if (!ctx->tracing &&
+        xpost_object_get_access(ctx, a) != XPOST_OBJECT_TAG_ACCESS_UNLIMITED)
+        return evalproc(ctx, a);
+
     switch (a.comp_.sz)
     {
         default /* > 1 */:
@@ -621,7 +715,7 @@ int eval(Xpost_Context *ctx)
     if (!validate_context(ctx))
         return unregistered;
 
-    if (_xpost_interpreter_is_tracing)
+    if (ctx->tracing)
     {
         XPOST_LOG_DUMP("eval(): Executing: ");
         xpost_object_dump(t);
@@ -697,7 +791,7 @@ void _onerror(Xpost_Context *ctx,
     sd = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0);
 
     /* printf("2\n"); */
-    dollarerror = xpost_dict_get(ctx, sd, namedollarerror);
+    dollarerror = xpost_dict_get(ctx, sd, ctx->name_shortcuts.dollarerror);
     if (xpost_object_get_type(dollarerror) == invalidtype)
     {
         XPOST_LOG_ERR("cannot load $error dict for error: %s",
@@ -719,7 +813,7 @@ void _onerror(Xpost_Context *ctx,
     /* printf("7\n"); */
     xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx(xpost_name_cons(ctx, "signalerror")));
 #endif
-    ed = xpost_dict_get(ctx, sd, nameerrordict);
+    ed = xpost_dict_get(ctx, sd, ctx->name_shortcuts.errordict);
     xpost_stack_push(ctx->lo, ctx->es,
             xpost_dict_get(ctx, ed,
                 xpost_name_cons(ctx, errorname[err])));
@@ -805,7 +899,7 @@ int mainloop(Xpost_Context *ctx)
     int ret;
 
 ctxswitch:
-    xpost_ctx = ctx = _switch_context(ctx);
+    ctx = _switch_context(ctx);
     itpdata->cid = ctx->id;
 
     while(!ctx->quit)
@@ -840,49 +934,92 @@ ctxswitch:
 #define CNT_STR(s) sizeof(s) - 1, s
 
 /*
-   set global pagesize,
-   initialize eval's jump-tabl
-   allocate global itpdata interpreter instance
+   initialize eval's jump-tabl and the other tables
+   which all the interpreter instances share.
+   called once by xpost_init(), before any thread creates an instance.
+ */
+void xpost_interpreter_tables_init(void)
+{
+    initevaltype();
+    xpost_object_install_dict_get_access(xpost_dict_get_access);
+    xpost_object_install_dict_set_access(xpost_dict_set_access);
+    null = xpost_object_cvlit(null);
+}
+
+/*
+   allocate an interpreter instance
    call xpost_interpreter_init
         which initializes the first context
  */
 static
-int initalldata(const char *device)
+Xpost_Interpreter *initalldata(const char *device,
+                               unsigned int vm_size,
+                               unsigned int vm_reserve)
 {
+    Xpost_Interpreter *itp;
     int ret;
 
-    initevaltype();
-    xpost_object_install_dict_get_access(xpost_dict_get_access);
-    xpost_object_install_dict_set_access(xpost_dict_set_access);
-
-    /* allocate the top-level itpdata data structure. */
-    null = xpost_object_cvlit(null);
-    itpdata = malloc(sizeof*itpdata);
-    if (!itpdata)
+    /* allocate the top-level interpreter data structure. */
+    itp = malloc(sizeof*itp);
+    if (!itp)
     {
         XPOST_LOG_ERR("itpdata=malloc failed");
-        return 0;
+        return NULL;
     }
-    memset(itpdata, 0, sizeof*itpdata);
+    memset(itp, 0, sizeof*itp);
+    itp->vm_size = vm_size;
+    itp->vm_reserve = vm_reserve;
 
     /* allocate and initialize the first context structure
        and associated memory structures.
        populate OPTAB and systemdict with operators.
        push systemdict, globaldict, and userdict on dict stack
      */
-    ret = xpost_interpreter_init(itpdata, device);
+    ret = xpost_interpreter_init(itp, device);
     if (!ret)
     {
-        return 0;
+        free(itp);
+        itpdata = NULL;
+        return NULL;
     }
 
-    /* set global shortcut to context_0
-       (the only context in a single-threaded interpreter)
-       TODO remove this variable
-     */
-    xpost_ctx = &itpdata->ctab[0];
+    return itp;
+}
 
-    return 1;
+/*
+   define the output of the device in systemdict,
+   from the output pointer given to xpost_create or xpost_output_set.
+   called with vmmode GLOBAL.
+ */
+static
+void setoutputconfig(Xpost_Context *ctx,
+                     Xpost_Object sd,
+                     const char *outfile,
+                     const char *bufferin,
+                     char **bufferout)
+{
+    if (outfile)
+    {
+        xpost_dict_put(ctx, sd,
+                       xpost_name_cons(ctx, "OutputFileName"),
+                       xpost_object_cvlit(xpost_string_cons(ctx, strlen(outfile), outfile)));
+    }
+
+    if (bufferin)
+    {
+        Xpost_Object s = xpost_object_cvlit(xpost_string_cons(ctx, sizeof(bufferin), NULL));
+        xpost_object_set_access(ctx, s, XPOST_OBJECT_TAG_ACCESS_NONE);
+        memcpy(xpost_string_get_pointer(ctx, s), &bufferin, sizeof(bufferin));
+        xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "OutputBufferIn"), s);
+    }
+
+    if (bufferout)
+    {
+        Xpost_Object s = xpost_object_cvlit(xpost_string_cons(ctx, sizeof(bufferout), NULL));
+        xpost_object_set_access(ctx, s, XPOST_OBJECT_TAG_ACCESS_NONE);
+        memcpy(xpost_string_get_pointer(ctx, s), &bufferout, sizeof(bufferout));
+        xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "OutputBufferOut"), s);
+    }
 }
 
 /* FIXME remove duplication of effort here and in bin/xpost_main.c
@@ -981,59 +1118,34 @@ void setlocalconfig(Xpost_Context *ctx,
 
     xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "ShowpageSemantics"), xpost_int_cons(semantics));
 
-    if (outfile)
-    {
-        xpost_dict_put(ctx, sd,
-                       xpost_name_cons(ctx, "OutputFileName"),
-                       xpost_object_cvlit(xpost_string_cons(ctx, strlen(outfile), outfile)));
-    }
-
-    if (bufferin)
-    {
-        Xpost_Object s = xpost_object_cvlit(xpost_string_cons(ctx, sizeof(bufferin), NULL));
-        xpost_object_set_access(ctx, s, XPOST_OBJECT_TAG_ACCESS_NONE);
-        memcpy(xpost_string_get_pointer(ctx, s), &bufferin, sizeof(bufferin));
-        xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "OutputBufferIn"), s);
-    }
-
-    if (bufferout)
-    {
-        Xpost_Object s = xpost_object_cvlit(xpost_string_cons(ctx, sizeof(bufferout), NULL));
-        xpost_object_set_access(ctx, s, XPOST_OBJECT_TAG_ACCESS_NONE);
-        memcpy(xpost_string_get_pointer(ctx, s), &bufferout, sizeof(bufferout));
-        xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "OutputBufferOut"), s);
-    }
+    setoutputconfig(ctx, sd, outfile, bufferin, bufferout);
 
     ctx->vmmode = LOCAL;
     free(devstr);
 }
 
 /*
-   load init.ps (which also loads err.ps) while systemdict is writeable
-   ignore invalidaccess errors.
+   find init.ps, in the directory given by the environment variable
+   XPOST_DATA_DIR, the data directory of the shared library,
+   or PACKAGE_DATA_DIR.
+   store its path in path_init_ps and return its directory,
+   or NULL if it can not be found.
  */
 static
-void loadinitps(Xpost_Context *ctx)
+char *findinitps(char *path_init_ps, size_t sz)
 {
-    char buf[1024];
-    char path_init_ps[XPOST_PATH_MAX];
     struct stat statbuf;
     char *path_init;
     char *path;
-    int n;
-
-    assert(ctx->gl->base);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "quit", NULL,0,0));
-    ctx->ignoreinvalidaccess = 1;
 
 #define XPOST_PATH_INIT \
     do \
     { \
-        snprintf(path_init_ps, sizeof(path_init_ps), "%s/init.ps", path); \
+        snprintf(path_init_ps, sz, "%s/init.ps", path); \
         if (stat(path_init_ps, &statbuf) == 0) \
         { \
             path_init = path; \
-            goto load_init_ps; \
+            goto found_init_ps; \
         } \
         else \
             XPOST_LOG_DBG("init.ps not present in", path_init_ps); \
@@ -1057,9 +1169,9 @@ void loadinitps(Xpost_Context *ctx)
 
     XPOST_LOG_ERR("init.ps can not be found");
 
-    return;
+    return NULL;
 
-  load_init_ps:
+  found_init_ps:
     /* backslashes are not supported in path because they are inserted in
     * PostScript files, and PostScript */
 #ifdef _WIN32
@@ -1068,6 +1180,29 @@ void loadinitps(Xpost_Context *ctx)
     path = path_init;
     while (*path++) if (*path == '\\') *path = '/';
 #endif
+    return path_init;
+}
+
+/*
+   load init.ps (which also loads err.ps) while systemdict is writeable
+   ignore invalidaccess errors.
+ */
+static
+void loadinitps(Xpost_Context *ctx)
+{
+    char buf[1024];
+    char path_init_ps[XPOST_PATH_MAX];
+    char *path_init;
+    int n;
+
+    assert(ctx->gl->base);
+    path_init = findinitps(path_init_ps, sizeof(path_init_ps));
+    if (!path_init)
+        return;
+
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "quit", NULL,0,0));
+    ctx->ignoreinvalidaccess = 1;
+
     n = snprintf(buf, sizeof(buf),
                  "(%s) (r) file cvx "
                  "/DATA_DIR (%s) def exec ", path_init_ps, path_init);
@@ -1079,6 +1214,55 @@ void loadinitps(Xpost_Context *ctx)
     ctx->ignoreinvalidaccess = 0;
 }
 
+/*
+   load the graphics files without instantiating the device,
+   so that xpost_image_save() can keep them in the image.
+ */
+void xpost_interpreter_load_graphics_files(Xpost_Context *ctx)
+{
+    itpdata = ctx->itp;
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons(ctx, "quit", NULL,0,0));
+    xpost_stack_push(ctx->lo, ctx->es,
+                     xpost_object_cvx(xpost_name_cons(ctx, "loadgraphicsfiles")));
+
+    ctx->quit = 0;
+    mainloop(ctx);
+}
+
+/*
+   prepare the vm loaded from an image for setlocalconfig:
+   remove the definitions which setlocalconfig makes only for
+   some configurations, and define DATA_DIR as loadinitps does.
+ */
+static
+void resetlocalconfig(Xpost_Context *ctx, Xpost_Object sd, Xpost_Object ud)
+{
+    const char *names[] = {
+        "SUBDEVICE", "OutputFileName", "OutputBufferIn", "OutputBufferOut",
+        "QUIET", NULL
+    };
+    char path_init_ps[XPOST_PATH_MAX];
+    char *path_init;
+    Xpost_Object k;
+    int i;
+
+    ctx->vmmode = GLOBAL;
+    for (i = 0; names[i]; i++)
+    {
+        k = xpost_name_cons(ctx, names[i]);
+        if (xpost_dict_known_key(ctx, ctx->gl, sd, k))
+            xpost_dict_undef(ctx, sd, k);
+    }
+    ctx->vmmode = LOCAL;
+
+    path_init = findinitps(path_init_ps, sizeof(path_init_ps));
+    if (path_init)
+    {
+        xpost_dict_put(ctx, ud, xpost_name_cons(ctx, "DATA_DIR"),
+                       xpost_object_cvlit(xpost_string_cons(ctx, strlen(path_init), path_init)));
+    }
+}
+
 
 /* copy userdict names to systemdict
     Problem: This is clearly an invalidaccess,
@@ -1116,28 +1300,34 @@ XPAPI Xpost_Context *xpost_create(const char *device,
                                   Xpost_Output_Message output_msg,
                                   Xpost_Set_Size set_size,
                                   int width,
-                                  int height)
+                                  int height,
+                                  unsigned int vm_size,
+                                  unsigned int vm_reserve)
 {
+    Xpost_Interpreter *itp;
+    Xpost_Context *ctx;
     Xpost_Object sd, ud;
     int ret;
+    const char *image;
     const char *outfile = NULL;
     const char *bufferin = NULL;
     char **bufferout = NULL;
     int quiet;
+    int tracing;
 
     switch (output_msg)
     {
         case XPOST_OUTPUT_MESSAGE_QUIET:
             quiet = 1;
-            _xpost_interpreter_is_tracing = 0;
+            tracing = 0;
             break;
         case XPOST_OUTPUT_MESSAGE_VERBOSE:
             quiet = 0;
-            _xpost_interpreter_is_tracing = 0;
+            tracing = 0;
             break;
         case XPOST_OUTPUT_MESSAGE_TRACING:
             quiet = 0;
-            _xpost_interpreter_is_tracing = 1;
+            tracing = 1;
             break;
         default:
             XPOST_LOG_ERR("Wrong output message value");
@@ -1171,47 +1361,76 @@ XPAPI Xpost_Context *xpost_create(const char *device,
         return NULL;
 #endif
 
-    nextid = 0; /*reset process counter */
-
     /* Allocate and initialize all interpreter data structures. */
-    ret = initalldata(device);
-    if (!ret)
+    itp = initalldata(device, vm_size, vm_reserve);
+    if (!itp)
     {
         return NULL;
     }
+    ctx = &itp->ctab[0];
+    ctx->tracing = tracing;
+    xpost_image_signature_get(ctx, itp->initsig);
+
+    /* map the state left by init.ps, if a VM image is set */
+    image = xpost_image_file_get();
+    if (image)
+    {
+        ret = xpost_image_load(ctx, image, itp->initsig);
+        if (ret < 0)
+        {
+            goto destroy_itp;
+        }
+        if (ret == 0)
+        {
+            XPOST_LOG_INFO("loading init.ps instead of VM image %s", image);
+            image = NULL;
+        }
+    }
 
     /* extract systemdict and userdict for additional definitions */
-    sd = xpost_stack_bottomup_fetch(xpost_ctx->lo, xpost_ctx->ds, 0);
-    ud = xpost_stack_bottomup_fetch(xpost_ctx->lo, xpost_ctx->ds, 2);
+    sd = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0);
+    ud = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 2);
 
-    setlocalconfig(xpost_ctx, sd,
+    if (image)
+    {
+        /* systemdict is already readonly */
+        ctx->ignoreinvalidaccess = 1;
+        resetlocalconfig(ctx, sd, ud);
+    }
+
+    setlocalconfig(ctx, sd,
                    device, outfile, bufferin, bufferout,
                    semantics, set_size, width, height);
 
     if (quiet)
     {
-        xpost_dict_put(xpost_ctx,
+        xpost_dict_put(ctx,
                        sd /*xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0)*/ ,
-                       xpost_name_cons(xpost_ctx, "QUIET"),
+                       xpost_name_cons(ctx, "QUIET"),
                        null);
     }
+    ctx->ignoreinvalidaccess = 0;
 
-    xpost_stack_clear(xpost_ctx->lo, xpost_ctx->hold);
+    xpost_stack_clear(ctx->lo, ctx->hold);
     xpost_interpreter_set_initializing(0);
-    loadinitps(xpost_ctx);
+    if (image)
+    {
+        return ctx;
+    }
+    loadinitps(ctx);
 
-    ret = copyudtosd(xpost_ctx, ud, sd);
+    ret = copyudtosd(ctx, ud, sd);
     if (ret)
     {
         XPOST_LOG_ERR("%s error in copyudtosd", errorname[ret]);
-        return NULL;
+        goto destroy_itp;
     }
 
     /* make systemdict readonly FIXME: use new access semantics */
-    xpost_dict_put(xpost_ctx, sd, xpost_name_cons(xpost_ctx, "systemdict"), sd);
-    xpost_object_set_access(xpost_ctx, sd, XPOST_OBJECT_TAG_ACCESS_READ_ONLY);
+    xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "systemdict"), sd);
+    xpost_object_set_access(ctx, sd, XPOST_OBJECT_TAG_ACCESS_READ_ONLY);
 #if 0
-    if (!xpost_stack_bottomup_replace(xpost_ctx->lo, xpost_ctx->ds, 0, xpost_object_set_access(xpost_ctx, sd, XPOST_OBJECT_TAG_ACCESS_READ_ONLY)))
+    if (!xpost_stack_bottomup_replace(ctx->lo, ctx->ds, 0, xpost_object_set_access(ctx, sd, XPOST_OBJECT_TAG_ACCESS_READ_ONLY)))
     {
         XPOST_LOG_ERR("cannot replace systemdict in dict stack");
         return NULL;
@@ -1220,7 +1439,13 @@ XPAPI Xpost_Context *xpost_create(const char *device,
 
     xpost_interpreter_set_initializing(0);
 
-    return xpost_ctx;
+    return ctx;
+
+  destroy_itp:
+    xpost_interpreter_exit(itp);
+    free(itp);
+    itpdata = NULL;
+    return NULL;
 }
 
 static
@@ -1243,6 +1468,7 @@ XPAPI int xpost_add_definitions(Xpost_Context *ctx, int cnt, char *defs[])
     Xpost_Object ud;
 
     if (!ctx) return 0;
+    itpdata = ctx->itp;
     XPOST_LOG_INFO("adding %d defs", cnt);
 
     ud = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 2);
@@ -1269,6 +1495,58 @@ XPAPI int xpost_add_definitions(Xpost_Context *ctx, int cnt, char *defs[])
     return 1;
 }
 
+/*
+   replace the output given to xpost_create,
+   for the devices instantiated by the next runs.
+ */
+XPAPI int xpost_output_set(Xpost_Context *ctx, Xpost_Output_Type output_type, const void *outputptr)
+{
+    const char *names[] = {
+        "OutputFileName", "OutputBufferIn", "OutputBufferOut", NULL
+    };
+    const char *outfile = NULL;
+    const char *bufferin = NULL;
+    char **bufferout = NULL;
+    Xpost_Object sd, k;
+    int i;
+
+    if (!ctx) return 0;
+    itpdata = ctx->itp;
+
+    switch (output_type)
+    {
+        case XPOST_OUTPUT_FILENAME:
+            outfile = outputptr;
+            break;
+        case XPOST_OUTPUT_BUFFERIN:
+            bufferin = outputptr;
+            break;
+        case XPOST_OUTPUT_BUFFEROUT:
+            bufferout = (char **)outputptr;
+            break;
+        case XPOST_OUTPUT_DEFAULT:
+            break;
+    }
+
+    /* systemdict is readonly */
+    sd = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0);
+    xpost_interpreter_set_initializing(1);
+    ctx->vmmode = GLOBAL;
+    ctx->ignoreinvalidaccess = 1;
+    for (i = 0; names[i]; i++)
+    {
+        k = xpost_name_cons(ctx, names[i]);
+        if (xpost_dict_known_key(ctx, ctx->gl, sd, k))
+            xpost_dict_undef(ctx, sd, k);
+    }
+    setoutputconfig(ctx, sd, outfile, bufferin, bufferout);
+    ctx->ignoreinvalidaccess = 0;
+    ctx->vmmode = LOCAL;
+    xpost_interpreter_set_initializing(0);
+
+    return 1;
+}
+
 /*
    execute ps program until quit, fall-through to quit,
    SHOWPAGE_RETURN semantic, or error (default action: message, purge and quit).
@@ -1285,6 +1563,7 @@ XPAPI int xpost_run(Xpost_Context *ctx, Xpost_Input_Type input_type, const void
     Xpost_Object device;
     Xpost_Object semantic;
 
+    itpdata = ctx->itp;
     switch(input_type)
     {
         case XPOST_INPUT_FILENAME:
@@ -1292,12 +1571,8 @@ XPAPI int xpost_run(Xpost_Context *ctx, Xpost_Input_Type input_type, const void
             break;
         case XPOST_INPUT_STRING:
             ps_str = inputptr;
-            ps_file_ptr = tmpfile();
-            if (set_size)
-                fwrite(ps_str, 1, set_size, (FILE*)ps_file_ptr);
-            else
-                fwrite(ps_str, 1, strlen(ps_str), (FILE*)ps_file_ptr);
-            rewind((FILE*)ps_file_ptr);
+            if (!set_size)
+                set_size = strlen(ps_str);
             break;
         case XPOST_INPUT_FILEPTR:
             ps_file_ptr = inputptr;
@@ -1306,6 +1581,11 @@ XPAPI int xpost_run(Xpost_Context *ctx, Xpost_Input_Type input_type, const void
             goto run;
     }
 
+    /* load the graphics procedures before the snapshot below, like
+       a VM image holds them, so they stay loaded for the next run.
+       the device is instantiated by the 'start*' procedure. */
+    xpost_interpreter_load_graphics_files(ctx);
+
     /* prime the exec stack
        so it starts with a 'start*' procedure,
        and if it ever gets to the bottom, it quits.
@@ -1328,6 +1608,12 @@ XPAPI int xpost_run(Xpost_Context *ctx, Xpost_Input_Type input_type, const void
         xpost_stack_push(ctx->lo, ctx->os, xpost_object_cvlit(xpost_string_cons(ctx, strlen(ps_file), ps_file)));
         xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx(xpost_name_cons(ctx, "startfilename")));
     }
+    else if (ps_str)
+    {
+        /* scan the caller's buffer in place, no copy */
+        xpost_stack_push(ctx->lo, ctx->os, xpost_object_cvlit(xpost_file_cons_readbuffer(ctx->lo, (unsigned char *)ps_str, set_size)));
+        xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx(xpost_name_cons(ctx, "startfile")));
+    }
     else if (ps_file_ptr)
     {
         xpost_stack_push(ctx->lo, ctx->os, xpost_object_cvlit(xpost_file_cons(ctx->lo, ps_file_ptr)));
@@ -1401,17 +1687,21 @@ run:
             xpost_save_restore_snapshot(ctx->lo);
         }
     }
+    xpost_context_load_cache_invalidate(ctx->gl, null);
+    xpost_context_load_cache_invalidate(ctx->lo, null);
 
     return noerror;
 }
 
 /*
-   destroy the given context and associated memory files (if not in use by a shared context)
-   exit interpreter if all contexts are destroyed.
+   destroy the given context and associated memory files,
+   with the interpreter instance which owns them.
  */
 XPAPI void xpost_destroy(Xpost_Context *ctx)
 {
+    Xpost_Interpreter *itp = ctx->itp;
 
+    itpdata = itp;
     if (!xpost_dict_known_key(ctx, ctx->gl, xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 0), xpost_name_cons(ctx, "QUIET")))
     {
         printf("bye!\n");
@@ -1426,7 +1716,7 @@ XPAPI void xpost_destroy(Xpost_Context *ctx)
 #endif
 #endif
 
-    /* exit if all contexts are destroyed */
-    /*xpost_interpreter_exit(itpdata); */
-    /*free(itpdata); */
+    xpost_interpreter_exit(itp);
+    free(itp);
+    itpdata = NULL;
 }
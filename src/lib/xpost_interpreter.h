@@ -41,6 +41,11 @@
  * also from tables. The itpdata structure thus encapsulates the entire
  * dynamic state of the interpreter as a whole.
  *
+ * Each xpost_create() makes a new instance, and the instances share
+ * no mutable state, so separate threads may each run their own. The
+ * instance in use by a thread is selected by the public entry points
+ * from the context they are given.
+ *
  * The interpreter module also contains functions for eval actions,
  * the core interpreter loop,
  *
@@ -51,18 +56,22 @@
  */
 #define MAXMFILE 10
 
-typedef struct
+typedef struct _Xpost_Interpreter
 {
     Xpost_Context ctab[MAXCONTEXT];
     unsigned int cid;
+    unsigned int nextid; /* cursor to next cid number to try to allocate */
     Xpost_Memory_File gtab[MAXMFILE];
     Xpost_Memory_File ltab[MAXMFILE];
     int in_onerror;
+    int initializing; /* garbage collect does not run while initializing is true */
+    unsigned int initsig[4]; /* vm sizes after the C initialization,
+                                see xpost_image_signature_get() */
+    unsigned int vm_size; /* initial size of the memory files, 0 for one page */
+    unsigned int vm_reserve; /* address range reserved for each memory file,
+                                0 for XPOST_MEMORY_FILE_RESERVE */
 } Xpost_Interpreter;
 
-
-extern Xpost_Interpreter *itpdata;
-
 /* garbage collection does not run during initializing */
 int xpost_interpreter_get_initializing(void);
 void xpost_interpreter_set_initializing(int i);
@@ -77,11 +86,19 @@ Xpost_Context *xpost_interpreter_cid_get_context(unsigned int cid);
  */
 int idleproc(Xpost_Context *ctx);
 
-extern int _xpost_interpreter_is_tracing;
+/**
+ * @brief initialize the tables shared by all the interpreter instances.
+ *
+ * Called once by xpost_init().
+ */
+void xpost_interpreter_tables_init(void);
 
 int xpost_interpreter_init(Xpost_Interpreter *itp, const char *device);
 void xpost_interpreter_exit(Xpost_Interpreter *itp);
 
+/* run graphics.ps without creating the device, for xpost_image_save() */
+void xpost_interpreter_load_graphics_files(Xpost_Context *ctx);
+
 /**
  * @}
  */
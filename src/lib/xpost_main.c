@@ -59,6 +59,8 @@
 #include "xpost_compat.h"
 #include "xpost_object.h"
 #include "xpost_memory.h"
+#include "xpost_context.h"
+#include "xpost_interpreter.h" /* xpost_interpreter_tables_init */
 #include "xpost_font.h"
 #include "xpost_main.h"
 #include "xpost_private.h"
@@ -122,6 +124,8 @@ xpost_init(void)
     if (!xpost_font_init())
         return --_xpost_init_count;
 
+    xpost_interpreter_tables_init();
+
 #ifdef _WIN32
     if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
         return --_xpost_init_count;
@@ -159,6 +163,12 @@ xpost_quit(void)
     return _xpost_init_count;
 }
 
+XPAPI void
+xpost_thread_quit(void)
+{
+    xpost_font_thread_quit();
+}
+
 XPAPI void
 xpost_version_get(int *maj, int *min, int *mic)
 {
@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <ctype.h> /* isprint */
 #include <errno.h>
+#include <limits.h> /* UINT_MAX */
 #include <stdlib.h> /* free malloc realloc */
 #include <stdio.h> /* remove puts */
 #include <string.h> /* memset strerror */
@@ -104,6 +105,107 @@ xpost_memory_init(void)
 #endif
 }
 
+/* round sz up to a multiple of the page size */
+static size_t
+_xpost_memory_file_round(size_t sz)
+{
+    return (sz + xpost_memory_page_size - 1) /
+        xpost_memory_page_size * xpost_memory_page_size;
+}
+
+/* the largest size of a memory file, whose offsets are unsigned int */
+static size_t
+_xpost_memory_file_limit(void)
+{
+    return (size_t)UINT_MAX / xpost_memory_page_size * xpost_memory_page_size;
+}
+
+#if defined (HAVE_MMAP) && !defined (_WIN32)
+
+# ifndef MAP_NORESERVE
+#  define MAP_NORESERVE 0
+# endif
+
+/*
+   reserve an address range of sz bytes, at adr if not NULL.
+   its pages are not accessible until they are committed.
+   return the range, or MAP_FAILED.
+ */
+static unsigned char *
+_xpost_memory_file_reserve(unsigned char *adr, size_t sz)
+{
+    return (unsigned char *)mmap(adr, sz,
+                                 PROT_NONE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+                                 (adr ? MAP_FIXED : 0),
+                                 -1, 0);
+}
+
+/*
+   commit the pages from off to sz of the range reserved at base,
+   mapping the file fd at the same offset, or anonymous memory if fd
+   is -1. off must be a multiple of the page size.
+   return 1 on success, 0 on failure.
+ */
+static int
+_xpost_memory_file_commit(unsigned char *base, int fd, size_t off, size_t sz)
+{
+    void *tmp;
+
+    if (sz <= off)
+        return 1;
+    tmp = mmap(base + off, sz - off,
+               PROT_READ | PROT_WRITE,
+               (fd == -1 ? MAP_PRIVATE   : MAP_SHARED) |
+               (fd == -1 ? MAP_ANONYMOUS : 0) | MAP_FIXED,
+               fd, (off_t)off);
+    return tmp != MAP_FAILED;
+}
+
+/*
+   commit the pages of mem up to sz bytes in its reserved range.
+   when the range is full, reserve a new one twice as large and
+   move there: the pages of the file are mapped again, anonymous
+   memory and VM images are copied.
+   return the base of mem, or MAP_FAILED.
+ */
+static unsigned char *
+_xpost_memory_file_extend(Xpost_Memory_File *mem, size_t sz)
+{
+    unsigned char *base;
+    size_t rsz;
+
+    if (sz <= mem->reserve)
+    {
+        if (!_xpost_memory_file_commit(mem->base, mem->fd,
+                                       _xpost_memory_file_round(mem->max), sz))
+            return (unsigned char *)MAP_FAILED;
+        return mem->base;
+    }
+
+    rsz = (sz > _xpost_memory_file_limit() / 2) ?
+        _xpost_memory_file_limit() : 2 * sz;
+    base = _xpost_memory_file_reserve(NULL, rsz);
+    if (base == MAP_FAILED)
+        return base;
+    if (!_xpost_memory_file_commit(base, mem->fd, 0, sz))
+    {
+        munmap((void *)base, rsz);
+        return (unsigned char *)MAP_FAILED;
+    }
+    if (mem->fd == -1)
+    {
+        memcpy(base, mem->base, mem->used);
+        mem->image = 0;
+    }
+    munmap((void *)mem->base, mem->reserve);
+    mem->reserve = (unsigned int)rsz;
+
+    return base;
+}
+
+#endif
+
 /*
    initialize the memory file structure,
    possibly using filename or file descriptor.
@@ -118,7 +220,8 @@ xpost_memory_file_init(Xpost_Memory_File *mem,
                        void (*xpost_interpreter_set_initializing)(int))
 {
     struct stat buf;
-    size_t sz = xpost_memory_page_size;
+    size_t sz;
+    size_t rsz = 0;
 #ifdef _WIN32
     HANDLE h;
     HANDLE fm;
@@ -145,14 +248,21 @@ xpost_memory_file_init(Xpost_Memory_File *mem,
         mem->fname[0] = '\0';
 
     mem->fd = fd;
+    mem->markbits = NULL;
+    mem->markbits_size = 0;
+    sz = _xpost_memory_file_round(mem->max);
+    if (sz < xpost_memory_page_size)
+        sz = xpost_memory_page_size;
+    if (sz > _xpost_memory_file_limit())
+        sz = _xpost_memory_file_limit();
     if (fd != -1)
     {
         if (fstat(fd, &buf) == 0)
         {
-            sz = buf.st_size;
-            if (sz < xpost_memory_page_size)
+            if ((size_t)buf.st_size > sz)
+                sz = (size_t)buf.st_size;
+            if ((size_t)buf.st_size < sz)
             {
-                sz = xpost_memory_page_size;
 #if defined (HAVE_MMAP) || defined (_WIN32)
                 if (fd != -1)
                 {
@@ -198,12 +308,32 @@ xpost_memory_file_init(Xpost_Memory_File *mem,
     if (!mem->base)
     {
 #elif defined (HAVE_MMAP)
-    mem->base = (unsigned char *)mmap(NULL,
-                                      sz,
-                                      PROT_READ | PROT_WRITE,
-                                      (fd == -1 ? MAP_PRIVATE   : MAP_SHARED) |
-                                      (fd == -1 ? MAP_ANONYMOUS : 0),
-                                      fd, 0);
+    rsz = mem->reserve ?
+        _xpost_memory_file_round(mem->reserve) : XPOST_MEMORY_FILE_RESERVE;
+    if (rsz > _xpost_memory_file_limit())
+        rsz = _xpost_memory_file_limit();
+    mem->base = (unsigned char *)MAP_FAILED;
+    if (rsz > sz)
+    {
+        mem->base = _xpost_memory_file_reserve(NULL, rsz);
+        if ((mem->base != MAP_FAILED) &&
+            !_xpost_memory_file_commit(mem->base, fd, 0, sz))
+        {
+            munmap((void *)mem->base, rsz);
+            mem->base = (unsigned char *)MAP_FAILED;
+        }
+    }
+    if (mem->base == MAP_FAILED)
+    {
+        /* no reserved range, the memory file moves when it grows */
+        rsz = 0;
+        mem->base = (unsigned char *)mmap(NULL,
+                                          sz,
+                                          PROT_READ | PROT_WRITE,
+                                          (fd == -1 ? MAP_PRIVATE   : MAP_SHARED) |
+                                          (fd == -1 ? MAP_ANONYMOUS : 0),
+                                          fd, 0);
+    }
     if (mem->base == MAP_FAILED)
     { /* . */
 #else
@@ -216,6 +346,8 @@ xpost_memory_file_init(Xpost_Memory_File *mem,
     } /* . .. */
     mem->used = 0;
     mem->max = sz;
+    mem->reserve = (unsigned int)rsz;
+    mem->image = 0;
 #ifndef HAVE_MMAP
     /* read file into malloc'd memory */
     if (fd != -1)
@@ -253,7 +385,7 @@ xpost_memory_file_exit(Xpost_Memory_File *mem)
 #ifdef _WIN32
     UnmapViewOfFile(mem->base);
 #elif defined (HAVE_MMAP)
-    munmap((void *)mem->base, mem->max);
+    munmap((void *)mem->base, mem->reserve ? mem->reserve : mem->max);
 #else
     if (mem->fd != -1)
     {
@@ -267,6 +399,10 @@ xpost_memory_file_exit(Xpost_Memory_File *mem)
     mem->base = NULL;
     mem->used = 0;
     mem->max = 0;
+    mem->reserve = 0;
+    free(mem->markbits);
+    mem->markbits = NULL;
+    mem->markbits_size = 0;
 
     if (mem->fd != -1)
     {
@@ -284,7 +420,8 @@ xpost_memory_file_exit(Xpost_Memory_File *mem)
     return 1;
 }
 
-/* grow memory file by sz bytes, rounded up to the nearest system page size.
+/* grow memory file by sz bytes, rounded up to the nearest system page size,
+   and by at least half of its size.
    return 1 on success, 0 on failure.
  */
 XPCHECKAPI int
@@ -314,6 +451,20 @@ xpost_memory_file_grow(Xpost_Memory_File *mem,
         sz = xpost_memory_page_size;
     else
         sz = (sz / xpost_memory_page_size + 1) * xpost_memory_page_size;
+    if (sz > _xpost_memory_file_limit() - mem->max)
+    {
+        XPOST_LOG_ERR("%d memory file can not grow beyond %u bytes",
+                      VMerror, (unsigned int)_xpost_memory_file_limit());
+        return 0;
+    }
+    /* grow geometrically, so that a memory file which grows steadily
+       is only extended, and possibly moved, a logarithmic number of times */
+    if (sz < mem->max / 2)
+    {
+        sz = _xpost_memory_file_round(mem->max / 2);
+        if (sz > _xpost_memory_file_limit() - mem->max)
+            sz = _xpost_memory_file_limit() - mem->max;
+    }
     sz += mem->max;
 
     XPOST_LOG_INFO("grow memory file%s%s (old: %d  new: %d)",
@@ -372,6 +523,27 @@ xpost_memory_file_grow(Xpost_Memory_File *mem,
             XPOST_LOG_ERR("ftruncate(%d, %d) returned -1 (error: %s)",
                           mem->fd, sz, strerror(errno));
     }
+    if (mem->reserve)
+    {
+        tmp = _xpost_memory_file_extend(mem, sz);
+    }
+    else if (mem->image)
+    {
+        /* a private mapping of a VM image can not be extended,
+           so move the data to anonymous memory */
+        tmp = mmap(NULL, sz,
+                   PROT_READ | PROT_WRITE,
+                   MAP_ANONYMOUS | MAP_PRIVATE,
+                   -1, 0);
+        if (tmp != MAP_FAILED)
+        {
+            memcpy(tmp, mem->base, mem->used);
+            munmap((void *)mem->base, mem->max);
+            mem->image = 0;
+        }
+    }
+    else
+    {
 # ifdef HAVE_MREMAP
     tmp = mremap(mem->base, mem->max, sz, MREMAP_MAYMOVE);
 # else
@@ -398,9 +570,11 @@ xpost_memory_file_grow(Xpost_Memory_File *mem,
         if (tmp != MAP_FAILED)
         {
             memcpy(tmp, mem->base, mem->used);
+            munmap((void *)mem->base, mem->max);
         }
     }
 # endif
+    }
     if (tmp == MAP_FAILED)
     { /* hanging error case */
 #else
@@ -420,6 +594,107 @@ xpost_memory_file_grow(Xpost_Memory_File *mem,
     return ret;
 }
 
+/*
+   replace the contents of the memory file with sz bytes of a VM image,
+   mapped copy-on-write where possible.
+   return 1 on success, 0 on failure.
+ */
+XPCHECKAPI int
+xpost_memory_file_load(Xpost_Memory_File *mem,
+                       int fd,
+                       size_t offset,
+                       unsigned int used,
+                       unsigned int sz)
+{
+#if defined (HAVE_MMAP) && !defined (_WIN32)
+    void *tmp;
+    size_t end;
+#endif
+
+    if (!mem)
+    {
+        XPOST_LOG_ERR("%d mem pointer is NULL", VMerror);
+        return 0;
+    }
+
+    if (mem->base == NULL)
+    {
+        XPOST_LOG_ERR("%d mem->base is NULL, mem not initialized ?", VMerror);
+        return 0;
+    }
+
+    if (used > sz)
+    {
+        XPOST_LOG_ERR("%d image size %u smaller than used size %u",
+                      VMerror, sz, used);
+        return 0;
+    }
+
+#if defined (HAVE_MMAP) && !defined (_WIN32)
+    if (mem->reserve >= sz)
+    {
+        /* map the image at the start of the reserved range, and give
+           the pages of the memory file beyond it back to the range */
+        tmp = mmap(mem->base, sz,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_FIXED,
+                   fd, (off_t)offset);
+        end = _xpost_memory_file_round(sz);
+        if ((tmp != MAP_FAILED) &&
+            (end < _xpost_memory_file_round(mem->max)) &&
+            (_xpost_memory_file_reserve(mem->base + end,
+                                        _xpost_memory_file_round(mem->max) - end) == MAP_FAILED))
+            tmp = MAP_FAILED;
+    }
+    else
+    {
+        tmp = mmap(NULL, sz,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE,
+                   fd, (off_t)offset);
+    }
+    if (tmp == MAP_FAILED)
+    {
+        XPOST_LOG_ERR("%d failed to map image (error: %s)",
+                      VMerror, strerror(errno));
+        return 0;
+    }
+    if (tmp != mem->base)
+    {
+        munmap((void *)mem->base, mem->reserve ? mem->reserve : mem->max);
+        mem->reserve = 0;
+    }
+    if (mem->fd != -1)
+    {
+        close(mem->fd);
+        mem->fd = -1;
+    }
+    if (mem->fname[0] != '\0')
+    {
+        remove(mem->fname);
+        mem->fname[0] = '\0';
+    }
+    mem->base = (unsigned char *)tmp;
+    mem->max = sz;
+    mem->image = 1;
+#else
+    if (mem->max < sz)
+    {
+        if (!xpost_memory_file_grow(mem, sz - mem->max))
+            return 0;
+    }
+    if ((lseek(fd, (long)offset, SEEK_SET) == -1) ||
+        (read(fd, mem->base, used) != (int)used))
+    {
+        XPOST_LOG_ERR("%d failed to read image (error: %s)",
+                      VMerror, strerror(errno));
+        return 0;
+    }
+#endif
+    mem->used = used;
+
+    return 1;
+}
 
 /*
    allocate data linearly from the memory file
@@ -600,6 +875,7 @@ _xpost_memory_table_alloc_new(Xpost_Memory_File *mem,
     mem->table.tab[ent].adr = adr;
     mem->table.tab[ent].sz = sz;
     mem->table.tab[ent].tag = tag;
+    mem->table.tab[ent].save = 0;
 
     if (mem->table.nextent == mem->table.max)
     {
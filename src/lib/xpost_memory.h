@@ -64,6 +64,18 @@
  */
 #define XPOST_MEMORY_TABLE_SIZE 2000
 
+/**
+ * @def XPOST_MEMORY_FILE_RESERVE
+ * @brief Default size of the address range reserved for a
+ * #Xpost_Memory_File.
+ *
+ * The memory file grows in place within this range, so mem->base does
+ * not move until it is full. The range only takes address space, its
+ * pages are committed as the memory file grows.
+ */
+#define XPOST_MEMORY_FILE_RESERVE \
+    (sizeof(void *) > 4 ? 0x40000000U : 0x4000000U)
+
 
 /*
  *
@@ -102,7 +114,7 @@ typedef enum
     XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK,
     XPOST_MEMORY_TABLE_SPECIAL_CONTEXT_LIST,
     XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK,
-    XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE,
+    XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE,
     XPOST_MEMORY_TABLE_SPECIAL_BOGUS_NAME,
     XPOST_MEMORY_TABLE_SPECIAL_OPERATOR_TABLE
 } Xpost_Memory_Table_Special;
@@ -129,6 +141,8 @@ typedef struct Xpost_Memory_Table
         unsigned int sz; /**< size of allocation */
         unsigned int mark; /**< garbage collection metadata */
         unsigned int tag; /**< type of object using this allocation, if needed */
+        unsigned int save; /**< chunks of the allocation saved at its top
+                                save level, or 0 if it is copied whole */
     } *tab; /**< table entries */
 } Xpost_Memory_Table;
 
@@ -149,14 +163,21 @@ typedef struct Xpost_Memory_File
     unsigned char *base; /**< pointer to mapped memory */
     unsigned int used;  /**< size used, cursor to free space */
     unsigned int max; /**< size available in memory pointed to by base */
+    int image; /**< 1 if base is a private mapping of a VM image,
+                    0 otherwise. */
+    unsigned int reserve; /**< size of the address range reserved at
+                               base, or 0 if none */
 
     struct Xpost_Memory_Table table;
 
     unsigned int start; /**< first 'live' entry in the memory_table. */
         /* the domain of the collector is entries >= start */
+    unsigned char *markbits; /**< collector mark bitmap, one bit per ent */
+    unsigned int markbits_size; /**< size of markbits in bytes */
 
     int period;
     int threshold;
+    int vmthreshold; /**< bytes to allocate between automatic collections */
     int free_list_alloc_is_installed;
     int (*free_list_alloc)(struct Xpost_Memory_File *mem,
                            unsigned sz,
@@ -216,6 +237,13 @@ int xpost_memory_init(void);
  *
  * This function initializes the memory file @p mem, possibly from
  * file specified by the file descriptor @p fd, if not -1.
+ *
+ * If mem->max is not 0, it is the initial size of @p mem, otherwise
+ * it is one page. If mem->reserve is 0, it is set to
+ * #XPOST_MEMORY_FILE_RESERVE. When it is larger than the initial
+ * size, and the system allows it, an address range of mem->reserve
+ * bytes is reserved, in which @p mem grows without moving. Otherwise
+ * mem->reserve is set to 0.
  */
 XPCHECKAPI int xpost_memory_file_init(Xpost_Memory_File *mem,
                                       const char *fname,
@@ -245,10 +273,46 @@ XPCHECKAPI int xpost_memory_file_exit(Xpost_Memory_File *mem);
  * @return 1 on success, 0 on failure.
  *
  * This function increases the memory used by @p mem by @p sz bites.
+ * It grows geometrically, by at least half of its size, so that a
+ * memory file which grows steadily is only extended a logarithmic
+ * number of times. Within the range reserved by
+ * xpost_memory_file_init(), the pages are committed in place and
+ * mem->base does not move. When the range is full, a new one, twice
+ * as large, is reserved.
  */
 XPCHECKAPI int xpost_memory_file_grow(Xpost_Memory_File *mem,
                                       size_t sz);
 
+/**
+ * @brief Replace the contents of the given memory file with a part of
+ * a VM image.
+ *
+ * @param[in,out] mem The memory file.
+ * @param[in] fd The file descriptor of the VM image.
+ * @param[in] offset The offset of the contents in the VM image.
+ * @param[in] used The size in use.
+ * @param[in] sz The size of the contents in the VM image.
+ * @return 1 on success, 0 on failure.
+ *
+ * This function discards the contents of @p mem and replaces them
+ * with the @p sz bytes at @p offset in the file @p fd, of which
+ * @p used are in use. Where mmap() is available, the bytes are mapped
+ * copy-on-write, so that the pages which are not written stay shared
+ * between all the processes which load the same image. They are
+ * mapped at the start of the range reserved for @p mem, in which
+ * xpost_memory_file_grow() commits anonymous memory after them. Without
+ * a reserved range, xpost_memory_file_grow() moves them to anonymous
+ * memory. Otherwise, they are read. @p offset must be a multiple of
+ * the page size.
+ *
+ * @note Invalidates all pointers derived from mem->base.
+ */
+XPCHECKAPI int xpost_memory_file_load(Xpost_Memory_File *mem,
+                                      int fd,
+                                      size_t offset,
+                                      unsigned int used,
+                                      unsigned int sz);
+
 /**
  * @brief Allocate memory in the given memory file and return offset.
  *
@@ -47,6 +47,7 @@
 //#include "xpost_interpreter.h"  // initialize interpreter to test
 #include "xpost_error.h"
 #include "xpost_string.h"  // access string objects
+#include "xpost_free.h"  // the name table grows with xpost_free_realloc
 #include "xpost_name.h"  // double-check prototypes
 
 #define CNT_STR(s) sizeof(s)-1, s
@@ -79,7 +80,7 @@ void xpost_name_dump_names(Xpost_Context *ctx)
     }
 }
 
-/* initialize the name special entities XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, NAME_TREE */
+/* initialize the name special entities XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, NAME_TABLE */
 int xpost_name_init(Xpost_Context *ctx)
 {
     Xpost_Memory_Table *tab;
@@ -99,19 +100,19 @@ int xpost_name_init(Xpost_Context *ctx)
     //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK);
     if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK)
         XPOST_LOG_ERR("Warning: name stack is not in special position");
-    ret = xpost_memory_table_alloc(ctx->gl, 0, 0, &ent); //gl:NAMET
+    ret = xpost_memory_table_alloc(ctx->gl, 0, 0, &ent); //gl:NAMET (name table)
     if (!ret)
     {
         return 0;
     }
-    //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE);
-    if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE)
-        XPOST_LOG_ERR("Warning: name tree is not in special position");
+    //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE);
+    if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE)
+        XPOST_LOG_ERR("Warning: name table is not in special position");
 
     xpost_stack_init(ctx->gl, &t);
     tab = &ctx->gl->table; //recalc pointer
     tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK].adr = t;
-    tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE].adr = 0;
+    tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr = 0;
     xpost_memory_table_get_addr(ctx->gl,
             XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &nstk);
     xpost_stack_push(ctx->gl, nstk, xpost_string_cons(ctx, CNT_STR("_not_a_name_")));
@@ -126,19 +127,19 @@ int xpost_name_init(Xpost_Context *ctx)
     //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK);
     if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK)
         XPOST_LOG_ERR("Warning: name stack is not in special position");
-    ret = xpost_memory_table_alloc(ctx->lo, 0, 0, &ent); //lo:NAMET
+    ret = xpost_memory_table_alloc(ctx->lo, 0, 0, &ent); //lo:NAMET (name table)
     if (!ret)
     {
         return 0;
     }
-    //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE);
-    if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE)
-        XPOST_LOG_ERR("Warning: name tree is not in special position");
+    //assert(ent == XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE);
+    if (ent != XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE)
+        XPOST_LOG_ERR("Warning: name table is not in special position");
 
     xpost_stack_init(ctx->lo, &t);
     tab = &ctx->lo->table; //recalc pointer
     tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK].adr = t;
-    tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE].adr = 0;
+    tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr = 0;
     xpost_memory_table_get_addr(ctx->lo,
             XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &nstk);
     xpost_stack_push(ctx->lo, nstk, xpost_string_cons(ctx, CNT_STR("_not_a_name_")));
@@ -151,159 +152,281 @@ int xpost_name_init(Xpost_Context *ctx)
     return 1;
 }
 
-/* perform a search using the ternary search tree */
+/* FNV-1a hash of the len bytes at s */
 static
-unsigned int tstsearch(Xpost_Memory_File *mem,
-                       unsigned int tadr,
-                       const char *s)
+unsigned int _xpost_name_hash(const char *s,
+                              unsigned int len)
 {
-    while (tadr) {
-        tst *p = (void *)(mem->base + tadr);
-        if ((unsigned int)*s < p->val) {
-            tadr = p->lo;
-        } else if ((unsigned int)*s == p->val) {
-            if (*s++ == 0) return p->eq; /* payload when val == '\0' */
-            tadr = p->eq;
-        } else {
-            tadr = p->hi;
-        }
+    unsigned int h = 2166136261U;
+
+    while (len--)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619U;
     }
-    return 0;
+    return h;
 }
 
-/* add a string to the ternary search tree */
+/* a name stops at a nul byte, as the C string given to
+   xpost_name_cons: the length of the name of the len bytes at s */
 static
-int tstinsert(Xpost_Memory_File *mem,
-              unsigned int tadr,
-              const char *s,
-              unsigned int *retval)
+unsigned int _xpost_name_length(const char *s,
+                                unsigned int len)
 {
-    tst *p;
-    unsigned int t; //temporary
-    unsigned int nstk;
-    int ret;
+    const char *nul = memchr(s, 0, len);
+
+    return nul ? (unsigned int)(nul - s) : len;
+}
 
-    if (!tadr) {
-        if (!xpost_memory_file_alloc(mem, sizeof(tst), &tadr))
+/* search the name table of mem for the len bytes at s, of hash h.
+   returns the index of the name in the name stack, or 0 */
+static
+unsigned int _xpost_name_table_search(Xpost_Memory_File *mem,
+                                      const char *s,
+                                      unsigned int len,
+                                      unsigned int h)
+{
+    Xpost_Name_Table *nt;
+    Xpost_Name_Table_Rec *r;
+    unsigned int mask;
+    unsigned int i;
+
+    if (!mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr)
+        return 0;
+    nt = (void *)(mem->base + mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr);
+    r = (void *)(nt + 1);
+    mask = nt->size - 1;
+    for (i = h & mask; r[i].name; i = (i + 1) & mask)
+    {
+        if (r[i].hash == h && r[i].len == len &&
+            memcmp(mem->base + mem->table.tab[r[i].ent].adr, s, len) == 0)
+            return r[i].name;
+    }
+    return 0;
+}
+
+/* make room in the name table of mem for one more name:
+   create it, or double it when it would be more than 3/4 full */
+static
+int _xpost_name_table_reserve(Xpost_Memory_File *mem)
+{
+    Xpost_Name_Table *nt;
+    Xpost_Name_Table_Rec *r;
+    Xpost_Name_Table_Rec *old;
+    unsigned int adr;
+    unsigned int size;
+    unsigned int oldsize;
+    unsigned int mask;
+    unsigned int i;
+    unsigned int j;
+
+    adr = mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr;
+    if (!adr)
+    {
+        size = XPOST_NAME_TABLE_SIZE;
+        if (!xpost_memory_file_alloc(mem,
+                sizeof(Xpost_Name_Table) + size * sizeof(Xpost_Name_Table_Rec), &adr))
         {
-            XPOST_LOG_ERR("cannot allocate tree node");
-            return VMerror;
+            XPOST_LOG_ERR("cannot allocate name table");
+            return 0;
         }
-        p = (void *)(mem->base + tadr);
-        p->val = *s;
-        p->lo = p->eq = p->hi = 0;
+        nt = (void *)(mem->base + adr);
+        nt->size = size;
+        nt->count = 0;
+        memset(nt + 1, 0, size * sizeof(Xpost_Name_Table_Rec));
+        mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr = adr;
+        return 1;
     }
-    p = (void *)(mem->base + tadr);
-    if ((unsigned int)*s < p->val) {
-        ret = tstinsert(mem, p->lo, s, &t);
-        if (ret)
-            return ret;
-        p = (void *)(mem->base + tadr); //recalc pointer
-        p->lo = t;
-    } else if ((unsigned int)*s == p->val) {
-        if (*s) {
-            ret = tstinsert(mem, p->eq, ++s, &t);
-            if (ret)
-                return ret;
-            p = (void *)(mem->base + tadr); //recalc pointer
-            p->eq = t;
-        }else {
-            xpost_memory_table_get_addr(mem,
-                    XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &nstk);
-            p->eq = xpost_stack_count(mem, nstk); /* payload when val == '\0' */
-        }
-    } else {
-        ret = tstinsert(mem, p->hi, s, &t);
-        if (ret)
-            return ret;
-        p = (void *)(mem->base + tadr); //recalc pointer
-        p->hi = t;
+
+    nt = (void *)(mem->base + adr);
+    if ((nt->count + 1) * 4 <= nt->size * 3)
+        return 1;
+
+    /* keep the records aside, the new table is cleared */
+    oldsize = nt->size;
+    old = malloc(oldsize * sizeof(Xpost_Name_Table_Rec));
+    if (!old)
+    {
+        XPOST_LOG_ERR("cannot allocate name table records");
+        return 0;
     }
-    //return tadr;
-    *retval = tadr;
-    return 0;
+    memcpy(old, nt + 1, oldsize * sizeof(Xpost_Name_Table_Rec));
+
+    size = oldsize * 2;
+    adr = xpost_free_realloc(mem, adr,
+            sizeof(Xpost_Name_Table) + oldsize * sizeof(Xpost_Name_Table_Rec),
+            sizeof(Xpost_Name_Table) + size * sizeof(Xpost_Name_Table_Rec));
+    if (!adr)
+    {
+        XPOST_LOG_ERR("cannot grow name table");
+        free(old);
+        return 0;
+    }
+    mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr = adr;
+    nt = (void *)(mem->base + adr);
+    nt->size = size;
+    r = (void *)(nt + 1);
+    memset(r, 0, size * sizeof(Xpost_Name_Table_Rec));
+    mask = size - 1;
+    for (j = 0; j < oldsize; j++)
+    {
+        if (!old[j].name)
+            continue;
+        for (i = old[j].hash & mask; r[i].name; i = (i + 1) & mask)
+            ;
+        r[i] = old[j];
+    }
+    free(old);
+    return 1;
 }
 
-/* add the name to the name stack, return index */
+/* add the name to the name stack and to the name table
+   of the current vm, return index */
 static
 unsigned int addname(Xpost_Context *ctx,
-                     const char *s)
+                     const char *s,
+                     unsigned int len,
+                     unsigned int h)
 {
     Xpost_Memory_File *mem = ctx->vmmode==GLOBAL?ctx->gl:ctx->lo;
+    Xpost_Name_Table *nt;
+    Xpost_Name_Table_Rec *r;
     unsigned int names;
     unsigned int u;
+    unsigned int mask;
+    unsigned int i;
     Xpost_Object str;
+    char *copy = NULL;
+
+    /* the bytes may be a string of mem, which the allocations
+       below can move */
+    if ((const unsigned char *)s >= mem->base &&
+        (const unsigned char *)s < mem->base + mem->max)
+    {
+        copy = malloc(len + 1);
+        if (!copy)
+        {
+            XPOST_LOG_ERR("cannot copy name");
+            return 0;
+        }
+        memcpy(copy, s, len);
+        s = copy;
+    }
+
+    if (!_xpost_name_table_reserve(mem))
+    {
+        free(copy);
+        return 0;
+    }
 
     xpost_memory_table_get_addr(mem,
             XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK, &names);
     u = xpost_stack_count(mem, names);
 
-    //xpost_memory_file_dump(ctx->gl);
-    //dumpmtab(ctx->gl, 0);
-    //unsigned int vmmode = ctx->vmmode;
-    //ctx->vmmode = GLOBAL;
-    str = xpost_string_cons(ctx, strlen(s), s);
+    str = xpost_string_cons(ctx, len, s);
+    free(copy);
     if (xpost_object_get_type(str) == nulltype)
     {
         XPOST_LOG_ERR("cannot allocate name string");
         return 0;
     }
-    xpost_stack_push(mem, names, str);
-    //ctx->vmmode = vmmode;
+    if (!xpost_stack_push(mem, names, str))
+    {
+        XPOST_LOG_ERR("cannot push name string");
+        return 0;
+    }
+
+    /* the allocations may have moved the memory file */
+    nt = (void *)(mem->base + mem->table.tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TABLE].adr);
+    r = (void *)(nt + 1);
+    mask = nt->size - 1;
+    for (i = h & mask; r[i].name; i = (i + 1) & mask)
+        ;
+    r[i].hash = h;
+    r[i].name = u;
+    r[i].ent = xpost_object_get_ent(str);
+    r[i].len = len;
+    ++nt->count;
     return u;
 }
 
-/* construct a name object from a string
-   searches and if necessary installs string
-   in ternary search tree,
+/* construct a name object from the len bytes at s
+   searches and if necessary installs the bytes
+   in the name table of the current vm,
    adding string to stack if so.
    returns a generic object with
        nametype tag with FBANK flag,
        mark_.pad0 set to zero
        mark_.padw contains XPOST_MEMORY_TABLE_SPECIAL_NAME_STACK stack index
  */
+Xpost_Object xpost_name_cons_bytes(Xpost_Context *ctx,
+                                   const char *s,
+                                   unsigned int len)
+{
+    unsigned int h;
+    unsigned int u;
+    Xpost_Object o;
+
+    len = _xpost_name_length(s, len);
+    h = _xpost_name_hash(s, len);
+    o.mark_.pad0 = 0;
+    u = _xpost_name_table_search(ctx->lo, s, len, h);
+    if (u) {
+        o.mark_.tag = nametype; // local
+        o.mark_.padw = u;
+        return o;
+    }
+    u = _xpost_name_table_search(ctx->gl, s, len, h);
+    if (u) {
+        o.mark_.tag = nametype | XPOST_OBJECT_TAG_DATA_FLAG_BANK; // global
+        o.mark_.padw = u;
+        return o;
+    }
+    u = addname(ctx, s, len, h); // obeys vmmode
+    if (!u)
+    {
+        //this can only be a VMerror
+        return invalid;
+    }
+    o.mark_.tag = nametype | (ctx->vmmode==GLOBAL?XPOST_OBJECT_TAG_DATA_FLAG_BANK:0);
+    o.mark_.padw = u;
+    return o;
+}
+
+/* construct a name object from a C string */
 Xpost_Object xpost_name_cons(Xpost_Context *ctx,
                              const char *s)
 {
+    return xpost_name_cons_bytes(ctx, s, strlen(s));
+}
+
+/* find the name of the len bytes at s, without installing it:
+   nothing is allocated.
+   returns invalid if s is not a name yet. */
+Xpost_Object xpost_name_find(Xpost_Context *ctx,
+                             const char *s,
+                             unsigned int len)
+{
+    unsigned int h;
     unsigned int u;
-    unsigned int t;
     Xpost_Object o;
-    unsigned int tstk;
-    int ret;
 
-    xpost_memory_table_get_addr(ctx->lo,
-            XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE, &tstk);
-    u = tstsearch(ctx->lo, tstk, s);
-    if (!u) {
-        xpost_memory_table_get_addr(ctx->gl,
-                XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE, &tstk);
-        u = tstsearch(ctx->gl, tstk, s);
-        if (!u) {
-            Xpost_Memory_File *mem = ctx->vmmode==GLOBAL?ctx->gl:ctx->lo;
-            Xpost_Memory_Table *tab = &mem->table;
-            ret = tstinsert(mem, tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE].adr, s, &t);
-            if (ret)
-            {
-                //this can only be a VMerror
-                return invalid;
-            }
-            tab = &mem->table; //recalc pointer
-            tab->tab[XPOST_MEMORY_TABLE_SPECIAL_NAME_TREE].adr = t;
-            u = addname(ctx, s); // obeys vmmode
-            o.mark_.tag = nametype | (ctx->vmmode==GLOBAL?XPOST_OBJECT_TAG_DATA_FLAG_BANK:0);
-            o.mark_.pad0 = 0;
-            o.mark_.padw = u;
-        } else {
-            o.mark_.tag = nametype | XPOST_OBJECT_TAG_DATA_FLAG_BANK; // global
-            o.mark_.pad0 = 0;
-            o.mark_.padw = u;
-        }
-    } else {
+    len = _xpost_name_length(s, len);
+    h = _xpost_name_hash(s, len);
+    o.mark_.pad0 = 0;
+    u = _xpost_name_table_search(ctx->lo, s, len, h);
+    if (u) {
         o.mark_.tag = nametype; // local
-        o.mark_.pad0 = 0;
         o.mark_.padw = u;
-        }
-    return o;
+        return o;
+    }
+    u = _xpost_name_table_search(ctx->gl, s, len, h);
+    if (u) {
+        o.mark_.tag = nametype | XPOST_OBJECT_TAG_DATA_FLAG_BANK; // global
+        o.mark_.padw = u;
+        return o;
+    }
+    return invalid;
 }
 
 /* yield the string object from the name string stack
@@ -36,23 +36,48 @@
  * @brief array functions
  *
  * The name mechanism associates strings with integers
- * using a ternary search tree
+ * using a hash table
  * and a stack of string objects.
  *
  * @{
  */
 
-typedef struct tst
+/**
+ * @brief initial number of records of a name table, a power of two.
+ */
+#define XPOST_NAME_TABLE_SIZE 256
+
+/**
+ * @typedef Xpost_Name_Table
+ * @brief header of the name table of a memory file, followed by
+ * size records. Each memory file has its own names, the local ones
+ * are searched before the global ones.
+ */
+typedef struct
+{
+    unsigned int size; /**< number of records, a power of two */
+    unsigned int count; /**< number of names */
+} Xpost_Name_Table;
+
+/**
+ * @typedef Xpost_Name_Table_Rec
+ * @brief record of a name in the name table, found by linear probing
+ * from its hash. The bytes of the name are those of its string on the
+ * name stack.
+ */
+typedef struct
 {
-    unsigned val,
-             lo,
-             eq,
-             hi;
-} tst;
+    unsigned int hash; /**< hash of the bytes of the name */
+    unsigned int name; /**< index in the name stack, 0 for an empty record */
+    unsigned int ent; /**< ent of the string of the name */
+    unsigned int len; /**< length of the name */
+} Xpost_Name_Table_Rec;
 
 void xpost_name_dump_names(Xpost_Context *ctx);
 int xpost_name_init(Xpost_Context *ctx);
 Xpost_Object xpost_name_cons(Xpost_Context *ctx, const char *s);
+Xpost_Object xpost_name_cons_bytes(Xpost_Context *ctx, const char *s, unsigned int len);
+Xpost_Object xpost_name_find(Xpost_Context *ctx, const char *s, unsigned int len);
 Xpost_Object xpost_name_get_string(Xpost_Context *ctx, Xpost_Object n);
 
 /**
@@ -302,12 +302,14 @@ typedef struct
  *
  * The saverec type is not available as a (Postscript) user type.
  *  saverec's occupy the "current save stack" referred to by the
- * stk field of a save object.
+ * stk field of a save object. The entity numbers are extended by
+ * the unused bits of the tag, see xpost_save_rec_get_src() and
+ * xpost_save_rec_get_cpy().
  */
 typedef struct
 {
     word tag; /**< arraytype or dicttype */
-    word pad; /**< == 0 */
+    word pad; /**< size of the array, 0 for a dict */
     word src; /**< entity number of source, the allocation being used */
     word cpy; /**< entity number of copy, the copy to revert to in restore */
 } Xpost_Object_Saverec;
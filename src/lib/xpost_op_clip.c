@@ -0,0 +1,262 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <assert.h>
+
+#include "xpost.h"
+#include "xpost_memory.h"
+#include "xpost_object.h"
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_error.h"
+#include "xpost_name.h"
+#include "xpost_dict.h"
+#include "xpost_path.h"
+#include "xpost_clip.h"
+
+#include "xpost_operator.h"
+#include "xpost_op_dict.h"
+#include "xpost_op_clip.h"
+
+/*
+   The clip region of the graphics state is the region (see
+   xpost_clip.h) held in graphicsdict /currgstate /clipregion, set to
+   the page by initclip. It is made once by clip or eoclip and then
+   used as it is by each fill, and gsave saves it without copy.
+
+   A clip or eoclip whose path is inside the previous region, as is
+   the first one after initclip, keeps the path in device space beside
+   the region in /clipoutline, and clippath returns it. Otherwise the
+   intersection is not a path already made, /clipoutline is null and
+   clippath traces the outline of the region, which is the rectangle
+   itself for a rectangle.
+ */
+
+#define NUM(x) (xpost_object_get_type(x)==realtype?(x).real_.val:(real)(x).int_.val)
+
+static
+int _gstate(Xpost_Context *ctx, Xpost_Object *gstate)
+{
+    Xpost_Object gd;
+    int ret;
+
+    /* graphicsdict /currgstate get */
+    ret = xpost_op_any_load(ctx, ctx->name_shortcuts.graphicsdict);
+    if (ret) return ret;
+    gd = xpost_stack_pop(ctx->lo, ctx->os);
+    if (xpost_object_get_type(gd) != dicttype)
+        return typecheck;
+    *gstate = xpost_dict_get(ctx, gd, ctx->name_shortcuts.currgstate);
+    if (xpost_object_get_type(*gstate) != dicttype)
+        return undefined;
+    return 0;
+}
+
+/* load the flatness of the graphics state */
+static
+int _flat(Xpost_Context *ctx, Xpost_Object gstate, real *flat)
+{
+    Xpost_Object o;
+
+    o = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.flat);
+    if (xpost_object_get_type(o) != integertype &&
+        xpost_object_get_type(o) != realtype)
+        return typecheck;
+    *flat = NUM(o);
+    return 0;
+}
+
+/* intersect the clip region with the inside of the current path,
+   which becomes the clip path if the region contains it */
+static
+int _intersect(Xpost_Context *ctx, Xpost_Clip_Rule rule)
+{
+    Xpost_Object gstate, region, path;
+    real flat;
+    int contains;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    ret = _flat(ctx, gstate, &flat);
+    if (ret) return ret;
+    region = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.clipregion);
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    ret = xpost_clip_contains(ctx, region, path, &contains);
+    if (ret) return ret;
+    ret = xpost_clip_intersect(ctx, region, path, rule, flat, &region);
+    if (ret) return ret;
+    ret = xpost_dict_put(ctx, gstate, ctx->name_shortcuts.clipregion, region);
+    if (ret) return ret;
+    if (!contains)
+        path = null;
+    ret = xpost_path_share(ctx, path);
+    if (ret) return ret;
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.clipoutline, path);
+}
+
+/* -  clip  -
+   intersect the clip region with the current path, nonzero rule */
+static
+int _clip(Xpost_Context *ctx)
+{
+    return _intersect(ctx, XPOST_CLIP_NONZERO);
+}
+
+/* -  eoclip  -
+   intersect the clip region with the current path, even-odd rule */
+static
+int _eoclip(Xpost_Context *ctx)
+{
+    return _intersect(ctx, XPOST_CLIP_EVENODD);
+}
+
+/* -  clippath  -
+   set the current path to the clip path */
+static
+int _clippath(Xpost_Context *ctx)
+{
+    Xpost_Object gstate, path;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.clipoutline);
+    if (xpost_object_get_type(path) == stringtype)
+    {
+        ret = xpost_path_share(ctx, path);
+    }
+    else
+    {
+        ret = xpost_clip_path(ctx,
+                              xpost_dict_get(ctx, gstate, ctx->name_shortcuts.clipregion),
+                              &path);
+    }
+    if (ret) return ret;
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, path);
+}
+
+typedef struct
+{
+    Xpost_Context *ctx;
+    integer n;
+} _Spans;
+
+/* push a span as the end points x0 y x1 y of its DrawLine */
+static
+int _pushspan(void *data, int y, int x0, int x1)
+{
+    _Spans *s = data;
+    Xpost_Context *ctx = s->ctx;
+
+    s->n++;
+    if (!xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(x0)) ||
+        !xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(y)) ||
+        !xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(x1)) ||
+        !xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(y)))
+        return VMerror;
+    return 0;
+}
+
+/* bool  .fillspans  x0 y0 x1 y0 ... n
+   scan convert the current path within the clip region, with the
+   even-odd rule if bool is true and the nonzero rule otherwise,
+   leaving the n spans of pixels to paint */
+static
+int _fillspans(Xpost_Context *ctx,
+               Xpost_Object evenodd)
+{
+    Xpost_Object gstate;
+    _Spans s;
+    real flat;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    ret = _flat(ctx, gstate, &flat);
+    if (ret) return ret;
+    s.ctx = ctx;
+    s.n = 0;
+    ret = xpost_clip_spans(ctx,
+                           xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath),
+                           evenodd.int_.val ? XPOST_CLIP_EVENODD : XPOST_CLIP_NONZERO,
+                           flat,
+                           xpost_dict_get(ctx, gstate, ctx->name_shortcuts.clipregion),
+                           _pushspan, &s);
+    if (ret) return ret;
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(s.n));
+    return 0;
+}
+
+/* -  .cliplines  -
+   replace the current path by the parts of its segments inside the
+   clip region, for the strokes of lines too thin for an outline */
+static
+int _cliplines(Xpost_Context *ctx)
+{
+    Xpost_Object gstate, path;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    ret = xpost_clip_lines(ctx,
+                           xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath),
+                           xpost_dict_get(ctx, gstate, ctx->name_shortcuts.clipregion),
+                           &path);
+    if (ret) return ret;
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, path);
+}
+
+int xpost_oper_init_clip_ops(Xpost_Context *ctx,
+                             Xpost_Object sd)
+{
+    Xpost_Operator *optab;
+    Xpost_Object n,op;
+    unsigned int optadr;
+
+    assert(ctx->gl->base);
+
+    op = xpost_operator_cons(ctx, "clip", (Xpost_Op_Func)_clip, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "eoclip", (Xpost_Op_Func)_eoclip, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "clippath", (Xpost_Op_Func)_clippath, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, ".fillspans", (Xpost_Op_Func)_fillspans, 0, 1, booleantype);
+    INSTALL;
+    op = xpost_operator_cons(ctx, ".cliplines", (Xpost_Op_Func)_cliplines, 0, 0);
+    INSTALL;
+
+    return 0;
+}
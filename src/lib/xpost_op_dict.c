@@ -143,6 +143,7 @@ int xpost_op_dict_begin(Xpost_Context *ctx,
 {
     if (!xpost_stack_push(ctx->lo, ctx->ds, D))
         return dictstackoverflow;
+    xpost_context_load_cache_flush(ctx);
     return 0;
 }
 
@@ -154,6 +155,7 @@ int xpost_op_end(Xpost_Context *ctx)
     if (xpost_stack_count(ctx->lo, ctx->ds) <= 3)
         return dictstackunderflow;
     (void)xpost_stack_pop(ctx->lo, ctx->ds);
+    xpost_context_load_cache_flush(ctx);
     return 0;
 }
 
@@ -189,6 +191,18 @@ int xpost_op_any_load(Xpost_Context *ctx,
         xpost_stack_dump(ctx->lo, ctx->ds);
     }
 
+    /* hot names skip the dict stack search, see xpost_context_load_cache_get() */
+    if (xpost_object_get_type(K) == nametype)
+    {
+        Xpost_Object x;
+
+        if (xpost_context_load_cache_get(ctx, K, &x))
+        {
+            xpost_stack_push(ctx->lo, ctx->os, x);
+            return 0;
+        }
+    }
+
     xpost_stack_push(ctx->lo, ctx->hold, K);
 
     for (i = 0; i < z; i++)
@@ -202,9 +216,12 @@ int xpost_op_any_load(Xpost_Context *ctx,
             (void)puts("");
         }
 
+        ++ctx->load_cache.probes;
         x = xpost_dict_get(ctx, D, K);
         if (xpost_object_get_type(x) != invalidtype)
         {
+            if (xpost_object_get_type(K) == nametype)
+                xpost_context_load_cache_put(ctx, K, x, i + 1);
             xpost_stack_push(ctx->lo, ctx->os, x);
             return 0;
         }
@@ -280,7 +297,6 @@ int xpost_op_dict_any_undef(Xpost_Context *ctx,
                             Xpost_Object D,
                             Xpost_Object K)
 {
-    XPOST_LOG_WARN("FIXME: undef doesn't adequately fix the chain");
     xpost_dict_undef(ctx, D, K);
     return 0;
 }
@@ -347,7 +363,7 @@ int xpost_op_dict_copy(Xpost_Context *ctx,
         return VMerror;
     }
     tp = (void *)(mem->base + ad + sizeof(dichead));
-    for (i = 0; i < DICTABN(sz); i++)
+    for (i = 0; i < (int)DICTABN(sz); i++)
     {
         if (xpost_object_get_type(tp[i].key) != nulltype)
         {
@@ -370,7 +386,7 @@ int xpost_op_dict_proc_forall (Xpost_Context *ctx,
     Xpost_Memory_File *mem = xpost_context_select_memory(ctx, D);
     assert(mem->base);
     D.comp_.sz = xpost_dict_max_length_memory (mem, D); // cache size locally
-    if (D.comp_.off <= D.comp_.sz) // FIXME: not finished?
+    if (D.comp_.off < DICTABN(D.comp_.sz))
     {
         unsigned ad;
         dicrec *tp; /* dict Table Pointer */
@@ -483,6 +499,7 @@ int xpost_op_cleardictstack(Xpost_Context *ctx)
     {
         (void)xpost_stack_pop(ctx->lo, ctx->ds);
     }
+    xpost_context_load_cache_flush(ctx);
     /*
     Xpost_Stack *ds;
     unsigned int dsaddr;
@@ -499,6 +516,41 @@ int xpost_op_cleardictstack(Xpost_Context *ctx)
     return 0;
 }
 
+/* -  .loadcachestatus  lookups hits probes saved
+   names looked up on the dict stack by load and name execution,
+   those found in the name lookup cache, dicts searched for the
+   others, and dicts the cache hits would have searched. */
+static
+int xpost_op_loadcachestatus(Xpost_Context *ctx)
+{
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(ctx->load_cache.lookups));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(ctx->load_cache.hits));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(ctx->load_cache.probes));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(ctx->load_cache.saved));
+    return 0;
+}
+
+/* dict  .dictstatus  length slots probes maxprobe
+   the keys of dict, the records of its table, the probes of
+   the lookups of all its keys, and of the longest lookup. */
+static
+int xpost_op_dict_dictstatus(Xpost_Context *ctx,
+                             Xpost_Object D)
+{
+    unsigned int slots;
+    unsigned int probes;
+    unsigned int maxprobe;
+
+    if (!xpost_dict_stats(ctx, D, &slots, &probes, &maxprobe))
+        return VMerror;
+    xpost_stack_push(ctx->lo, ctx->os,
+                     xpost_int_cons(xpost_dict_length_memory(xpost_context_select_memory(ctx, D), D)));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(slots));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(probes));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(maxprobe));
+    return 0;
+}
+
 int xpost_oper_init_dict_ops (Xpost_Context *ctx,
                               Xpost_Object sd)
 {
@@ -556,5 +608,9 @@ int xpost_oper_init_dict_ops (Xpost_Context *ctx,
     INSTALL;
     op = xpost_operator_cons(ctx, "cleardictstack", (Xpost_Op_Func)xpost_op_cleardictstack, 0, 0);
     INSTALL;
+    op = xpost_operator_cons(ctx, ".loadcachestatus", (Xpost_Op_Func)xpost_op_loadcachestatus, 4, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, ".dictstatus", (Xpost_Op_Func)xpost_op_dict_dictstatus, 4, 1, dicttype);
+    INSTALL;
     return 0;
 }
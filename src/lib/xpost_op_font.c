@@ -64,6 +64,7 @@ void *alloca (size_t);
 #include <string.h>
 
 #include "xpost.h"
+#include "xpost_compat.h" /* XPOST_THREAD_LOCAL */
 #include "xpost_log.h"
 #include "xpost_memory.h"
 #include "xpost_object.h"
@@ -76,9 +77,11 @@ void *alloca (size_t);
 #include "xpost_string.h"
 #include "xpost_array.h"
 #include "xpost_dict.h"
+#include "xpost_path.h"
 
 //#include "xpost_interpreter.h"
 #include "xpost_operator.h"
+#include "xpost_dev_generic.h"
 #include "xpost_op_font.h"
 
 /*
@@ -86,16 +89,108 @@ void *alloca (size_t);
  * These codes seem quite similar
  */
 
+/* face is shared by all the font dicts made from the same font,
+   the size and matrix given to scalefont and makefont are applied
+   to it with _fontdata_select() before rendering */
 typedef struct fontdata
 {
     void *face;
+    real size;
+    float mat[4];
 } fontdata;
 
+/* font dicts returned from the FontCache dict or the ScaledFonts
+   dict of a font, and those which had to be made, by the calling
+   thread like the face cache statistics */
+static XPOST_THREAD_LOCAL unsigned long _font_cache_hits = 0;
+static XPOST_THREAD_LOCAL unsigned long _font_cache_misses = 0;
+
+static
+void _fontdata_select(struct fontdata *data)
+{
+    xpost_font_face_scale(data->face, data->size);
+    xpost_font_face_transform(data->face, data->mat);
+}
+
+static
+int _fontdata_get(Xpost_Context *ctx,
+                  Xpost_Object fontdict,
+                  struct fontdata *data)
+{
+    Xpost_Object privatestr;
+
+    privatestr = xpost_dict_get(ctx, fontdict, xpost_name_cons(ctx, "Private"));
+    if (xpost_object_get_type(privatestr) != stringtype ||
+        privatestr.comp_.sz != sizeof *data)
+        return undefined;
+    xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
+                     xpost_object_get_ent(privatestr), 0, sizeof *data, data);
+
+    if (data->face == NULL)
+        return invalidfont;
+
+    return 0;
+}
+
+/* a new font dict with the entries of fontdict, except its
+   private data and its scaled font cache, and with data.
+   it is made in the VM of fontdict, so that it may be kept in the
+   ScaledFonts dict of fontdict whatever the current allocation mode. */
+static
+int _fontdata_copy(Xpost_Context *ctx,
+                   Xpost_Object fontdict,
+                   const struct fontdata *data,
+                   Xpost_Object *newdict)
+{
+    Xpost_Object namePrivate = xpost_name_cons(ctx, "Private");
+    Xpost_Object nameScaledFonts = xpost_name_cons(ctx, "ScaledFonts");
+    Xpost_Memory_File *mem;
+    Xpost_Object privatestr;
+    unsigned ad;
+    dicrec *tp;
+    int vmmode;
+    int i, sz;
+    int ret;
+
+    mem = xpost_context_select_memory(ctx, fontdict);
+    vmmode = ctx->vmmode;
+    ctx->vmmode = (mem == ctx->gl) ? GLOBAL : LOCAL;
+    sz = xpost_dict_max_length_memory(mem, fontdict);
+    *newdict = xpost_dict_cons(ctx, sz);
+    privatestr = xpost_string_cons(ctx, sizeof *data, (const char *)data);
+    ctx->vmmode = vmmode;
+    if (xpost_object_get_type(*newdict) == nulltype ||
+        xpost_object_get_type(privatestr) == invalidtype)
+        return VMerror;
+
+    if (!xpost_memory_table_get_addr(mem, xpost_object_get_ent(fontdict), &ad))
+        return VMerror;
+    tp = (void *)(mem->base + ad + sizeof(dichead));
+    for (i = 0; i < (int)DICTABN(sz); i++)
+    {
+        if (xpost_object_get_type(tp[i].key) != nulltype &&
+            xpost_dict_compare_objects(ctx, tp[i].key, namePrivate) != 0 &&
+            xpost_dict_compare_objects(ctx, tp[i].key, nameScaledFonts) != 0)
+        {
+            ret = xpost_dict_put(ctx, *newdict, tp[i].key, tp[i].value);
+            if (ret)
+                return ret;
+            tp = (void *)(mem->base + ad + sizeof(dichead)); /* recalc */
+        }
+    }
+    return xpost_dict_put(ctx, *newdict, namePrivate, privatestr);
+}
+
+/* fontname  findfont  font
+   fonts are kept in the FontCache dict of userdict, and share the
+   face opened for the first one. */
 static
 int _findfont(Xpost_Context *ctx,
               Xpost_Object fontname)
 {
 #ifdef HAVE_FREETYPE
+    Xpost_Object userdict;
+    Xpost_Object fontcache;
     Xpost_Object fontstr;
     Xpost_Object fontdict;
     Xpost_Object privatestr;
@@ -109,6 +204,22 @@ int _findfont(Xpost_Context *ctx,
     fname = alloca(fontstr.comp_.sz + 1);
     memcpy(fname, xpost_string_get_pointer(ctx, fontstr), fontstr.comp_.sz);
     fname[fontstr.comp_.sz] = '\0';
+    if (xpost_object_get_type(fontname) != nametype)
+        fontname = xpost_name_cons(ctx, fname);
+
+    userdict = xpost_stack_bottomup_fetch(ctx->lo, ctx->ds, 2);
+    fontcache = xpost_dict_get(ctx, userdict, xpost_name_cons(ctx, "FontCache"));
+    if (xpost_object_get_type(fontcache) == dicttype)
+    {
+        fontdict = xpost_dict_get(ctx, fontcache, fontname);
+        if (xpost_object_get_type(fontdict) == dicttype)
+        {
+            _font_cache_hits++;
+            xpost_stack_push(ctx->lo, ctx->os, fontdict);
+            return 0;
+        }
+    }
+    _font_cache_misses++;
 
     fontdict = xpost_dict_cons (ctx, 10);
     privatestr = xpost_string_cons(ctx, sizeof data, NULL);
@@ -118,9 +229,16 @@ int _findfont(Xpost_Context *ctx,
     data.face = xpost_font_face_new_from_name(fname);
     if (data.face == NULL)
         return invalidfont;
+    data.size = 1.0;
+    data.mat[0] = 1.0;
+    data.mat[1] = 0.0;
+    data.mat[2] = 0.0;
+    data.mat[3] = 1.0;
 
     xpost_memory_put(xpost_context_select_memory(ctx, privatestr),
             xpost_object_get_ent(privatestr), 0, sizeof data, &data);
+    if (xpost_object_get_type(fontcache) == dicttype)
+        xpost_dict_put(ctx, fontcache, fontname, fontdict);
     xpost_stack_push(ctx->lo, ctx->os, fontdict);
     return 0;
 #else
@@ -130,91 +248,118 @@ int _findfont(Xpost_Context *ctx,
 #endif
 }
 
-static int _scalefont(Xpost_Context *ctx, Xpost_Object fontdict, Xpost_Object size);
-
-
 static
 int _makefont(Xpost_Context *ctx,
               Xpost_Object fontdict,
               Xpost_Object psmat)
 {
-    Xpost_Object privatestr;
+    Xpost_Object newdict;
     struct fontdata data;
+    int ret;
 
-    //_scalefont(ctx, fontdict, xpost_real_cons(1.0));
-    privatestr = xpost_dict_get(ctx, fontdict, xpost_name_cons(ctx, "Private"));
-    if (xpost_object_get_type(privatestr) == invalidtype)
-        return undefined;
-    xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
-                     xpost_object_get_ent(privatestr), 0, sizeof(data), &data);
-
-    if (data.face == NULL)
-        return invalidfont;
+    ret = _fontdata_get(ctx, fontdict, &data);
+    if (ret)
+        return ret;
 
     /* apply linear transform from the matrix */
     {
-        float mat[6];
         int i;
-        for (i = 0; i < 6; i++)
+        for (i = 0; i < 4; i++)
         {
             Xpost_Object el;
             el = xpost_array_get(ctx, psmat, i);
             switch (xpost_object_get_type(el))
             {
-                case integertype: mat[i] = (float)el.int_.val; break;
-                case realtype: mat[i] = el.real_.val; break;
+                case integertype: data.mat[i] = (float)el.int_.val; break;
+                case realtype: data.mat[i] = el.real_.val; break;
                 default: return typecheck;
             }
         }
-        xpost_font_face_transform(data.face, mat);
     }
 
-    xpost_stack_push(ctx->lo, ctx->os, fontdict);
+    ret = _fontdata_copy(ctx, fontdict, &data, &newdict);
+    if (ret)
+        return ret;
+
+    xpost_stack_push(ctx->lo, ctx->os, newdict);
     return 0;
 }
 
-
+/* font size  scalefont  font'
+   the scaled fonts of a font are kept in its ScaledFonts dict,
+   by size. */
 static
 int _scalefont(Xpost_Context *ctx,
                Xpost_Object fontdict,
                Xpost_Object size)
 {
-#if 1
-    Xpost_Object privatestr;
+    Xpost_Object nameScaledFonts = xpost_name_cons(ctx, "ScaledFonts");
+    Xpost_Object scaledfonts;
+    Xpost_Object newdict;
     struct fontdata data;
+    int ret;
 
-    privatestr = xpost_dict_get(ctx, fontdict, xpost_name_cons(ctx, "Private"));
-    if (xpost_object_get_type(privatestr) == invalidtype)
-        return undefined;
-    xpost_memory_get(xpost_context_select_memory(ctx, privatestr),
-                     xpost_object_get_ent(privatestr), 0, sizeof data, &data);
+    ret = _fontdata_get(ctx, fontdict, &data);
+    if (ret)
+        return ret;
 
-    if (data.face == NULL)
-        return invalidfont;
+    scaledfonts = xpost_dict_get(ctx, fontdict, nameScaledFonts);
+    if (xpost_object_get_type(scaledfonts) == dicttype)
+    {
+        newdict = xpost_dict_get(ctx, scaledfonts, size);
+        if (xpost_object_get_type(newdict) == dicttype)
+        {
+            _font_cache_hits++;
+            xpost_stack_push(ctx->lo, ctx->os, newdict);
+            return 0;
+        }
+    }
+    else
+    {
+        /* in the VM of fontdict, like the scaled fonts kept in it */
+        int vmmode = ctx->vmmode;
+        ctx->vmmode = (xpost_context_select_memory(ctx, fontdict) == ctx->gl)
+            ? GLOBAL : LOCAL;
+        scaledfonts = xpost_dict_cons(ctx, 4);
+        ctx->vmmode = vmmode;
+        if (xpost_object_get_type(scaledfonts) == nulltype)
+            return VMerror;
+        ret = xpost_dict_put(ctx, fontdict, nameScaledFonts, scaledfonts);
+        if (ret)
+            return ret;
+    }
+    _font_cache_misses++;
 
     /* scale x and y sizes by @p size */
-    xpost_font_face_scale(data.face, size.real_.val);
+    data.size = size.real_.val;
+    ret = _fontdata_copy(ctx, fontdict, &data, &newdict);
+    if (ret)
+        return ret;
+    ret = xpost_dict_put(ctx, scaledfonts, size, newdict);
+    if (ret)
+        return ret;
 
-    /* if face is really a pointer, there's nothing to save back to the string
-    xpost_memory_put(xpost_context_select_memory(ctx, privatestr),
-            xpost_object_get_ent(privatestr), 0, sizeof data, &data);
-            */
-    xpost_stack_push(ctx->lo, ctx->os, fontdict);
+    xpost_stack_push(ctx->lo, ctx->os, newdict);
     return 0;
-#else
-    Xpost_Object psmat;
-    psmat = xpost_array_cons(ctx, 6);
-    xpost_array_put(ctx, psmat, 0, size);
-    xpost_array_put(ctx, psmat, 1, xpost_real_cons(0.0));
-    xpost_array_put(ctx, psmat, 2, xpost_real_cons(0.0));
-    xpost_array_put(ctx, psmat, 3, size);
-    xpost_array_put(ctx, psmat, 4, xpost_real_cons(0.0));
-    xpost_array_put(ctx, psmat, 5, xpost_real_cons(0.0));
-    return _makefont(ctx, fontdict, psmat);
-#endif
 }
 
+/* -  .fontcachestatus  fonthits fontmisses facehits facemisses
+   hits and misses of the font dict caches of findfont and
+   scalefont, and of the face cache behind findfont. */
+static
+int _fontcachestatus(Xpost_Context *ctx)
+{
+    unsigned long hits;
+    unsigned long misses;
 
+    xpost_font_face_cache_stats_get(&hits, &misses);
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(_font_cache_hits));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(_font_cache_misses));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(hits));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_int_cons(misses));
+
+    return 0;
+}
 
 static
 int _setfont(Xpost_Context *ctx,
@@ -315,6 +460,7 @@ static
 int _show_char(Xpost_Context *ctx,
                Xpost_Object devdic,
                Xpost_Object putpix,
+               const Xpost_Device_Raster *raster,
                struct fontdata data,
                real *xpos,
                real *ypos,
@@ -328,7 +474,7 @@ int _show_char(Xpost_Context *ctx,
 {
 #ifdef HAVE_FREETYPE
     unsigned int glyph_index;
-    unsigned char *buffer;
+    const unsigned char *buffer;
     int rows;
     int width;
     int pitch;
@@ -352,15 +498,21 @@ int _show_char(Xpost_Context *ctx,
             *ypos += delta_y >> 6;
         }
     }
-    if (!xpost_font_face_glyph_render(data.face, glyph_index))
+    if (!xpost_font_face_glyph_cache_get(data.face, glyph_index,
+                                         &buffer, &rows, &width, &pitch, &pixel_mode,
+                                         &left, &top, &advance_x, &advance_y))
         return 0;
-    xpost_font_face_glyph_buffer_get(data.face,
-                                     &buffer, &rows, &width, &pitch, &pixel_mode,
-                                     &left, &top, &advance_x, &advance_y);
-    _draw_bitmap(ctx, devdic, putpix,
-                 buffer, rows, width, pitch, pixel_mode,
-                 *xpos + left, *ypos - top,
-                 ncomp, comp1, comp2, comp3);
+    if (raster && (pixel_mode == XPOST_FONT_PIXEL_MODE_MONO ||
+                   pixel_mode == XPOST_FONT_PIXEL_MODE_GRAY))
+        xpost_device_raster_draw_mask(raster,
+                                      buffer, rows, width, pitch,
+                                      pixel_mode == XPOST_FONT_PIXEL_MODE_MONO ? 1 : 8,
+                                      (int)(*xpos + left), (int)(*ypos - top));
+    else
+        _draw_bitmap(ctx, devdic, putpix,
+                     buffer, rows, width, pitch, pixel_mode,
+                     *xpos + left, *ypos - top,
+                     ncomp, comp1, comp2, comp3);
     *xpos += advance_x >> 6;
     *ypos += advance_y >> 6;
     *glyph_previous = glyph_index;
@@ -368,6 +520,7 @@ int _show_char(Xpost_Context *ctx,
     (void)ctx;
     (void)devdic;
     (void)putpix;
+    (void)raster;
     (void)data;
     (void)xpos;
     (void)ypos;
@@ -382,42 +535,44 @@ int _show_char(Xpost_Context *ctx,
     return 1;
 }
 
+/* the device buffer to blit glyphs into, set to the current color,
+   or NULL if the device must be drawn with PutPix */
+static
+const Xpost_Device_Raster *_show_raster(Xpost_Context *ctx,
+                                        Xpost_Object devdic,
+                                        int ncomp,
+                                        Xpost_Object comp1,
+                                        Xpost_Object comp2,
+                                        Xpost_Object comp3,
+                                        Xpost_Device_Raster *raster)
+{
+    if (!xpost_device_raster_get(ctx, devdic, raster))
+        return NULL;
+    if (ncomp == 1)
+        xpost_device_raster_set_color(raster, comp1, comp1, comp1);
+    else
+        xpost_device_raster_set_color(raster, comp1, comp2, comp3);
+
+    return raster;
+}
+
 static
 int _get_current_point (Xpost_Context *ctx,
                         Xpost_Object gs,
                         real *xpos,
                         real *ypos)
 {
-    Xpost_Object path;
-    Xpost_Object subpath;
-    Xpost_Object pathelem;
-    Xpost_Object pathelemdata;
-    Xpost_Object datax, datay;
+    float x, y;
+    int ret;
 
     /* get the current pen position */
-    /*FIXME if any of these calls fail, should return nocurrentpoint; */
-    path = xpost_dict_get(ctx, gs, xpost_name_cons(ctx, "currpath"));
-    subpath = xpost_dict_get(ctx,
-                             path,
-                             xpost_int_cons(xpost_dict_length_memory(xpost_context_select_memory(ctx,path), path) - 1));
-    if (xpost_object_get_type(subpath) == invalidtype)
-        return nocurrentpoint;
-    pathelem = xpost_dict_get(ctx,
-                              subpath, xpost_int_cons(xpost_dict_length_memory(xpost_context_select_memory(ctx,subpath), subpath) - 1));
-    if (xpost_object_get_type(pathelem) == invalidtype)
-        return nocurrentpoint;
-    pathelemdata = xpost_dict_get(ctx, pathelem, xpost_name_cons(ctx, "data"));
-    if (xpost_object_get_type(pathelemdata) == invalidtype)
-        return nocurrentpoint;
-
-    datax = xpost_array_get(ctx, pathelemdata, pathelemdata.comp_.sz - 2);
-    datay = xpost_array_get(ctx, pathelemdata, pathelemdata.comp_.sz - 1);
-    if (xpost_object_get_type(datax) == integertype)
-        datax = xpost_real_cons((real)datax.int_.val);
-    if (xpost_object_get_type(datay) == integertype)
-        datay = xpost_real_cons((real)datay.int_.val);
-    *xpos = datax.real_.val;
-    *ypos = datay.real_.val;
+    ret = xpost_path_current_point(ctx,
+                                   xpost_dict_get(ctx, gs, xpost_name_cons(ctx, "currpath")),
+                                   &x, &y);
+    if (ret)
+        return ret;
+    *xpos = x;
+    *ypos = y;
     XPOST_LOG_INFO("currentpoint: %f %f", *xpos, *ypos);
 
     return 0;
@@ -438,6 +593,8 @@ int _show(Xpost_Context *ctx,
     char *ch;
     Xpost_Object devdic;
     Xpost_Object putpix;
+    Xpost_Device_Raster rasterbuf;
+    const Xpost_Device_Raster *raster;
     Xpost_Object colorspace;
     int ncomp;
     Xpost_Object comp1, comp2, comp3;
@@ -474,6 +631,7 @@ int _show(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -506,6 +664,8 @@ int _show(Xpost_Context *ctx,
     }
     XPOST_LOG_INFO("ncomp = %d", ncomp);
 
+    raster = _show_raster(ctx, devdic, ncomp, comp1, comp2, comp3, &rasterbuf);
+
     finalize = xpost_object_cvx(xpost_array_cons(ctx, 5));
     /* fill-in final pos before return */
     xpost_array_put(ctx, finalize, 0, xpost_real_cons(xpos));
@@ -519,7 +679,7 @@ int _show(Xpost_Context *ctx,
     has_kerning = xpost_font_face_kerning_has(data.face);
     glyph_previous = 0;
     for (ch = cstr; *ch; ch++) {
-        _show_char(ctx, devdic, putpix, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
+        _show_char(ctx, devdic, putpix, raster, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
                 ncomp, comp1, comp2, comp3);
     }
 
@@ -547,6 +707,8 @@ int _ashow(Xpost_Context *ctx,
     char *ch;
     Xpost_Object devdic;
     Xpost_Object putpix;
+    Xpost_Device_Raster rasterbuf;
+    const Xpost_Device_Raster *raster;
     Xpost_Object colorspace;
     int ncomp;
     Xpost_Object comp1, comp2, comp3;
@@ -583,6 +745,7 @@ int _ashow(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -615,6 +778,8 @@ int _ashow(Xpost_Context *ctx,
     }
     XPOST_LOG_INFO("ncomp = %d", ncomp);
 
+    raster = _show_raster(ctx, devdic, ncomp, comp1, comp2, comp3, &rasterbuf);
+
     finalize = xpost_object_cvx(xpost_array_cons(ctx, 5));
     /* fill-in final pos before return */
     xpost_array_put(ctx, finalize, 0, xpost_real_cons(xpos));
@@ -629,7 +794,7 @@ int _ashow(Xpost_Context *ctx,
     glyph_previous = 0;
     for (ch = cstr; *ch; ch++)
     {
-        _show_char(ctx, devdic, putpix, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
+        _show_char(ctx, devdic, putpix, raster, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
                    ncomp, comp1, comp2, comp3);
         xpos += dx.real_.val;
         ypos += dy.real_.val;
@@ -660,6 +825,8 @@ int _widthshow(Xpost_Context *ctx,
     char *ch;
     Xpost_Object devdic;
     Xpost_Object putpix;
+    Xpost_Device_Raster rasterbuf;
+    const Xpost_Device_Raster *raster;
     Xpost_Object colorspace;
     int ncomp;
     Xpost_Object comp1, comp2, comp3;
@@ -696,6 +863,7 @@ int _widthshow(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -728,6 +896,8 @@ int _widthshow(Xpost_Context *ctx,
     }
     XPOST_LOG_INFO("ncomp = %d", ncomp);
 
+    raster = _show_raster(ctx, devdic, ncomp, comp1, comp2, comp3, &rasterbuf);
+
     finalize = xpost_object_cvx(xpost_array_cons(ctx, 5));
     /* fill-in final pos before return */
     xpost_array_put(ctx, finalize, 0, xpost_real_cons(xpos));
@@ -742,7 +912,7 @@ int _widthshow(Xpost_Context *ctx,
     glyph_previous = 0;
     for (ch = cstr; *ch; ch++)
     {
-        _show_char(ctx, devdic, putpix, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
+        _show_char(ctx, devdic, putpix, raster, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
                    ncomp, comp1, comp2, comp3);
         if (*ch == charcode.int_.val)
         {
@@ -778,6 +948,8 @@ int _awidthshow(Xpost_Context *ctx,
     char *ch;
     Xpost_Object devdic;
     Xpost_Object putpix;
+    Xpost_Device_Raster rasterbuf;
+    const Xpost_Device_Raster *raster;
     Xpost_Object colorspace;
     int ncomp;
     Xpost_Object comp1, comp2, comp3;
@@ -814,6 +986,7 @@ int _awidthshow(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -846,6 +1019,8 @@ int _awidthshow(Xpost_Context *ctx,
     }
     XPOST_LOG_INFO("ncomp = %d", ncomp);
 
+    raster = _show_raster(ctx, devdic, ncomp, comp1, comp2, comp3, &rasterbuf);
+
     finalize = xpost_object_cvx(xpost_array_cons(ctx, 5));
     /* fill-in final pos before return */
     xpost_array_put(ctx, finalize, 0, xpost_real_cons(xpos));
@@ -860,7 +1035,7 @@ int _awidthshow(Xpost_Context *ctx,
     glyph_previous = 0;
     for (ch = cstr; *ch; ch++)
     {
-        _show_char(ctx, devdic, putpix, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
+        _show_char(ctx, devdic, putpix, raster, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
                 ncomp, comp1, comp2, comp3);
         xpos += dx.real_.val;
         ypos += dy.real_.val;
@@ -917,6 +1092,7 @@ int _stringwidth(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -936,7 +1112,7 @@ int _stringwidth(Xpost_Context *ctx,
 
 #ifdef HAVE_FREETYPE
         unsigned int glyph_index;
-        unsigned char *buffer;
+        const unsigned char *buffer;
         int rows;
         int width;
         int pitch;
@@ -959,9 +1135,8 @@ int _stringwidth(Xpost_Context *ctx,
                 ypos += delta_y >> 6;
             }
         }
-        if (!xpost_font_face_glyph_render(data.face, glyph_index))
+        if (!xpost_font_face_glyph_cache_get(data.face, glyph_index, &buffer, &rows, &width, &pitch, &pixel_mode, &left, &top, &advance_x, &advance_y))
             return unregistered;
-        xpost_font_face_glyph_buffer_get(data.face, &buffer, &rows, &width, &pitch, &pixel_mode, &left, &top, &advance_x, &advance_y);
         /*
         _draw_bitmap(ctx, devdic, putpix,
                 buffer, rows, width, pitch, pixel_mode,
@@ -997,6 +1172,8 @@ int _kshow(Xpost_Context *ctx,
     char *ch;
     Xpost_Object devdic;
     Xpost_Object putpix;
+    Xpost_Device_Raster rasterbuf;
+    const Xpost_Device_Raster *raster;
     Xpost_Object colorspace;
     int ncomp;
     Xpost_Object comp1, comp2, comp3;
@@ -1033,6 +1210,7 @@ int _kshow(Xpost_Context *ctx,
         XPOST_LOG_ERR("face is NULL");
         return invalidfont;
     }
+    _fontdata_select(&data);
     XPOST_LOG_INFO("loaded font data from dict");
 
     /* get a c-style nul-terminated string */
@@ -1065,6 +1243,8 @@ int _kshow(Xpost_Context *ctx,
     }
     XPOST_LOG_INFO("ncomp = %d", ncomp);
 
+    raster = _show_raster(ctx, devdic, ncomp, comp1, comp2, comp3, &rasterbuf);
+
     finalize = xpost_object_cvx(xpost_array_cons(ctx, 5));
     /* fill-in final pos before return */
     xpost_array_put(ctx, finalize, 0, xpost_real_cons(xpos));
@@ -1079,7 +1259,7 @@ int _kshow(Xpost_Context *ctx,
     glyph_previous = 0;
     for (ch = cstr; *ch; ch++)
     {
-        _show_char(ctx, devdic, putpix, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
+        _show_char(ctx, devdic, putpix, raster, data, &xpos, &ypos, *ch, &glyph_previous, has_kerning,
                 ncomp, comp1, comp2, comp3);
     }
 
@@ -1111,6 +1291,8 @@ int xpost_oper_init_font_ops(Xpost_Context *ctx,
     INSTALL;
     op = xpost_operator_cons(ctx, "setfont", (Xpost_Op_Func)_setfont, 1, 1, dicttype);
     INSTALL;
+    op = xpost_operator_cons(ctx, ".fontcachestatus", (Xpost_Op_Func)_fontcachestatus, 4, 0);
+    INSTALL;
 
     op = xpost_operator_cons(ctx, "show", (Xpost_Op_Func)_show, 0, 1, stringtype);
     INSTALL;
@@ -0,0 +1,355 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "xpost.h"
+#include "xpost_log.h"
+#include "xpost_memory.h"
+#include "xpost_object.h"
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_error.h"
+#include "xpost_name.h"
+#include "xpost_array.h"
+#include "xpost_dict.h"
+#include "xpost_path.h"
+
+#include "xpost_operator.h"
+#include "xpost_op_dict.h"
+#include "xpost_op_gstate.h"
+
+/*
+   The graphics state stack.
+
+   The current graphics state is the dict graphicsdict /currgstate,
+   which the graphics procedures and operators read and change.
+   gsave saves it as a record in the array graphicsdict /gstackarray,
+   at the index graphicsdict /gptr, and grestore copies the record
+   back, so each costs a fixed number of puts whatever the state holds.
+
+   A record is an array of the numbers of the CTM, copied since
+   setmatrix changes currmatrix in place, followed by the values of
+   the other entries, shared with currgstate: the current path and
+   the clip path are marked with xpost_path_share() so that the first
+   change of either copy copies them, while the clip region is never
+   changed in place.
+   The records are allocated once per depth and reused. As they live
+   in local vm, restore also brings back the gsave level and the
+   saved states of its save.
+ */
+
+enum
+{
+    XPOST_GSTATE_CTM = 0, /* 6 numbers */
+    XPOST_GSTATE_PATH = 6,
+    XPOST_GSTATE_CLIP,
+    XPOST_GSTATE_CLIPPATH,
+    XPOST_GSTATE_COLORSPACE,
+    XPOST_GSTATE_COLOR, /* 4 components */
+    XPOST_GSTATE_TRANSFER = XPOST_GSTATE_COLOR + 4,
+    XPOST_GSTATE_FLAT,
+    XPOST_GSTATE_LINEWIDTH,
+    XPOST_GSTATE_LINECAP,
+    XPOST_GSTATE_LINEJOIN,
+    XPOST_GSTATE_MITERLIMIT,
+    XPOST_GSTATE_DASHARRAY,
+    XPOST_GSTATE_DASHOFFSET,
+    XPOST_GSTATE_FONT,
+    XPOST_GSTATE_DEVICE,
+    XPOST_GSTATE_RECORD_SIZE
+};
+
+/* the keys of the entries of a record, from XPOST_GSTATE_PATH on */
+static
+void _keys(Xpost_Context *ctx, Xpost_Object *keys)
+{
+    keys[XPOST_GSTATE_PATH] = ctx->name_shortcuts.currpath;
+    keys[XPOST_GSTATE_CLIP] = ctx->name_shortcuts.clipregion;
+    keys[XPOST_GSTATE_CLIPPATH] = ctx->name_shortcuts.clipoutline;
+    keys[XPOST_GSTATE_COLORSPACE] = ctx->name_shortcuts.colorspace;
+    keys[XPOST_GSTATE_COLOR] = ctx->name_shortcuts.colorcomp1;
+    keys[XPOST_GSTATE_COLOR + 1] = ctx->name_shortcuts.colorcomp2;
+    keys[XPOST_GSTATE_COLOR + 2] = ctx->name_shortcuts.colorcomp3;
+    keys[XPOST_GSTATE_COLOR + 3] = ctx->name_shortcuts.colorcomp4;
+    keys[XPOST_GSTATE_TRANSFER] = ctx->name_shortcuts.transfer;
+    keys[XPOST_GSTATE_FLAT] = ctx->name_shortcuts.flat;
+    keys[XPOST_GSTATE_LINEWIDTH] = ctx->name_shortcuts.linewidth;
+    keys[XPOST_GSTATE_LINECAP] = ctx->name_shortcuts.linecap;
+    keys[XPOST_GSTATE_LINEJOIN] = ctx->name_shortcuts.linejoin;
+    keys[XPOST_GSTATE_MITERLIMIT] = ctx->name_shortcuts.miterlimit;
+    keys[XPOST_GSTATE_DASHARRAY] = ctx->name_shortcuts.dasharray;
+    keys[XPOST_GSTATE_DASHOFFSET] = ctx->name_shortcuts.dashoffset;
+    keys[XPOST_GSTATE_FONT] = ctx->name_shortcuts.currfont;
+    keys[XPOST_GSTATE_DEVICE] = ctx->name_shortcuts.device;
+}
+
+/* load graphicsdict, its current graphics state, stack and stack pointer */
+static
+int _stack(Xpost_Context *ctx,
+           Xpost_Object *gd,
+           Xpost_Object *gstate,
+           Xpost_Object *stack,
+           integer *gptr)
+{
+    Xpost_Object ptr;
+    int ret;
+
+    ret = xpost_op_any_load(ctx, ctx->name_shortcuts.graphicsdict);
+    if (ret)
+        return ret;
+    *gd = xpost_stack_pop(ctx->lo, ctx->os);
+    if (xpost_object_get_type(*gd) != dicttype)
+        return typecheck;
+    *gstate = xpost_dict_get(ctx, *gd, ctx->name_shortcuts.currgstate);
+    *stack = xpost_dict_get(ctx, *gd, ctx->name_shortcuts.gstackarray);
+    ptr = xpost_dict_get(ctx, *gd, ctx->name_shortcuts.gptr);
+    if (xpost_object_get_type(*gstate) != dicttype ||
+        xpost_object_get_type(*stack) != arraytype ||
+        xpost_object_get_type(ptr) != integertype)
+        return undefined;
+    *gptr = ptr.int_.val;
+    return 0;
+}
+
+/* copy a record back to the current graphics state */
+static
+int _restore(Xpost_Context *ctx,
+             Xpost_Object gstate,
+             Xpost_Object rec)
+{
+    Xpost_Object keys[XPOST_GSTATE_RECORD_SIZE];
+    Xpost_Object ctm;
+    int ret;
+    int i;
+
+    if (xpost_object_get_type(rec) != arraytype ||
+        rec.comp_.sz != XPOST_GSTATE_RECORD_SIZE)
+        return 0;
+
+    if (xpost_object_get_type(xpost_array_get(ctx, rec, XPOST_GSTATE_CTM)) != nulltype)
+    {
+        ctm = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currmatrix);
+        if (xpost_object_get_type(ctm) != arraytype || ctm.comp_.sz < 6)
+        {
+            ctm = xpost_array_cons(ctx, 6);
+            if (xpost_object_get_type(ctm) == nulltype)
+                return VMerror;
+            ret = xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currmatrix, ctm);
+            if (ret)
+                return ret;
+        }
+        for (i = 0; i < 6; i++)
+        {
+            ret = xpost_array_put(ctx, ctm, i,
+                                  xpost_array_get(ctx, rec, XPOST_GSTATE_CTM + i));
+            if (ret)
+                return ret;
+        }
+    }
+
+    _keys(ctx, keys);
+    for (i = XPOST_GSTATE_PATH; i < XPOST_GSTATE_RECORD_SIZE; i++)
+    {
+        ret = xpost_dict_put(ctx, gstate, keys[i], xpost_array_get(ctx, rec, i));
+        if (ret)
+            return ret;
+    }
+
+    return 0;
+}
+
+/* -  gsave  -
+   push graphics state */
+static
+int _gsave(Xpost_Context *ctx)
+{
+    Xpost_Object keys[XPOST_GSTATE_RECORD_SIZE];
+    Xpost_Object gd, gstate, stack;
+    Xpost_Object rec, ctm, val;
+    integer gptr;
+    int ret;
+    int i;
+
+    ret = _stack(ctx, &gd, &gstate, &stack, &gptr);
+    if (ret)
+        return ret;
+    if (++gptr >= stack.comp_.sz)
+        return limitcheck;
+
+    rec = xpost_array_get(ctx, stack, gptr);
+    if (xpost_object_get_type(rec) != arraytype ||
+        rec.comp_.sz != XPOST_GSTATE_RECORD_SIZE)
+    {
+        /* the stack is in local vm, so are its records */
+        rec = xpost_array_cons_memory(ctx->lo, XPOST_GSTATE_RECORD_SIZE);
+        if (xpost_object_get_type(rec) == nulltype)
+            return VMerror;
+        xpost_stack_push(ctx->lo, ctx->hold, rec);
+        ret = xpost_array_put(ctx, stack, gptr, rec);
+        if (ret)
+            return ret;
+    }
+
+    ctm = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currmatrix);
+    for (i = 0; i < 6; i++)
+    {
+        val = null;
+        if (xpost_object_get_type(ctm) == arraytype && ctm.comp_.sz >= 6)
+            val = xpost_array_get(ctx, ctm, i);
+        ret = xpost_array_put(ctx, rec, XPOST_GSTATE_CTM + i, val);
+        if (ret)
+            return ret;
+    }
+
+    _keys(ctx, keys);
+    for (i = XPOST_GSTATE_PATH; i < XPOST_GSTATE_RECORD_SIZE; i++)
+    {
+        val = xpost_dict_get(ctx, gstate, keys[i]);
+        if (xpost_object_get_type(val) == invalidtype)
+            val = null;
+        if (i == XPOST_GSTATE_PATH || i == XPOST_GSTATE_CLIPPATH)
+        {
+            ret = xpost_path_share(ctx, val);
+            if (ret)
+                return ret;
+        }
+        ret = xpost_array_put(ctx, rec, i, val);
+        if (ret)
+            return ret;
+    }
+
+    return xpost_dict_put(ctx, gd, ctx->name_shortcuts.gptr, xpost_int_cons(gptr));
+}
+
+/* -  grestore  -
+   pop graphics state.
+   the record stays in the stack, to be reused by the next gsave,
+   and the bottom one is the state restored by grestoreall */
+static
+int _grestore(Xpost_Context *ctx)
+{
+    Xpost_Object gd, gstate, stack;
+    integer gptr;
+    int ret;
+
+    ret = _stack(ctx, &gd, &gstate, &stack, &gptr);
+    if (ret)
+        return ret;
+    if (gptr < 0)
+        return 0;
+
+    ret = _restore(ctx, gstate, xpost_array_get(ctx, stack, gptr));
+    if (ret)
+        return ret;
+    return xpost_dict_put(ctx, gd, ctx->name_shortcuts.gptr, xpost_int_cons(gptr - 1));
+}
+
+/* -  grestoreall  -
+   pop to bottommost graphics state */
+static
+int _grestoreall(Xpost_Context *ctx)
+{
+    Xpost_Object gd, gstate, stack;
+    integer gptr;
+    int ret;
+
+    ret = _stack(ctx, &gd, &gstate, &stack, &gptr);
+    if (ret)
+        return ret;
+    if (stack.comp_.sz > 0)
+    {
+        ret = _restore(ctx, gstate, xpost_array_get(ctx, stack, 0));
+        if (ret)
+            return ret;
+    }
+    return xpost_dict_put(ctx, gd, ctx->name_shortcuts.gptr, xpost_int_cons(-1));
+}
+
+int xpost_oper_init_gstate_ops(Xpost_Context *ctx,
+                               Xpost_Object sd)
+{
+    Xpost_Operator *optab;
+    Xpost_Object n,op;
+    unsigned int optadr;
+
+    assert(ctx->gl->base);
+
+    if (xpost_object_get_type((ctx->name_shortcuts.gstackarray = xpost_name_cons(ctx, "gstackarray"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.gptr = xpost_name_cons(ctx, "gptr"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.clipregion = xpost_name_cons(ctx, "clipregion"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.clipoutline = xpost_name_cons(ctx, "clipoutline"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.colorspace = xpost_name_cons(ctx, "colorspace"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.colorcomp1 = xpost_name_cons(ctx, "colorcomp1"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.colorcomp2 = xpost_name_cons(ctx, "colorcomp2"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.colorcomp3 = xpost_name_cons(ctx, "colorcomp3"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.colorcomp4 = xpost_name_cons(ctx, "colorcomp4"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.transfer = xpost_name_cons(ctx, "transfer"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.linewidth = xpost_name_cons(ctx, "linewidth"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.linecap = xpost_name_cons(ctx, "linecap"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.linejoin = xpost_name_cons(ctx, "linejoin"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.miterlimit = xpost_name_cons(ctx, "miterlimit"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.dasharray = xpost_name_cons(ctx, "dasharray"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.dashoffset = xpost_name_cons(ctx, "dashoffset"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.currfont = xpost_name_cons(ctx, "currfont"))) == invalidtype)
+        return VMerror;
+    if (xpost_object_get_type((ctx->name_shortcuts.device = xpost_name_cons(ctx, "device"))) == invalidtype)
+        return VMerror;
+
+    op = xpost_operator_cons(ctx, "gsave", (Xpost_Op_Func)_gsave, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "grestore", (Xpost_Op_Func)_grestore, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "grestoreall", (Xpost_Op_Func)_grestoreall, 0, 0);
+    INSTALL;
+
+    return 0;
+}
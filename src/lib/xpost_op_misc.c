@@ -129,7 +129,9 @@ Xpost_Object bind(Xpost_Context *ctx,
 }
 
 /* proc  bind  proc
-   replace names with operators in proc and make read-only */
+   replace names with operators in proc and make read-only.
+   read-only procs are run by the interpreter's compiled loop,
+   see xpost_interpreter.c:evalproc() */
 static
 int Pbind(Xpost_Context *ctx,
           Xpost_Object P)
@@ -255,15 +257,13 @@ int _array_swap(Xpost_Context *ctx,
 static
 int traceon (Xpost_Context *ctx)
 {
-    (void)ctx;
-    _xpost_interpreter_is_tracing = 1;
+    ctx->tracing = 1;
     return 0;
 }
 static
 int traceoff(Xpost_Context *ctx)
 {
-    (void)ctx;
-    _xpost_interpreter_is_tracing = 0;
+    ctx->tracing = 0;
     return 0;
 }
 #endif
@@ -60,6 +60,8 @@
 #include "xpost_array.h"
 #include "xpost_dict.h"
 #include "xpost_matrix.h"
+#include "xpost_path.h"
+#include "xpost_stroke.h"
 
 #include "xpost_operator.h"
 #include "xpost_op_dict.h"
@@ -69,234 +71,177 @@
 #undef y1
 
 /*
-   % path == <<
-   %             0 << subpath0 >>
-   %             1 << %subpath1
-   %                   0  << elem0 /move >> %first elem must be /move
-   %                   1  << elem1 >>
-   %               >>
-   %         >>
-   % A /move element will always start a new subpath
-   % Any other element appends to the last subpath
+   The current path is a packed path (see xpost_path.h) held in
+   graphicsdict /currgstate /currpath, the null object when it is empty.
+   Its points are in device coordinates: the construction operators
+   transform their operands by the CTM, pathforall transforms the
+   points back to user space.
  */
 
 //#define RAD_PER_DEG (M_PI / 180.0)
 #define RAD_PER_DEG (0.0174533)
 
-/*name objects*/
-static Xpost_Object namegraphicsdict;
-static Xpost_Object namecurrgstate;
-static Xpost_Object namecurrpath;
-static Xpost_Object namecmd;
-static Xpost_Object namedata;
-static Xpost_Object namemove;
-static Xpost_Object nameline;
-static Xpost_Object namecurve;
-static Xpost_Object nameclose;
-
-/*opcodes*/
-static unsigned int _currentpoint_opcode;
-static unsigned int _moveto_opcode;
-static unsigned int _moveto_cont_opcode;
-static unsigned int _rmoveto_cont_opcode;
-static unsigned int _lineto_opcode;
-static unsigned int _lineto_cont_opcode;
-static unsigned int _rlineto_cont_opcode;
-static unsigned int _curveto_opcode;
-static unsigned int _curveto_cont1_opcode;
-static unsigned int _curveto_cont2_opcode;
-static unsigned int _curveto_cont3_opcode;
-static unsigned int _rcurveto_cont_opcode;
-
-/*matrices*/
-static Xpost_Object _mat;
-static Xpost_Object _mat1;
+#define NUM(x) (xpost_object_get_type(x)==realtype?(x).real_.val:(real)(x).int_.val)
 
 static
-int _newpath(Xpost_Context *ctx)
+int _gstate(Xpost_Context *ctx, Xpost_Object *gstate)
 {
-    Xpost_Object gd, gstate;
+    Xpost_Object gd;
     int ret;
 
-    /* graphicsdict /currgstate get /currpath 1 dict put */
-    ret = xpost_op_any_load(ctx, namegraphicsdict);
+    /* graphicsdict /currgstate get */
+    ret = xpost_op_any_load(ctx, ctx->name_shortcuts.graphicsdict);
     if (ret) return ret;
     gd = xpost_stack_pop(ctx->lo, ctx->os);
-    gstate = xpost_dict_get(ctx, gd, namecurrgstate);
-    ret = xpost_dict_put(ctx, gstate,
-                         namecurrpath,
-                         xpost_dict_cons(ctx, 1));
-    if (ret) return ret;
+    if (xpost_object_get_type(gd) != dicttype)
+        return typecheck;
+    *gstate = xpost_dict_get(ctx, gd, ctx->name_shortcuts.currgstate);
+    if (xpost_object_get_type(*gstate) != dicttype)
+        return undefined;
     return 0;
 }
 
 static
 Xpost_Object _cpath(Xpost_Context *ctx)
 {
-    Xpost_Object gd, gstate, path;
-    int ret;
+    Xpost_Object gstate;
 
     /* graphicsdict /currgstate get /currpath get */
-    ret = xpost_op_any_load(ctx, namegraphicsdict);
-    if (ret) return invalid;
-    gd = xpost_stack_pop(ctx->lo, ctx->os);
-    if (xpost_object_get_type(gd) == invalidtype)
-        return invalid;
-    gstate = xpost_dict_get(ctx, gd, namecurrgstate);
-    if (xpost_object_get_type(gstate) == invalidtype)
+    if (_gstate(ctx, &gstate))
         return invalid;
-    path = xpost_dict_get(ctx, gstate, namecurrpath);
-    return path;
+    return xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
 }
 
-int _currentpoint(Xpost_Context *ctx)
+/* load the CTM of the graphics state */
+static
+int _ctm(Xpost_Context *ctx, Xpost_Object gstate, Xpost_Matrix *m)
 {
-    Xpost_Object path, subpath, elem, data;
-    int pathlen, subpathlen, datalen;
-
-    /*
-    cpath dup length 0 eq {
-        pop /currentpoint cvx /nocurrentpoint signalerror
-    }{
-        dup length 1 sub get % last-subpath
-        dup length 1 sub get % last-elem
-        /data get dup length 2 sub 2 getinterval % last data pair
-        aload pop itransform
-    } ifelse
-    */
-    path = _cpath(ctx);
-    if (xpost_object_get_type(path) == invalidtype)
-        return nocurrentpoint;
-    pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
-    if (pathlen == 0)
-        return nocurrentpoint;
-    subpath = xpost_dict_get(ctx, path, xpost_int_cons(pathlen - 1));
-    subpathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, subpath), subpath);
-    elem = xpost_dict_get(ctx, subpath, xpost_int_cons(subpathlen - 1));
-    data = xpost_dict_get(ctx, elem, namedata);
-    datalen = data.comp_.sz;
-    xpost_stack_push(ctx->lo, ctx->os, xpost_array_get(ctx, data, datalen - 2));
-    xpost_stack_push(ctx->lo, ctx->os, xpost_array_get(ctx, data, datalen - 1));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.itransform));
+    Xpost_Object psm;
+    Xpost_Object arr[6];
+    int i;
 
+    psm = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currmatrix);
+    if (xpost_object_get_type(psm) != arraytype || psm.comp_.sz < 6)
+        return typecheck;
+    for (i = 0; i < 6; i++)
+        if (!xpost_memory_get(xpost_context_select_memory(ctx, psm),
+                              xpost_object_get_ent(psm),
+                              psm.comp_.off + i, sizeof(Xpost_Object), &arr[i]))
+            return VMerror;
+    m->xx = NUM(arr[0]);
+    m->yx = NUM(arr[1]);
+    m->xy = NUM(arr[2]);
+    m->yy = NUM(arr[3]);
+    m->xz = NUM(arr[4]);
+    m->yz = NUM(arr[5]);
     return 0;
 }
 
 static
-int _addtopath(Xpost_Context *ctx, Xpost_Object elem, Xpost_Object path)
-{
-    Xpost_Object subpath, cmd, lastelem;
-    int pathlen;
-
-    /*
-    dup length 0 eq {                       % elem path
-        1 index /cmd get /move eq {         % elem path
-            %(New Path)=
-            << 0 4 3 roll >> % new subpath  % <path> <subpath>
-            0 exch put                      %
-        }{
-            /addtopath cvx /nocurrentpoint signalerror
-        } ifelse
-    }{                                  % elem path
-        1 index /cmd get /move eq {     % elem path
-            dup dup length 1 sub get    % elem path last-subpath
-            dup length 1 sub get        % elem path last-elem-of-last-subpath
-            dup /cmd get /move eq { % elem path last-elem
-                %(Merge /move)=
-                3 1 roll pop            % last-elem elem
-                /data get /data exch put
-            }{                          % elem path last-elem
-                %(New subpath)=
-                pop                     % elem path
-                dup length 3 2 roll     % <path> n <elem>
-                << 0 3 2 roll >>        % <path> n <<0 <elem>>>        % new subpath
-                %pstack()=
-                put
-            } ifelse
-        }{                              % elem path
-            %(Append elem)=
-            dup length 1 sub get        % elem last-subpath
-            dup length                  % elem last-subpath key
-            3 2 roll
-            %pstack()=
-            put
-        } ifelse
-    } ifelse
-    */
-    pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
-    if (pathlen == 0)
-    {
-        cmd = xpost_dict_get(ctx, elem, namecmd);
-        if (xpost_dict_compare_objects(ctx, cmd, namemove) == 0)
-        {
-            /* New Path */
-            subpath = xpost_dict_cons(ctx, 10);
-            xpost_dict_put(ctx, subpath, xpost_int_cons(0), elem);
-            xpost_dict_put(ctx, path, xpost_int_cons(0), subpath);
-        }
-        else
-        {
-            return nocurrentpoint;
-        }
-    }
-    else
-    {
-        cmd = xpost_dict_get(ctx, elem, namecmd);
-        if (xpost_dict_compare_objects(ctx, cmd, namemove) == 0)
-        {
-            int subpathlen;
-            subpath = xpost_dict_get(ctx, path, xpost_int_cons(pathlen - 1));
-            subpathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, subpath), subpath);
-            lastelem = xpost_dict_get(ctx, subpath, xpost_int_cons(subpathlen - 1));
-            cmd = xpost_dict_get(ctx, lastelem, namecmd);
-            if (xpost_dict_compare_objects(ctx, cmd, namemove) == 0)
-            {
-                /* Merge "move" */
-                Xpost_Object data;
-                data = xpost_dict_get(ctx, elem, namedata);
-                xpost_dict_put(ctx, lastelem, namedata, data);
-            }
-            else
-            {
-                /* New Sub-path */
-                subpath = xpost_dict_cons(ctx, 10);
-                xpost_dict_put(ctx, subpath, xpost_int_cons(0), elem);
-                xpost_dict_put(ctx, path, xpost_int_cons(pathlen), subpath);
-            }
-        }
-        else
-        {
-            /* Append elem */
-            int subpathlen;
-            subpath = xpost_dict_get(ctx, path, xpost_int_cons(pathlen - 1));
-            subpathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, subpath), subpath);
-            xpost_dict_put(ctx, subpath, xpost_int_cons(subpathlen), elem);
-        }
-    }
+void _transform(Xpost_Matrix mat, real x, real y, real *xres, real *yres)
+{
+    *xres = mat.xx * x + mat.xy * y + mat.xz;
+    *yres = mat.yx * x + mat.yy * y + mat.yz;
+}
+
+static
+int _itransform(Xpost_Matrix mat, real x, real y, real *xres, real *yres)
+{
+    real det;
+
+    det = mat.xx * mat.yy - mat.yx * mat.xy;
+    if (det == 0)
+        return undefinedresult;
+    x -= mat.xz;
+    y -= mat.yz;
+    *xres = (mat.yy * x - mat.xy * y) / det;
+    *yres = (mat.xx * y - mat.yx * x) / det;
     return 0;
 }
 
 static
-int _moveto(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
+int _newpath(Xpost_Context *ctx)
 {
-    xpost_stack_push(ctx->lo, ctx->os, x);
-    xpost_stack_push(ctx->lo, ctx->os, y);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_moveto_cont_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.transform));
+    Xpost_Object gstate;
+    int ret;
+
+    /* graphicsdict /currgstate get /currpath null put */
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, null);
+}
+
+/* append an element to the current path,
+   storing the path back if it was copied */
+static
+int _append(Xpost_Context *ctx,
+            Xpost_Object gstate,
+            Xpost_Path_Verb verb,
+            const float *pts)
+{
+    Xpost_Object path, old;
+    int ret;
+
+    path = old = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    ret = xpost_path_append(ctx, &path, verb, pts);
+    if (ret) return ret;
+    if (xpost_object_get_type(path) == stringtype &&
+        (xpost_object_get_type(old) != stringtype ||
+         xpost_object_get_ent(old) != xpost_object_get_ent(path)))
+        return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, path);
     return 0;
 }
 
+/* transform the user space points xy by the CTM,
+   and append them to the current path */
 static
-int _moveto_cont(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
+int _appenduser(Xpost_Context *ctx,
+                Xpost_Path_Verb verb,
+                const Xpost_Object *xy)
 {
-    Xpost_Object data, elem;
-    data = xpost_object_cvlit(xpost_array_cons(ctx, 2));
-    xpost_array_put(ctx, data, 0, x);
-    xpost_array_put(ctx, data, 1, y);
-    elem = xpost_dict_cons(ctx, 2);
-    xpost_dict_put(ctx, elem, namecmd, namemove);
-    xpost_dict_put(ctx, elem, namedata, data);
-    return _addtopath(ctx, elem, _cpath(ctx));
+    Xpost_Object gstate;
+    Xpost_Matrix mat;
+    float pts[6];
+    real x, y;
+    int ret;
+    int i;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    ret = _ctm(ctx, gstate, &mat);
+    if (ret) return ret;
+    for (i = 0; i < XPOST_PATH_POINTS(verb); i++)
+    {
+        _transform(mat, NUM(xy[2 * i]), NUM(xy[2 * i + 1]), &x, &y);
+        pts[2 * i] = x;
+        pts[2 * i + 1] = y;
+    }
+    return _append(ctx, gstate, verb, pts);
+}
+
+int _currentpoint(Xpost_Context *ctx)
+{
+    float x, y;
+    int ret;
+
+    ret = xpost_path_current_point(ctx, _cpath(ctx), &x, &y);
+    if (ret)
+        return ret;
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.itransform));
+
+    return 0;
+}
+
+static
+int _moveto(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
+{
+    Xpost_Object xy[2];
+
+    xy[0] = x;
+    xy[1] = y;
+    return _appenduser(ctx, XPOST_PATH_MOVE, xy);
 }
 
 static
@@ -304,8 +249,8 @@ int _rmoveto(Xpost_Context *ctx, Xpost_Object dx, Xpost_Object dy)
 {
     xpost_stack_push(ctx->lo, ctx->os, dx);
     xpost_stack_push(ctx->lo, ctx->os, dy);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_rmoveto_cont_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_currentpoint_opcode));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.rmoveto_cont));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.currentpoint));
     return 0;
 }
 
@@ -322,24 +267,11 @@ int _rmoveto_cont(Xpost_Context *ctx,
 static
 int _lineto(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
 {
-    xpost_stack_push(ctx->lo, ctx->os, x);
-    xpost_stack_push(ctx->lo, ctx->os, y);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_lineto_cont_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.transform));
-    return 0;
-}
+    Xpost_Object xy[2];
 
-static
-int _lineto_cont(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
-{
-    Xpost_Object data, elem;
-    data = xpost_object_cvlit(xpost_array_cons(ctx, 2));
-    xpost_array_put(ctx, data, 0, x);
-    xpost_array_put(ctx, data, 1, y);
-    elem = xpost_dict_cons(ctx, 2);
-    xpost_dict_put(ctx, elem, namecmd, nameline);
-    xpost_dict_put(ctx, elem, namedata, data);
-    return _addtopath(ctx, elem, _cpath(ctx));
+    xy[0] = x;
+    xy[1] = y;
+    return _appenduser(ctx, XPOST_PATH_LINE, xy);
 }
 
 static
@@ -347,8 +279,8 @@ int _rlineto(Xpost_Context *ctx, Xpost_Object dx, Xpost_Object dy)
 {
     xpost_stack_push(ctx->lo, ctx->os, dx);
     xpost_stack_push(ctx->lo, ctx->os, dy);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_rlineto_cont_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_currentpoint_opcode));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.rlineto_cont));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.currentpoint));
     return 0;
 }
 
@@ -368,69 +300,15 @@ int _curveto(Xpost_Context *ctx,
              Xpost_Object x2, Xpost_Object y2,
              Xpost_Object x3, Xpost_Object y3)
 {
-    xpost_stack_push(ctx->lo, ctx->os, x1);
-    xpost_stack_push(ctx->lo, ctx->os, y1);
-    xpost_stack_push(ctx->lo, ctx->os, x2);
-    xpost_stack_push(ctx->lo, ctx->os, y2);
-    xpost_stack_push(ctx->lo, ctx->os, x3);
-    xpost_stack_push(ctx->lo, ctx->os, y3);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_curveto_cont1_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.transform));
-    return 0;
-}
-
-static
-int _curveto_cont1(Xpost_Context *ctx,
-                   Xpost_Object x1, Xpost_Object y1,
-                   Xpost_Object x2, Xpost_Object y2,
-                   Xpost_Object X3, Xpost_Object Y3)
-{
-    xpost_stack_push(ctx->lo, ctx->os, X3);
-    xpost_stack_push(ctx->lo, ctx->os, Y3);
-    xpost_stack_push(ctx->lo, ctx->os, x1);
-    xpost_stack_push(ctx->lo, ctx->os, y1);
-    xpost_stack_push(ctx->lo, ctx->os, x2);
-    xpost_stack_push(ctx->lo, ctx->os, y2);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_curveto_cont2_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.transform));
-    return 0;
-}
-
-static
-int _curveto_cont2(Xpost_Context *ctx,
-                   Xpost_Object X3, Xpost_Object Y3,
-                   Xpost_Object x1, Xpost_Object y1,
-                   Xpost_Object X2, Xpost_Object Y2)
-{
-    xpost_stack_push(ctx->lo, ctx->os, X2);
-    xpost_stack_push(ctx->lo, ctx->os, Y2);
-    xpost_stack_push(ctx->lo, ctx->os, X3);
-    xpost_stack_push(ctx->lo, ctx->os, Y3);
-    xpost_stack_push(ctx->lo, ctx->os, x1);
-    xpost_stack_push(ctx->lo, ctx->os, y1);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_curveto_cont3_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.transform));
-    return 0;
-}
-
-static
-int _curveto_cont3(Xpost_Context *ctx,
-                   Xpost_Object X2, Xpost_Object Y2,
-                   Xpost_Object X3, Xpost_Object Y3,
-                   Xpost_Object X1, Xpost_Object Y1)
-{
-    Xpost_Object data, elem;
-    data = xpost_object_cvlit(xpost_array_cons(ctx, 6));
-    xpost_array_put(ctx, data, 0, X1);
-    xpost_array_put(ctx, data, 1, Y1);
-    xpost_array_put(ctx, data, 2, X2);
-    xpost_array_put(ctx, data, 3, Y2);
-    xpost_array_put(ctx, data, 4, X3);
-    xpost_array_put(ctx, data, 5, Y3);
-    elem = xpost_dict_cons(ctx, 2);
-    xpost_dict_put(ctx, elem, namecmd, namecurve);
-    xpost_dict_put(ctx, elem, namedata, data);
-    return _addtopath(ctx, elem, _cpath(ctx));
+    Xpost_Object xy[6];
+
+    xy[0] = x1;
+    xy[1] = y1;
+    xy[2] = x2;
+    xy[3] = y2;
+    xy[4] = x3;
+    xy[5] = y3;
+    return _appenduser(ctx, XPOST_PATH_CURVE, xy);
 }
 
 static
@@ -445,8 +323,8 @@ int _rcurveto(Xpost_Context *ctx,
     xpost_stack_push(ctx->lo, ctx->os, y2);
     xpost_stack_push(ctx->lo, ctx->os, x3);
     xpost_stack_push(ctx->lo, ctx->os, y3);
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_rcurveto_cont_opcode));
-    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_currentpoint_opcode));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.rcurveto_cont));
+    xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.currentpoint));
     return 0;
 }
 
@@ -469,43 +347,12 @@ int _rcurveto_cont(Xpost_Context *ctx,
 static
 int _closepath(Xpost_Context *ctx)
 {
-    Xpost_Object path;
-    int pathlen;
-
-    /*
-    cpath length 0 gt {
-        cpath dup length 1 sub get % subpath
-        dup dup length 1 sub get % subpath last-elem
-        /cmd get /close eq { % subpath
-            pop
-        }{                   % subpath
-            0 get /data get % subpath [data]
-            << /data 3 2 roll /cmd /close >> cpath addtopath
-        } ifelse
-    } if
-    */
-    path = _cpath(ctx);
-    pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
-    if (pathlen)
-    {
-        Xpost_Object subpath, lastelem, firstelem, cmd, elem, data;
-        int subpathlen;
-
-        subpath = xpost_dict_get(ctx, path, xpost_int_cons(pathlen - 1));
-        subpathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, subpath), subpath);
-        lastelem = xpost_dict_get(ctx, subpath, xpost_int_cons(subpathlen - 1));
-        cmd = xpost_dict_get(ctx, lastelem, namecmd);
-        if (xpost_dict_compare_objects(ctx, cmd, nameclose) != 0)
-        {
-            firstelem = xpost_dict_get(ctx, subpath, xpost_int_cons(0));
-            data = xpost_dict_get(ctx, firstelem, namedata);
-            elem = xpost_dict_cons(ctx, 2);
-            xpost_dict_put(ctx, elem, namecmd, nameclose);
-            xpost_dict_put(ctx, elem, namedata, data);
-            return _addtopath(ctx, elem, _cpath(ctx));
-        }
-    }
-    return 0;
+    Xpost_Object gstate;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    return _append(ctx, gstate, XPOST_PATH_CLOSE, NULL);
 }
 
 /*
@@ -546,16 +393,6 @@ def
 */
 
 
-static
-void _transform(Xpost_Matrix mat, real x, real y, real *xres, real *yres)
-{
-    *xres = mat.xx * x + mat.xy * y + mat.xz;
-    *yres = mat.yx * x + mat.yy * y + mat.yz;
-}
-
-static
-Xpost_Object _arc_start_proc;
-
 static
 int _arcbez(Xpost_Context *ctx,
             Xpost_Object x, Xpost_Object y, Xpost_Object r,
@@ -564,11 +401,19 @@ int _arcbez(Xpost_Context *ctx,
     Xpost_Matrix mat1, mat2, mat3;
     real da_2, sin_a, cos_a;
     real x0, y0, x1, y1, x2, y2, x3, y3;
+    double a;
 
     xpost_matrix_scale(&mat1, r.real_.val, r.real_.val);
     xpost_matrix_translate(&mat2, x.real_.val, y.real_.val);
     xpost_matrix_mult(&mat2, &mat1, &mat3);
-    xpost_matrix_rotate(&mat2, (real)(((angle1.real_.val + angle2.real_.val) / 2.0) * RAD_PER_DEG));
+    /* the rotation by the middle angle, with sin and cos rather than
+       the approximations of xpost_matrix_rotate, so that the pieces
+       of an arc meet */
+    a = ((angle1.real_.val + angle2.real_.val) / 2.0) * RAD_PER_DEG;
+    mat2.xx = mat2.yy = (real)cos(a);
+    mat2.yx = (real)sin(a);
+    mat2.xy = -mat2.yx;
+    mat2.xz = mat2.yz = 0;
     xpost_matrix_mult(&mat3, &mat2, &mat1);
 
     da_2 = (real)(((angle2.real_.val - angle1.real_.val) / 2.0) * RAD_PER_DEG);
@@ -587,14 +432,16 @@ int _arcbez(Xpost_Context *ctx,
     _transform(mat1, x1, y1, &x1, &y1);
     _transform(mat1, x2, y2, &x2, &y2);
     _transform(mat1, x3, y3, &x3, &y3);
-    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x1));
-    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y1));
+    /* (x3,y3) is at angle1 and (x0,y0) at angle2: the curve runs
+       from the former to the latter */
     xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x2));
     xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y2));
-    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x3));
-    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y3));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x1));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y1));
     xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x0));
     xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y0));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x3));
+    xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y3));
     return 0;
 }
 
@@ -611,24 +458,17 @@ int _arc(Xpost_Context *ctx,
         t = a2 + 360;
         a2 = t;
     }
+    /* the pieces are scheduled last first, to run first first */
     if ((a2 - a1) > 90)
     {
-        _arc(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons((real)(a2 - ((a2 - a1)/2.0))));
         _arc(ctx, x, y, r, xpost_real_cons((real)(a1 + ((a2 - a1)/2.0))), xpost_real_cons(a2));
+        _arc(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons((real)(a2 - ((a2 - a1)/2.0))));
     }
     else
     {
-        //Xpost_Object path = _cpath(ctx);
-        //int pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
         _arcbez(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons(a2));
-        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_curveto_opcode));
-        xpost_stack_push(ctx->lo, ctx->es, _arc_start_proc);
-        /*
-        if (pathlen)
-            xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_lineto_opcode));
-        else
-            xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_moveto_opcode));
-            */
+        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.curveto));
+        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.arc_start));
     }
     return 0;
 }
@@ -648,40 +488,44 @@ int _arcn(Xpost_Context *ctx,
     }
     if ((a1 - a2) > 90)
     {
-        _arcn(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons(a2 + (real)((a1 - a2)/2.0)));
         _arcn(ctx, x, y, r, xpost_real_cons(a1 - (real)((a1 - a2)/2.0)), xpost_real_cons(a2));
+        _arcn(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons(a2 + (real)((a1 - a2)/2.0)));
     }
     else
     {
-        //Xpost_Object path = _cpath(ctx);
-        //int pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
         _arcbez(ctx, x, y, r, xpost_real_cons(a1), xpost_real_cons(a2));
-        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_curveto_opcode));
-        xpost_stack_push(ctx->lo, ctx->es, _arc_start_proc);
-        /*
-        if (pathlen)
-            xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_lineto_opcode));
-        else
-            xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(_moveto_opcode));
-            */
+        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.curveto));
+        xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(ctx->opcode_shortcuts.arc_start));
     }
     return 0;
 }
 
-#define NUM(x) (xpost_object_get_type(x)==realtype?x.real_.val:(real)x.int_.val)
+/* x0 y0  arc_start  -
+   begin a segment of arc at (x0,y0), with lineto if the current path
+   has a current point and moveto otherwise. it runs once the previous
+   segments are appended, after the operator which scheduled it */
+static
+int _arc_start(Xpost_Context *ctx, Xpost_Object x, Xpost_Object y)
+{
+    if (xpost_path_length(ctx, _cpath(ctx)))
+        return _lineto(ctx, x, y);
+    return _moveto(ctx, x, y);
+}
 
 static
 int _chopcurve(Xpost_Context *ctx,
+               Xpost_Object *path,
                real x0, real y0,
                real x1, real y1,
                real x2, real y2,
                real x3, real y3,
-               Xpost_Object flat)
+               real flat)
 {
     real x01, y01, x12, y12, x23, y23,
          x012, y012, x123, y123,
          x0123, y0123;
     real x03, y03;
+    int ret;
 
     //printf("%f %f %f %f %f %f %f %f\n", x0, y0, x1, y1, x2, y2, x3, y3);
 
@@ -722,136 +566,500 @@ int _chopcurve(Xpost_Context *ctx,
 #define DIST(xA, yA, xB, yB) \
     sqrt((xB-xA)*(xB-xA) + (yB-yA)*(yB-yA))
 
-    //printf("%f %f\n", DIST(x03, y03, x0123, y0123), NUM(flat));
-    if (DIST(x03, y03, x0123, y0123) < NUM(flat))
+    //printf("%f %f\n", DIST(x03, y03, x0123, y0123), flat);
+    if (DIST(x03, y03, x0123, y0123) < flat)
     {
-        Xpost_Object elem, data;
-        elem = xpost_dict_cons(ctx, 2);
-        xpost_dict_put(ctx, elem, namecmd, nameline);
-        data = xpost_object_cvlit(xpost_array_cons(ctx, 2));
-        xpost_array_put(ctx, data, 0, xpost_real_cons(x3));
-        xpost_array_put(ctx, data, 1, xpost_real_cons(y3));
-        xpost_dict_put(ctx, elem, namedata, data);
-        _addtopath(ctx, elem, _cpath(ctx));
+        float pts[2];
+        pts[0] = x3;
+        pts[1] = y3;
+        return xpost_path_append(ctx, path, XPOST_PATH_LINE, pts);
     }
-    else
+
+    ret = _chopcurve(ctx, path, x0, y0, x01, y01, x012, y012, x0123, y0123, flat);
+    if (ret)
+        return ret;
+    return _chopcurve(ctx, path, x0123, y0123, x123, y123, x23, y23, x3, y3, flat);
+}
+
+static
+int _flattenpath (Xpost_Context *ctx)
+{
+    Xpost_Object gstate, flat;
+    Xpost_Object path, the_new_path;
+    Xpost_Path_Verb verb;
+    float pts[6];
+    real x0 = 0, y0 = 0;
+    unsigned int off, end;
+    int curved;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    end = xpost_path_length(ctx, path);
+
+    /* a path without curves is left as it is */
+    curved = 0;
+    for (off = 0; off < end && !curved; )
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            return ret;
+        curved = verb == XPOST_PATH_CURVE;
+    }
+    if (!curved)
+        return 0;
+
+    flat = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.flat);
+    the_new_path = null;
+    for (off = 0; off < end; )
     {
-        _chopcurve(ctx, x0, y0, x01, y01, x012, y012, x0123, y0123, flat);
-        _chopcurve(ctx, x0123, y0123, x123, y123, x23, y23, x3, y3, flat);
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            return ret;
+        if (verb == XPOST_PATH_CURVE)
+            ret = _chopcurve(ctx, &the_new_path, x0, y0,
+                             pts[0], pts[1], pts[2], pts[3], pts[4], pts[5],
+                             NUM(flat));
+        else
+            ret = xpost_path_append(ctx, &the_new_path, verb, pts);
+        if (ret)
+            return ret;
+        x0 = pts[2 * XPOST_PATH_POINTS(verb) - 2];
+        y0 = pts[2 * XPOST_PATH_POINTS(verb) - 1];
     }
 
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, the_new_path);
+}
+
+typedef struct
+{
+    Xpost_Path_Verb verb;
+    float pts[6];
+} _Element;
+
+#define ENDPOINT(e) ((e).pts + 2 * XPOST_PATH_POINTS((e).verb) - 2)
+
+/* append the subpath elem[0..n-1] reversed to path */
+static
+int _reversesubpath(Xpost_Context *ctx,
+                    Xpost_Object *path,
+                    const _Element *elem,
+                    int n)
+{
+    const float *p;
+    float pts[6];
+    int closed;
+    int last;
+    int i;
+    int ret;
+
+    /* a closed subpath starts at its start, by the closing segment */
+    closed = n > 1 && elem[n - 1].verb == XPOST_PATH_CLOSE;
+    last = closed ? n - 2 : n - 1;
+    ret = xpost_path_append(ctx, path, XPOST_PATH_MOVE,
+                            closed ? elem[0].pts : ENDPOINT(elem[last]));
+    if (ret) return ret;
+    if (closed && last > 0)
+    {
+        ret = xpost_path_append(ctx, path, XPOST_PATH_LINE, ENDPOINT(elem[last]));
+        if (ret) return ret;
+    }
+
+    for (i = last; i > 0; i--)
+    {
+        p = ENDPOINT(elem[i - 1]);
+        if (elem[i].verb == XPOST_PATH_CURVE)
+        {
+            pts[0] = elem[i].pts[2];
+            pts[1] = elem[i].pts[3];
+            pts[2] = elem[i].pts[0];
+            pts[3] = elem[i].pts[1];
+            pts[4] = p[0];
+            pts[5] = p[1];
+            ret = xpost_path_append(ctx, path, XPOST_PATH_CURVE, pts);
+        }
+        else if (!closed || i > 1)
+            ret = xpost_path_append(ctx, path, XPOST_PATH_LINE, p);
+        if (ret) return ret;
+    }
+
+    if (closed)
+        return xpost_path_append(ctx, path, XPOST_PATH_CLOSE, NULL);
     return 0;
 }
 
 static
-int _flattenpath (Xpost_Context *ctx)
+int _reversepath(Xpost_Context *ctx)
 {
-    Xpost_Object gd, gstate, flat;
+    Xpost_Object gstate;
     Xpost_Object path, the_new_path;
-    Xpost_Object cp;
-    Xpost_Object num;
-    real x0, y0, x1, y1, x2, y2, x3, y3;
-    int pathlen;
+    _Element *elem = NULL;
+    _Element e;
+    unsigned int off, end;
+    int n = 0;
+    int max = 0;
     int ret;
-    int i;
 
-    ret = xpost_op_any_load(ctx, namegraphicsdict);
+    ret = _gstate(ctx, &gstate);
     if (ret) return ret;
-    gd = xpost_stack_pop(ctx->lo, ctx->os);
-    xpost_stack_push(ctx->lo, ctx->hold, gd);
-    gstate = xpost_dict_get(ctx, gd, namecurrgstate);
-    flat = xpost_dict_get(ctx, gstate, xpost_name_cons(ctx, "flat"));
-
-    path = _cpath(ctx);
-    pathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, path), path);
-    xpost_stack_push(ctx->lo, ctx->hold, path);
-    ret = _newpath(ctx);
-    if (ret)
-        return ret;
-    the_new_path = _cpath(ctx);
-    xpost_stack_push(ctx->lo, ctx->hold, the_new_path);
-    for (i = 0; i < pathlen; i++)
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    end = xpost_path_length(ctx, path);
+    the_new_path = null;
+    for (off = 0; ; )
     {
-        Xpost_Object subpath;
-        int subpathlen;
-        int j;
+        int done = off >= end;
 
-        subpath = xpost_dict_get(ctx, path, xpost_int_cons(i));
-        if (xpost_object_get_type(subpath) == invalidtype)
+        if (!done)
+        {
+            ret = xpost_path_get(ctx, path, &off, &e.verb, e.pts);
+            if (ret)
+                goto fail;
+        }
+        if (n && (done || e.verb == XPOST_PATH_MOVE))
         {
-            XPOST_LOG_ERR("subpath %d not found in path (size %d)", i, pathlen);
-            return undefined;
+            ret = _reversesubpath(ctx, &the_new_path, elem, n);
+            if (ret)
+                goto fail;
+            n = 0;
         }
-        subpathlen = xpost_dict_length_memory(xpost_context_select_memory(ctx, subpath), subpath);
-        for (j = 0; j < subpathlen; j++)
+        if (done)
+            break;
+        if (n == max)
         {
-            Xpost_Object elem;
-            Xpost_Object cmd;
+            _Element *tmp;
 
-            elem = xpost_dict_get(ctx, subpath, xpost_int_cons(j));
-            if (xpost_object_get_type(elem) == invalidtype)
-            {
-                XPOST_LOG_ERR("elem %d not found in subpath %d (size %d)", j, i, subpathlen);
-                return undefined;
-            }
-            cmd = xpost_dict_get(ctx, elem, namecmd);
-            if (xpost_object_get_type(cmd) == invalidtype)
+            max = max ? 2 * max : 16;
+            tmp = realloc(elem, max * sizeof *elem);
+            if (!tmp)
             {
-                XPOST_LOG_ERR("/cmd not found in elem %d of subpath %d", j, i);
-                return undefined;
+                ret = VMerror;
+                goto fail;
             }
-            if (cmd.mark_.padw == namemove.mark_.padw)
-            {
-                cp = xpost_dict_get(ctx, elem, namedata);
-                ret = _addtopath(ctx, elem, the_new_path);
-                if (ret)
-                    return ret;
-            }
-            else if (cmd.mark_.padw == nameline.mark_.padw)
-            {
-                cp = xpost_dict_get(ctx, elem, namedata);
-                ret = _addtopath(ctx, elem, the_new_path);
-                if (ret)
-                    return ret;
-            }
-            else if (cmd.mark_.padw == namecurve.mark_.padw)
-            {
+            elem = tmp;
+        }
+        elem[n++] = e;
+    }
+    free(elem);
 
-                Xpost_Object data;
-                num = xpost_array_get(ctx, cp, 0);
-                x0 = NUM(num);
-                num = xpost_array_get(ctx, cp, 1);
-                y0 = NUM(num);
-                data = xpost_dict_get(ctx, elem, namedata);
-                num = xpost_array_get(ctx, data, 0);
-                x1 = NUM(num);
-                num = xpost_array_get(ctx, data, 1);
-                y1 = NUM(num);
-                num = xpost_array_get(ctx, data, 2);
-                x2 = NUM(num);
-                num = xpost_array_get(ctx, data, 3);
-                y2 = NUM(num);
-                num = xpost_array_get(ctx, data, 4);
-                x3 = NUM(num);
-                num = xpost_array_get(ctx, data, 5);
-                y3 = NUM(num);
-                //printf("%f %f %f %f %f %f %f %f\n", x0, y0, x1, y1, x2, y2, x3, y3);
-
-                _chopcurve(ctx, x0, y0, x1, y1, x2, y2, x3, y3, flat);
-            }
-            else if (cmd.mark_.padw == nameclose.mark_.padw)
-            {
-                cp = xpost_dict_get(ctx, elem, namedata);
-                ret = _addtopath(ctx, elem, the_new_path);
-                if (ret)
-                    return ret;
-            }
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, the_new_path);
+
+fail:
+    free(elem);
+    return ret;
+}
+
+/* -  pathbbox  llx lly urx ury
+   bounding box in user space of the current path, control points
+   of the curves included */
+static
+int _pathbbox(Xpost_Context *ctx)
+{
+    Xpost_Object gstate, path;
+    Xpost_Path_Verb verb;
+    Xpost_Matrix mat;
+    float pts[6];
+    real box[4];
+    real x, y;
+    unsigned int off, end;
+    int i;
+    int ret;
+
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    end = xpost_path_length(ctx, path);
+    if (!end)
+        return nocurrentpoint;
+    ret = _ctm(ctx, gstate, &mat);
+    if (ret) return ret;
+
+    off = 0;
+    ret = xpost_path_get(ctx, path, &off, &verb, pts);
+    if (ret) return ret;
+    box[0] = box[2] = pts[0];
+    box[1] = box[3] = pts[1];
+    while (off < end)
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret) return ret;
+        for (i = 0; i < 2 * XPOST_PATH_POINTS(verb); i += 2)
+        {
+            if (pts[i] < box[0]) box[0] = pts[i];
+            if (pts[i] > box[2]) box[2] = pts[i];
+            if (pts[i + 1] < box[1]) box[1] = pts[i + 1];
+            if (pts[i + 1] > box[3]) box[3] = pts[i + 1];
         }
     }
 
+    /* the user space box of the corners of the device box */
+    for (i = 0; i < 4; i++)
+    {
+        ret = _itransform(mat, box[i & 1 ? 2 : 0], box[i & 2 ? 3 : 1], &x, &y);
+        if (ret) return ret;
+        pts[0] = i == 0 || x < pts[0] ? x : pts[0];
+        pts[1] = i == 0 || y < pts[1] ? y : pts[1];
+        pts[2] = i == 0 || x > pts[2] ? x : pts[2];
+        pts[3] = i == 0 || y > pts[3] ? y : pts[3];
+    }
+    for (i = 0; i < 4; i++)
+        xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(pts[i]));
+
+    return 0;
+}
+
+/* call the procedure for the element of path at off, with its points,
+   transformed to user space unless dev is set, on the operand stack.
+   the enumeration of the elements up to end continues with the
+   continuation operator, scheduled under the procedure */
+static
+int _forall(Xpost_Context *ctx,
+            Xpost_Object move, Xpost_Object line,
+            Xpost_Object curve, Xpost_Object close,
+            Xpost_Object path,
+            unsigned int off, unsigned int end,
+            int dev)
+{
+    Xpost_Path_Verb verb;
+    Xpost_Object gstate, proc;
+    Xpost_Matrix mat;
+    float pts[6];
+    real x, y;
+    int i;
+    int ret;
+
+    if (off >= end)
+        return 0;
+    ret = xpost_path_get(ctx, path, &off, &verb, pts);
+    if (ret)
+        return ret;
+    if (!dev)
+    {
+        ret = _gstate(ctx, &gstate);
+        if (ret) return ret;
+        ret = _ctm(ctx, gstate, &mat);
+        if (ret) return ret;
+    }
+
+    for (i = 0; verb != XPOST_PATH_CLOSE && i < XPOST_PATH_POINTS(verb); i++)
+    {
+        x = pts[2 * i];
+        y = pts[2 * i + 1];
+        if (!dev)
+        {
+            ret = _itransform(mat, x, y, &x, &y);
+            if (ret) return ret;
+        }
+        if (!xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(x)) ||
+            !xpost_stack_push(ctx->lo, ctx->os, xpost_real_cons(y)))
+            return stackoverflow;
+    }
+    switch (verb)
+    {
+        case XPOST_PATH_MOVE: proc = move; break;
+        case XPOST_PATH_LINE: proc = line; break;
+        case XPOST_PATH_CURVE: proc = curve; break;
+        default: proc = close; break;
+    }
+
+    if (off < end)
+    {
+        if (!xpost_stack_push(ctx->lo, ctx->es, xpost_operator_cons_opcode(dev ?
+                    ctx->opcode_shortcuts.devpathforall_cont :
+                    ctx->opcode_shortcuts.pathforall_cont)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_int_cons(end)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_int_cons(off)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, path) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvlit(close)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvlit(curve)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvlit(line)) ||
+            !xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvlit(move)))
+            return execstackoverflow;
+    }
+    if (!xpost_stack_push(ctx->lo, ctx->es, xpost_object_cvx(proc)))
+        return execstackoverflow;
+
+    return 0;
+}
+
+/* move line curve close  pathforall  -
+   enumerate current path in user coordinates */
+static
+int _pathforall(Xpost_Context *ctx,
+                Xpost_Object move, Xpost_Object line,
+                Xpost_Object curve, Xpost_Object close)
+{
+    Xpost_Object path = _cpath(ctx);
+    return _forall(ctx, move, line, curve, close,
+                   path, 0, xpost_path_length(ctx, path), 0);
+}
+
+static
+int _pathforall_cont(Xpost_Context *ctx,
+                     Xpost_Object move, Xpost_Object line,
+                     Xpost_Object curve, Xpost_Object close,
+                     Xpost_Object path, Xpost_Object off, Xpost_Object end)
+{
+    return _forall(ctx, move, line, curve, close,
+                   path, off.int_.val, end.int_.val, 0);
+}
+
+/* move line curve close  .devpathforall  -
+   enumerate current path in device coordinates */
+static
+int _devpathforall(Xpost_Context *ctx,
+                   Xpost_Object move, Xpost_Object line,
+                   Xpost_Object curve, Xpost_Object close)
+{
+    Xpost_Object path = _cpath(ctx);
+    return _forall(ctx, move, line, curve, close,
+                   path, 0, xpost_path_length(ctx, path), 1);
+}
+
+static
+int _devpathforall_cont(Xpost_Context *ctx,
+                        Xpost_Object move, Xpost_Object line,
+                        Xpost_Object curve, Xpost_Object close,
+                        Xpost_Object path, Xpost_Object off, Xpost_Object end)
+{
+    return _forall(ctx, move, line, curve, close,
+                   path, off.int_.val, end.int_.val, 1);
+}
+
+/* path move line curve close  .pathforall  -
+   enumerate path in device coordinates */
+static
+int _dotpathforall(Xpost_Context *ctx,
+                   Xpost_Object path,
+                   Xpost_Object move, Xpost_Object line,
+                   Xpost_Object curve, Xpost_Object close)
+{
+    if (xpost_object_get_type(path) != nulltype &&
+        xpost_object_get_type(path) != stringtype)
+        return typecheck;
+    return _forall(ctx, move, line, curve, close,
+                   path, 0, xpost_path_length(ctx, path), 1);
+}
+
+/* path  .sharepath  path
+   mark path as shared, before referencing it from a second place */
+static
+int _sharepath(Xpost_Context *ctx,
+               Xpost_Object path)
+{
+    int ret;
+
+    ret = xpost_path_share(ctx, path);
+    if (ret)
+        return ret;
+    xpost_stack_push(ctx->lo, ctx->os, path);
+    return 0;
+}
+
+/* load the stroke style of the graphics state, with the dash array
+   in a buffer for the caller to free */
+static
+int _style(Xpost_Context *ctx,
+           Xpost_Object gstate,
+           Xpost_Stroke_Style *style,
+           real **dash)
+{
+    Xpost_Object o[6];
+    real *buf;
+    int i;
+    int ret;
+
+    ret = _ctm(ctx, gstate, &style->ctm);
+    if (ret) return ret;
+    o[0] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.linewidth);
+    o[1] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.linecap);
+    o[2] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.linejoin);
+    o[3] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.miterlimit);
+    o[4] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.dashoffset);
+    o[5] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.flat);
+    for (i = 0; i < 6; i++)
+        if (xpost_object_get_type(o[i]) != integertype &&
+            xpost_object_get_type(o[i]) != realtype)
+            return typecheck;
+    style->width = NUM(o[0]);
+    style->cap = (int)NUM(o[1]);
+    style->join = (int)NUM(o[2]);
+    style->miterlimit = NUM(o[3]);
+    style->dashoffset = NUM(o[4]);
+    style->flat = NUM(o[5]);
+
+    o[0] = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.dasharray);
+    if (xpost_object_get_type(o[0]) != arraytype)
+        return typecheck;
+    buf = NULL;
+    if (o[0].comp_.sz)
+    {
+        buf = malloc(o[0].comp_.sz * sizeof *buf);
+        if (!buf)
+            return VMerror;
+    }
+    for (i = 0; i < o[0].comp_.sz; i++)
+    {
+        o[1] = xpost_array_get(ctx, o[0], i);
+        if (xpost_object_get_type(o[1]) != integertype &&
+            xpost_object_get_type(o[1]) != realtype)
+        {
+            free(buf);
+            return typecheck;
+        }
+        buf[i] = NUM(o[1]);
+    }
+    style->dash = buf;
+    style->ndash = o[0].comp_.sz;
+    *dash = buf;
     return 0;
 }
 
+/* replace the current path by the path its stroke or its dash
+   pattern gives with the stroke style of the graphics state */
+static
+int _stroke(Xpost_Context *ctx,
+            int (*stroke)(Xpost_Context *ctx,
+                          Xpost_Object path,
+                          const Xpost_Stroke_Style *style,
+                          Xpost_Object *out))
+{
+    Xpost_Object gstate, path, the_new_path;
+    Xpost_Stroke_Style style;
+    real *dash;
+    int ret;
+
+    ret = _flattenpath(ctx);
+    if (ret) return ret;
+    ret = _gstate(ctx, &gstate);
+    if (ret) return ret;
+    ret = _style(ctx, gstate, &style, &dash);
+    if (ret) return ret;
+    path = xpost_dict_get(ctx, gstate, ctx->name_shortcuts.currpath);
+    ret = stroke(ctx, path, &style, &the_new_path);
+    free(dash);
+    if (ret) return ret;
+
+    return xpost_dict_put(ctx, gstate, ctx->name_shortcuts.currpath, the_new_path);
+}
+
+/* -  strokepath  -
+   replace the current path by the outline of its stroke */
+static
+int _strokepath(Xpost_Context *ctx)
+{
+    return _stroke(ctx, xpost_stroke_path);
+}
+
+/* -  .dashpath  -
+   replace the current path by the dashes of its stroke,
+   for the strokes of lines too thin for an outline */
+static
+int _dashpath(Xpost_Context *ctx)
+{
+    return _stroke(ctx, xpost_stroke_dash);
+}
+
 
 int xpost_oper_init_path_ops(Xpost_Context *ctx,
                              Xpost_Object sd)
@@ -864,80 +1072,54 @@ int xpost_oper_init_path_ops(Xpost_Context *ctx,
     //xpost_memory_table_get_addr(ctx->gl, XPOST_MEMORY_TABLE_SPECIAL_OPERATOR_TABLE, &optadr);
     //optab = (void *)(ctx->gl->base + optadr);
 
-    if (xpost_object_get_type((namegraphicsdict = xpost_name_cons(ctx, "graphicsdict"))) == invalidtype)
-        return VMerror;
-    if (xpost_object_get_type((namecurrgstate = xpost_name_cons(ctx, "currgstate"))) == invalidtype)
-        return VMerror;
-    if (xpost_object_get_type((namecurrpath = xpost_name_cons(ctx, "currpath"))) == invalidtype)
-        return VMerror;
-    if (xpost_object_get_type((namecmd = xpost_name_cons(ctx, "cmd"))) == invalidtype)
-        return VMerror;
-    if (xpost_object_get_type((namedata = xpost_name_cons(ctx, "data"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.graphicsdict = xpost_name_cons(ctx, "graphicsdict"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namemove = xpost_name_cons(ctx, "move"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.currgstate = xpost_name_cons(ctx, "currgstate"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameline = xpost_name_cons(ctx, "line"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.currpath = xpost_name_cons(ctx, "currpath"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((namecurve = xpost_name_cons(ctx, "curve"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.currmatrix = xpost_name_cons(ctx, "currmatrix"))) == invalidtype)
         return VMerror;
-    if (xpost_object_get_type((nameclose = xpost_name_cons(ctx, "close"))) == invalidtype)
+    if (xpost_object_get_type((ctx->name_shortcuts.flat = xpost_name_cons(ctx, "flat"))) == invalidtype)
         return VMerror;
 
-    _mat = xpost_object_cvlit(xpost_array_cons(ctx, 6));
-    _mat1 = xpost_object_cvlit(xpost_array_cons(ctx, 6));
-
     op = xpost_operator_cons(ctx, "newpath", (Xpost_Op_Func)_newpath, 0, 0);
     INSTALL;
     op = xpost_operator_cons(ctx, "currentpoint", (Xpost_Op_Func)_currentpoint, 0, 0);
-    _currentpoint_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.currentpoint = op.mark_.padw;
     INSTALL;
 
     op = xpost_operator_cons(ctx, "moveto", (Xpost_Op_Func)_moveto, 0, 2, numbertype, numbertype);
-    _moveto_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.moveto = op.mark_.padw;
     INSTALL;
-    op = xpost_operator_cons(ctx, "moveto_cont", (Xpost_Op_Func)_moveto_cont, 0, 2, numbertype, numbertype);
-    _moveto_cont_opcode = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "rmoveto", (Xpost_Op_Func)_rmoveto, 0, 2, floattype, floattype);
     INSTALL;
     op = xpost_operator_cons(ctx, "rmoveto_cont", (Xpost_Op_Func)_rmoveto_cont, 0, 4,
                              floattype, floattype, floattype, floattype);
-    _rmoveto_cont_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.rmoveto_cont = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "lineto", (Xpost_Op_Func)_lineto, 0, 2, numbertype, numbertype);
-    _lineto_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.lineto = op.mark_.padw;
     INSTALL;
-    op = xpost_operator_cons(ctx, "lineto_cont", (Xpost_Op_Func)_lineto_cont, 0, 2, numbertype, numbertype);
-    _lineto_cont_opcode = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "rlineto", (Xpost_Op_Func)_rlineto, 0, 2, floattype, floattype);
     INSTALL;
     op = xpost_operator_cons(ctx, "rlineto_cont", (Xpost_Op_Func)_rlineto_cont, 0, 4,
                              floattype, floattype, floattype, floattype);
-    _rlineto_cont_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.rlineto_cont = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "curveto", (Xpost_Op_Func)_curveto, 0, 6,
                              numbertype, numbertype, numbertype, numbertype, numbertype, numbertype);
-    _curveto_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.curveto = op.mark_.padw;
     INSTALL;
-    op = xpost_operator_cons(ctx, "curveto_cont1", (Xpost_Op_Func)_curveto_cont1, 0, 6,
-                             numbertype, numbertype, numbertype, numbertype, numbertype, numbertype);
-    _curveto_cont1_opcode = op.mark_.padw;
-
-    op = xpost_operator_cons(ctx, "curveto_cont2", (Xpost_Op_Func)_curveto_cont2, 0, 6,
-                             numbertype, numbertype, numbertype, numbertype, numbertype, numbertype);
-    _curveto_cont2_opcode = op.mark_.padw;
-
-    op = xpost_operator_cons(ctx, "curveto_cont3", (Xpost_Op_Func)_curveto_cont3, 0, 6,
-                             numbertype, numbertype, numbertype, numbertype, numbertype, numbertype);
-    _curveto_cont3_opcode = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "rcurveto", (Xpost_Op_Func)_rcurveto, 0, 6,
                              floattype, floattype, floattype, floattype, floattype, floattype);
     INSTALL;
     op = xpost_operator_cons(ctx, "rcurveto_cont", (Xpost_Op_Func)_rcurveto_cont, 0, 8,
                              floattype, floattype, floattype, floattype, floattype, floattype, floattype, floattype);
-    _rcurveto_cont_opcode = op.mark_.padw;
+    ctx->opcode_shortcuts.rcurveto_cont = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "closepath", (Xpost_Op_Func)_closepath, 0, 0);
     INSTALL;
@@ -948,26 +1130,41 @@ int xpost_oper_init_path_ops(Xpost_Context *ctx,
     op = xpost_operator_cons(ctx, "arcn", (Xpost_Op_Func)_arcn, 0, 5,
                              floattype, floattype, floattype, floattype, floattype);
     INSTALL;
+    op = xpost_operator_cons(ctx, "arc_start", (Xpost_Op_Func)_arc_start, 0, 2, numbertype, numbertype);
+    ctx->opcode_shortcuts.arc_start = op.mark_.padw;
 
     op = xpost_operator_cons(ctx, "flattenpath", (Xpost_Op_Func)_flattenpath, 0, 0);
     INSTALL;
+    op = xpost_operator_cons(ctx, "reversepath", (Xpost_Op_Func)_reversepath, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "pathbbox", (Xpost_Op_Func)_pathbbox, 4, 0);
+    INSTALL;
 
-    _arc_start_proc = xpost_array_cons(ctx, 7);
-    xpost_array_put(ctx, _arc_start_proc, 0, xpost_object_cvx(xpost_name_cons(ctx, "cpath")));
-    xpost_array_put(ctx, _arc_start_proc, 1, xpost_object_cvx(xpost_name_cons(ctx, "length")));
-    xpost_array_put(ctx, _arc_start_proc, 2, xpost_int_cons(0));
-    xpost_array_put(ctx, _arc_start_proc, 3, xpost_object_cvx(xpost_name_cons(ctx, "gt")));
-    {
-        Xpost_Object true_clause = xpost_object_cvx(xpost_array_cons(ctx, 1));
-        xpost_array_put(ctx, true_clause, 0, xpost_object_cvx(xpost_name_cons(ctx, "lineto")));
-        xpost_array_put(ctx, _arc_start_proc, 4, true_clause);
-    }
-    {
-        Xpost_Object false_clause = xpost_object_cvx(xpost_array_cons(ctx, 1));
-        xpost_array_put(ctx, false_clause, 0, xpost_object_cvx(xpost_name_cons(ctx, "moveto")));
-        xpost_array_put(ctx, _arc_start_proc, 5, false_clause);
-    }
-    xpost_array_put(ctx, _arc_start_proc, 6, xpost_object_cvx(xpost_name_cons(ctx, "ifelse")));
+    op = xpost_operator_cons(ctx, "pathforall", (Xpost_Op_Func)_pathforall, 0, 4,
+                             proctype, proctype, proctype, proctype);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "pathforall_cont", (Xpost_Op_Func)_pathforall_cont, 0, 7,
+                             anytype, anytype, anytype, anytype,
+                             stringtype, integertype, integertype);
+    ctx->opcode_shortcuts.pathforall_cont = op.mark_.padw;
+    op = xpost_operator_cons(ctx, ".devpathforall", (Xpost_Op_Func)_devpathforall, 0, 4,
+                             proctype, proctype, proctype, proctype);
+    INSTALL;
+    op = xpost_operator_cons(ctx, "devpathforall_cont", (Xpost_Op_Func)_devpathforall_cont, 0, 7,
+                             anytype, anytype, anytype, anytype,
+                             stringtype, integertype, integertype);
+    ctx->opcode_shortcuts.devpathforall_cont = op.mark_.padw;
+    op = xpost_operator_cons(ctx, ".pathforall", (Xpost_Op_Func)_dotpathforall, 0, 5,
+                             anytype, proctype, proctype, proctype, proctype);
+    INSTALL;
+
+    op = xpost_operator_cons(ctx, ".sharepath", (Xpost_Op_Func)_sharepath, 1, 1, anytype);
+    INSTALL;
+
+    op = xpost_operator_cons(ctx, "strokepath", (Xpost_Op_Func)_strokepath, 0, 0);
+    INSTALL;
+    op = xpost_operator_cons(ctx, ".dashpath", (Xpost_Op_Func)_dashpath, 0, 0);
+    INSTALL;
 
     return 0;
 }
@@ -113,6 +113,7 @@ int Vrestore(Xpost_Context *ctx,
         xpost_save_restore_snapshot(ctx->lo);
         z--;
     }
+    xpost_context_load_cache_invalidate(ctx->lo, null);
     printf("restore\n");
     return 0;
 }
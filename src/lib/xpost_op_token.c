@@ -39,7 +39,12 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h> /* strchr */
+#include <string.h> /* strchr memcpy */
+
+#if defined (__SSE2__) && defined (__GNUC__)
+# include <emmintrin.h>
+# define XPOST_TOKEN_SSE2 1
+#endif
 
 #include "xpost.h"
 #include "xpost_log.h"
@@ -62,18 +67,37 @@
 
 enum { NBUF = 2 * BUFSIZ };
 
+/* a contiguous run of unread bytes of the source,
+   for scanning tokens in bulk. */
+typedef
+struct
+{
+    const unsigned char *ptr;
+    size_t len;
+    int final; /* the span reaches the end of the source */
+} span;
+
+/* sources that can expose their unread bytes as a span */
+typedef
+struct
+{
+    int (*peek)(Xpost_Context *ctx, void *src, span *sp);
+    void (*skip)(Xpost_Context *ctx, void *src, size_t n);
+} span_methods;
+
 static
 int puff(Xpost_Context *ctx,
          char *buf,
          int nbuf,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src),
-         void (*back)(Xpost_Context *ctx, int c, Xpost_Object *src));
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src),
+         void (*back)(Xpost_Context *ctx, int c, void *src));
 static
 int toke(Xpost_Context *ctx,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src),
-         void (*back)(Xpost_Context *ctx, int c, Xpost_Object *src),
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src),
+         void (*back)(Xpost_Context *ctx, int c, void *src),
+         const span_methods *spans,
          Xpost_Object *retval);
 
 static
@@ -197,9 +221,10 @@ static
 int grok(Xpost_Context *ctx,
          char *s,
          int ns,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src),
-         void (*back)(Xpost_Context *ctx, int c, Xpost_Object *src),
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src),
+         void (*back)(Xpost_Context *ctx, int c, void *src),
+         const span_methods *spans,
          Xpost_Object *retval)
 {
     Xpost_Object obj;
@@ -397,7 +422,7 @@ int grok(Xpost_Context *ctx,
                 while (1)
                 {
                     Xpost_Object t;
-                    ret = toke(ctx, src, next, back, &t);
+                    ret = toke(ctx, src, next, back, spans, &t);
                     //printf("grok: x?%d", xpost_object_is_exe(t));
                     if (ret)
                         return ret;
@@ -432,7 +457,7 @@ int grok(Xpost_Context *ctx,
                     //xpost_operator_exec(ctx, xpost_operator_cons(ctx, "load", NULL,0,0).mark_.padw);
                     if (DEBUGLOAD)
                         printf("\ntoken: loading immediate name %s\n", s);
-                    xpost_op_any_load(ctx, xpost_object_cvx(xpost_name_cons(ctx, s)));
+                    xpost_op_any_load(ctx, xpost_object_cvx(xpost_name_cons_bytes(ctx, s, ns)));
                     ret = xpost_stack_pop(ctx->lo, ctx->os);
                     if (DEBUGLOAD)
                         xpost_object_dump(ret);
@@ -464,13 +489,13 @@ int grok(Xpost_Context *ctx,
                 //printf("grok:/%s\n", s);
                 s[ns] = '\0';
                 //return xpost_object_cvlit(xpost_name_cons(ctx, s));
-                *retval = xpost_object_cvlit(xpost_name_cons(ctx, s));
+                *retval = xpost_object_cvlit(xpost_name_cons_bytes(ctx, s, ns));
                 return 0;
             }
             default:
             {
                 //return xpost_object_cvx(xpost_name_cons(ctx, s));
-                *retval = xpost_object_cvx(xpost_name_cons(ctx, s));
+                *retval = xpost_object_cvx(xpost_name_cons_bytes(ctx, s, ns));
                 return 0;
             }
         }
@@ -481,8 +506,8 @@ int grok(Xpost_Context *ctx,
 static
 int snip(Xpost_Context *ctx,
          char *buf,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src))
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src))
 {
     int c;
     do {
@@ -506,9 +531,9 @@ static
 int puff(Xpost_Context *ctx,
          char *buf,
          int nbuf,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src),
-         void (*back)(Xpost_Context *ctx, int c, Xpost_Object *src))
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src),
+         void (*back)(Xpost_Context *ctx, int c, void *src))
 {
     int c;
     char *s = buf;
@@ -522,11 +547,325 @@ int puff(Xpost_Context *ctx,
 }
 
 
+/*
+   span scanner.
+   When the source can show its unread bytes as a contiguous span
+   (strings, and files whose contents are in memory), the common
+   tokens are scanned straight out of the span: whitespace and
+   comments are skipped in bulk, runs of regular characters are
+   found with a classification table (16 bytes at a time with SSE2),
+   and names and plain integers are built without going through
+   next()/back() for each character.
+   Anything unusual, or a token which may continue past the end of
+   the span, is left to the character-at-a-time scanner above,
+   which picks up at the first unconsumed byte.
+ */
+
+enum { REG = 0, SPACE = 1, DEL = 2 };
+
+/* agrees with isspace() and isdel() */
+static const unsigned char tokclass[256] = {
+    ['\t'] = SPACE, ['\n'] = SPACE, ['\v'] = SPACE,
+    ['\f'] = SPACE, ['\r'] = SPACE, [' '] = SPACE,
+    ['('] = DEL, [')'] = DEL, ['['] = DEL, [']'] = DEL,
+    ['<'] = DEL, ['>'] = DEL, ['{'] = DEL, ['}'] = DEL,
+    ['/'] = DEL, ['%'] = DEL
+};
+
+/* find the end of a run of regular characters */
+static
+const unsigned char *span_regular(const unsigned char *p,
+                                  const unsigned char *end)
+{
+#ifdef XPOST_TOKEN_SSE2
+    const __m128i sp = _mm_set1_epi8(' ');
+    while (end - p >= 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m;
+        int mask;
+
+        /* candidates: anything <= ' ', and the delimiters */
+        m = _mm_cmpeq_epi8(_mm_min_epu8(x, sp), x);
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('(')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(')')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('[')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(']')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('<')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('>')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('{')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('}')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('/')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('%')));
+        mask = _mm_movemask_epi8(m);
+        while (mask)
+        {
+            int i = __builtin_ctz(mask);
+            if (tokclass[p[i]] != REG) /* control chars are regular */
+                return p + i;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && tokclass[*p] == REG)
+        ++p;
+    return p;
+}
+
+/* find the first ( ) or \ in the body of a string */
+static
+const unsigned char *span_string(const unsigned char *p,
+                                 const unsigned char *end)
+{
+#ifdef XPOST_TOKEN_SSE2
+    while (end - p >= 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m;
+        int mask;
+
+        m = _mm_cmpeq_epi8(x, _mm_set1_epi8('('));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(')')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+        mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '(' && *p != ')' && *p != '\\')
+        ++p;
+    return p;
+}
+
+static
+int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* convert a regular-character token held in s[0..ns).
+   plain decimal integers are converted here,
+   other numbers go through the fsm checks in grok. */
+static
+int grok_span(Xpost_Context *ctx,
+              char *s,
+              int ns,
+              void *src,
+              int (*next)(Xpost_Context *ctx, void *src),
+              void (*back)(Xpost_Context *ctx, int c, void *src),
+              const span_methods *spans,
+              Xpost_Object *retval)
+{
+    int c = (unsigned char)*s;
+
+    if (isdigit(c) || issign(c) || isdot(c))
+    {
+        char *d = s + (issign(c) ? 1 : 0);
+        int nd = ns - (d - s);
+        long num = 0;
+        int i;
+
+        if (nd < 1 || nd > 9)
+            return grok(ctx, s, ns, src, next, back, spans, retval);
+        for (i = 0; i < nd; ++i)
+        {
+            if (!isdigit((unsigned char)d[i]))
+                return grok(ctx, s, ns, src, next, back, spans, retval);
+            num = num * 10 + (d[i] - '0');
+        }
+        *retval = xpost_int_cons(c == '-' ? -num : num);
+        return 0;
+    }
+
+    *retval = xpost_object_cvx(xpost_name_cons_bytes(ctx, s, ns));
+    return 0;
+}
+
+/* scan one token straight out of the source's span.
+   returns -1 if the character scanner must finish the job,
+   otherwise 0 or an error code, like toke. */
+static
+int toke_span(Xpost_Context *ctx,
+              void *src,
+              int (*next)(Xpost_Context *ctx, void *src),
+              void (*back)(Xpost_Context *ctx, int c, void *src),
+              const span_methods *spans,
+              Xpost_Object *retval)
+{
+    char buf[NBUF];
+    span sp;
+    const unsigned char *p, *q, *end;
+    size_t n;
+
+    if (!spans->peek(ctx, src, &sp))
+        return -1;
+    p = sp.ptr;
+    end = p + sp.len;
+
+    /* whitespace and comments */
+    while (p < end)
+    {
+        if (tokclass[*p] == SPACE)
+            ++p;
+        else if (*p == '%')
+        {
+            const unsigned char *nl, *ff;
+            nl = memchr(p, '\n', end - p);
+            ff = memchr(p, '\f', (nl ? nl : end) - p);
+            q = ff ? ff : nl;
+            if (!q)
+            {
+                if (!sp.final)
+                    goto fallback;
+                p = end;
+                break;
+            }
+            p = q + 1;
+        }
+        else
+            break;
+    }
+    if (p == end)
+    {
+        spans->skip(ctx, src, p - sp.ptr);
+        if (!sp.final)
+            return -1;
+        *retval = null;
+        return 0;
+    }
+
+    switch (tokclass[*p])
+    {
+        case REG:
+            q = span_regular(p, end);
+            if (q == end && !sp.final)
+                goto fallback;
+            n = q - p;
+            if (n >= NBUF - 1)
+                goto fallback;
+            memcpy(buf, p, n);
+            buf[n] = '\0';
+            if (q < end && tokclass[*q] == SPACE)
+                ++q; /* the delimiting space is consumed, as in puff */
+            spans->skip(ctx, src, q - sp.ptr);
+            return grok_span(ctx, buf, (int)n, src, next, back, spans, retval);
+
+        case DEL:
+            switch (*p)
+            {
+                case '[': case ']': case '}':
+                    buf[0] = *p;
+                    buf[1] = '\0';
+                    spans->skip(ctx, src, p + 1 - sp.ptr);
+                    *retval = xpost_object_cvx(xpost_name_cons(ctx, buf));
+                    return 0;
+
+                case '/':
+                    if (end - p < 2 || tokclass[p[1]] != REG)
+                        goto fallback; /* //immediate, or empty name */
+                    q = span_regular(p + 1, end);
+                    if (q == end && !sp.final)
+                        goto fallback;
+                    n = q - (p + 1);
+                    if (n >= NBUF - 1)
+                        goto fallback;
+                    memcpy(buf, p + 1, n);
+                    buf[n] = '\0';
+                    if (q < end && tokclass[*q] == SPACE)
+                        ++q;
+                    spans->skip(ctx, src, q - sp.ptr);
+                    *retval = xpost_object_cvlit(xpost_name_cons(ctx, buf));
+                    return 0;
+
+                case '(':
+                {
+                    Xpost_Object obj;
+                    /* only a string without escapes or nested parens */
+                    q = span_string(p + 1, end);
+                    if (q == end || *q != ')')
+                        goto fallback;
+                    n = q - (p + 1);
+                    if (n >= NBUF)
+                        goto fallback;
+                    memcpy(buf, p + 1, n);
+                    spans->skip(ctx, src, q + 1 - sp.ptr);
+                    obj = xpost_string_cons(ctx, n, buf);
+                    if (xpost_object_get_type(obj) == nulltype)
+                        return VMerror;
+                    *retval = xpost_object_cvlit(obj);
+                    return 0;
+                }
+
+                case '<':
+                {
+                    Xpost_Object obj;
+                    int hi, lo;
+                    if (end - p < 2)
+                        goto fallback;
+                    if (p[1] == '<')
+                    {
+                        spans->skip(ctx, src, p + 2 - sp.ptr);
+                        *retval = xpost_object_cvx(xpost_name_cons(ctx, "<<"));
+                        return 0;
+                    }
+                    n = 0;
+                    q = p + 1;
+                    for (;;)
+                    {
+                        while (q < end && tokclass[*q] == SPACE)
+                            ++q;
+                        if (q == end)
+                            goto fallback;
+                        if (*q == '>')
+                            break;
+                        if ((hi = hexval(*q++)) < 0)
+                            goto fallback; /* let the scanner report it */
+                        while (q < end && tokclass[*q] == SPACE)
+                            ++q;
+                        if (q == end)
+                            goto fallback;
+                        if (*q == '>')
+                            lo = 0;
+                        else if ((lo = hexval(*q++)) < 0)
+                            goto fallback;
+                        if (n >= NBUF)
+                            goto fallback;
+                        buf[n++] = (char)(hi << 4 | lo);
+                    }
+                    spans->skip(ctx, src, q + 1 - sp.ptr);
+                    obj = xpost_string_cons(ctx, n, buf);
+                    if (xpost_object_get_type(obj) == nulltype)
+                        return VMerror;
+                    *retval = xpost_object_cvlit(obj);
+                    return 0;
+                }
+
+                case '>':
+                    if (end - p < 2 || p[1] != '>')
+                        goto fallback;
+                    spans->skip(ctx, src, p + 2 - sp.ptr);
+                    *retval = xpost_object_cvx(xpost_name_cons(ctx, ">>"));
+                    return 0;
+            }
+            break;
+    }
+
+fallback:
+    spans->skip(ctx, src, p - sp.ptr);
+    return -1;
+}
+
 static
 int toke(Xpost_Context *ctx,
-         Xpost_Object *src,
-         int (*next)(Xpost_Context *ctx, Xpost_Object *src),
-         void (*back)(Xpost_Context *ctx, int c, Xpost_Object *src),
+         void *src,
+         int (*next)(Xpost_Context *ctx, void *src),
+         void (*back)(Xpost_Context *ctx, int c, void *src),
+         const span_methods *spans,
          Xpost_Object *retval)
 {
     char buf[NBUF] = "";
@@ -540,6 +879,13 @@ int toke(Xpost_Context *ctx,
         return unregistered;
     }
 
+    if (spans)
+    {
+        ret = toke_span(ctx, src, next, back, spans, retval);
+        if (ret != -1)
+            return ret;
+    }
+
     sta = snip(ctx, buf, src, next);
     if (!sta)
     {
@@ -548,7 +894,7 @@ int toke(Xpost_Context *ctx,
     }
     if (!isdel(*buf))
         sta += puff(ctx, buf + 1, NBUF - 1, src, next, back);
-    ret = grok(ctx, buf, sta, src, next, back, &o);
+    ret = grok(ctx, buf, sta, src, next, back, spans, &o);
     if (ret)
         return ret;
     *retval = o;
@@ -561,29 +907,78 @@ int toke(Xpost_Context *ctx,
    read token from file */
 static
 int Fnext(Xpost_Context *ctx,
-          Xpost_Object *F)
+          void *src)
 {
-    return xpost_file_getc(xpost_file_get_file_pointer(ctx->lo, *F));
+    (void)ctx;
+    return xpost_file_getc(src);
 }
 static
 void Fback(Xpost_Context *ctx,
            int c,
-           Xpost_Object *F)
+           void *src)
 {
-    (void)xpost_file_ungetc(xpost_file_get_file_pointer(ctx->lo, *F), c);
+    (void)ctx;
+    (void)xpost_file_ungetc(src, c);
+}
+static
+int Fpeek(Xpost_Context *ctx,
+          void *src,
+          span *sp)
+{
+    (void)ctx;
+    return xpost_file_peek(src, &sp->ptr, &sp->len, &sp->final);
+}
+static
+void Fskip(Xpost_Context *ctx,
+           void *src,
+           size_t n)
+{
+    (void)ctx;
+    xpost_file_skip(src, n);
+}
+static const span_methods Fspans = { Fpeek, Fskip };
+
+/* a file whose contents are in memory (a mapped disk file
+   or a wrapped buffer) is scanned directly, without the
+   per-character method call. */
+static
+int Mnext(Xpost_Context *ctx,
+          void *src)
+{
+    Xpost_MemoryFile *mf = src;
+    (void)ctx;
+    if (mf->read_next == mf->read_limit) return EOF;
+    return mf->contents[ mf->read_next++ ];
+}
+static
+void Mback(Xpost_Context *ctx,
+           int c,
+           void *src)
+{
+    Xpost_MemoryFile *mf = src;
+    (void)ctx;
+    (void)c;
+    if (mf->read_next) --mf->read_next;
 }
 static
 int Ftoken(Xpost_Context *ctx,
            Xpost_Object F)
 {
     Xpost_Object t;
+    Xpost_File *fp;
+    Xpost_MemoryFile *mf;
     int ret;
 
     xpost_stack_push(ctx->lo, ctx->hold, F);
 
-    if (!xpost_file_get_status(ctx->lo, F))
+    fp = xpost_file_get_file_pointer(ctx->lo, F);
+    if (!fp)
         return ioerror;
-    ret = toke(ctx, &F, Fnext, Fback, &t);
+    mf = xpost_file_get_read_buffer(fp);
+    if (mf)
+        ret = toke(ctx, mf, Mnext, Mback, &Fspans, &t);
+    else
+        ret = toke(ctx, fp, Fnext, Fback, &Fspans, &t);
     if (ret)
         return ret;
     if (xpost_object_get_type(t) != nulltype)
@@ -603,8 +998,9 @@ int Ftoken(Xpost_Context *ctx,
    read token from string */
 static
 int Snext(Xpost_Context *ctx,
-          Xpost_Object *S)
+          void *src)
 {
+    Xpost_Object *S = src;
     int ret;
     if (S->comp_.sz == 0) return EOF;
     ret = xpost_string_get_pointer(ctx, *S)[0];
@@ -615,13 +1011,36 @@ int Snext(Xpost_Context *ctx,
 static
 void Sback(Xpost_Context *ctx,
            int c,
-           Xpost_Object *S)
+           void *src)
 {
+    Xpost_Object *S = src;
     --S->comp_.off;
     ++S->comp_.sz;
     xpost_string_get_pointer(ctx, *S)[0] = c;
 }
 static
+int Speek(Xpost_Context *ctx,
+          void *src,
+          span *sp)
+{
+    Xpost_Object *S = src;
+    sp->ptr = (unsigned char *)xpost_string_get_pointer(ctx, *S);
+    sp->len = S->comp_.sz;
+    sp->final = 1;
+    return sp->ptr != NULL;
+}
+static
+void Sskip(Xpost_Context *ctx,
+           void *src,
+           size_t n)
+{
+    Xpost_Object *S = src;
+    (void)ctx;
+    S->comp_.off += n;
+    S->comp_.sz -= n;
+}
+static const span_methods Sspans = { Speek, Sskip };
+static
 int Stoken(Xpost_Context *ctx,
            Xpost_Object S)
 {
@@ -630,7 +1049,7 @@ int Stoken(Xpost_Context *ctx,
 
     xpost_stack_push(ctx->lo, ctx->hold, S);
 
-    ret = toke(ctx, &S, Snext, Sback, &t);
+    ret = toke(ctx, &S, Snext, Sback, &Sspans, &t);
     if (ret)
         return ret;
     if (xpost_object_get_type(t) != nulltype)
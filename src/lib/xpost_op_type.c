@@ -233,13 +233,9 @@ static
 int Scvn(Xpost_Context *ctx,
          Xpost_Object s)
 {
-    char *t;
     Xpost_Object name;
 
-    t = alloca(s.comp_.sz+1);
-    memcpy(t, xpost_string_get_pointer(ctx, s), s.comp_.sz);
-    t[s.comp_.sz] = '\0';
-    name = xpost_name_cons(ctx, t);
+    name = xpost_name_cons_bytes(ctx, xpost_string_get_pointer(ctx, s), s.comp_.sz);
     if (xpost_object_get_type(name) == invalidtype)
         return VMerror;
     if (xpost_object_is_exe(s))
@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h> /* uintptr_t */
 #include <stdlib.h> /* NULL */
 #include <string.h> /* memcpy */
 
@@ -67,7 +68,6 @@ Xpost_Object _promote_integer_to_real(Xpost_Object o)
    int (*fp)(Xpost_Context *ctx);
    int in;
    unsigned t;
-   int (*checkstack)(Xpost_Context *ctx);
    int out;
    } Xpost_Signature;
 
@@ -83,220 +83,133 @@ Xpost_Object _promote_integer_to_real(Xpost_Object o)
    #define MAXOPS 20
 */
 
-/* the number of ops, at any given time. */
-static
-int _xpost_noops = 0;
+/* type-mask bit of an object type */
+#define TYPEBIT(type) (1U << (type))
 
-static
-int _stack_none(Xpost_Context *ctx)
-{
-    (void)ctx;
-    return 0;
-}
+/* types which the garbage collector need not see on the hold stack */
+#define SIMPLEMASK (TYPEBIT(nulltype) | TYPEBIT(marktype) | \
+                    TYPEBIT(integertype) | TYPEBIT(realtype) | \
+                    TYPEBIT(operatortype) | TYPEBIT(nametype) | \
+                    TYPEBIT(booleantype) | TYPEBIT(extendedtype))
 
-static
-int _stack_int(Xpost_Context *ctx)
+/* native copy of a signature, checked by xpost_operator_exec
+   without going through vm. */
+typedef struct
 {
-    Xpost_Object s0;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
-    {
-        case invalidtype:
-            return stackunderflow;
-        case integertype:
-            return 0;
-        default:
-            return typecheck;
-    }
-}
-
-static
-int _stack_real(Xpost_Context *ctx)
+    Xpost_Op_Func fp;
+    int in;
+    unsigned int mask[XPOST_OPERATOR_MAX_ARGS]; /* accepted types, top of stack first */
+    unsigned int promote; /* bit j set: convert integer argument j to real */
+    unsigned int exec; /* bit j set: argument j must be executable */
+    int simple; /* no argument needs to be held for the garbage collector */
+} Xpost_Dispatch_Signature;
+
+typedef struct
 {
-    Xpost_Object s0;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
-    {
-        case invalidtype:
-            return stackunderflow;
-        case realtype:
-            return 0;
-        default:
-            return typecheck;
-    }
-}
-
-static
-int _stack_float(Xpost_Context *ctx)
+    int n;
+    int maxin; /* largest number of arguments of the signatures */
+    Xpost_Dispatch_Signature sig[XPOST_OPERATOR_MAX_SIGS];
+} Xpost_Dispatch;
+
+/* dispatch table of an interpreter instance, indexed by opcode.
+   filled by xpost_operator_cons along with the optab.
+   opcodes of the operators installed after initialization (by the
+   devices) depend on the order of installation, so each interpreter
+   has its own table, which its contexts share. */
+struct _Xpost_Operator_Dispatch
 {
-    Xpost_Object s0;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
-    {
-        case invalidtype:
-            return stackunderflow;
-        case integertype:
-            xpost_stack_topdown_replace(ctx->lo, ctx->os, 0, s0 = _promote_integer_to_real(s0));
-        case realtype:
-            return 0;
-        default:
-            return typecheck;
-    }
-}
+    int noops; /* the number of ops, at any given time. */
+    Xpost_Dispatch op[MAXOPS];
+};
 
+/* fill the native copy of signature si of an operator
+   from its vm type pattern */
 static
-int _stack_any(Xpost_Context *ctx)
+void _xpost_dispatch_set(Xpost_Context *ctx,
+                         unsigned opcode,
+                         unsigned si,
+                         Xpost_Op_Func fp,
+                         int in,
+                         const byte *t)
 {
-    if (xpost_stack_count(ctx->lo, ctx->os) >= 1)
-        return 0;
-    return stackunderflow;
-}
+    Xpost_Dispatch *op = &ctx->dispatch->op[opcode];
+    Xpost_Dispatch_Signature *sig = &op->sig[si];
+    int j;
 
-static
-int _stack_bool_bool(Xpost_Context *ctx)
-{
-    Xpost_Object s0, s1;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
+    sig->fp = fp;
+    sig->in = in;
+    sig->promote = 0;
+    sig->exec = 0;
+    sig->simple = 1;
+    for (j = 0; j < in; j++)
     {
-        case invalidtype:
-            return stackunderflow;
-        case booleantype:
-            s1 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 1);
-            switch(xpost_object_get_type(s1))
-            {
-                case invalidtype:
-                    return stackunderflow;
-                case booleantype:
-                    return 0;
-                default:
-                    return typecheck;
-            }
-        default:
-            return typecheck;
+        switch (t[j])
+        {
+            case anytype:
+                sig->mask[j] = ~0U;
+                break;
+            case floattype:
+                sig->mask[j] = TYPEBIT(integertype) | TYPEBIT(realtype);
+                sig->promote |= 1U << j;
+                break;
+            case numbertype:
+                sig->mask[j] = TYPEBIT(integertype) | TYPEBIT(realtype);
+                break;
+            case proctype:
+                sig->mask[j] = TYPEBIT(arraytype);
+                sig->exec |= 1U << j;
+                break;
+            default:
+                sig->mask[j] = TYPEBIT(t[j]);
+                break;
+        }
+        if (sig->mask[j] & ~SIMPLEMASK)
+            sig->simple = 0;
     }
+    if (op->n <= (int)si)
+        op->n = si + 1;
+    if (op->maxin < in)
+        op->maxin = in;
 }
 
+/* check the arguments below top against a signature */
 static
-int _stack_int_int(Xpost_Context *ctx)
+int _xpost_dispatch_match(const Xpost_Dispatch_Signature *sig,
+                          const Xpost_Object *top)
 {
-    Xpost_Object s0, s1;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
-    {
-        case invalidtype:
-            return stackunderflow;
-        case integertype:
-            s1 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 1);
-            switch(xpost_object_get_type(s1))
-            {
-                case invalidtype:
-                    return stackunderflow;
-                case integertype:
-                    return 0;
-                default:
-                    return typecheck;
-            }
-        default:
-            return typecheck;
-    }
-}
+    int j;
 
-static
-int _stack_float_float(Xpost_Context *ctx)
-{
-    Xpost_Object s0, s1;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
+    for (j = 0; j < sig->in; j++)
     {
-        case invalidtype:
-            return stackunderflow;
-        case integertype:
-            xpost_stack_topdown_replace(ctx->lo, ctx->os, 0, s0 = _promote_integer_to_real(s0));
-        case realtype:
-            s1 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 1);
-            switch(xpost_object_get_type(s1))
-            {
-                case invalidtype:
-                    return stackunderflow;
-                case integertype:
-                    xpost_stack_topdown_replace(ctx->lo, ctx->os, 1, s1 = _promote_integer_to_real(s1));
-                case realtype:
-                    return 0;
-                default:
-                    return typecheck;
-            }
-        default:
-            return typecheck;
-    }
-}
+        Xpost_Object el = top[-1 - j];
 
-static
-int _stack_number_number(Xpost_Context *ctx)
-{
-    Xpost_Object s0, s1;
-    s0 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 0);
-    switch(xpost_object_get_type(s0))
-    {
-        case invalidtype:
-            return stackunderflow;
-        case integertype: /* fallthrough */
-        case realtype:
-            s1 = xpost_stack_topdown_fetch(ctx->lo, ctx->os, 1);
-            switch(xpost_object_get_type(s1))
-            {
-                case invalidtype:
-                    return stackunderflow;
-                case integertype: /* fallthrough */
-                case realtype:
-                    return 0;
-                default:
-                    return typecheck;
-            }
-        default:
-            return typecheck;
+        if (!(sig->mask[j] & TYPEBIT(el.tag & XPOST_OBJECT_TAG_DATA_TYPE_MASK)))
+            return 0;
+        if ((sig->exec & (1U << j)) && !xpost_object_is_exe(el))
+            return 0;
     }
+    return 1;
 }
 
-static
-int _stack_any_any(Xpost_Context *ctx)
-{
-    if (xpost_stack_count(ctx->lo, ctx->os) >= 2)
-        return 0;
-    return stackunderflow;
-}
-
-typedef struct {
-    int (*checkstack)(Xpost_Context *ctx);
-    int n;
-    int t[8];
-} Xpost_Check_Stack;
-
-static
-Xpost_Check_Stack _check_stack_funcs[] = {
-    { _stack_none, 0, { 0, 0, 0, 0, 0, 0, 0, 0} },
-    { _stack_int, 1, { integertype } },
-    { _stack_real, 1, { realtype } },
-    { _stack_float, 1, { floattype } },
-    { _stack_any, 1, { anytype } },
-    { _stack_bool_bool, 2, { booleantype, booleantype } },
-    { _stack_int_int, 2, { integertype, integertype } },
-    { _stack_float_float, 2, { floattype, floattype } },
-    { _stack_number_number, 2, { numbertype, numbertype } },
-    { _stack_any_any, 2, { anytype, anytype } }
-};
-
-
-/* allocate the OPTAB structure in VM */
+/* allocate the OPTAB structure in VM
+   and the dispatch table of the interpreter */
 int xpost_operator_init_optab(Xpost_Context *ctx)
 {
     unsigned ent;
     Xpost_Memory_Table *tab;
     int ret;
 
+    ctx->dispatch = calloc(1, sizeof *ctx->dispatch);
+    if (!ctx->dispatch)
+    {
+        XPOST_LOG_ERR("cannot allocate dispatch table");
+        return 0;
+    }
     ret = xpost_memory_table_alloc(ctx->gl, MAXOPS * sizeof(Xpost_Operator), 0, &ent);
     if (!ret)
     {
+        free(ctx->dispatch);
+        ctx->dispatch = NULL;
         return 0;
     }
     tab = &ctx->gl->table;
@@ -307,6 +220,13 @@ int xpost_operator_init_optab(Xpost_Context *ctx)
     return 1;
 }
 
+/* free the dispatch table */
+void xpost_operator_exit_optab(Xpost_Context *ctx)
+{
+    free(ctx->dispatch);
+    ctx->dispatch = NULL;
+}
+
 /* print a dump of the operator struct given opcode */
 void xpost_operator_dump(Xpost_Context *ctx,
                          int opcode)
@@ -344,7 +264,7 @@ Xpost_Object xpost_operator_cons_opcode(int opcode)
     op.mark_.tag = operatortype;
     op.mark_.pad0 = 0;
     op.mark_.padw = opcode;
-    if (opcode >= _xpost_noops)
+    if (opcode < 0 || opcode >= MAXOPS)
     {
         XPOST_LOG_ERR("opcode does not index a valid operator");
         return null;
@@ -376,7 +296,9 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
     Xpost_Signature *sp;
     Xpost_Operator *optab;
     Xpost_Operator  op;
+    byte types[XPOST_OPERATOR_MAX_ARGS];
     unsigned int optadr;
+    int noops = ctx->dispatch->noops;
     int ret;
 
     //fprintf(stderr, "name: %s\n", name);
@@ -391,13 +313,20 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
     }
     optab = (void *)(ctx->gl->base + optadr);
 
-    if (!(in < XPOST_STACK_SEGMENT_SIZE))
+    if (!(in <= XPOST_OPERATOR_MAX_ARGS))
     {
-        printf("!(in < XPOST_STACK_SEGMENT_SIZE) in xpost_operator_cons(%s, %d. %d)\n", name, out, in);
-        fprintf(stderr, "!(in < XPOST_STACK_SEGMENT_SIZE) in xpost_operator_cons(%s, %d. %d)\n", name, out, in);
+        printf("!(in <= XPOST_OPERATOR_MAX_ARGS) in xpost_operator_cons(%s, %d. %d)\n", name, out, in);
+        fprintf(stderr, "!(in <= XPOST_OPERATOR_MAX_ARGS) in xpost_operator_cons(%s, %d. %d)\n", name, out, in);
         exit(EXIT_FAILURE);
     }
-    //assert(in < XPOST_STACK_SEGMENT_SIZE); // or else xpost_operator_exec can't call it using HOLD
+    {
+        va_list args;
+        va_start(args, in);
+        for (i = in-1; i >= 0; i--) {
+            types[i] = va_arg(args, int);
+        }
+        va_end(args);
+    }
 
     vmmode=ctx->vmmode;
     ctx->vmmode = GLOBAL;
@@ -409,16 +338,16 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
     optab = (void *)(ctx->gl->base + optadr);
     for (opcode = 0; optab[opcode].name != nm.mark_.padw; opcode++)
     {
-        if (opcode == _xpost_noops) break;
+        if (opcode == noops) break;
     }
 
     /* install a new signature (prototype) */
     if (fp)
     {
-        if (opcode == _xpost_noops)
+        if (opcode == noops)
         { /* a new operator */
             unsigned adr;
-            if (_xpost_noops == MAXOPS-1)
+            if (noops == MAXOPS-1)
             {
                 XPOST_LOG_ERR("optab too small in xpost_operator.h");
                 XPOST_LOG_ERR("operator %s NOT installed", name);
@@ -435,11 +364,31 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
             op.n = 1;
             op.sigadr = adr;
             optab[opcode] = op;
-            ++_xpost_noops;
+            ++ctx->dispatch->noops;
             si = 0;
         }
         else
-        { /* increase sig table by 1 */
+        {
+            /* a signature already installed, eg. by a device loaded
+               again after a restore, is not added twice */
+            sp = (void *)(ctx->gl->base + optab[opcode].sigadr);
+            for (si = 0; si < (unsigned)optab[opcode].n; si++)
+            {
+                if (sp[si].fp == (int(*)(Xpost_Context *))fp &&
+                    sp[si].in == in && sp[si].out == out &&
+                    memcmp(ctx->gl->base + sp[si].t, types, in) == 0)
+                {
+                    goto done;
+                }
+            }
+
+            /* increase sig table by 1 */
+            if (optab[opcode].n == XPOST_OPERATOR_MAX_SIGS)
+            {
+                XPOST_LOG_ERR("too many signatures, see XPOST_OPERATOR_MAX_SIGS");
+                XPOST_LOG_ERR("operator %s NOT installed", name);
+                return null;
+            }
             t = xpost_free_realloc(ctx->gl,
                                    optab[opcode].sigadr,
                                    optab[opcode].n * sizeof(Xpost_Signature),
@@ -470,57 +419,55 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
             sp[si].t = ad;
         }
         {
-            va_list args;
             byte *b = (void *)(ctx->gl->base + sp[si].t);
-            va_start(args, in);
-            for (i = in-1; i >= 0; i--) {
-                b[i] = va_arg(args, int);
-            }
-            va_end(args);
+            memcpy(b, types, in);
             sp[si].in = in;
             sp[si].out = out;
             sp[si].fp = (int(*)(Xpost_Context *))fp;
-            sp[si].checkstack = NULL;
-            {
-                int j;
-                int k;
-                int pass;
-                for (j = 0; j < (int)(sizeof _check_stack_funcs/sizeof*_check_stack_funcs); j++)
-                {
-                    if (_check_stack_funcs[j].n == sp[si].in)
-                    {
-                        pass = 1;
-                        for (k=0; k < _check_stack_funcs[j].n; k++)
-                        {
-                            if (b[k] != _check_stack_funcs[j].t[k])
-                            {
-                                pass = 0;
-                                break;
-                            }
-                        }
-                        if (pass)
-                        {
-                            sp[si].checkstack = _check_stack_funcs[j].checkstack;
-                            break;
-                        }
-                    }
-                }
-            }
-            //sp[si].checkstack = NULL;
+            _xpost_dispatch_set(ctx, opcode, si, fp, in, b);
         }
     }
-    else if (opcode == _xpost_noops)
+    else if (opcode == noops)
     {
         XPOST_LOG_ERR("operator not found");
         return null;
     }
 
+done:
     o.tag = operatortype;
     o.mark_.padw = opcode;
     return o;
 }
 
-/* clear hold and pop n objects from opstack to hold stack.
+/* rewrite the function pointers of the signatures in vm from the
+   dispatch table, which the C initialization has filled.
+   the ones in a vm image are those of the process which wrote it. */
+void xpost_operator_relink(Xpost_Context *ctx)
+{
+    Xpost_Operator *optab;
+    Xpost_Signature *sp;
+    unsigned int optadr;
+    int opcode;
+    int si;
+
+    if (!xpost_memory_table_get_addr(ctx->gl,
+                                     XPOST_MEMORY_TABLE_SPECIAL_OPERATOR_TABLE, &optadr))
+    {
+        XPOST_LOG_ERR("cannot load optab!");
+        return;
+    }
+    optab = (void *)(ctx->gl->base + optadr);
+    for (opcode = 0; opcode < ctx->dispatch->noops; opcode++)
+    {
+        const Xpost_Dispatch *op = &ctx->dispatch->op[opcode];
+
+        sp = (void *)(ctx->gl->base + optab[opcode].sigadr);
+        for (si = 0; si < optab[opcode].n && si < op->n; si++)
+            sp[si].fp = op->sig[si].fp;
+    }
+}
+
+/* clear hold and copy the n arguments of an operator to the hold stack.
    The hold stack is used as temporary storage to hold the
    arguments for an operator-function call.
    If the operator-function does not itself call xpost_operator_exec,
@@ -539,22 +486,15 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
 */
 static
 void _xpost_operator_push_args_to_hold(Xpost_Context *ctx,
-                                       Xpost_Memory_File *mem,
-                                       unsigned stacadr,
+                                       const Xpost_Object *args,
                                        int n)
 {
     int j;
 
-    assert(n < XPOST_MEMORY_TABLE_SIZE);
     xpost_stack_clear(ctx->lo, ctx->hold);
-    for (j = n; j--;)
-    {  /* copy */
-        xpost_stack_push(ctx->lo, ctx->hold,
-                         xpost_stack_topdown_fetch(mem, stacadr, j));
-    }
-    for (j = n; j--;)
-    {  /* pop */
-        (void)xpost_stack_pop(mem, stacadr);
+    for (j = 0; j < n; j++)
+    {
+        xpost_stack_push(ctx->lo, ctx->hold, args[j]);
     }
 }
 
@@ -564,92 +504,52 @@ void _xpost_operator_push_args_to_hold(Xpost_Context *ctx,
 int xpost_operator_exec(Xpost_Context *ctx,
                         unsigned opcode)
 {
-    Xpost_Operator *optab;
-    Xpost_Operator op;
-    Xpost_Signature *sp;
+    const Xpost_Dispatch *op;
+    const Xpost_Dispatch_Signature *sig;
+    Xpost_Object args[XPOST_OPERATOR_MAX_ARGS];
+    Xpost_Object *top;
+    Xpost_Stack *s;
+    int avail;
     int i,j;
-    int pass;
+    int n;
     int err = unregistered;
-    Xpost_Stack *hold;
-    int ct;
-    unsigned int optadr;
     int ret;
 
-    ret = xpost_memory_table_get_addr(ctx->gl,
-                                      XPOST_MEMORY_TABLE_SPECIAL_OPERATOR_TABLE, &optadr);
-    if (!ret)
-    {
-        XPOST_LOG_ERR("cannot load optab!");
-        return VMerror;
-    }
-    optab = (void *)(ctx->gl->base + optadr);
-    op = optab[opcode];
-    sp = (void *)(ctx->gl->base + op.sigadr);
-
-    ct = xpost_stack_count(ctx->lo, ctx->os);
-    if (op.n == 0)
+    op = &ctx->dispatch->op[opcode];
+    if (op->n == 0)
     {
         XPOST_LOG_ERR("operator has no signatures");
         return unregistered;
     }
-    for (i =0 ; i < op.n; i++)
-    { /* try each signature */
-        byte *t;
 
-        /* call signature's stack-checking proc, if available */
-        if (sp[i].checkstack)
-        {
-            if ((ret = sp[i].checkstack(ctx)))
-            {
-                err = ret;
-                continue;
-            }
-            goto call;
-        }
+    /* find the arguments. usually they all are in the top segment
+       of the operand stack and are checked in place. */
+    s = xpost_stack_top_segment(ctx->lo, ctx->os);
+    if ((int)s->top >= op->maxin)
+    {
+        top = s->data + s->top;
+        avail = s->top;
+    }
+    else
+    {
+        avail = xpost_stack_count(ctx->lo, ctx->os);
+        n = avail < op->maxin ? avail : op->maxin;
+        for (j = 0; j < n; j++)
+            args[n - 1 - j] = xpost_stack_topdown_fetch(ctx->lo, ctx->os, j);
+        top = args + n;
+    }
 
-        /* check stack size */
-        if (ct < sp[i].in)
+    for (i = 0; i < op->n; i++)
+    { /* try each signature */
+        sig = &op->sig[i];
+        if (avail < sig->in)
         {
-            pass = 0;
             err = stackunderflow;
             continue;
         }
-
-        /* check type-pattern against stack */
-        pass = 1;
-        t = (void *)(ctx->gl->base + sp[i].t);
-        for (j=0; j < sp[i].in; j++)
-        {
-            Xpost_Object el = xpost_stack_topdown_fetch(ctx->lo, ctx->os, j);
-            if (t[j] == anytype)
-                continue;
-            if (t[j] == xpost_object_get_type(el))
-                continue;
-            if ((t[j] == numbertype) &&
-                (((xpost_object_get_type(el) == integertype) ||
-                  (xpost_object_get_type(el) == realtype))))
-                continue;
-            if (t[j] == floattype)
-            {
-                if (xpost_object_get_type(el) == integertype)
-                {
-                    if (!xpost_stack_topdown_replace(ctx->lo, ctx->os, j, el = _promote_integer_to_real(el)))
-                        return unregistered;
-                    continue;
-                }
-                if (xpost_object_get_type(el) == realtype)
-                    continue;
-            }
-            if ((t[j] == proctype) &&
-                (xpost_object_get_type(el) == arraytype) &&
-                xpost_object_is_exe(el))
-                continue;
-            pass = 0;
-            err = typecheck;
-            break;
-        }
-
-        if (pass) goto call;
+        if (_xpost_dispatch_match(sig, top))
+            goto call;
+        err = typecheck;
     }
     return err;
 
@@ -663,7 +563,7 @@ int xpost_operator_exec(Xpost_Context *ctx,
     if ((ctx->currentobject.tag == operatortype) &&
         (ctx->currentobject.mark_.padw == opcode))
     {
-        ctx->currentobject.mark_.pad0 = sp[i].in;
+        ctx->currentobject.mark_.pad0 = sig->in;
         ctx->currentobject.tag |= XPOST_OBJECT_TAG_DATA_FLAG_OPARGSINHOLD;
     }
     else
@@ -675,42 +575,61 @@ int xpost_operator_exec(Xpost_Context *ctx,
         ctx->currentobject.tag &= ~XPOST_OBJECT_TAG_DATA_FLAG_OPARGSINHOLD;
     }
 
-    _xpost_operator_push_args_to_hold(ctx, ctx->lo, ctx->os, sp[i].in);
-    hold = (void *)(ctx->lo->base + ctx->hold);
+    /* take the arguments off the stack, bottom first */
+    n = sig->in;
+    for (j = 0; j < n; j++)
+        args[j] = top[j - n];
+    xpost_stack_discard(ctx->lo, ctx->os, n);
+    for (j = 0; j < n; j++)
+        if ((sig->promote & (1U << (n - 1 - j))) &&
+            xpost_object_get_type(args[j]) == integertype)
+            args[j] = _promote_integer_to_real(args[j]);
+
+    /* simple arguments need no protection from the garbage collector,
+       so they are only copied to hold if the operator fails */
+    if (sig->simple)
+        xpost_stack_clear(ctx->lo, ctx->hold);
+    else
+        _xpost_operator_push_args_to_hold(ctx, args, n);
 
-    switch(sp[i].in)
+    switch(n)
     {
         case 0:
-            ret = sp[i].fp(ctx); break;
+            ret = sig->fp(ctx); break;
         case 1:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object))sig->fp)
+                (ctx, args[0]); break;
         case 2:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1]); break;
         case 3:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2]); break;
         case 4:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2], hold->data[3]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2], args[3]); break;
         case 5:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2], hold->data[3], hold->data[4]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2], args[3], args[4]); break;
         case 6:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2], hold->data[3], hold->data[4], hold->data[5]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2], args[3], args[4], args[5]); break;
         case 7:
-            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2], hold->data[3], hold->data[4], hold->data[5], hold->data[6]); break;
+            ret = ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2], args[3], args[4], args[5], args[6]); break;
         case 8:
             ret =
-                ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sp[i].fp)
-                (ctx, hold->data[0], hold->data[1], hold->data[2], hold->data[3], hold->data[4], hold->data[5], hold->data[6], hold->data[7]); break;
+                ((int(*)(Xpost_Context*,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object,Xpost_Object))sig->fp)
+                (ctx, args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7]); break;
         default:
             ret = unregistered;
     }
     if (ret)
+    {
+        if (sig->simple &&
+            (ctx->currentobject.tag & XPOST_OBJECT_TAG_DATA_FLAG_OPARGSINHOLD))
+            _xpost_operator_push_args_to_hold(ctx, args, n);
         return ret;
+    }
     return 0;
 }
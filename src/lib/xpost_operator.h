@@ -54,10 +54,11 @@
  *
  * ----
  * To speed-up typechecks,
- * a `int (*check)()` function pointer is added to the signature
- * which directly implements the stack-checking performed by
- * xpost_operator_exec (but without the nasty loops).
- * xpost_operator_exec would then call op.sig[i].check() if not null.
+ * xpost_operator_cons also copies each signature into a native
+ * dispatch table indexed by opcode, with the type pattern turned
+ * into a mask of accepted types per argument.
+ * xpost_operator_exec checks the masks against the top of the
+ * operand stack segment in place, without going through vm.
  *
  * @{
  */
@@ -70,15 +71,13 @@ typedef int (*Xpost_Op_Func)(Xpost_Context *ctx);
 /**
  * @brief operator signature structure
  *
- * A signature contains a stack-pattern, an optional stack-checking
- * function, and an operator function.
+ * A signature contains a stack-pattern and an operator function.
  */
 typedef struct Xpost_Signature
 {
     Xpost_Op_Func fp;  /* function-pointer which implements the operator action */
     int in;       /* number of argument objects */
     unsigned t;   /* memory address of array of ints representing argument types */
-    int (*checkstack)(Xpost_Context *ctx);  /* stack-checking function to bypass generic type-check loop */
     int out;      /* number of output objects */
 } Xpost_Signature;
 
@@ -118,6 +117,16 @@ enum typepat
  */
 #define MAXOPS 250
 
+/**
+ * @brief largest number of arguments of an operator signature
+ */
+#define XPOST_OPERATOR_MAX_ARGS 8
+
+/**
+ * @brief largest number of signatures of an operator
+ */
+#define XPOST_OPERATOR_MAX_SIGS 8
+
 /**
  * @brief initial size of systemdict (which then grows, automatically)
  */
@@ -125,9 +134,15 @@ enum typepat
 
 /**
  * @brief allocate the optab structure
+ *        and the dispatch table of the interpreter
  */
 int xpost_operator_init_optab(Xpost_Context *ctx);
 
+/**
+ * @brief free the dispatch table of the interpreter
+ */
+void xpost_operator_exit_optab(Xpost_Context *ctx);
+
 /**
  * @brief output a text dump of the operator contents
  */
@@ -149,6 +164,12 @@ Xpost_Object xpost_operator_cons(Xpost_Context *ctx,
                                  int in,
                                  ...);
 
+/**
+ * @brief rewrite the function pointers of the signatures in vm
+ *        from the dispatch table, after vm was loaded from an image
+ */
+void xpost_operator_relink(Xpost_Context *ctx);
+
 /**
  * @brief execute an operator
  */
@@ -62,6 +62,8 @@
 #include "xpost_op_param.h"
 #include "xpost_op_matrix.h"
 #include "xpost_op_path.h"
+#include "xpost_op_gstate.h"
+#include "xpost_op_clip.h"
 #include "xpost_op_font.h"
 #include "xpost_op_context.h"
 #include "xpost_dev_generic.h"
@@ -115,6 +117,7 @@ int xpost_oplib_init_ops(Xpost_Context *ctx)
     }
     xpost_dict_put(ctx, sd, xpost_name_cons(ctx, "systemdict"), sd);
     xpost_stack_push(ctx->lo, ctx->ds, sd); // push systemdict on dictstack
+    xpost_context_load_cache_flush(ctx);
     ent = xpost_object_get_ent(sd);
     tab = &ctx->gl->table;
     tab->tab[ent].sz = 0; // make systemdict immune to collection
@@ -172,6 +175,8 @@ int xpost_oplib_init_ops(Xpost_Context *ctx)
     xpost_oper_init_param_ops(ctx, sd);
     xpost_oper_init_matrix_ops(ctx, sd);
     xpost_oper_init_path_ops (ctx, sd);
+    xpost_oper_init_gstate_ops(ctx, sd);
+    xpost_oper_init_clip_ops(ctx, sd);
     xpost_oper_init_font_ops(ctx, sd);
     xpost_oper_init_generic_device_ops(ctx, sd);
 #ifdef _WIN32
@@ -0,0 +1,325 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h> /* memcpy memset */
+
+#include "xpost.h"
+#include "xpost_log.h"
+#include "xpost_memory.h"  // paths live in mfile, accessed via mtab
+#include "xpost_object.h"  // paths are string objects
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_error.h"
+
+#include "xpost_path.h"
+
+/* the header of a path allocation, followed by the elements */
+typedef struct
+{
+    unsigned int used;  /* size of the elements */
+    unsigned int level; /* save level of the allocation, or XPOST_PATH_SHARED */
+    unsigned int start; /* offset of the move starting the last subpath */
+    unsigned int last;  /* offset of the last element */
+} Xpost_Path_Header;
+
+#define XPOST_PATH_SHARED 0xffffffffU
+
+/* size of the first allocation of a path, for about 20 lines */
+#define XPOST_PATH_INITIAL_SIZE 256
+
+/* size of an element with verb v */
+#define XPOST_PATH_ELEMENT_SIZE(v) \
+    (sizeof(unsigned int) + 2 * XPOST_PATH_POINTS(v) * sizeof(float))
+
+/* copy sz bytes at byte offset off of a path from or to buf */
+static
+int _xpost_path_access(Xpost_Memory_File *mem,
+                       unsigned int ent,
+                       unsigned int off,
+                       unsigned int sz,
+                       void *buf,
+                       int write)
+{
+    unsigned int adr;
+    unsigned int tsz;
+
+    if (!xpost_memory_table_get_addr(mem, ent, &adr) ||
+        !xpost_memory_table_get_size(mem, ent, &tsz) ||
+        off > tsz || sz > tsz - off)
+        return 0;
+    if (write)
+        memcpy(mem->base + adr + off, buf, sz);
+    else
+        memcpy(buf, mem->base + adr + off, sz);
+    return 1;
+}
+
+#define _xpost_path_read(mem, ent, off, sz, buf) \
+    _xpost_path_access(mem, ent, off, sz, buf, 0)
+#define _xpost_path_write(mem, ent, off, sz, buf) \
+    _xpost_path_access(mem, ent, off, sz, (void *)(buf), 1)
+
+/* the save level of a memory file */
+static
+unsigned int _xpost_path_level(Xpost_Memory_File *mem)
+{
+    unsigned int vs;
+
+    if (!xpost_memory_table_get_addr(mem,
+                                     XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK, &vs))
+        return 0;
+    return xpost_stack_count(mem, vs);
+}
+
+/* allocate a path of sz bytes in local vm, whatever the allocation
+   mode: a path appended in place after a save must be brought back
+   by the restore, and global vm is not restored */
+static
+Xpost_Object _xpost_path_alloc(Xpost_Context *ctx,
+                               unsigned int sz)
+{
+    unsigned int ent;
+    Xpost_Object o;
+
+    if (!xpost_memory_table_alloc(ctx->lo, sz, stringtype, &ent))
+    {
+        XPOST_LOG_ERR("cannot allocate path");
+        return null;
+    }
+    /* literal, no access: the contents are not chars */
+    o.tag = stringtype | XPOST_OBJECT_TAG_DATA_FLAG_LIT;
+    o.comp_.sz = 0;
+    o = xpost_object_set_ent(o, ent);
+    o.comp_.off = 0;
+    xpost_stack_push(ctx->lo, ctx->hold, o); /* in case of gc in caller */
+
+    return o;
+}
+
+/* load the header of a path, return 0 for the empty path */
+static
+int _xpost_path_get_header(Xpost_Context *ctx,
+                           Xpost_Object path,
+                           Xpost_Path_Header *h)
+{
+    if (xpost_object_get_type(path) != stringtype)
+        return 0;
+    if (!_xpost_path_read(xpost_context_select_memory(ctx, path),
+                          xpost_object_get_ent(path), 0, sizeof *h, h))
+    {
+        XPOST_LOG_ERR("cannot load path header");
+        return 0;
+    }
+    return 1;
+}
+
+int xpost_path_append(Xpost_Context *ctx,
+                      Xpost_Object *path,
+                      Xpost_Path_Verb verb,
+                      const float *pts)
+{
+    unsigned char elem[XPOST_PATH_ELEMENT_SIZE(XPOST_PATH_CURVE)];
+    Xpost_Memory_File *mem;
+    Xpost_Path_Header h;
+    unsigned int lastverb = XPOST_PATH_CLOSE;
+    unsigned int esz;
+    unsigned int off;
+    unsigned int used;
+    unsigned int sz = 0;
+    unsigned int ent = 0;
+    unsigned int v;
+    float start[2];
+
+    mem = NULL;
+    if (_xpost_path_get_header(ctx, *path, &h))
+    {
+        mem = xpost_context_select_memory(ctx, *path);
+        ent = xpost_object_get_ent(*path);
+        if (!_xpost_path_read(mem, ent, sizeof h + h.last,
+                              sizeof lastverb, &lastverb) ||
+            !xpost_memory_table_get_size(mem, ent, &sz))
+            return VMerror;
+    }
+    else
+    {
+        if (verb == XPOST_PATH_CLOSE)
+            return 0;
+        if (verb != XPOST_PATH_MOVE)
+            return nocurrentpoint;
+        memset(&h, 0, sizeof h);
+    }
+
+    if (verb == XPOST_PATH_CLOSE)
+    {
+        if (lastverb == XPOST_PATH_CLOSE)
+            return 0;
+        if (!_xpost_path_read(mem, ent, sizeof h + h.start + sizeof(unsigned int),
+                              sizeof start, start))
+            return VMerror;
+        pts = start;
+    }
+
+    /* a move following a move replaces it */
+    esz = XPOST_PATH_ELEMENT_SIZE(verb);
+    if (verb == XPOST_PATH_MOVE && h.used && lastverb == XPOST_PATH_MOVE)
+    {
+        off = h.last;
+        used = h.used;
+    }
+    else
+    {
+        off = h.used;
+        used = h.used + esz;
+        if (used < h.used || used > 0x7fffffffU)
+            return limitcheck;
+    }
+
+    /* copy a path which is shared, saved or full to a new allocation */
+    if (!mem || h.level != _xpost_path_level(mem) || sizeof h + used > sz)
+    {
+        Xpost_Object o;
+        Xpost_Memory_File *newmem;
+        unsigned int adr, newadr;
+        unsigned int newsz;
+
+        newsz = sz;
+        if (sizeof h + used > newsz)
+            newsz = sz < XPOST_PATH_INITIAL_SIZE / 2 ? XPOST_PATH_INITIAL_SIZE :
+                sz > 0x7fffffffU ? 0 : sz * 2;
+        if (newsz < sizeof h + used)
+            newsz = sizeof h + used;
+        o = _xpost_path_alloc(ctx, newsz);
+        if (xpost_object_get_type(o) == nulltype)
+            return VMerror;
+        newmem = xpost_context_select_memory(ctx, o);
+        if (mem && h.used)
+        {
+            if (!xpost_memory_table_get_addr(mem, ent, &adr) ||
+                !xpost_memory_table_get_addr(newmem, xpost_object_get_ent(o), &newadr))
+                return VMerror;
+            memcpy(newmem->base + newadr + sizeof h, mem->base + adr + sizeof h, h.used);
+        }
+        h.level = _xpost_path_level(newmem);
+        *path = o;
+        mem = newmem;
+        ent = xpost_object_get_ent(o);
+    }
+
+    v = verb;
+    memcpy(elem, &v, sizeof v);
+    memcpy(elem + sizeof v, pts, esz - sizeof v);
+    if (!_xpost_path_write(mem, ent, sizeof h + off, esz, elem))
+        return VMerror;
+    if (verb == XPOST_PATH_MOVE)
+        h.start = off;
+    h.last = off;
+    h.used = used;
+    if (!_xpost_path_write(mem, ent, 0, sizeof h, &h))
+        return VMerror;
+
+    return 0;
+}
+
+int xpost_path_share(Xpost_Context *ctx,
+                     Xpost_Object path)
+{
+    Xpost_Path_Header h;
+
+    if (!_xpost_path_get_header(ctx, path, &h))
+        return 0;
+    h.level = XPOST_PATH_SHARED;
+    if (!_xpost_path_write(xpost_context_select_memory(ctx, path),
+                           xpost_object_get_ent(path), 0, sizeof h, &h))
+        return VMerror;
+    return 0;
+}
+
+unsigned int xpost_path_length(Xpost_Context *ctx,
+                               Xpost_Object path)
+{
+    Xpost_Path_Header h;
+
+    if (!_xpost_path_get_header(ctx, path, &h))
+        return 0;
+    return h.used;
+}
+
+int xpost_path_get(Xpost_Context *ctx,
+                   Xpost_Object path,
+                   unsigned int *off,
+                   Xpost_Path_Verb *verb,
+                   float *pts)
+{
+    Xpost_Memory_File *mem;
+    unsigned int ent;
+    unsigned int v;
+
+    mem = xpost_context_select_memory(ctx, path);
+    ent = xpost_object_get_ent(path);
+    if (!_xpost_path_read(mem, ent, sizeof(Xpost_Path_Header) + *off, sizeof v, &v))
+        return rangecheck;
+    if (v > XPOST_PATH_CLOSE)
+    {
+        XPOST_LOG_ERR("bad verb %u in path", v);
+        return unregistered;
+    }
+    if (!_xpost_path_read(mem, ent, sizeof(Xpost_Path_Header) + *off + sizeof v,
+                          2 * XPOST_PATH_POINTS(v) * sizeof(float), pts))
+        return rangecheck;
+    *verb = v;
+    *off += XPOST_PATH_ELEMENT_SIZE(v);
+    return 0;
+}
+
+int xpost_path_current_point(Xpost_Context *ctx,
+                             Xpost_Object path,
+                             float *x,
+                             float *y)
+{
+    Xpost_Path_Header h;
+    Xpost_Path_Verb verb;
+    float pts[6];
+    unsigned int off;
+    int ret;
+
+    if (!_xpost_path_get_header(ctx, path, &h))
+        return nocurrentpoint;
+    off = h.last;
+    ret = xpost_path_get(ctx, path, &off, &verb, pts);
+    if (ret)
+        return ret;
+    *x = pts[2 * XPOST_PATH_POINTS(verb) - 2];
+    *y = pts[2 * XPOST_PATH_POINTS(verb) - 1];
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef XPOST_PATH_H
+#define XPOST_PATH_H
+
+/**
+ * @file xpost_path.h
+ * @brief path functions
+ *
+ * A path is an opaque string object: its allocation holds a header
+ * followed by the packed elements of the path, and its sz and off
+ * fields are unused. An element is a verb word followed by the float
+ * device coordinates of its points: one point for a move, a line or
+ * a close (the start of its subpath), three for a curve. A move
+ * always starts a new subpath, other elements append to the last one.
+ * The empty path is the null object, the path is allocated by its
+ * first move, always in local VM.
+ *
+ * Elements are appended in place, while the allocation has room,
+ * unless the path is shared or was allocated before the last save:
+ * then the path is copied, and the new path object is returned to
+ * the caller to store in place of the old one. A path must be shared
+ * with xpost_path_share() before it is referenced from a second
+ * place, as the other references would see the elements appended
+ * in place.
+ *
+ * @{
+ */
+
+/**
+ * @typedef Xpost_Path_Verb
+ * @brief the verb of a path element.
+ */
+typedef enum
+{
+    XPOST_PATH_MOVE,
+    XPOST_PATH_LINE,
+    XPOST_PATH_CURVE,
+    XPOST_PATH_CLOSE
+} Xpost_Path_Verb;
+
+/**
+ * @def XPOST_PATH_POINTS
+ * @brief Number of points of an element with verb @p verb.
+ */
+#define XPOST_PATH_POINTS(verb) ((verb) == XPOST_PATH_CURVE ? 3 : 1)
+
+/**
+ * @brief Append an element to a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in,out] path The path, replaced by its copy if it is copied.
+ * @param[in] verb The verb of the element.
+ * @param[in] pts The device coordinates of the points of the element.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * A move following a move replaces it, a close following a close is
+ * ignored, and the points of a close are taken from the start of the
+ * subpath. An element other than a move or a close appended to the
+ * empty path is a nocurrentpoint error.
+ */
+int xpost_path_append(Xpost_Context *ctx,
+                      Xpost_Object *path,
+                      Xpost_Path_Verb verb,
+                      const float *pts);
+
+/**
+ * @brief Mark a path as shared, so that it is copied when appended.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The path, or null.
+ * @return 0 on success, a postscript error code otherwise.
+ */
+int xpost_path_share(Xpost_Context *ctx,
+                     Xpost_Object path);
+
+/**
+ * @brief Return the size of the elements of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The path, or null.
+ * @return The size in bytes of the elements, 0 for the empty path.
+ *
+ * The elements of a path are at offsets from 0 to this size, which
+ * bounds an enumeration of the path even if it is appended to.
+ */
+unsigned int xpost_path_length(Xpost_Context *ctx,
+                               Xpost_Object path);
+
+/**
+ * @brief Fetch an element of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The path.
+ * @param[in,out] off The offset of the element, advanced to the next one.
+ * @param[out] verb The verb of the element.
+ * @param[out] pts The device coordinates of its points, 6 floats.
+ * @return 0 on success, a postscript error code otherwise.
+ */
+int xpost_path_get(Xpost_Context *ctx,
+                   Xpost_Object path,
+                   unsigned int *off,
+                   Xpost_Path_Verb *verb,
+                   float *pts);
+
+/**
+ * @brief Return the current point of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The path, or null.
+ * @param[out] x The device x coordinate of the current point.
+ * @param[out] y The device y coordinate of the current point.
+ * @return 0 on success, nocurrentpoint for the empty path.
+ */
+int xpost_path_current_point(Xpost_Context *ctx,
+                             Xpost_Object path,
+                             float *x,
+                             float *y);
+
+/**
+ * @}
+ */
+
+#endif
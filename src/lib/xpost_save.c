@@ -41,6 +41,8 @@
 #include "xpost_object.h"  /* save/restore examines objects */
 #include "xpost_stack.h"  /* save/restore manipulates (internal) stacks */
 #include "xpost_error.h"
+#include "xpost_context.h"
+#include "xpost_dict.h"  /* dicts are saved by records */
 
 #include "xpost_save.h"  /* double-check prototypes */
 
@@ -59,6 +61,104 @@ typedef struct {
 } saverec_;
 */
 
+/*
+   the ent numbers of a saverec are wider than its word fields: like
+   the ent of a composite object, src is extended by the extra bits
+   of the tag, and cpy by the bits between the type and the extra
+   bits, which a saverec does not use.
+ */
+#define XPOST_SAVE_REC_CPY_OFFSET XPOST_OBJECT_TAG_DATA_FLAG_ACCESS_OFFSET
+#define XPOST_SAVE_REC_CPY_MASK \
+    (((1 << XPOST_OBJECT_TAG_EXTRA_BITS_SIZE) - 1) << XPOST_SAVE_REC_CPY_OFFSET)
+
+/* the flag of the saverecs whose cpy is a directory of chunks,
+   in the first bit after the extra bits of cpy */
+#define XPOST_SAVE_REC_CHUNKS \
+    (1 << (XPOST_SAVE_REC_CPY_OFFSET + XPOST_OBJECT_TAG_EXTRA_BITS_SIZE))
+
+static
+Xpost_Object _xpost_save_rec_cons(unsigned tag,
+                                  unsigned pad,
+                                  unsigned src,
+                                  unsigned cpy)
+{
+    Xpost_Object o;
+
+    o.saverec_.tag = (word)(tag |
+        ((src >> (8 * sizeof(word))) << XPOST_OBJECT_TAG_DATA_EXTRA_BITS) |
+        ((cpy >> (8 * sizeof(word))) << XPOST_SAVE_REC_CPY_OFFSET));
+    o.saverec_.pad = (word)pad;
+    o.saverec_.src = (word)src;
+    o.saverec_.cpy = (word)cpy;
+    return o;
+}
+
+unsigned int xpost_save_rec_get_src(Xpost_Object rec)
+{
+    return rec.saverec_.src |
+        ((unsigned int)(rec.saverec_.tag >> XPOST_OBJECT_TAG_DATA_EXTRA_BITS)
+         << (8 * sizeof(word)));
+}
+
+unsigned int xpost_save_rec_get_cpy(Xpost_Object rec)
+{
+    return rec.saverec_.cpy |
+        ((unsigned int)((rec.saverec_.tag & XPOST_SAVE_REC_CPY_MASK)
+                        >> XPOST_SAVE_REC_CPY_OFFSET)
+         << (8 * sizeof(word)));
+}
+
+/* the layout of the allocation of an array or a dict:
+   the size of its header, and of its slots */
+static
+void _xpost_save_layout(unsigned tag,
+                        unsigned int *head,
+                        unsigned int *slot)
+{
+    if ((tag & XPOST_OBJECT_TAG_DATA_TYPE_MASK) == dicttype)
+    {
+        *head = sizeof(dichead);
+        *slot = sizeof(dicrec);
+    }
+    else
+    {
+        *head = 0;
+        *slot = sizeof(Xpost_Object);
+    }
+}
+
+unsigned int xpost_save_rec_get_chunk_count(Xpost_Memory_File *mem,
+                                            Xpost_Object rec)
+{
+    unsigned int head;
+    unsigned int slot;
+    unsigned int dir;
+
+    if (!(rec.saverec_.tag & XPOST_SAVE_REC_CHUNKS))
+        return 0;
+    dir = xpost_save_rec_get_cpy(rec);
+    if (dir >= mem->table.nextent)
+        return 0;
+    _xpost_save_layout(rec.saverec_.tag, &head, &slot);
+    return (mem->table.tab[dir].used - head) / sizeof(unsigned int);
+}
+
+unsigned int xpost_save_rec_get_chunk(Xpost_Memory_File *mem,
+                                      Xpost_Object rec,
+                                      unsigned int i)
+{
+    unsigned int head;
+    unsigned int slot;
+    unsigned int cent;
+
+    _xpost_save_layout(rec.saverec_.tag, &head, &slot);
+    memcpy(&cent,
+           mem->base + mem->table.tab[xpost_save_rec_get_cpy(rec)].adr
+           + head + i * sizeof(unsigned int),
+           sizeof(unsigned int));
+    return cent;
+}
+
 /* create a stack in slot XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK.
    sz is 0 so gc will ignore it. */
 int xpost_save_init(Xpost_Memory_File *mem)
@@ -76,6 +176,9 @@ int xpost_save_init(Xpost_Memory_File *mem)
     assert(ent == XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK);
 
     xpost_stack_init(mem, &t);
+    /* no save object above the top of the stack to reuse yet */
+    memset(((Xpost_Stack *)(mem->base + t))->data, 0,
+           sizeof(((Xpost_Stack *)(mem->base + t))->data));
     tab = &mem->table;
     tab->tab[ent].adr = t;
 
@@ -87,6 +190,7 @@ int xpost_save_init(Xpost_Memory_File *mem)
 Xpost_Object xpost_save_create_snapshot_object(Xpost_Memory_File *mem)
 {
     Xpost_Object v;
+    Xpost_Stack *s;
     unsigned int vs;
     int ret;
 
@@ -99,7 +203,18 @@ Xpost_Object xpost_save_create_snapshot_object(Xpost_Memory_File *mem)
         return null;
     }
     v.save_.lev = xpost_stack_count(mem, vs);
-    xpost_stack_init(mem, &v.save_.stk);
+    /* reuse the stack of the save object last restored at this level,
+       which is left just above the top of the save stack */
+    s = xpost_stack_top_segment(mem, vs);
+    if (s == (Xpost_Stack *)(mem->base + vs) &&
+        xpost_object_get_type(s->data[s->top]) == savetype &&
+        s->data[s->top].save_.lev == v.save_.lev)
+    {
+        v.save_.stk = s->data[s->top].save_.stk;
+        xpost_stack_clear(mem, v.save_.stk);
+    }
+    else
+        xpost_stack_init(mem, &v.save_.stk);
     xpost_stack_push(mem, vs, v);
     return v;
 }
@@ -142,8 +257,12 @@ unsigned xpost_save_ent_is_saved(Xpost_Memory_File *mem,
     llev = (tab->tab[ent].mark & XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_MASK)
         >> XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_OFFSET;
 
-    return llev < sav.save_.lev ?
-        tlev == sav.save_.lev : 1;
+    /* the save object of level lev is pushed when the save stack
+       count is lev, so the ents allocated before it have llev <= lev,
+       and the ents saved since have tlev lev + 1. an ent saved by
+       chunks is only saved whole by xpost_save_save_ent */
+    return llev <= (unsigned int)sav.save_.lev ?
+        (tlev == (unsigned int)sav.save_.lev + 1 && !tab->tab[ent].save) : 1;
 }
 
 /* make a clone of ent, return new ent */
@@ -183,6 +302,7 @@ unsigned int _copy_ent(Xpost_Memory_File *mem,
     memcpy(mem->base + adr,
            mem->base + tab->tab[ent].adr,
            tab->tab[ent].sz);
+    tab->tab[new].used = tab->tab[ent].used;
 
     XPOST_LOG_INFO("ent %u copied to ent %u in %s", ent, new, mem->fname);
     return new;
@@ -218,25 +338,175 @@ int xpost_save_save_ent(Xpost_Memory_File *mem,
         XPOST_LOG_ERR("cannot find table for ent %u", ent);
         return 0;
     }
-    tlev = sav.save_.lev;
+    tlev = sav.save_.lev + 1;
     tab->tab[ent].mark &= ~XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_MASK; // clear TLEV field
     tab->tab[ent].mark |= (tlev << XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_OFFSET);  // set TLEV field
 
-    o.saverec_.tag = tag;
-    o.saverec_.pad = pad;
-    o.saverec_.src = ent;
+    /* if the ent is already saved by chunks, the whole copy is
+       restored first, then the chunks it has changed */
     cpy = _copy_ent(mem, ent);
     if (cpy == 0)
     {
         XPOST_LOG_ERR("unable to make copy of ent %d", ent);
         return 0;
     }
+    mem->table.tab[ent].save = 0;
 
-    o.saverec_.cpy = cpy;
+    o = _xpost_save_rec_cons(tag, pad, ent, cpy);
     xpost_stack_push(mem, sav.save_.stk, o);
     return 1;
 }
 
+/* start saving ent by chunks at the current level:
+   set tlev, create the chunk directory with a copy of the header,
+   push the saverec. returns the directory ent */
+static
+unsigned int _xpost_save_chunk_dir(Xpost_Memory_File *mem,
+                                   unsigned tag,
+                                   unsigned pad,
+                                   unsigned ent,
+                                   Xpost_Object sav)
+{
+    Xpost_Memory_Table *tab = &mem->table;
+    unsigned int head;
+    unsigned int slot;
+    unsigned int nchunks;
+    unsigned int dir;
+    unsigned int adr;
+    unsigned tlev;
+
+    _xpost_save_layout(tag, &head, &slot);
+    nchunks = ((tab->tab[ent].used - head) / slot + XPOST_SAVE_CHUNK_SLOTS - 1)
+        / XPOST_SAVE_CHUNK_SLOTS;
+    if (!xpost_memory_table_alloc(mem, head + nchunks * sizeof(unsigned int), 0, &dir))
+    {
+        XPOST_LOG_ERR("cannot allocate chunk directory");
+        return 0;
+    }
+    if (dir > XPOST_OBJECT_COMP_MAX_ENT)
+    {
+        XPOST_LOG_ERR("ent number %u exceeds object storage max %u",
+                      dir, XPOST_OBJECT_COMP_MAX_ENT);
+        return 0;
+    }
+    adr = tab->tab[dir].adr;
+    memcpy(mem->base + adr, mem->base + tab->tab[ent].adr, head);
+    memset(mem->base + adr + head, 0, nchunks * sizeof(unsigned int));
+
+    tlev = sav.save_.lev + 1;
+    tab->tab[ent].mark &= ~XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_MASK;
+    tab->tab[ent].mark |= (tlev << XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_OFFSET);
+    tab->tab[ent].save = dir;
+
+    xpost_stack_push(mem, sav.save_.stk,
+                     _xpost_save_rec_cons(tag | XPOST_SAVE_REC_CHUNKS, pad, ent, dir));
+    return dir;
+}
+
+/* set tlev for ent to current save level, if it is not saved yet:
+   copy ent whole if it is small, otherwise copy the chunks holding
+   the n slots from slot first which are not copied yet */
+int xpost_save_save_slots(Xpost_Memory_File *mem,
+                          unsigned tag,
+                          unsigned pad,
+                          unsigned ent,
+                          unsigned int first,
+                          unsigned int n)
+{
+    Xpost_Memory_Table *tab = &mem->table;
+    Xpost_Object sav;
+    unsigned int vs;
+    unsigned int llev;
+    unsigned int tlev;
+    unsigned int head;
+    unsigned int slot;
+    unsigned int nslots;
+    unsigned int dir;
+    unsigned int c;
+    int ret;
+
+    ret = xpost_memory_table_get_addr(mem,
+                                      XPOST_MEMORY_TABLE_SPECIAL_SAVE_STACK, &vs);
+    if (!ret)
+    {
+        XPOST_LOG_ERR("cannot load save stack");
+        return 0;
+    }
+    if (xpost_stack_count(mem, vs) == 0 || n == 0)
+        return 1;
+    sav = xpost_stack_topdown_fetch(mem, vs, 0);
+
+    if (ent >= tab->nextent)
+    {
+        XPOST_LOG_ERR("cannot find table for ent %u", ent);
+        return 0;
+    }
+    tlev = (tab->tab[ent].mark & XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_MASK)
+        >> XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_OFFSET;
+    llev = (tab->tab[ent].mark & XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_MASK)
+        >> XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_OFFSET;
+    if (llev > (unsigned int)sav.save_.lev)
+        return 1; /* allocated since the save */
+
+    if (tlev == (unsigned int)sav.save_.lev + 1)
+    {
+        dir = tab->tab[ent].save;
+        if (!dir)
+            return 1; /* copied whole */
+    }
+    else
+    {
+        if (tab->tab[ent].used < XPOST_SAVE_CHUNK_MIN)
+            return xpost_save_save_ent(mem, tag, pad, ent);
+        dir = _xpost_save_chunk_dir(mem, tag, pad, ent, sav);
+        if (!dir)
+            return 0;
+    }
+
+    _xpost_save_layout(tag, &head, &slot);
+    nslots = (tab->tab[ent].used - head) / slot;
+    if (first + n > nslots)
+        n = first < nslots ? nslots - first : 0;
+    for (c = first / XPOST_SAVE_CHUNK_SLOTS;
+         n && c <= (first + n - 1) / XPOST_SAVE_CHUNK_SLOTS;
+         c++)
+    {
+        unsigned int cent;
+        unsigned int off;
+        unsigned int sz;
+
+        memcpy(&cent, mem->base + tab->tab[dir].adr + head + c * sizeof(unsigned int),
+               sizeof(unsigned int));
+        if (cent)
+            continue;
+
+        off = head + c * XPOST_SAVE_CHUNK_SLOTS * slot;
+        sz = XPOST_SAVE_CHUNK_SLOTS * slot;
+        if (off + sz > tab->tab[ent].used)
+            sz = tab->tab[ent].used - off;
+        /* the allocation may move the memory file, and collect
+           garbage: the directory is already on the save stack */
+        if (!xpost_memory_table_alloc(mem, sz, 0, &cent))
+        {
+            XPOST_LOG_ERR("cannot allocate chunk to backup object");
+            return 0;
+        }
+        if (cent > XPOST_OBJECT_COMP_MAX_ENT)
+        {
+            XPOST_LOG_ERR("ent number %u exceeds object storage max %u",
+                          cent, XPOST_OBJECT_COMP_MAX_ENT);
+            return 0;
+        }
+        memcpy(mem->base + tab->tab[cent].adr,
+               mem->base + tab->tab[ent].adr + off,
+               sz);
+        memcpy(mem->base + tab->tab[dir].adr + head + c * sizeof(unsigned int),
+               &cent, sizeof(unsigned int));
+    }
+
+    return 1;
+}
+
 /* for each saverec from current save stack
         exchange adrs between src and cpy
         pop saverec
@@ -269,8 +539,8 @@ void xpost_save_restore_snapshot(Xpost_Memory_File *mem)
         rec = xpost_stack_pop(mem, sav.save_.stk);
         if (xpost_object_get_type(rec) == invalidtype)
             return;
-        sent = rec.saverec_.src;
-        cent = rec.saverec_.cpy;
+        sent = xpost_save_rec_get_src(rec);
+        cent = xpost_save_rec_get_cpy(rec);
         XPOST_LOG_INFO("replacing ent %u with copy ent %u", sent, cent);
         if (sent >= tab->nextent)
         {
@@ -282,11 +552,51 @@ void xpost_save_restore_snapshot(Xpost_Memory_File *mem)
             XPOST_LOG_ERR("cannot find table for ent %u", cent);
             return;
         }
-        hold = tab->tab[sent].adr;                 // tmp = src
-        tab->tab[sent].adr = tab->tab[cent].adr;  // src = cpy
-        tab->tab[cent].adr = hold;                 // cpy = tmp
+        if (rec.saverec_.tag & XPOST_SAVE_REC_CHUNKS)
+        {
+            /* copy back the header and the saved chunks */
+            unsigned int head;
+            unsigned int slot;
+            unsigned int n;
+            unsigned int c;
+
+            _xpost_save_layout(rec.saverec_.tag, &head, &slot);
+            memcpy(mem->base + tab->tab[sent].adr,
+                   mem->base + tab->tab[cent].adr, head);
+            n = xpost_save_rec_get_chunk_count(mem, rec);
+            for (c = 0; c < n; c++)
+            {
+                unsigned int chunk = xpost_save_rec_get_chunk(mem, rec, c);
+
+                if (chunk)
+                    memcpy(mem->base + tab->tab[sent].adr
+                           + head + c * XPOST_SAVE_CHUNK_SLOTS * slot,
+                           mem->base + tab->tab[chunk].adr,
+                           tab->tab[chunk].used);
+            }
+        }
+        else
+        {
+            hold = tab->tab[sent].adr;                 // tmp = src
+            tab->tab[sent].adr = tab->tab[cent].adr;  // src = cpy
+            tab->tab[cent].adr = hold;                 // cpy = tmp
+            /* the ent may have been grown since it was saved */
+            hold = tab->tab[sent].sz;
+            tab->tab[sent].sz = tab->tab[cent].sz;
+            tab->tab[cent].sz = hold;
+            hold = tab->tab[sent].used;
+            tab->tab[sent].used = tab->tab[cent].used;
+            tab->tab[cent].used = hold;
+        }
+        tab->tab[sent].save = 0;
+        /* reset tlev, so the ent is saved again by the next save */
+        tab->tab[sent].mark &= ~XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_MASK;
+        tab->tab[sent].mark |= ((tab->tab[sent].mark & XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_MASK)
+                                >> XPOST_MEMORY_TABLE_MARK_DATA_LOWLEVEL_OFFSET)
+            << XPOST_MEMORY_TABLE_MARK_DATA_TOPLEVEL_OFFSET;
     }
-    //xpost_stack_free(mem, sav.save_.stk);
+    /* the stack of sav stays in the popped slot of the save stack,
+       it is reused by the next save at this level */
 }
 
 #ifdef TESTMODULE_V
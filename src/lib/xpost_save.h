@@ -60,7 +60,28 @@
  *     -- saverec
  *     -- saverec = { src=foo_ent, cpy=bar_ent }
  *
+ *  An array or dictionary smaller than XPOST_SAVE_CHUNK_MIN bytes is
+ *  copied whole the first time it is changed after a save. A larger one
+ *  is saved by chunks of XPOST_SAVE_CHUNK_SLOTS slots (array elements or
+ *  dictionary records): its saverec is marked with the chunks flag, and
+ *  its cpy is a directory holding a copy of the header of the
+ *  dictionary followed by the ent of the copy of each chunk, or 0 if
+ *  the chunk is unchanged. Each chunk is copied the first time one of
+ *  its slots is changed, and the directory is kept in the save field of
+ *  the memory table entry of src until the restore, which copies the
+ *  saved chunks back.
+ *
+ */
+
+/**
+ * Number of slots of the chunks of the larger arrays and dictionaries
  */
+#define XPOST_SAVE_CHUNK_SLOTS 32
+
+/**
+ * Size of the smallest array or dictionary saved by chunks
+ */
+#define XPOST_SAVE_CHUNK_MIN 2048
 
 /*
  * @brief initialize the save stack for memory file.
@@ -83,9 +104,37 @@ unsigned xpost_save_ent_is_saved(Xpost_Memory_File *mem, unsigned ent);
  */
 int xpost_save_save_ent(Xpost_Memory_File *mem, unsigned tag, unsigned pad, unsigned ent);
 
+/*
+ * @brief add the n slots from slot first of ent to current snapshot,
+ *        before changing them.
+ */
+int xpost_save_save_slots(Xpost_Memory_File *mem, unsigned tag, unsigned pad, unsigned ent,
+                          unsigned int first, unsigned int n);
+
 /*
  * @brief rewind the stack 1 level, reverting memory to previous snapshot.
  */
 void xpost_save_restore_snapshot(Xpost_Memory_File *mem);
 
+/*
+ * @brief return the ent number of the source of a saverec.
+ */
+unsigned int xpost_save_rec_get_src(Xpost_Object rec);
+
+/*
+ * @brief return the ent number of the copy of a saverec.
+ */
+unsigned int xpost_save_rec_get_cpy(Xpost_Object rec);
+
+/*
+ * @brief return the number of chunks of a saverec, 0 if it holds a whole copy.
+ */
+unsigned int xpost_save_rec_get_chunk_count(Xpost_Memory_File *mem, Xpost_Object rec);
+
+/*
+ * @brief return the ent number of the copy of the chunk i of a saverec,
+ *        0 if this chunk is not saved.
+ */
+unsigned int xpost_save_rec_get_chunk(Xpost_Memory_File *mem, Xpost_Object rec, unsigned int i);
+
 #endif
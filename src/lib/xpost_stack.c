@@ -53,6 +53,7 @@ typedef struct
     unsigned int nextseg;
     unsigned int prevseg;
     unsigned int top;
+    unsigned int count;
     Xpost_Object data[XPOST_STACK_SEGMENT_SIZE];
 } Xpost_Stack;
 */
@@ -69,6 +70,7 @@ XPCHECKAPI int xpost_stack_init(Xpost_Memory_File *mem,
     s->nextseg = 0;
     s->prevseg = adr;
     s->top = 0;
+    s->count = 0;
     *paddr = adr;
     return 1;
 }
@@ -79,6 +81,7 @@ void xpost_stack_clear(Xpost_Memory_File *mem,
     Xpost_Stack *s = (Xpost_Stack *)(mem->base + stackadr);
     s->top = 0;
     s->prevseg = stackadr;
+    s->count = 0;
 }
 
 void xpost_stack_dump(Xpost_Memory_File *mem,
@@ -121,30 +124,17 @@ XPCHECKAPI void xpost_stack_free(Xpost_Memory_File *mem,
     /* discard */
 }
 
-int xpost_stack_count(Xpost_Memory_File *mem,
-                      unsigned int stackadr)
-{
-    Xpost_Stack *s = (Xpost_Stack *)(mem->base + stackadr);
-    unsigned int ct = 0;
-    while (s->top == XPOST_STACK_SEGMENT_SIZE)
-    {
-        ct += XPOST_STACK_SEGMENT_SIZE;
-        s = (Xpost_Stack *)(mem->base + s->nextseg);
-    }
-    return ct + s->top;
-}
-
-XPCHECKAPI int xpost_stack_push(Xpost_Memory_File *mem,
-                                unsigned int stackadr,
-                                Xpost_Object obj)
+/* called by xpost_stack_push when the top segment has
+   only one free slot left */
+int xpost_stack_push_segment(Xpost_Memory_File *mem,
+                             unsigned int stackadr,
+                             Xpost_Object obj)
 {
     Xpost_Stack *root = (Xpost_Stack *)(mem->base + stackadr);
     Xpost_Stack *s = (Xpost_Stack *)(mem->base + root->prevseg); /* load top segment */
 
-    if (xpost_object_get_type(obj) == invalidtype)
-        return 0;
-
     s->data[s->top++] = obj; /* push value */
+    ++root->count;
 
     /* if push filled the topmost segment, link a new one. */
     if (s->top == XPOST_STACK_SEGMENT_SIZE)
@@ -176,16 +166,12 @@ XPCHECKAPI int xpost_stack_push(Xpost_Memory_File *mem,
     return 1;
 }
 
-Xpost_Object xpost_stack_topdown_fetch(Xpost_Memory_File *mem,
-                                       unsigned int stackadr,
-                                       int idx)
+/* find the slot of the object idx places below the top of the stack,
+   walking down the segments. NULL if the stack is not that deep. */
+Xpost_Object *xpost_stack_topdown_segment(Xpost_Memory_File *mem,
+                                          unsigned int stackadr,
+                                          int idx)
 {
-#if 0
-    int i = idx;
-    int cnt = xpost_stack_count(mem, stackadr);
-    if (idx >= cnt) return invalid;
-    return xpost_stack_bottomup_fetch(mem, stackadr, cnt - 1 - i);
-#else
     int i = idx;
     Xpost_Stack *s = (Xpost_Stack *)(mem->base + stackadr);
 
@@ -197,42 +183,11 @@ Xpost_Object xpost_stack_topdown_fetch(Xpost_Memory_File *mem,
             XPOST_LOG_ERR("%d can't find stack segment for index -%d in stack of size %u",
                     unregistered, idx,
                     xpost_stack_count(mem, stackadr));
-            return invalid;
+            return NULL;
         }
         s = (Xpost_Stack *)(mem->base + s->prevseg);
     }
-    return s->data[s->top - 1 - i];
-#endif
-}
-
-int xpost_stack_topdown_replace(Xpost_Memory_File *mem,
-                                unsigned int stackadr,
-                                int idx,
-                                Xpost_Object obj)
-{
-#if 0
-    int i = idx;
-    int cnt = xpost_stack_count(mem, stackadr);
-    if (idx >= cnt) return 0;
-    return xpost_stack_bottomup_replace(mem, stackadr, cnt - 1 - i, obj);
-#else
-    int i = idx;
-    Xpost_Stack *s = (Xpost_Stack *)(mem->base + stackadr);
-    if (s->prevseg) s = (Xpost_Stack *)(mem->base + s->prevseg); /* find top seg */
-
-    while (i >= (signed)(s->top)){
-        i -= s->top;
-        if (s == (Xpost_Stack *)(mem->base + stackadr)){
-            XPOST_LOG_ERR("%d can't find stack segment for index -%d in stack of size %u",
-                    unregistered, idx,
-                    xpost_stack_count(mem, stackadr));
-            return 0;
-        }
-        s = (Xpost_Stack *)(mem->base + s->prevseg);
-    }
-    s->data[s->top - 1 - i] = obj;
-    return 1;
-#endif
+    return &s->data[s->top - 1 - i];
 }
 
 Xpost_Object xpost_stack_bottomup_fetch(Xpost_Memory_File *mem,
@@ -291,8 +246,9 @@ int xpost_stack_bottomup_replace(Xpost_Memory_File *mem,
     return 1;
 }
 
-XPCHECKAPI Xpost_Object xpost_stack_pop(Xpost_Memory_File *mem,
-                                        unsigned int stackadr)
+/* called by xpost_stack_pop when the top segment is empty */
+Xpost_Object xpost_stack_pop_segment(Xpost_Memory_File *mem,
+                                     unsigned int stackadr)
 {
     Xpost_Stack *root = (Xpost_Stack *)(mem->base + stackadr);
     Xpost_Stack *s = (Xpost_Stack *)(mem->base + root->prevseg); /* load top seg */
@@ -311,5 +267,6 @@ XPCHECKAPI Xpost_Object xpost_stack_pop(Xpost_Memory_File *mem,
         }
     }
 
+    --root->count;
     return s->data[--s->top]; /* pop value */
 }
@@ -66,11 +66,19 @@
  */
 #define XPOST_STACK_SEGMENT_SIZE 1000
 
+/**
+ * @brief One segment of a stack.
+ *
+ * The first segment is the root: its prevseg is the address of the
+ * top segment, and its count is the number of objects in the whole
+ * stack. The objects of a segment are data[0] .. data[top-1].
+ */
 typedef struct
 {
     unsigned int nextseg;
     unsigned int prevseg;
     unsigned int top;
+    unsigned int count; /**< in the root segment: size of the stack */
     Xpost_Object data[XPOST_STACK_SEGMENT_SIZE];
 } Xpost_Stack;
 
@@ -94,32 +102,156 @@ void xpost_stack_dump(Xpost_Memory_File *mem, unsigned int stackadr);
  */
 XPCHECKAPI void xpost_stack_free(Xpost_Memory_File *mem, unsigned int stackadr);
 
+/*
+ * The functions below which work on the top of the stack are inline,
+ * handling the common case of a top segment with room to spare or
+ * enough objects, and call the *_segment functions to chain to the
+ * next or previous segment.
+ */
+
+/**
+ * @brief Push an object on a full top segment, linking the next one.
+ */
+int xpost_stack_push_segment(Xpost_Memory_File *mem,
+                             unsigned int stackadr,
+                             Xpost_Object obj);
+
+/**
+ * @brief Pop an object, backing up to the previous segment if the top
+ * segment is empty.
+ */
+Xpost_Object xpost_stack_pop_segment(Xpost_Memory_File *mem,
+                                     unsigned int stackadr);
+
+/**
+ * @brief Index the stack from the top down, past the top segment.
+ */
+Xpost_Object *xpost_stack_topdown_segment(Xpost_Memory_File *mem,
+                                          unsigned int stackadr,
+                                          int i);
+
+/**
+ * @brief Return the segment holding the top of the stack.
+ *
+ * Its objects may be read and replaced in place. Objects must be
+ * removed with xpost_stack_pop() or xpost_stack_discard(), which keep
+ * the count of the stack.
+ */
+static inline
+Xpost_Stack *xpost_stack_top_segment(Xpost_Memory_File *mem,
+                                     unsigned int stackadr)
+{
+    return (Xpost_Stack *)(mem->base +
+                           ((Xpost_Stack *)(mem->base + stackadr))->prevseg);
+}
+
 /**
  * @brief Count elements in stack.
  */
-int xpost_stack_count(Xpost_Memory_File *mem, unsigned int stackadr);
+static inline
+int xpost_stack_count(Xpost_Memory_File *mem,
+                      unsigned int stackadr)
+{
+    return ((Xpost_Stack *)(mem->base + stackadr))->count;
+}
 
 /**
  * @brief Put an object on top of the stack.
  */
-XPCHECKAPI int xpost_stack_push(Xpost_Memory_File *mem,
-                                unsigned int stackadr,
-                                Xpost_Object obj);
+static inline
+int xpost_stack_push(Xpost_Memory_File *mem,
+                     unsigned int stackadr,
+                     Xpost_Object obj)
+{
+    Xpost_Stack *root = (Xpost_Stack *)(mem->base + stackadr);
+    Xpost_Stack *s = (Xpost_Stack *)(mem->base + root->prevseg);
+
+    if ((obj.tag & XPOST_OBJECT_TAG_DATA_TYPE_MASK) == invalidtype)
+        return 0;
+    if (s->top >= XPOST_STACK_SEGMENT_SIZE - 1)
+        return xpost_stack_push_segment(mem, stackadr, obj);
+    s->data[s->top++] = obj;
+    ++root->count;
+    return 1;
+}
+
+/**
+ * @brief Pop the stack, remove and return top object.
+ */
+static inline
+Xpost_Object xpost_stack_pop(Xpost_Memory_File *mem,
+                             unsigned int stackadr)
+{
+    Xpost_Stack *root = (Xpost_Stack *)(mem->base + stackadr);
+    Xpost_Stack *s = (Xpost_Stack *)(mem->base + root->prevseg);
+
+    if (s->top == 0)
+        return xpost_stack_pop_segment(mem, stackadr);
+    --root->count;
+    return s->data[--s->top];
+}
+
+/**
+ * @brief Remove the n top objects of the stack.
+ */
+static inline
+void xpost_stack_discard(Xpost_Memory_File *mem,
+                         unsigned int stackadr,
+                         int n)
+{
+    Xpost_Stack *root = (Xpost_Stack *)(mem->base + stackadr);
+    Xpost_Stack *s = (Xpost_Stack *)(mem->base + root->prevseg);
+
+    if ((int)s->top >= n)
+    {
+        s->top -= n;
+        root->count -= n;
+        return;
+    }
+    while (n-- > 0)
+        (void)xpost_stack_pop_segment(mem, stackadr);
+}
 
 /**
  * @brief Index the stack from the top down, fetching object.
  */
+static inline
 Xpost_Object xpost_stack_topdown_fetch(Xpost_Memory_File *mem,
-                                       unsigned stackadr,
-                                       int i);
+                                       unsigned int stackadr,
+                                       int i)
+{
+    Xpost_Stack *s = xpost_stack_top_segment(mem, stackadr);
+    Xpost_Object *o;
+
+    if (i >= 0 && i < (int)s->top)
+        return s->data[s->top - 1 - i];
+    o = xpost_stack_topdown_segment(mem, stackadr, i);
+    return o ? *o : invalid;
+}
 
 /**
  * @brief Index the stack from the top down, replacing object.
  */
+static inline
 int xpost_stack_topdown_replace(Xpost_Memory_File *mem,
-                                unsigned stackadr,
+                                unsigned int stackadr,
                                 int i,
-                                Xpost_Object obj);
+                                Xpost_Object obj)
+{
+    Xpost_Stack *s = xpost_stack_top_segment(mem, stackadr);
+    Xpost_Object *o;
+
+    if (i >= 0 && i < (int)s->top)
+    {
+        s->data[s->top - 1 - i] = obj;
+        return 1;
+    }
+    o = xpost_stack_topdown_segment(mem, stackadr, i);
+    if (!o)
+        return 0;
+    *o = obj;
+    return 1;
+}
 
 /**
  * @brief Index the stack from the bottom up, fetching object.
@@ -136,12 +268,6 @@ int xpost_stack_bottomup_replace(Xpost_Memory_File *mem,
                                  int i,
                                  Xpost_Object obj);
 
-/**
- * @brief Pop the stack, remove and return top object.
- */
-XPCHECKAPI Xpost_Object xpost_stack_pop(Xpost_Memory_File *mem,
-                                        unsigned stackadr);
-
 /**
  * @}
  */
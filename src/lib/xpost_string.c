@@ -33,6 +33,7 @@
 #endif
 
 #include <stdlib.h> /* size_t */
+#include <string.h> /* memset */
 
 #include "xpost.h"
 #include "xpost_log.h"
@@ -74,6 +75,18 @@ Xpost_Object xpost_string_cons_memory(Xpost_Memory_File *mem,
             return null;
         }
     }
+    else
+    {
+        unsigned int adr;
+
+        /* the allocation may be reused from the free list */
+        if (!xpost_memory_table_get_addr(mem, ent, &adr))
+        {
+            XPOST_LOG_ERR("cannot retrieve address for string ent %u", ent);
+            return null;
+        }
+        memset(mem->base + adr, 0, sz);
+    }
     o.tag = stringtype | (XPOST_OBJECT_TAG_ACCESS_UNLIMITED << XPOST_OBJECT_TAG_DATA_FLAG_ACCESS_OFFSET);
     o.comp_.sz = sz;
     //o.comp_.ent = ent;
@@ -0,0 +1,611 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#ifdef STDC_HEADERS
+# include <stdlib.h>
+#else
+# ifdef HAVE_STDLIB_H
+#  include <stdlib.h>
+# endif
+#endif
+
+#define _USE_MATH_DEFINES /* needed for M_PI with Visual Studio */
+#include <math.h>
+
+#include "xpost.h"
+#include "xpost_memory.h"  // paths live in mfile
+#include "xpost_object.h"  // paths are string objects
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_error.h"
+#include "xpost_matrix.h"
+#include "xpost_path.h"
+
+#include "xpost_stroke.h"
+
+/* points of the path closer than this in device space are taken as
+   one, as the direction of a segment of rounding errors is arbitrary */
+#define XPOST_STROKE_EPSILON 1e-3
+
+/* bounds of the number of segments of a full circle */
+#define XPOST_STROKE_MIN_STEPS 8
+#define XPOST_STROKE_MAX_STEPS 256
+
+typedef struct
+{
+    real x;
+    real y;
+} _Point;
+
+/* a growable array of points */
+typedef struct
+{
+    _Point *p;
+    int n;
+    int max;
+} _Points;
+
+typedef struct _Stroker _Stroker;
+
+/* the output of a dash, or of an undashed subpath */
+typedef int (*_Piece)(_Stroker *s, const _Point *p, int n, int closed);
+
+struct _Stroker
+{
+    Xpost_Context *ctx;
+    const Xpost_Stroke_Style *style;
+    Xpost_Object *out;
+    _Piece piece;
+    Xpost_Matrix inv; /* the inverse of the CTM */
+    real det;         /* the determinant of the CTM */
+    real hw;          /* half the line width */
+    int steps;        /* segments of a full circle */
+    _Points sub;      /* the current subpath, in user space */
+    _Points dash;     /* the current dash, in user space */
+};
+
+/* append a point, unless it is the last one */
+static
+int _push(_Points *pts, real x, real y)
+{
+    if (pts->n &&
+        pts->p[pts->n - 1].x == x &&
+        pts->p[pts->n - 1].y == y)
+        return 0;
+    if (pts->n == pts->max)
+    {
+        _Point *tmp;
+        int max;
+
+        max = pts->max ? 2 * pts->max : 64;
+        tmp = realloc(pts->p, max * sizeof *tmp);
+        if (!tmp)
+            return VMerror;
+        pts->p = tmp;
+        pts->max = max;
+    }
+    pts->p[pts->n].x = x;
+    pts->p[pts->n].y = y;
+    pts->n++;
+    return 0;
+}
+
+/* append the point p of user space to the output, in device space */
+static
+int _emit(_Stroker *s, Xpost_Path_Verb verb, _Point p)
+{
+    const Xpost_Matrix *m = &s->style->ctm;
+    float pts[2];
+
+    pts[0] = (float)(m->xx * p.x + m->xy * p.y + m->xz);
+    pts[1] = (float)(m->yx * p.x + m->yy * p.y + m->yz);
+    return xpost_path_append(s->ctx, s->out, verb, pts);
+}
+
+/* append the polygon q[0..n-1] of user space to the output, turning
+   counterclockwise in device space, unless it is flat */
+static
+int _polygon(_Stroker *s, const _Point *q, int n)
+{
+    real area = 0;
+    int forward;
+    int i, j;
+    int ret;
+
+    for (i = 0, j = n - 1; i < n; j = i++)
+        area += q[j].x * q[i].y - q[i].x * q[j].y;
+    if (area == 0)
+        return 0;
+
+    /* a CTM of negative determinant reverses the orientation */
+    forward = (area > 0) == (s->det > 0);
+    for (i = 0; i < n; i++)
+    {
+        ret = _emit(s, i ? XPOST_PATH_LINE : XPOST_PATH_MOVE,
+                    q[forward ? i : n - 1 - i]);
+        if (ret)
+            return ret;
+    }
+    return xpost_path_append(s->ctx, s->out, XPOST_PATH_CLOSE, NULL);
+}
+
+/* store in q the points of the arc of center c and radius hw from the
+   angle a, sweeping by the angle sweep, ends included, and return
+   their number, at most XPOST_STROKE_MAX_STEPS + 1 */
+static
+int _arc(_Stroker *s, _Point c, real a, real sweep, _Point *q)
+{
+    real t;
+    int n;
+    int i;
+
+    n = (int)ceil(fabs(sweep) * s->steps / (2 * M_PI));
+    if (n < 1)
+        n = 1;
+    if (n > s->steps)
+        n = s->steps;
+    for (i = 0; i <= n; i++)
+    {
+        t = a + sweep * i / n;
+        q[i].x = c.x + s->hw * (real)cos(t);
+        q[i].y = c.y + s->hw * (real)sin(t);
+    }
+    return n + 1;
+}
+
+/* the quadrilateral of the segment from a to b, of direction u */
+static
+int _segment(_Stroker *s, _Point a, _Point b, _Point u)
+{
+    _Point q[4];
+    real nx, ny;
+
+    nx = -u.y * s->hw;
+    ny = u.x * s->hw;
+    q[0].x = a.x - nx; q[0].y = a.y - ny;
+    q[1].x = b.x - nx; q[1].y = b.y - ny;
+    q[2].x = b.x + nx; q[2].y = b.y + ny;
+    q[3].x = a.x + nx; q[3].y = a.y + ny;
+    return _polygon(s, q, 4);
+}
+
+/* the join at c of a segment of direction u0 to one of direction u1,
+   filling the gap on the outer side of the turn */
+static
+int _join(_Stroker *s, _Point c, _Point u0, _Point u1)
+{
+    _Point q[XPOST_STROKE_MAX_STEPS + 2];
+    real cross, dot;
+    real ax, ay, bx, by;
+    real side;
+    real sx, sy, len2;
+    real ml;
+    int n;
+
+    cross = u0.x * u1.y - u0.y * u1.x;
+    dot = u0.x * u1.x + u0.y * u1.y;
+    if (cross == 0 && dot > 0)
+        return 0;
+
+    /* the offsets of the outer side, right of a left turn */
+    side = cross > 0 ? -s->hw : s->hw;
+    ax = -u0.y * side; ay = u0.x * side;
+    bx = -u1.y * side; by = u1.x * side;
+    q[0] = c;
+    q[1].x = c.x + ax; q[1].y = c.y + ay;
+
+    if (s->style->join == 1)
+    {
+        n = _arc(s, c, (real)atan2(ay, ax),
+                 (real)atan2(ax * by - ay * bx, ax * bx + ay * by), q + 1);
+        return _polygon(s, q, n + 1);
+    }
+    if (s->style->join == 0)
+    {
+        /* the miter length over the width is 2 hw / |a + b| */
+        sx = ax + bx;
+        sy = ay + by;
+        len2 = sx * sx + sy * sy;
+        ml = s->style->miterlimit;
+        if (len2 > 0 && 4 * s->hw * s->hw <= ml * ml * len2)
+        {
+            q[2].x = c.x + sx * 2 * s->hw * s->hw / len2;
+            q[2].y = c.y + sy * 2 * s->hw * s->hw / len2;
+            q[3].x = c.x + bx; q[3].y = c.y + by;
+            return _polygon(s, q, 4);
+        }
+    }
+
+    /* a bevel, also for a miter beyond the miter limit */
+    q[2].x = c.x + bx; q[2].y = c.y + by;
+    return _polygon(s, q, 3);
+}
+
+/* the cap at the end p of a line, of outward direction u */
+static
+int _cap(_Stroker *s, _Point p, _Point u)
+{
+    _Point q[XPOST_STROKE_MAX_STEPS + 1];
+    real nx, ny;
+
+    nx = -u.y * s->hw;
+    ny = u.x * s->hw;
+    switch (s->style->cap)
+    {
+        case 1:
+            return _polygon(s, q, _arc(s, p, (real)atan2(ny, nx), (real)-M_PI, q));
+        case 2:
+            q[0].x = p.x + nx; q[0].y = p.y + ny;
+            q[1].x = p.x - nx; q[1].y = p.y - ny;
+            q[2].x = q[1].x + u.x * s->hw; q[2].y = q[1].y + u.y * s->hw;
+            q[3].x = q[0].x + u.x * s->hw; q[3].y = q[0].y + u.y * s->hw;
+            return _polygon(s, q, 4);
+        default:
+            return 0;
+    }
+}
+
+/* the unit vector from a to b, which differ */
+static
+_Point _direction(_Point a, _Point b)
+{
+    _Point u;
+    real len;
+
+    u.x = b.x - a.x;
+    u.y = b.y - a.y;
+    len = (real)sqrt(u.x * u.x + u.y * u.y);
+    u.x /= len;
+    u.y /= len;
+    return u;
+}
+
+/* stroke the line p[0..n-1] of distinct consecutive points,
+   closed if closed is set */
+static
+int _outline(_Stroker *s, const _Point *p, int n, int closed)
+{
+    _Point q[XPOST_STROKE_MAX_STEPS + 1];
+    _Point u, u0, first;
+    int nseg;
+    int i;
+    int ret;
+
+    /* a single point is a dot with round caps */
+    if (n == 1)
+    {
+        if (s->style->cap != 1)
+            return 0;
+        return _polygon(s, q, _arc(s, p[0], 0, (real)(2 * M_PI), q) - 1);
+    }
+
+    nseg = closed ? n : n - 1;
+    u0 = closed ? _direction(p[n - 1], p[0]) : _direction(p[0], p[1]);
+    first = _direction(p[0], p[1]);
+    for (i = 0; i < nseg; i++)
+    {
+        u = _direction(p[i], p[(i + 1) % n]);
+        ret = _segment(s, p[i], p[(i + 1) % n], u);
+        if (ret)
+            return ret;
+        if (i > 0 || closed)
+        {
+            ret = _join(s, p[i], u0, u);
+            if (ret)
+                return ret;
+        }
+        u0 = u;
+    }
+
+    if (closed)
+        return 0;
+    first.x = -first.x;
+    first.y = -first.y;
+    ret = _cap(s, p[0], first);
+    if (ret)
+        return ret;
+    return _cap(s, p[n - 1], u0);
+}
+
+/* output the line p[0..n-1] as is, for the dashes, nothing for a
+   dash of length zero */
+static
+int _lines(_Stroker *s, const _Point *p, int n, int closed)
+{
+    int i;
+    int ret;
+
+    if (n < 2)
+        return 0;
+    for (i = 0; i < n; i++)
+    {
+        ret = _emit(s, i ? XPOST_PATH_LINE : XPOST_PATH_MOVE, p[i]);
+        if (ret)
+            return ret;
+    }
+    if (closed)
+        return xpost_path_append(s->ctx, s->out, XPOST_PATH_CLOSE, NULL);
+    return 0;
+}
+
+/* cut the line p[0..n-1] into the dashes of the dash pattern,
+   restarted at p[0], and output each dash */
+static
+int _dash(_Stroker *s, const _Point *p, int n, int closed)
+{
+    const real *dash = s->style->dash;
+    int ndash = s->style->ndash;
+    real period, o, remain;
+    real len, t;
+    _Point a, b;
+    int idx, on;
+    int nseg;
+    int i;
+    int ret;
+
+    /* find the element of the pattern at the offset; an odd
+       pattern toggles between dashes and gaps each period */
+    period = 0;
+    for (i = 0; i < ndash; i++)
+        period += dash[i];
+    if (ndash & 1)
+        period *= 2;
+    o = (real)fmod(s->style->dashoffset, period);
+    if (o < 0)
+        o += period;
+    idx = 0;
+    on = 1;
+    while (o > 0 && o >= dash[idx])
+    {
+        o -= dash[idx];
+        idx = (idx + 1) % ndash;
+        on = !on;
+    }
+    remain = dash[idx] - o;
+
+    s->dash.n = 0;
+    if (on)
+    {
+        ret = _push(&s->dash, p[0].x, p[0].y);
+        if (ret)
+            return ret;
+    }
+    nseg = closed && n > 1 ? n : n - 1;
+    for (i = 0; i < nseg; i++)
+    {
+        a = p[i];
+        b = p[(i + 1) % n];
+        len = (real)sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+        for (t = 0; ; )
+        {
+            if (remain > len - t)
+            {
+                remain -= len - t;
+                if (on)
+                {
+                    ret = _push(&s->dash, b.x, b.y);
+                    if (ret)
+                        return ret;
+                }
+                break;
+            }
+
+            /* the element ends on the segment */
+            t += remain;
+            if (!on)
+                s->dash.n = 0;
+            ret = _push(&s->dash, a.x + (b.x - a.x) * t / len, a.y + (b.y - a.y) * t / len);
+            if (ret)
+                return ret;
+            if (on)
+            {
+                ret = s->piece(s, s->dash.p, s->dash.n, 0);
+                if (ret)
+                    return ret;
+                s->dash.n = 0;
+            }
+            idx = (idx + 1) % ndash;
+            on = !on;
+            remain = dash[idx];
+        }
+    }
+    if (on && s->dash.n)
+        return s->piece(s, s->dash.p, s->dash.n, 0);
+    return 0;
+}
+
+/* output the current subpath, nothing for a lone move */
+static
+int _subpath(_Stroker *s, int closed, int lone)
+{
+    _Points *sub = &s->sub;
+
+    if (!sub->n || lone)
+        return 0;
+    if (s->style->ndash)
+        return _dash(s, sub->p, sub->n, closed);
+    return s->piece(s, sub->p, sub->n, closed);
+}
+
+/* check the dash pattern */
+static
+int _checkdash(const Xpost_Stroke_Style *style)
+{
+    real sum = 0;
+    int i;
+
+    for (i = 0; i < style->ndash; i++)
+    {
+        if (style->dash[i] < 0)
+            return rangecheck;
+        sum += style->dash[i];
+    }
+    if (style->ndash && sum == 0)
+        return rangecheck;
+    return 0;
+}
+
+/* pass each subpath of path, in user space, to piece */
+static
+int _stroke(Xpost_Context *ctx,
+            Xpost_Object path,
+            const Xpost_Stroke_Style *style,
+            _Piece piece,
+            Xpost_Object *out)
+{
+    const Xpost_Matrix *m = &style->ctm;
+    _Stroker s;
+    Xpost_Path_Verb verb;
+    float pts[6];
+    real x = 0, y = 0; /* the last point, in device space */
+    real r;
+    unsigned int off, end;
+    int lone = 1;
+    int ret;
+
+    ret = _checkdash(style);
+    if (ret)
+        return ret;
+
+    s.ctx = ctx;
+    s.style = style;
+    s.out = out;
+    s.piece = piece;
+    s.det = m->xx * m->yy - m->yx * m->xy;
+    if (s.det == 0)
+        return undefinedresult;
+    s.inv.xx = m->yy / s.det;
+    s.inv.xy = -m->xy / s.det;
+    s.inv.yx = -m->yx / s.det;
+    s.inv.yy = m->xx / s.det;
+    s.inv.xz = -(s.inv.xx * m->xz + s.inv.xy * m->yz);
+    s.inv.yz = -(s.inv.yx * m->xz + s.inv.yy * m->yz);
+
+    /* a width of zero is one device pixel */
+    s.hw = (style->width > 0 ? style->width : 1 / (real)sqrt(fabs(s.det))) / 2;
+
+    /* enough segments for a circle of the width to be within the
+       flatness of the circle in device space */
+    r = m->xx * m->xx + m->yx * m->yx;
+    if (m->xy * m->xy + m->yy * m->yy > r)
+        r = m->xy * m->xy + m->yy * m->yy;
+    r = s.hw * (real)sqrt(r);
+    s.steps = XPOST_STROKE_MAX_STEPS;
+    if (style->flat > 0)
+    {
+        real steps;
+
+        steps = r > style->flat ? M_PI / acos(1 - style->flat / r) : 0;
+        if (steps < XPOST_STROKE_MIN_STEPS)
+            s.steps = XPOST_STROKE_MIN_STEPS;
+        else if (steps < XPOST_STROKE_MAX_STEPS)
+            s.steps = (int)ceil(steps);
+    }
+
+    s.sub.p = s.dash.p = NULL;
+    s.sub.n = s.dash.n = 0;
+    s.sub.max = s.dash.max = 0;
+
+    *out = null;
+    end = xpost_path_length(ctx, path);
+    for (off = 0; off < end; )
+    {
+        ret = xpost_path_get(ctx, path, &off, &verb, pts);
+        if (ret)
+            goto done;
+        switch (verb)
+        {
+            case XPOST_PATH_MOVE:
+                ret = _subpath(&s, 0, lone);
+                s.sub.n = 0;
+                lone = 1;
+                break;
+            case XPOST_PATH_CLOSE:
+                /* the closing segment ends at the start point, a
+                   line which follows starts there */
+                if (s.sub.n > 1 &&
+                    fabs(pts[0] - x) < XPOST_STROKE_EPSILON &&
+                    fabs(pts[1] - y) < XPOST_STROKE_EPSILON)
+                    s.sub.n--;
+                ret = _subpath(&s, 1, 0);
+                s.sub.n = 0;
+                lone = 1;
+                break;
+            default:
+                lone = 0;
+                if (fabs(pts[2 * XPOST_PATH_POINTS(verb) - 2] - x) < XPOST_STROKE_EPSILON &&
+                    fabs(pts[2 * XPOST_PATH_POINTS(verb) - 1] - y) < XPOST_STROKE_EPSILON)
+                    continue;
+                break;
+        }
+        if (ret)
+            goto done;
+
+        /* the end point, the start point for a close */
+        x = pts[2 * XPOST_PATH_POINTS(verb) - 2];
+        y = pts[2 * XPOST_PATH_POINTS(verb) - 1];
+        ret = _push(&s.sub,
+                    s.inv.xx * x + s.inv.xy * y + s.inv.xz,
+                    s.inv.yx * x + s.inv.yy * y + s.inv.yz);
+        if (ret)
+            goto done;
+    }
+    ret = _subpath(&s, 0, lone);
+
+done:
+    free(s.sub.p);
+    free(s.dash.p);
+    return ret;
+}
+
+int xpost_stroke_dash(Xpost_Context *ctx,
+                      Xpost_Object path,
+                      const Xpost_Stroke_Style *style,
+                      Xpost_Object *dashed)
+{
+    if (!style->ndash)
+    {
+        *dashed = path;
+        return 0;
+    }
+    return _stroke(ctx, path, style, _lines, dashed);
+}
+
+int xpost_stroke_path(Xpost_Context *ctx,
+                      Xpost_Object path,
+                      const Xpost_Stroke_Style *style,
+                      Xpost_Object *outline)
+{
+    return _stroke(ctx, path, style, _outline, outline);
+}
@@ -0,0 +1,112 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef XPOST_STROKE_H
+#define XPOST_STROKE_H
+
+/**
+ * @file xpost_stroke.h
+ * @brief stroke functions
+ *
+ * The stroker turns a flattened path (see xpost_path.h) into the
+ * outline of its stroke, as a path of closed polygons which, filled,
+ * paint the stroke: a quadrilateral for each segment, and a polygon
+ * for each join and each cap. The polygons overlap, and all turn
+ * counterclockwise in device space, so that they can be filled one
+ * by one as well as with the nonzero rule.
+ *
+ * The line width, the dash pattern and the round joins and caps are
+ * in user space: the points of the path are transformed back to user
+ * space by the CTM, stroked there, and the polygons transformed to
+ * device space, so a non uniform CTM gives elliptic round joins.
+ *
+ * @{
+ */
+
+/**
+ * @typedef Xpost_Stroke_Style
+ * @brief the parameters of the graphics state used by a stroke.
+ */
+typedef struct
+{
+    real width;       /**< the line width, in user space */
+    int cap;          /**< the line cap: 0 butt, 1 round, 2 square */
+    int join;         /**< the line join: 0 miter, 1 round, 2 bevel */
+    real miterlimit;  /**< the miter limit */
+    const real *dash; /**< the dash array, in user space */
+    int ndash;        /**< the length of the dash array, 0 for a solid line */
+    real dashoffset;  /**< the dash offset, in user space */
+    real flat;        /**< the flatness of round joins and caps, in device space */
+    Xpost_Matrix ctm; /**< the CTM */
+} Xpost_Stroke_Style;
+
+/**
+ * @brief Apply the dash pattern of a stroke style to a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The flattened path, or null.
+ * @param[in] style The stroke style.
+ * @param[out] dashed The path of the dashes, null if there is none.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * Each dash is an open subpath of lines. The dash pattern restarts
+ * with each subpath of @p path. With a solid line style, @p dashed
+ * is @p path itself.
+ */
+int xpost_stroke_dash(Xpost_Context *ctx,
+                      Xpost_Object path,
+                      const Xpost_Stroke_Style *style,
+                      Xpost_Object *dashed);
+
+/**
+ * @brief Return the outline of the stroke of a path.
+ *
+ * @param[in] ctx The context.
+ * @param[in] path The flattened path, or null.
+ * @param[in] style The stroke style.
+ * @param[out] outline The outline, null if the stroke paints nothing.
+ * @return 0 on success, a postscript error code otherwise.
+ *
+ * A curve of @p path is taken as a line to its end point. A subpath
+ * made of a single point, which is closed or has lines of length
+ * zero, paints a dot with round caps, and nothing otherwise. A width
+ * of zero gives a line of one device pixel.
+ */
+int xpost_stroke_path(Xpost_Context *ctx,
+                      Xpost_Object path,
+                      const Xpost_Stroke_Style *style,
+                      Xpost_Object *outline);
+
+/**
+ * @}
+ */
+
+#endif
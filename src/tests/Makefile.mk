@@ -5,8 +5,11 @@ src_tests_xpost_suite_SOURCES = \
 src/tests/xpost_suite.c \
 src/tests/xpost_suite.h \
 src/tests/xpost_test_main.c \
+src/tests/xpost_test_batch.c \
+src/tests/xpost_test_garbage.c \
 src/tests/xpost_test_memory.c \
-src/tests/xpost_test_stack.c
+src/tests/xpost_test_stack.c \
+src/tests/xpost_test_thread.c
 
 src_tests_xpost_suite_CPPFLAGS = \
 -I$(top_srcdir)/src/lib \
@@ -20,4 +23,5 @@ src_tests_xpost_suite_CFLAGS = \
 src_tests_xpost_suite_LDADD = \
 $(top_builddir)/src/lib/libxpost.la \
 @CHECK_LIBS@ \
+@XPOST_TEST_LIBS@ \
 @XPOST_COV_LIBS@
@@ -49,7 +49,10 @@ typedef struct
 static const Xpost_Test_Case _tests[] = {
     { "Main", xpost_test_main },
     { "Memory", xpost_test_memory },
+    { "Garbage", xpost_test_garbage },
     { "Stack", xpost_test_stack },
+    { "Thread", xpost_test_thread },
+    { "Batch", xpost_test_batch },
     { NULL, NULL }
 };
 
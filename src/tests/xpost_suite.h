@@ -34,6 +34,9 @@
 
 void xpost_test_main(TCase *tc);
 void xpost_test_memory(TCase *tc);
+void xpost_test_garbage(TCase *tc);
 void xpost_test_stack(TCase *tc);
+void xpost_test_thread(TCase *tc);
+void xpost_test_batch(TCase *tc);
 
 #endif
@@ -0,0 +1,100 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * Copyright (C) 2013-2016, Vincent Torri
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <check.h>
+
+#include "xpost.h"
+
+#include "xpost_suite.h"
+
+#define XPOST_TEST_BATCH_WIDTH 64
+#define XPOST_TEST_BATCH_HEIGHT 64
+#define XPOST_TEST_BATCH_BUFFER_SIZE \
+    (XPOST_TEST_BATCH_WIDTH * XPOST_TEST_BATCH_HEIGHT * 3)
+
+/* more jobs than the signatures an operator may have, as each job
+   loads the device again after the previous one has been restored */
+#define XPOST_TEST_BATCH_JOBS 12
+
+static const char _xpost_test_batch_job[] =
+    "0 1 0 setrgbcolor 8 8 48 48 rectfill 1 setgray 24 24 16 16 rectfill showpage";
+
+START_TEST(xpost_batch_warm_worker)
+{
+    Xpost_Batch_Job jobs[XPOST_TEST_BATCH_JOBS];
+    unsigned char *out[XPOST_TEST_BATCH_JOBS];
+    int i;
+
+    ck_assert_int_ne(xpost_init(), 0);
+
+    for (i = 0; i < XPOST_TEST_BATCH_JOBS; i++)
+    {
+        out[i] = NULL;
+        jobs[i].input_type = XPOST_INPUT_STRING;
+        jobs[i].inputptr = _xpost_test_batch_job;
+        jobs[i].size = 0;
+        jobs[i].output_type = XPOST_OUTPUT_BUFFEROUT;
+        jobs[i].outputptr = &out[i];
+    }
+
+    ck_assert_int_eq(xpost_batch_run("bgr",
+                                     XPOST_OUTPUT_MESSAGE_QUIET,
+                                     XPOST_USE_SIZE,
+                                     XPOST_TEST_BATCH_WIDTH,
+                                     XPOST_TEST_BATCH_HEIGHT,
+                                     jobs, XPOST_TEST_BATCH_JOBS, 1),
+                     XPOST_TEST_BATCH_JOBS);
+
+    for (i = 0; i < XPOST_TEST_BATCH_JOBS; i++)
+    {
+        ck_assert_int_eq(jobs[i].status, 0);
+        ck_assert_int_eq(jobs[i].worker, 0);
+        ck_assert_msg(out[i] != NULL, "job %d renders no page", i);
+        ck_assert_msg(memcmp(out[i], out[0],
+                             XPOST_TEST_BATCH_BUFFER_SIZE) == 0,
+                      "job %d renders differently", i);
+    }
+
+    xpost_quit();
+}
+END_TEST
+
+void xpost_test_batch(TCase *tc)
+{
+    tcase_add_test(tc, xpost_batch_warm_worker);
+}
@@ -0,0 +1,136 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * Copyright (C) 2013-2016, Vincent Torri
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <check.h>
+
+#include "xpost.h"
+#include "xpost_memory.h"
+#include "xpost_object.h"
+#include "xpost_stack.h"
+#include "xpost_context.h"
+#include "xpost_free.h"
+
+#include "xpost_suite.h"
+
+/* allocate garbage in global vm, and keep a few objects alive in
+   globaldict, which a collection must not free */
+static const char *_xpost_test_garbage_churn =
+    "true setglobal "
+    "globaldict /keep known not { globaldict /keep 10 dict put } if "
+    "0 1 3000 { /i exch def "
+    "  100 array pop "
+    "  (some string to churn) 64 string copy pop "
+    "  20 dict dup /a 1 put pop "
+    "  globaldict /keep get i 10 mod [ i 50 string ] put "
+    "} for "
+    "false setglobal";
+
+#define XPOST_TEST_GARBAGE_ROUNDS 10
+
+static Xpost_Context *
+_xpost_test_garbage_create(void)
+{
+    return xpost_create("null",
+                        XPOST_OUTPUT_DEFAULT,
+                        NULL,
+                        XPOST_SHOWPAGE_NOPAUSE,
+                        XPOST_OUTPUT_MESSAGE_QUIET,
+                        XPOST_IGNORE_SIZE,
+                        0, 0,
+                        0, 0);
+}
+
+START_TEST(xpost_garbage_global_automatic)
+{
+    Xpost_Context *ctx;
+    unsigned int used;
+    int i;
+
+    ck_assert_int_ne(xpost_init(), 0);
+    ctx = _xpost_test_garbage_create();
+    ck_assert(ctx != NULL);
+
+    xpost_run(ctx, XPOST_INPUT_STRING, _xpost_test_garbage_churn, 0);
+    used = ctx->gl->used;
+    for (i = 1; i < XPOST_TEST_GARBAGE_ROUNDS; i++)
+        xpost_run(ctx, XPOST_INPUT_STRING, _xpost_test_garbage_churn, 0);
+
+    /* without global collections, each round adds several MB */
+    ck_assert_msg(ctx->gl->used < used + 2 * XPOST_GARBAGE_COLLECTION_GLOBAL_THRESHOLD,
+                  "global vm grows from %u to %u bytes", used, ctx->gl->used);
+
+    xpost_destroy(ctx);
+    xpost_quit();
+}
+END_TEST
+
+START_TEST(xpost_garbage_global_vmreclaim)
+{
+    Xpost_Context *ctx;
+    unsigned int used;
+    unsigned int max;
+    int i;
+
+    ck_assert_int_ne(xpost_init(), 0);
+    ctx = _xpost_test_garbage_create();
+    ck_assert(ctx != NULL);
+
+    xpost_run(ctx, XPOST_INPUT_STRING, _xpost_test_garbage_churn, 0);
+    xpost_run(ctx, XPOST_INPUT_STRING, "2 vmreclaim", 0);
+    used = ctx->gl->used;
+    max = ctx->gl->max;
+    for (i = 1; i < XPOST_TEST_GARBAGE_ROUNDS; i++)
+    {
+        xpost_run(ctx, XPOST_INPUT_STRING, _xpost_test_garbage_churn, 0);
+        xpost_run(ctx, XPOST_INPUT_STRING, "2 vmreclaim", 0);
+    }
+
+    /* only the replaced objects of keep are left over from each round */
+    ck_assert_msg(ctx->gl->used < used + 4096,
+                  "global vm grows from %u to %u bytes", used, ctx->gl->used);
+    ck_assert_uint_eq(ctx->gl->max, max);
+
+    xpost_destroy(ctx);
+    xpost_quit();
+}
+END_TEST
+
+void xpost_test_garbage(TCase *tc)
+{
+    tcase_add_test(tc, xpost_garbage_global_automatic);
+    tcase_add_test(tc, xpost_garbage_global_vmreclaim);
+}
@@ -41,6 +41,7 @@
 #include "xpost.h"
 #include "xpost_log.h"
 #include "xpost_memory.h"
+#include "xpost_free.h"
 
 #include "xpost_suite.h"
 
@@ -187,6 +188,68 @@ START_TEST(xpost_memory_tab_alloc)
 }
 END_TEST
 
+static int
+_xpost_test_memory_get_initializing(void)
+{
+    return 0;
+}
+
+START_TEST(xpost_memory_free_list)
+{
+    Xpost_Memory_File mem = {0};
+    unsigned int sizes[] = { 16, 24, 600, 800, 5000 };
+    unsigned int ents[ sizeof sizes / sizeof sizes[0] ];
+    unsigned int ent;
+    unsigned int i;
+    int ret;
+
+    xpost_init();
+
+    ret = xpost_memory_file_init(&mem, NULL, -1, NULL,
+                                 _xpost_test_memory_get_initializing, NULL);
+    ck_assert_int_eq (ret, 1);
+    ret = xpost_memory_table_init(&mem);
+    ck_assert_int_eq (ret, 1);
+    ret = xpost_free_init(&mem);
+    ck_assert_int_eq (ret, 1);
+
+    for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+    {
+        ret = xpost_memory_table_alloc(&mem, sizes[i], 0, &ents[i]);
+        ck_assert_int_eq (ret, 1);
+    }
+    for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+    {
+        ret = xpost_free_memory_ent(&mem, ents[i]);
+        ck_assert_int_eq (ret, sizes[i]);
+    }
+
+    /* exact size class */
+    ret = xpost_memory_table_alloc(&mem, 24, 0, &ent);
+    ck_assert_int_eq (ret, 1);
+    ck_assert_int_eq (ent, ents[1]);
+    /* best fit of a large class */
+    ret = xpost_memory_table_alloc(&mem, 700, 0, &ent);
+    ck_assert_int_eq (ret, 1);
+    ck_assert_int_eq (ent, ents[3]);
+    ret = xpost_memory_table_alloc(&mem, 16, 0, &ent);
+    ck_assert_int_eq (ret, 1);
+    ck_assert_int_eq (ent, ents[0]);
+    /* too big to be reused */
+    ret = xpost_memory_table_alloc(&mem, 3000, 0, &ent);
+    ck_assert_int_eq (ret, 1);
+    ck_assert(ent != ents[4]);
+    ret = xpost_memory_table_alloc(&mem, 4000, 0, &ent);
+    ck_assert_int_eq (ret, 1);
+    ck_assert_int_eq (ent, ents[4]);
+
+    ret = xpost_memory_file_exit(&mem);
+    ck_assert_int_eq (ret, 1);
+
+    xpost_quit();
+}
+END_TEST
+
 void xpost_test_memory(TCase *tc)
 {
     tcase_add_test(tc, xpost_memory_init_simple);
@@ -195,4 +258,5 @@ void xpost_test_memory(TCase *tc)
     tcase_add_test(tc, xpost_memory_grow);
     tcase_add_test(tc, xpost_memory_tab_init);
     tcase_add_test(tc, xpost_memory_tab_alloc);
+    tcase_add_test(tc, xpost_memory_free_list);
 }
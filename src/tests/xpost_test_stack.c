@@ -111,8 +111,70 @@ START_TEST(xpost_stack_push_pop)
 }
 END_TEST
 
+START_TEST(xpost_stack_count_topdown)
+{
+    Xpost_Memory_File mem;
+    unsigned int stack;
+    int segsize = XPOST_STACK_SEGMENT_SIZE;
+    int n = 2 * segsize + 5;
+    int i;
+    Xpost_Object obj;
+    int ret;
+
+    xpost_init();
+
+    memset(&mem, 0, sizeof(Xpost_Memory_File));
+    ret = xpost_memory_file_init(&mem, NULL, -1, NULL, NULL, NULL);
+    ck_assert_int_eq (ret, 1);
+    ck_assert(mem.base != NULL);
+
+    ret = xpost_stack_init(&mem, &stack);
+    ck_assert_int_eq (ret, 1);
+    ck_assert_int_eq (xpost_stack_count(&mem, stack), 0);
+
+    for (i = 0; i < n; i++)
+    {
+        ret = xpost_stack_push(&mem, stack, xpost_int_cons(i));
+        ck_assert_int_eq (ret, 1);
+        ck_assert_int_eq (xpost_stack_count(&mem, stack), i + 1);
+    }
+
+    /* index across the segments */
+    for (i = 0; i < n; i++)
+    {
+        obj = xpost_stack_topdown_fetch(&mem, stack, i);
+        ck_assert_int_eq (xpost_object_get_type(obj), integertype);
+        ck_assert_int_eq (obj.int_.val, n - 1 - i);
+    }
+    obj = xpost_stack_topdown_fetch(&mem, stack, n);
+    ck_assert_int_eq (xpost_object_get_type(obj), invalidtype);
+
+    ret = xpost_stack_topdown_replace(&mem, stack, n - 1, xpost_int_cons(-1));
+    ck_assert_int_eq (ret, 1);
+    obj = xpost_stack_bottomup_fetch(&mem, stack, 0);
+    ck_assert_int_eq (obj.int_.val, -1);
+
+    /* drop down into the first segment */
+    xpost_stack_discard(&mem, stack, segsize + 10);
+    ck_assert_int_eq (xpost_stack_count(&mem, stack), n - segsize - 10);
+    obj = xpost_stack_pop(&mem, stack);
+    ck_assert_int_eq (obj.int_.val, n - segsize - 11);
+
+    xpost_stack_clear(&mem, stack);
+    ck_assert_int_eq (xpost_stack_count(&mem, stack), 0);
+    obj = xpost_stack_pop(&mem, stack);
+    ck_assert_int_eq (xpost_object_get_type(obj), invalidtype);
+
+    ret = xpost_memory_file_exit(&mem);
+    ck_assert_int_eq (ret, 1);
+
+    xpost_quit();
+}
+END_TEST
+
 void xpost_test_stack(TCase *tc)
 {
     tcase_add_test(tc, xpost_stack);
     tcase_add_test(tc, xpost_stack_push_pop);
+    tcase_add_test(tc, xpost_stack_count_topdown);
 }
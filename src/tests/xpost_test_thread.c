@@ -0,0 +1,188 @@
+/*
+ * Xpost - a Level-2 Postscript interpreter
+ * Copyright (C) 2013-2016, Michael Joshua Ryan
+ * Copyright (C) 2013-2016, Vincent Torri
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of the Xpost software product nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#include <check.h>
+
+#include "xpost.h"
+
+#include "xpost_suite.h"
+
+#ifdef HAVE_PTHREAD_H
+
+#define XPOST_TEST_THREAD_WIDTH 64
+#define XPOST_TEST_THREAD_HEIGHT 64
+#define XPOST_TEST_THREAD_BUFFER_SIZE \
+    (XPOST_TEST_THREAD_WIDTH * XPOST_TEST_THREAD_HEIGHT * 3)
+
+/* each job draws something different, so that an instance which
+   sees the state of another one renders a wrong page */
+static const char *_xpost_test_thread_jobs[] =
+{
+    "0 0 moveto 64 64 lineto 64 0 lineto closepath fill showpage",
+    "1 0 0 setrgbcolor 32 32 24 0 360 arc fill showpage",
+    "0 0 1 setrgbcolor 8 setlinewidth 4 32 moveto 60 32 lineto stroke showpage",
+    "0 1 0 setrgbcolor 8 8 48 48 rectfill 1 setgray 24 24 16 16 rectfill showpage",
+    "/Helvetica findfont 24 scalefont setfont 4 24 moveto (xp) show showpage",
+    "gsave 32 32 translate 30 rotate -16 -16 32 32 rectfill grestore showpage"
+};
+
+#define XPOST_TEST_THREAD_JOBS \
+    (int)(sizeof(_xpost_test_thread_jobs) / sizeof(_xpost_test_thread_jobs[0]))
+
+/* rounds of all the jobs run by each thread */
+#define XPOST_TEST_THREAD_ROUNDS 2
+
+typedef struct
+{
+    int first; /* job of the first round of the thread */
+    int rendered[XPOST_TEST_THREAD_JOBS];
+    unsigned char buffer[XPOST_TEST_THREAD_JOBS][XPOST_TEST_THREAD_BUFFER_SIZE];
+} Xpost_Test_Thread;
+
+static Xpost_Test_Thread _xpost_test_thread_serial;
+static Xpost_Test_Thread _xpost_test_thread_parallel[XPOST_TEST_THREAD_JOBS];
+
+/* render a job with a new interpreter and keep the page */
+static int
+_xpost_test_thread_render(const char *ps, unsigned char *buffer)
+{
+    Xpost_Context *ctx;
+    unsigned char *out = NULL;
+
+    ctx = xpost_create("bgr",
+                       XPOST_OUTPUT_BUFFEROUT,
+                       &out,
+                       XPOST_SHOWPAGE_RETURN,
+                       XPOST_OUTPUT_MESSAGE_QUIET,
+                       XPOST_USE_SIZE,
+                       XPOST_TEST_THREAD_WIDTH,
+                       XPOST_TEST_THREAD_HEIGHT,
+                       0, 0);
+    if (!ctx)
+        return 0;
+
+    xpost_run(ctx, XPOST_INPUT_STRING, ps, 0);
+    if (out)
+        memcpy(buffer, out, XPOST_TEST_THREAD_BUFFER_SIZE);
+    xpost_destroy(ctx);
+
+    return out != NULL;
+}
+
+/* run all the jobs, starting at a different one in each thread,
+   so that the threads run different jobs at the same time */
+static void *
+_xpost_test_thread_run(void *data)
+{
+    Xpost_Test_Thread *thread = data;
+    int round;
+    int i;
+
+    for (round = 0; round < XPOST_TEST_THREAD_ROUNDS; round++)
+    {
+        for (i = 0; i < XPOST_TEST_THREAD_JOBS; i++)
+        {
+            int job = (thread->first + i) % XPOST_TEST_THREAD_JOBS;
+
+            thread->rendered[job] =
+                _xpost_test_thread_render(_xpost_test_thread_jobs[job],
+                                          thread->buffer[job]);
+        }
+    }
+    xpost_thread_quit();
+
+    return NULL;
+}
+
+START_TEST(xpost_thread_parallel_jobs)
+{
+    pthread_t threads[XPOST_TEST_THREAD_JOBS];
+    int i;
+    int job;
+
+    ck_assert_int_ne(xpost_init(), 0);
+
+    /* the expected pages, from serial runs */
+    for (job = 0; job < XPOST_TEST_THREAD_JOBS; job++)
+    {
+        _xpost_test_thread_serial.rendered[job] =
+            _xpost_test_thread_render(_xpost_test_thread_jobs[job],
+                                      _xpost_test_thread_serial.buffer[job]);
+        ck_assert_int_eq(_xpost_test_thread_serial.rendered[job], 1);
+    }
+
+    for (i = 0; i < XPOST_TEST_THREAD_JOBS; i++)
+    {
+        _xpost_test_thread_parallel[i].first = i;
+        ck_assert_int_eq(pthread_create(&threads[i], NULL,
+                                        _xpost_test_thread_run,
+                                        &_xpost_test_thread_parallel[i]), 0);
+    }
+    for (i = 0; i < XPOST_TEST_THREAD_JOBS; i++)
+        ck_assert_int_eq(pthread_join(threads[i], NULL), 0);
+
+    for (i = 0; i < XPOST_TEST_THREAD_JOBS; i++)
+    {
+        for (job = 0; job < XPOST_TEST_THREAD_JOBS; job++)
+        {
+            ck_assert_int_eq(_xpost_test_thread_parallel[i].rendered[job], 1);
+            ck_assert_msg(memcmp(_xpost_test_thread_parallel[i].buffer[job],
+                                 _xpost_test_thread_serial.buffer[job],
+                                 XPOST_TEST_THREAD_BUFFER_SIZE) == 0,
+                          "thread %d renders job %d differently", i, job);
+        }
+    }
+
+    xpost_quit();
+}
+END_TEST
+
+#endif
+
+void xpost_test_thread(TCase *tc)
+{
+#ifdef HAVE_PTHREAD_H
+    tcase_add_test(tc, xpost_thread_parallel_jobs);
+#else
+    (void)tc;
+#endif
+}